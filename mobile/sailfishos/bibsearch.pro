@@ -6,6 +6,7 @@ SOURCES += src/main.cpp src/searchenginelist.cpp \
     src/bibliographymodel.cpp ../../src/data/value.cpp \
     ../../src/data/entry.cpp ../../src/data/macro.cpp \
     ../../src/data/comment.cpp ../../src/data/file.cpp \
+    ../../src/data/completionindex.cpp \
     ../../src/data/preamble.cpp ../../src/data/element.cpp \
     ../../src/networking/internalnetworkaccessmanager.cpp \
     ../../src/networking/onlinesearch/onlinesearchabstract.cpp \
@@ -35,6 +36,7 @@ HEADERS += src/bibliographymodel.h src/searchenginelist.h \
     src/kbibtexnamespace.h ../../src/data/entry.h \
     ../../src/data/macro.h ../../src/data/comment.h \
     ../../src/data/file.h ../../src/data/preamble.h \
+    ../../src/data/completionindex.h \
     ../../src/data/value.h ../../src/data/element.h \
     ../../src/networking/internalnetworkaccessmanager.h \
     ../../src/networking/onlinesearch/onlinesearchabstract.h \
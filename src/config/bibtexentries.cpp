@@ -18,6 +18,7 @@
 #include "bibtexentries.h"
 
 #include <QStandardPaths>
+#include <QHash>
 
 #ifdef HAVE_KF5
 #include <KLocalizedString>
@@ -50,6 +51,13 @@ public:
     KSharedConfigPtr layoutConfig;
 #endif // HAVE_KF5
 
+    /// Position of an entry type's description in the list, by lower-case
+    /// entry type name (upperCamelCase only)
+    QHash<QString, int> indexByName;
+    /// Position of an entry type's description in the list, by lower-case
+    /// entry type name or alternative name (upperCamelCaseAlt)
+    QHash<QString, int> indexByNameOrAlt;
+
     static BibTeXEntries *singleton;
 
     BibTeXEntriesPrivate(BibTeXEntries *parent)
@@ -95,8 +103,38 @@ public:
         }
 
         if (p->isEmpty()) qCWarning(LOG_KBIBTEX_CONFIG) << "List of entry descriptions is empty";
+
+        buildIndex();
+    }
+#endif // HAVE_KF5
+
+    /**
+     * Build the lookup tables used by @see BibTeXEntries::format,
+     * @see BibTeXEntries::label, and @see BibTeXEntries::xmappings.
+     * Has to be called whenever the list of entry descriptions changes.
+     */
+    void buildIndex() {
+        indexByName.clear();
+        indexByNameOrAlt.clear();
+        indexByName.reserve(p->count());
+        indexByNameOrAlt.reserve(p->count() * 2);
+
+        int index = 0;
+        for (const auto &ed : const_cast<const BibTeXEntries &>(*p)) {
+            /// First description wins, as a linear search would have returned it
+            const QString iName = ed.upperCamelCase.toLower();
+            if (!indexByName.contains(iName))
+                indexByName.insert(iName, index);
+            if (!indexByNameOrAlt.contains(iName))
+                indexByNameOrAlt.insert(iName, index);
+            const QString iNameAlt = ed.upperCamelCaseAlt.toLower();
+            if (!iNameAlt.isEmpty() && !indexByNameOrAlt.contains(iNameAlt))
+                indexByNameOrAlt.insert(iNameAlt, index);
+            ++index;
+        }
     }
 
+#ifdef HAVE_KF5
     void save() {
         int typeCount = 0;
         for (const EntryDescription &ed : const_cast<const BibTeXEntries &>(*p)) {
@@ -160,28 +198,20 @@ QString BibTeXEntries::format(const QString &name, KBibTeX::Casing casing) const
         iName[0] = iName[0].toUpper();
         return iName;
     case KBibTeX::cLowerCamelCase: {
-        for (const auto &ed : const_cast<const BibTeXEntries &>(*this)) {
-            /// configuration file uses camel-case
-            QString itName = ed.upperCamelCase.toLower();
-            if (itName == iName) {
-                iName = ed.upperCamelCase;
-                break;
-            }
-        }
+        /// configuration file uses camel-case
+        const auto it = d->indexByName.constFind(iName);
+        if (it != d->indexByName.constEnd())
+            iName = at(*it).upperCamelCase;
 
         /// make an educated guess how camel-case would look like
         iName[0] = iName[0].toLower();
         return iName;
     }
     case KBibTeX::cUpperCamelCase: {
-        for (const auto &ed : const_cast<const BibTeXEntries &>(*this)) {
-            /// configuration file uses camel-case
-            QString itName = ed.upperCamelCase.toLower();
-            if (itName == iName) {
-                iName = ed.upperCamelCase;
-                break;
-            }
-        }
+        /// configuration file uses camel-case
+        const auto it = d->indexByName.constFind(iName);
+        if (it != d->indexByName.constEnd())
+            return at(*it).upperCamelCase;
 
         /// make an educated guess how camel-case would look like
         iName[0] = iName[0].toUpper();
@@ -193,26 +223,16 @@ QString BibTeXEntries::format(const QString &name, KBibTeX::Casing casing) const
 
 QString BibTeXEntries::label(const QString &name) const
 {
-    const QString iName = name.toLower();
-
-    for (const auto &ed : const_cast<const BibTeXEntries &>(*this)) {
-        /// Configuration file uses camel-case, convert this to lower case for faster comparison
-        QString itName = ed.upperCamelCase.toLower();
-        if (itName == iName || (!(itName = ed.upperCamelCaseAlt.toLower()).isEmpty() && itName == iName))
-            return ed.label;
-    }
+    const auto it = d->indexByNameOrAlt.constFind(name.toLower());
+    if (it != d->indexByNameOrAlt.constEnd())
+        return at(*it).label;
     return QString();
 }
 
 QMap<QString, QString> BibTeXEntries::xmappings(const QString &name) const
 {
-    const QString iName = name.toLower();
-
-    for (ConstIterator it = begin(); it != end(); ++it) {
-        /// Configuration file uses camel-case, convert this to lower case for faster comparison
-        QString itName = (*it).upperCamelCase.toLower();
-        if (itName == iName || (!(itName = (*it).upperCamelCaseAlt.toLower()).isEmpty() && itName == iName))
-            return (*it).crossrefMappings;
-    }
+    const auto it = d->indexByNameOrAlt.constFind(name.toLower());
+    if (it != d->indexByNameOrAlt.constEnd())
+        return at(*it).crossrefMappings;
     return QMap<QString, QString>();
 }
@@ -19,6 +19,7 @@
 
 #include <QExplicitlySharedDataPointer>
 #include <QStandardPaths>
+#include <QHash>
 
 #ifdef HAVE_KF5
 #include <KSharedConfig>
@@ -50,6 +51,12 @@ public:
     KSharedConfigPtr layoutConfig;
 #endif // HAVE_KF5
 
+    /// Position of a field's description in the list, by lower-case field name;
+    /// fields having an alternative name (upperCamelCaseAlt) are not included
+    QHash<QString, int> indexByName;
+    /// Field names in lower camel case, by lower-case field name
+    QHash<QString, QString> lowerCamelCaseByName;
+
     static BibTeXFields *singleton;
 
     BibTeXFieldsPrivate(BibTeXFields *parent)
@@ -115,8 +122,39 @@ public:
         }
 
         if (p->isEmpty()) qCWarning(LOG_KBIBTEX_CONFIG) << "List of field descriptions is empty after load()";
+
+        buildIndex();
     }
+#endif // HAVE_KF5
 
+    /**
+     * Build the lookup tables used by @see BibTeXFields::find and
+     * @see BibTeXFields::format. Has to be called whenever the list
+     * of field descriptions or their names change.
+     */
+    void buildIndex() {
+        indexByName.clear();
+        lowerCamelCaseByName.clear();
+        indexByName.reserve(p->count());
+        lowerCamelCaseByName.reserve(p->count());
+
+        int index = 0;
+        for (const auto &fd : const_cast<const BibTeXFields &>(*p)) {
+            if (fd.upperCamelCaseAlt.isEmpty()) {
+                const QString iName = fd.upperCamelCase.toLower();
+                /// First description wins, as a linear search would have returned it
+                if (!indexByName.contains(iName)) {
+                    indexByName.insert(iName, index);
+                    QString lowerCamelCase = fd.upperCamelCase;
+                    lowerCamelCase[0] = lowerCamelCase[0].toLower();
+                    lowerCamelCaseByName.insert(iName, lowerCamelCase);
+                }
+            }
+            ++index;
+        }
+    }
+
+#ifdef HAVE_KF5
     void save() {
         if (p->isEmpty()) qCWarning(LOG_KBIBTEX_CONFIG) << "List of field descriptions is empty before save()";
 
@@ -207,28 +245,20 @@ QString BibTeXFields::format(const QString &name, KBibTeX::Casing casing) const
         iName[0] = iName[0].toUpper();
         return iName;
     case KBibTeX::cLowerCamelCase: {
-        for (const auto &fd : const_cast<const BibTeXFields &>(*this)) {
-            /// configuration file uses camel-case
-            QString itName = fd.upperCamelCase.toLower();
-            if (itName == iName && fd.upperCamelCaseAlt.isEmpty()) {
-                iName = fd.upperCamelCase;
-                break;
-            }
-        }
+        /// configuration file uses camel-case
+        const auto it = d->lowerCamelCaseByName.constFind(iName);
+        if (it != d->lowerCamelCaseByName.constEnd())
+            return *it;
 
         /// make an educated guess how camel-case would look like
         iName[0] = iName[0].toLower();
         return iName;
     }
     case KBibTeX::cUpperCamelCase: {
-        for (const auto &fd : const_cast<const BibTeXFields &>(*this)) {
-            /// configuration file uses camel-case
-            QString itName = fd.upperCamelCase.toLower();
-            if (itName == iName && fd.upperCamelCaseAlt.isEmpty()) {
-                iName = fd.upperCamelCase;
-                break;
-            }
-        }
+        /// configuration file uses camel-case
+        const auto it = d->indexByName.constFind(iName);
+        if (it != d->indexByName.constEnd())
+            return at(*it).upperCamelCase;
 
         /// make an educated guess how camel-case would look like
         iName[0] = iName[0].toUpper();
@@ -241,10 +271,9 @@ QString BibTeXFields::format(const QString &name, KBibTeX::Casing casing) const
 const FieldDescription BibTeXFields::find(const QString &name) const
 {
     const QString iName = name.toLower();
-    for (const auto &fd : const_cast<const BibTeXFields &>(*this)) {
-        if (fd.upperCamelCase.toLower() == iName && fd.upperCamelCaseAlt.isEmpty())
-            return fd;
-    }
+    const auto it = d->indexByName.constFind(iName);
+    if (it != d->indexByName.constEnd())
+        return at(*it);
     qCWarning(LOG_KBIBTEX_CONFIG) << "No field description for " << name << "(" << iName << ")";
     return FieldDescription {QString(), QString(), QString(), KBibTeX::tfSource, KBibTeX::tfSource, 0, {}, false, false};
 }
@@ -0,0 +1,237 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "completionindex.h"
+
+#ifdef HAVE_KF5
+#include <KSharedConfig>
+#include <KConfigGroup>
+#endif // HAVE_KF5
+
+#include "preferences.h"
+#include "entry.h"
+#include "macro.h"
+#include "value.h"
+
+/// Pseudo field names under which keys are indexed
+static const QString keyEntryId = QStringLiteral("^id");
+static const QString keyMacro = QStringLiteral("^macro");
+
+class CompletionIndex::Private
+{
+public:
+    const File *file;
+    bool isBuilt;
+
+    /// Texts an element contributed to the index as (field, text) pairs,
+    /// required to remove them again once the element changes
+    typedef QVector<QPair<QString, QString> > Contributions;
+    QHash<const Element *, Contributions> contributions;
+    /// Per (lower-case) field: number of elements each text occurs in
+    QHash<QString, QHash<QString, int> > counts;
+    /// Sorted lists computed on demand, dropped when their field changes
+    mutable QHash<QString, QStringList> sortedValues;
+    mutable QHash<QString, QStringList> completionLists;
+
+    Private(const File *f)
+            : file(f), isBuilt(false) {
+        /// nothing
+    }
+
+    static Contributions contributionsOf(const QSharedPointer<Element> &element) {
+        Contributions result;
+        const QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
+        if (!entry.isNull()) {
+            result.append(qMakePair(keyEntryId, entry->id()));
+            for (Entry::ConstIterator it = entry->constBegin(); it != entry->constEnd(); ++it) {
+                const QString lcFieldName = it.key().toLower();
+                for (const QSharedPointer<ValueItem> &valueItem : it.value()) {
+                    const QStringList texts = valueItemTexts(valueItem);
+                    for (const QString &text : texts)
+                        result.append(qMakePair(lcFieldName, text));
+                }
+            }
+        } else {
+            const QSharedPointer<const Macro> macro = element.dynamicCast<const Macro>();
+            if (!macro.isNull())
+                result.append(qMakePair(keyMacro, macro->key()));
+        }
+        return result;
+    }
+
+    void fieldChanged(const QString &lcFieldName) {
+        sortedValues.remove(lcFieldName);
+        if (lcFieldName == keyMacro)
+            /// Macro keys are part of every field's completions
+            completionLists.clear();
+        else if (lcFieldName == keyEntryId)
+            completionLists.remove(Entry::ftCrossRef);
+        else
+            completionLists.remove(lcFieldName);
+    }
+
+    void add(const QSharedPointer<Element> &element) {
+        const Contributions c = contributionsOf(element);
+        if (c.isEmpty()) return;
+        for (const auto &pair : c)
+            if (++counts[pair.first][pair.second] == 1)
+                fieldChanged(pair.first);
+        contributions.insert(element.data(), c);
+    }
+
+    void remove(const Element *element) {
+        const QHash<const Element *, Contributions>::Iterator cit = contributions.find(element);
+        if (cit == contributions.end()) return;
+        for (const auto &pair : const_cast<const Contributions &>(*cit)) {
+            QHash<QString, int> &fieldCounts = counts[pair.first];
+            const QHash<QString, int>::Iterator it = fieldCounts.find(pair.second);
+            if (it != fieldCounts.end() && --(*it) <= 0) {
+                fieldCounts.erase(it);
+                fieldChanged(pair.first);
+            }
+        }
+        contributions.erase(cit);
+    }
+
+    void clear() {
+        contributions.clear();
+        counts.clear();
+        sortedValues.clear();
+        completionLists.clear();
+        isBuilt = false;
+    }
+
+    void ensureBuilt() {
+        if (isBuilt) return;
+        isBuilt = true;
+        if (file == nullptr) return;
+        contributions.reserve(file->count());
+        for (const auto &element : const_cast<const File &>(*file))
+            add(element);
+    }
+
+    QStringList sorted(const QString &lcFieldName) const {
+        QHash<QString, QStringList>::Iterator it = sortedValues.find(lcFieldName);
+        if (it == sortedValues.end()) {
+            QStringList list = counts.value(lcFieldName).keys();
+            list.sort();
+            it = sortedValues.insert(lcFieldName, list);
+        }
+        return *it;
+    }
+};
+
+CompletionIndex::CompletionIndex(const File *file)
+        : d(new CompletionIndex::Private(file))
+{
+    /// nothing
+}
+
+CompletionIndex::~CompletionIndex()
+{
+    delete d;
+}
+
+QStringList CompletionIndex::values(const QString &fieldName) const
+{
+    d->ensureBuilt();
+    return d->sorted(fieldName.toLower());
+}
+
+QStringList CompletionIndex::keys(File::ElementTypes elementTypes) const
+{
+    d->ensureBuilt();
+    if (elementTypes == File::etEntry)
+        return d->sorted(keyEntryId);
+    else if (elementTypes == File::etMacro)
+        return d->sorted(keyMacro);
+
+    QStringList result = d->sorted(keyEntryId) + d->sorted(keyMacro);
+    result.sort();
+    return result;
+}
+
+QStringList CompletionIndex::completions(const QString &fieldName) const
+{
+    d->ensureBuilt();
+    const QString lcFieldName = fieldName.toLower();
+    QHash<QString, QStringList>::Iterator it = d->completionLists.find(lcFieldName);
+    if (it == d->completionLists.end()) {
+        QStringList list = d->sorted(lcFieldName);
+        /// for crossref fields, add all entries' ids
+        if (lcFieldName == Entry::ftCrossRef)
+            list.append(d->sorted(keyEntryId));
+        /// add macro keys
+        list.append(d->sorted(keyMacro));
+        it = d->completionLists.insert(lcFieldName, list);
+    }
+    return *it;
+}
+
+void CompletionIndex::updateElement(const QSharedPointer<Element> &element)
+{
+    /// Changes before the index got built will be picked up when building it
+    if (!d->isBuilt) return;
+    d->remove(element.data());
+    d->add(element);
+}
+
+void CompletionIndex::removeElement(const QSharedPointer<Element> &element)
+{
+    if (!d->isBuilt) return;
+    d->remove(element.data());
+}
+
+void CompletionIndex::invalidate()
+{
+    d->clear();
+}
+
+QStringList CompletionIndex::valueItemTexts(const QSharedPointer<ValueItem> &valueItem)
+{
+    /// Check if ValueItem to process points to a person
+    const QSharedPointer<Person> person = valueItem.dynamicCast<Person>();
+    if (!person.isNull()) {
+        /// Assemble a list of formatting templates for a person's name
+        static QStringList personNameFormattingList; ///< use static to do pattern assembly only once
+        if (personNameFormattingList.isEmpty()) {
+            /// Use the two default patterns last-name-first and first-name-first
+#ifdef HAVE_KF5
+            personNameFormattingList << Preferences::personNameFormatLastFirst << Preferences::personNameFormatFirstLast;
+            /// Check configuration if user-specified formatting template is different
+            KSharedConfigPtr config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc")));
+            KConfigGroup configGroup(config, "General");
+            QString personNameFormatting = configGroup.readEntry(Preferences::keyPersonNameFormatting, Preferences::defaultPersonNameFormatting);
+            /// Add user's template if it differs from the two specified above
+            if (!personNameFormattingList.contains(personNameFormatting))
+                personNameFormattingList << personNameFormatting;
+#else // HAVE_KF5
+            personNameFormattingList << QStringLiteral("<%l><, %s><, %f>") << QStringLiteral("<%f ><%l>< %s>");
+#endif // HAVE_KF5
+        }
+        /// Add person's name formatted using each of the templates assembled above
+        QStringList result;
+        result.reserve(personNameFormattingList.count());
+        for (const QString &personNameFormatting : const_cast<const QStringList &>(personNameFormattingList))
+            result.append(Person::transcribePersonName(person.data(), personNameFormatting));
+        return result;
+    } else {
+        /// Default case: use PlainTextValue::text to translate ValueItem
+        /// to a human-readable text
+        return QStringList() << PlainTextValue::text(*valueItem);
+    }
+}
@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_DATA_COMPLETIONINDEX_H
+#define KBIBTEX_DATA_COMPLETIONINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QStringList>
+#include <QSharedPointer>
+
+#include "file.h"
+
+#ifdef HAVE_KF5
+#include "kbibtexdata_export.h"
+#endif // HAVE_KF5
+
+class Element;
+class ValueItem;
+
+/**
+ * Index of all unique values per field, entry ids, and macro keys of a
+ * @see File, as used to offer completions when editing elements.
+ * Each File object has one index, see @see File::completionIndex().
+ *
+ * The index is built in a single pass over the file the first time it
+ * is queried, and afterwards kept up-to-date element by element as
+ * long as changes to the file are announced by calling
+ * @see updateElement or @see removeElement. Sorted value lists are
+ * computed only when queried and shared until values of their field
+ * change.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXDATA_EXPORT CompletionIndex
+{
+public:
+    explicit CompletionIndex(const File *file);
+    ~CompletionIndex();
+
+    /**
+     * Sorted list of all unique values (as text) of the given field,
+     * the same as @see File::uniqueEntryValuesList would return
+     * @param fieldName field name, e.g. "volume"
+     */
+    QStringList values(const QString &fieldName) const;
+
+    /**
+     * Sorted list of keys of elements of the given types,
+     * i.e. ids of entries and keys of macros
+     */
+    QStringList keys(File::ElementTypes elementTypes) const;
+
+    /**
+     * List of completions for the given field: the field's sorted
+     * values, followed by all entry ids (sorted) in case of crossref
+     * fields, followed by all macro keys (sorted)
+     */
+    QStringList completions(const QString &fieldName) const;
+
+    /// Announce that @p element got inserted into the file or modified
+    void updateElement(const QSharedPointer<Element> &element);
+    /// Announce that @p element got removed from the file
+    void removeElement(const QSharedPointer<Element> &element);
+    /// Rebuild index from the whole file when queried next time
+    void invalidate();
+
+    /**
+     * Text representations of a single value item as offered for
+     * completion; persons' names are formatted in several ways
+     */
+    static QStringList valueItemTexts(const QSharedPointer<ValueItem> &valueItem);
+
+private:
+    Q_DISABLE_COPY(CompletionIndex)
+
+    class Private;
+    Private *d;
+};
+
+#endif // KBIBTEX_DATA_COMPLETIONINDEX_H
@@ -200,7 +200,7 @@ Entry *Entry::resolveCrossref(const File *bibTeXfile, QMap<QString, QString> xma
     return resolveCrossref(*this, bibTeXfile, xmaps);
 }
 
-Entry *Entry::resolveCrossref(const Entry &original, const File *bibTeXfile, QMap<QString, QString> xmaps)
+Entry *Entry::resolveCrossref(const Entry &original, const File *bibTeXfile, QMap<QString, QString> xmaps, QStringList *referencedKeys)
 {
     Entry *result = new Entry(original);
 
@@ -210,6 +210,8 @@ Entry *Entry::resolveCrossref(const Entry &original, const File *bibTeXfile, QMa
     const QString crossRef = PlainTextValue::text(original.value(ftCrossRef));
     if (crossRef.isEmpty())
         return result;
+    if (referencedKeys != nullptr)
+        referencedKeys->append(crossRef);
 
     const QSharedPointer<Entry> crossRefEntry = bibTeXfile->containsKey(crossRef, File::etEntry).dynamicCast<Entry>();
     if (!crossRefEntry.isNull()) {
@@ -252,6 +254,8 @@ Entry *Entry::resolveCrossref(const Entry &original, const File *bibTeXfile, QMa
                         continue;
                 // Record that we visit this one.
                 xDatasVisited.append(xDataToken);
+                if (referencedKeys != nullptr)
+                    referencedKeys->append(xDataToken);
                 QSharedPointer<Entry> xDataEntry = bibTeXfile->containsKey(xDataToken, File::etEntry).dynamicCast<Entry>();
                 if (!xDataEntry.isNull()) {
                         /// copy all fields from xdata entry to parent entry which do not (yet) exist in the parent entry
@@ -191,7 +191,13 @@ public:
     bool contains(const QString &key) const;
 
     Entry *resolveCrossref(const File *bibTeXfile, QMap<QString, QString> xmaps) const;
-    static Entry *resolveCrossref(const Entry &original, const File *bibTeXfile, QMap<QString, QString> xmaps);
+    /**
+     * Create a copy of @p original completed with the fields of the entries
+     * it refers to through crossref and xdata fields.
+     * @param referencedKeys if not null, receives the keys of all entries the
+     * resolution looked up, whether they exist in @p bibTeXfile or not
+     */
+    static Entry *resolveCrossref(const Entry &original, const File *bibTeXfile, QMap<QString, QString> xmaps, QStringList *referencedKeys = nullptr);
 
     static QStringList authorsLastName(const Entry &entry);
     QStringList authorsLastName() const;
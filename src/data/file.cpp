@@ -28,6 +28,7 @@
 #endif // HAVE_KF5
 
 #include "preferences.h"
+#include "completionindex.h"
 #include "entry.h"
 #include "element.h"
 #include "macro.h"
@@ -62,13 +63,15 @@ private:
 public:
     const quint64 internalId;
     QHash<QString, QVariant> properties;
+    /// Created on first use, see File::completionIndex()
+    CompletionIndex *completionIndex;
 
     explicit FilePrivate(File *parent)
             : validInvalidField(valid),
 #ifdef HAVE_KF5
         config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), configGroupName(QStringLiteral("FileExporterBibTeX")),
 #endif // HAVE_KF5
-        internalId(++internalIdCounter) {
+        internalId(++internalIdCounter), completionIndex(nullptr) {
         Q_UNUSED(parent)
         const bool isValid = checkValidity();
         if (!isValid) qCDebug(LOG_KBIBTEX_DATA) << "Creating File instance" << internalId << "  Valid?" << isValid;
@@ -81,6 +84,7 @@ public:
         const bool isValid = checkValidity();
         if (!isValid) qCDebug(LOG_KBIBTEX_DATA) << "Deleting File instance" << internalId << "  Valid?" << isValid;
         validInvalidField = invalid;
+        delete completionIndex;
     }
 
     /// Copy-assignment operator
@@ -88,6 +92,7 @@ public:
         if (this != &other) {
             validInvalidField = other.validInvalidField;
             properties = other.properties;
+            if (completionIndex != nullptr) completionIndex->invalidate();
             const bool isValid = checkValidity();
             if (!isValid) qCDebug(LOG_KBIBTEX_DATA) << "Assigning File instance" << other.internalId << "to" << internalId << "  Is other valid?" << other.checkValidity() << "  Self valid?" << isValid;
         }
@@ -99,6 +104,7 @@ public:
         if (this != &other) {
             validInvalidField = std::move(other.validInvalidField);
             properties = std::move(other.properties);
+            if (completionIndex != nullptr) completionIndex->invalidate();
             const bool isValid = checkValidity();
             if (!isValid) qCDebug(LOG_KBIBTEX_DATA) << "Assigning File instance" << other.internalId << "to" << internalId << "  Is other valid?" << other.checkValidity() << "  Self valid?" << isValid;
         }
@@ -280,35 +286,9 @@ QSet<QString> File::uniqueEntryValuesSet(const QString &fieldName) const
                 if (it.key().toLower() == lcFieldName) {
                     const auto itValue = it.value();
                     for (const QSharedPointer<ValueItem> &valueItem : itValue) {
-                        /// Check if ValueItem to process points to a person
-                        const QSharedPointer<Person> person = valueItem.dynamicCast<Person>();
-                        if (!person.isNull()) {
-                            /// Assemble a list of formatting templates for a person's name
-                            static QStringList personNameFormattingList; ///< use static to do pattern assembly only once
-                            if (personNameFormattingList.isEmpty()) {
-                                /// Use the two default patterns last-name-first and first-name-first
-#ifdef HAVE_KF5
-                                personNameFormattingList << Preferences::personNameFormatLastFirst << Preferences::personNameFormatFirstLast;
-                                /// Check configuration if user-specified formatting template is different
-                                KSharedConfigPtr config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc")));
-                                KConfigGroup configGroup(config, "General");
-                                QString personNameFormatting = configGroup.readEntry(Preferences::keyPersonNameFormatting, Preferences::defaultPersonNameFormatting);
-                                /// Add user's template if it differs from the two specified above
-                                if (!personNameFormattingList.contains(personNameFormatting))
-                                    personNameFormattingList << personNameFormatting;
-#else // HAVE_KF5
-                                personNameFormattingList << QStringLiteral("<%l><, %s><, %f>") << QStringLiteral("<%f ><%l>< %s>");
-#endif // HAVE_KF5
-                            }
-                            /// Add person's name formatted using each of the templates assembled above
-                            for (const QString &personNameFormatting : const_cast<const QStringList &>(personNameFormattingList)) {
-                                valueSet.insert(Person::transcribePersonName(person.data(), personNameFormatting));
-                            }
-                        } else {
-                            /// Default case: use PlainTextValue::text to translate ValueItem
-                            /// to a human-readable text
-                            valueSet.insert(PlainTextValue::text(*valueItem));
-                        }
+                        const QStringList texts = CompletionIndex::valueItemTexts(valueItem);
+                        for (const QString &text : texts)
+                            valueSet.insert(text);
                     }
                 }
     }
@@ -326,6 +306,15 @@ QStringList File::uniqueEntryValuesList(const QString &fieldName) const
     return list;
 }
 
+CompletionIndex *File::completionIndex() const
+{
+    if (!d->checkValidity())
+        qCCritical(LOG_KBIBTEX_DATA) << "CompletionIndex *File::completionIndex() const" << "This File object is not valid";
+    if (d->completionIndex == nullptr)
+        d->completionIndex = new CompletionIndex(this);
+    return d->completionIndex;
+}
+
 void File::setProperty(const QString &key, const QVariant &value)
 {
     if (!d->checkValidity())
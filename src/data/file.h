@@ -29,6 +29,7 @@
 #endif // HAVE_KF5
 
 class Element;
+class CompletionIndex;
 
 /**
  * This class represents a bibliographic file such as a BibTeX file
@@ -102,6 +103,15 @@ public:
      */
     QStringList uniqueEntryValuesList(const QString &fieldName) const;
 
+    /**
+     * Index of unique values, entry ids, and macro keys of this file,
+     * shared by everyone offering completions for this file. Changes to
+     * this file have to be announced to the index to keep it up-to-date,
+     * as done by @see FileModel.
+     * @return index owned by this File object
+     */
+    CompletionIndex *completionIndex() const;
+
     void setProperty(const QString &key, const QVariant &value);
     QVariant property(const QString &key) const;
     QVariant property(const QString &key, const QVariant &defaultValue) const;
@@ -21,7 +21,9 @@
 
 #include <QColor>
 #include <QFile>
+#include <QSet>
 #include <QString>
+#include <QtConcurrentRun>
 
 #include <KLocalizedString>
 #include <KConfigGroup>
@@ -32,9 +34,11 @@
 #include "macro.h"
 #include "comment.h"
 #include "preamble.h"
+#include "completionindex.h"
 #include "bibtexentries.h"
 #include "bibtexfields.h"
 #include "preferences.h"
+#include "undojournal.h"
 
 const int FileModel::NumberRole = Qt::UserRole + 9581;
 const int FileModel::SortRole = Qt::UserRole + 236; /// see also MDIWidget's SortRole
@@ -45,11 +49,13 @@ const QString FileModel::keyShowMacros = QStringLiteral("showMacros");
 const bool FileModel::defaultShowMacros = true;
 const QString FileModel::keyShowXDatas = QStringLiteral("showXDatas");
 const bool FileModel::defaultShowXDatas = true;
+const int FileModel::maxCachedRows = 8192;
 
 
 FileModel::FileModel(QObject *parent)
-        : QAbstractTableModel(parent), m_file(nullptr)
+        : QAbstractTableModel(parent), m_file(nullptr), m_rowData(maxCachedRows), m_cacheGeneration(0), m_prefetchWatcher(new QFutureWatcher<PrefetchResult>(this)), m_prefetchGeneration(0), m_journal(new UndoJournal(this))
 {
+    connect(m_prefetchWatcher, &QFutureWatcher<PrefetchResult>::finished, this, &FileModel::prefetchDone);
     NotificationHub::registerNotificationListener(this, NotificationHub::EventConfigurationChanged);
     readConfiguration();
 }
@@ -58,6 +64,8 @@ void FileModel::notificationEvent(int eventId)
 {
     if (eventId == NotificationHub::EventConfigurationChanged) {
         readConfiguration();
+        /// Color labels and person name formatting are part of cached data
+        invalidateCache();
         int column = 0;
         const BibTeXFields *bf = BibTeXFields::self();
         for (const auto &fd : const_cast<const BibTeXFields &>(*bf)) {
@@ -87,7 +95,7 @@ void FileModel::readConfiguration()
     }
 }
 
-QVariant FileModel::entryData(const Entry *entry, const QString &raw, const QString &rawAlt, int role, bool followCrossRef) const
+QVariant FileModel::entryData(const Entry *entry, const Entry *resolvedEntry, const QString &raw, const QString &rawAlt, const QMap<QString, QString> &colorToLabel, const QString &nameFormatting)
 {
     if (raw == QStringLiteral("^id")) // FIXME: Use constant here?
         return QVariant(entry->id());
@@ -103,36 +111,241 @@ QVariant FileModel::entryData(const Entry *entry, const QString &raw, const QStr
     } else if (raw.toLower() == Entry::ftStarRating) {
         return QVariant();
     } else if (raw.toLower() == Entry::ftColor) {
-        QString text = PlainTextValue::text(entry->value(raw));
+        QString text = PlainTextValue::text(entry->value(raw), nameFormatting);
         if (text.isEmpty()) return QVariant();
-        QString colorText = colorToLabel[text];
+        QString colorText = colorToLabel.value(text);
         if (colorText.isEmpty()) return QVariant(text);
         return QVariant(colorText);
     } else {
         QString text;
         if (entry->contains(raw))
-            text = PlainTextValue::text(entry->value(raw)).simplified();
+            text = PlainTextValue::text(entry->value(raw), nameFormatting).simplified();
         else if (!rawAlt.isEmpty() && entry->contains(rawAlt))
-            text = PlainTextValue::text(entry->value(rawAlt)).simplified();
+            text = PlainTextValue::text(entry->value(rawAlt), nameFormatting).simplified();
 
-        if (followCrossRef && text.isEmpty() && entry->contains(Entry::ftCrossRef)) {
-            Entry *completedEntry = entry->resolveCrossref(m_file, BibTeXEntries::self()->xmappings(entry->type()));
-            QVariant result = entryData(completedEntry, raw, rawAlt, role, false);
-            delete completedEntry;
-            return result;
-        }
+        /// Fall back to the value inherited through crossref or xdata
+        if (text.isEmpty() && resolvedEntry != nullptr)
+            return entryData(resolvedEntry, nullptr, raw, rawAlt, colorToLabel, nameFormatting);
 
         if (text.isEmpty())
             return QVariant();
-        else if (role == FileModel::SortRole)
-            return QVariant(text.toLower());
-        else if (role == Qt::ToolTipRole) {
-            // TODO: find a better solution, such as line-wrapping tooltips
-            return QVariant(KBibTeX::leftSqueezeText(text, 128));
-        } else
+        else
             return QVariant(text);
     }
+}
+
+void FileModel::computeRowData(const Element *element, const Entry *resolvedEntry, const QVector<FieldDescription> &fields, const QMap<QString, QString> &colorToLabel, const QString &nameFormatting, RowData &rowData)
+{
+    rowData.display.clear();
+    rowData.display.reserve(fields.count());
+    rowData.color = QColor();
+    rowData.hasStarRating = false;
+    rowData.starRating = 0.0;
+
+    const Entry *entry = dynamic_cast<const Entry *>(element);
+    if (entry != nullptr) {
+        /// if BibTeX entry has a "x-color" field, use that color to highlight row
+        const QString colorName = PlainTextValue::text(entry->value(Entry::ftColor), nameFormatting);
+        if (!colorName.isEmpty() && colorName != QStringLiteral("#000000"))
+            rowData.color = QColor(colorName);
+        if (entry->contains(Entry::ftStarRating)) {
+            const QString text = PlainTextValue::text(entry->value(Entry::ftStarRating), nameFormatting).simplified();
+            rowData.starRating = text.toDouble(&rowData.hasStarRating);
+        }
+
+        for (const FieldDescription &fd : fields)
+            rowData.display.append(entryData(entry, resolvedEntry, fd.upperCamelCase, fd.upperCamelCaseAlt, colorToLabel, nameFormatting));
+        return;
+    }
 
+    const Macro *macro = dynamic_cast<const Macro *>(element);
+    const Comment *comment = macro == nullptr ? dynamic_cast<const Comment *>(element) : nullptr;
+    const Preamble *preamble = macro == nullptr && comment == nullptr ? dynamic_cast<const Preamble *>(element) : nullptr;
+    for (const FieldDescription &fd : fields) {
+        const QString &raw = fd.upperCamelCase;
+        if (macro != nullptr) {
+            if (raw == QStringLiteral("^id"))
+                rowData.display.append(QVariant(macro->key()));
+            else if (raw == QStringLiteral("^type"))
+                rowData.display.append(QVariant(i18n("Macro")));
+            else if (raw == QStringLiteral("Title"))
+                rowData.display.append(QVariant(PlainTextValue::text(macro->value(), nameFormatting).simplified()));
+            else
+                rowData.display.append(QVariant());
+        } else if (comment != nullptr) {
+            if (raw == QStringLiteral("^type"))
+                rowData.display.append(QVariant(i18n("Comment")));
+            else if (raw == Entry::ftTitle)
+                rowData.display.append(QVariant(comment->text().simplified()));
+            else
+                rowData.display.append(QVariant());
+        } else if (preamble != nullptr) {
+            if (raw == QStringLiteral("^type"))
+                rowData.display.append(QVariant(i18n("Preamble")));
+            else if (raw == Entry::ftTitle)
+                rowData.display.append(QVariant(PlainTextValue::text(preamble->value(), nameFormatting).simplified()));
+            else
+                rowData.display.append(QVariant());
+        } else
+            rowData.display.append(QVariant("?"));
+    }
+}
+
+const FileModel::RowData *FileModel::cachedRowData(const QSharedPointer<Element> &element) const
+{
+    const RowData *cached = m_rowData.object(element.data());
+    /// Cached data is incomplete if fields got added or removed in the meantime
+    return cached != nullptr && cached->display.count() == BibTeXFields::self()->count() ? cached : nullptr;
+}
+
+const FileModel::RowData *FileModel::rowData(const QSharedPointer<Element> &element) const
+{
+    const RowData *cached = cachedRowData(element);
+    if (cached != nullptr)
+        return cached;
+
+    RowData *computed = new RowData();
+    const Entry *entry = dynamic_cast<const Entry *>(element.data());
+    const Entry *resolved = entry != nullptr && entry->contains(Entry::ftCrossRef) ? resolvedEntry(entry) : nullptr;
+    computeRowData(element.data(), resolved, *BibTeXFields::self(), colorToLabel, PlainTextValue::currentPersonNameFormatting(), *computed);
+    m_rowData.insert(element.data(), computed);
+    return computed;
+}
+
+FileModel::PrefetchResult FileModel::prefetchRowData(const QVector<PrefetchItem> &items, const QVector<FieldDescription> &fields, const QMap<QString, QString> &colorToLabel, const QString &nameFormatting)
+{
+    PrefetchResult result;
+    result.reserve(items.count());
+    for (const PrefetchItem &item : items) {
+        RowData rowData;
+        computeRowData(&item.entry, nullptr, fields, colorToLabel, nameFormatting, rowData);
+        result.append(qMakePair(item.element, rowData));
+    }
+    return result;
+}
+
+void FileModel::prefetchRows(const QList<int> &rows)
+{
+    if (m_file == nullptr) return;
+    if (m_prefetchWatcher->isRunning()) {
+        /// Only the most recently requested rows are of interest
+        /// once the running prefetch has finished
+        m_pendingPrefetchRows = rows;
+        return;
+    }
+    m_pendingPrefetchRows.clear();
+
+    QVector<PrefetchItem> items;
+    items.reserve(rows.count());
+    for (int row : rows) {
+        if (row < 0 || row >= m_file->count()) continue;
+        const QSharedPointer<Element> &element = m_file->at(row);
+        if (cachedRowData(element) != nullptr) continue;
+        /// Entries inheriting fields need the whole file to be resolved,
+        /// which may only be accessed from the model's thread; other
+        /// elements are cheap enough to be computed on demand
+        const QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
+        if (entry.isNull() || entry->contains(Entry::ftCrossRef)) continue;
+        /// Working on a copy protects the background thread against
+        /// modifications of the original entry; a plain copy would still
+        /// share the value items, which may get modified in place
+        PrefetchItem item;
+        item.element = element.data();
+        item.entry = *entry;
+        for (Entry::Iterator it = item.entry.begin(); it != item.entry.end(); ++it)
+            it.value() = it.value().deepCopy();
+        items.append(item);
+    }
+    if (items.isEmpty()) return;
+
+    m_prefetchGeneration = m_cacheGeneration;
+    /// The background thread works on a snapshot of the fields and of the
+    /// person name formatting, as both may be altered by the main thread
+    /// meanwhile
+    const QVector<FieldDescription> fields = *BibTeXFields::self();
+    const QString nameFormatting = PlainTextValue::currentPersonNameFormatting();
+    m_prefetchWatcher->setFuture(QtConcurrent::run(&FileModel::prefetchRowData, items, fields, colorToLabel, nameFormatting));
+}
+
+void FileModel::prefetchDone()
+{
+    /// Results are stale if any cached data got invalidated while prefetching
+    if (m_prefetchGeneration == m_cacheGeneration) {
+        const PrefetchResult result = m_prefetchWatcher->result();
+        for (const auto &item : result)
+            if (!m_rowData.contains(item.first))
+                m_rowData.insert(item.first, new RowData(item.second));
+    }
+
+    if (!m_pendingPrefetchRows.isEmpty())
+        prefetchRows(m_pendingPrefetchRows);
+}
+
+const Entry *FileModel::resolvedEntry(const Entry *entry) const
+{
+    const QString crossRef = PlainTextValue::text(entry->value(Entry::ftCrossRef));
+    QHash<const Entry *, ResolvedEntry>::ConstIterator it = m_resolvedEntries.constFind(entry);
+    /// A cached resolution is only valid if the crossref has not been altered since
+    if (it != m_resolvedEntries.constEnd() && it->crossRef == crossRef)
+        return it->entry.data();
+
+    removeResolvedEntry(entry);
+    ResolvedEntry resolved;
+    resolved.crossRef = crossRef;
+    resolved.entry = QSharedPointer<const Entry>(Entry::resolveCrossref(*entry, m_file, BibTeXEntries::self()->xmappings(entry->type()), &resolved.referencedKeys));
+    m_resolvedEntries.insert(entry, resolved);
+    for (const QString &key : const_cast<const QStringList &>(resolved.referencedKeys))
+        m_dependentEntries[key].insert(entry);
+    return resolved.entry.data();
+}
+
+void FileModel::removeResolvedEntry(const Entry *entry) const
+{
+    const QHash<const Entry *, ResolvedEntry>::Iterator it = m_resolvedEntries.find(entry);
+    if (it == m_resolvedEntries.end()) return;
+
+    for (const QString &key : const_cast<const QStringList &>(it->referencedKeys)) {
+        const QHash<QString, QSet<const Entry *> >::Iterator dit = m_dependentEntries.find(key);
+        if (dit == m_dependentEntries.end()) continue;
+        dit->remove(entry);
+        if (dit->isEmpty())
+            m_dependentEntries.erase(dit);
+    }
+    m_resolvedEntries.erase(it);
+}
+
+void FileModel::invalidateCachedData(const QSharedPointer<Element> &element)
+{
+    ++m_cacheGeneration;
+    m_rowData.remove(element.data());
+    if (m_resolvedEntries.isEmpty()) return;
+
+    /// Only entries can be referenced through crossref or xdata fields
+    QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
+    if (entry.isNull()) return;
+
+    removeResolvedEntry(entry.data());
+    /// Drop every resolution which looked up this entry's key,
+    /// no matter if the entry was found back then or not,
+    /// and the row data computed from it
+    const QSet<const Entry *> dependentEntries = m_dependentEntries.value(entry->id());
+    for (const Entry *dependentEntry : dependentEntries) {
+        m_rowData.remove(dependentEntry);
+        removeResolvedEntry(dependentEntry);
+    }
+}
+
+void FileModel::invalidateCache()
+{
+    ++m_cacheGeneration;
+    m_rowData.clear();
+    m_resolvedEntries.clear();
+    m_dependentEntries.clear();
+}
+
+UndoJournal *FileModel::journal() const
+{
+    return m_journal;
 }
 
 File *FileModel::bibliographyFile() const
@@ -146,6 +359,8 @@ void FileModel::setBibliographyFile(File *file)
     if (resetNecessary) {
         beginResetModel();
         m_file = file;
+        invalidateCache();
+        m_journal->clear();
         endResetModel();
     }
 }
@@ -190,91 +405,60 @@ QVariant FileModel::data(const QModelIndex &index, int role) const
     const BibTeXFields *bibtexFields = BibTeXFields::self();
     if (index.row() < m_file->count() && index.column() < bibtexFields->count()) {
         const FieldDescription &fd = bibtexFields->at(index.column());
-        QString raw = fd.upperCamelCase;
-        QString rawAlt = fd.upperCamelCaseAlt;
-        QSharedPointer<Element> element = (*m_file)[index.row()];
-        QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
+        const QString &raw = fd.upperCamelCase;
+        const QSharedPointer<Element> &element = m_file->at(index.row());
+        const Entry *entry = dynamic_cast<const Entry *>(element.data());
+
+        if (role == FileModel::SortRole && entry != nullptr && cachedRowData(element) == nullptr) {
+            /// Sorting requests a single column of every row, so computing
+            /// and caching whole rows would be wasted effort and would
+            /// evict the cached data of the rows actually shown
+            const QVariant display = entryData(entry, entry->contains(Entry::ftCrossRef) ? resolvedEntry(entry) : nullptr, raw, fd.upperCamelCaseAlt, colorToLabel);
+            if (display.isNull() || raw == QStringLiteral("^id") || raw == QStringLiteral("^type") || raw.toLower() == Entry::ftColor)
+                return display;
+            return QVariant(display.toString().toLower());
+        }
 
-        /// if BibTeX entry has a "x-color" field, use that color to highlight row
+        const RowData *rowData = this->rowData(element);
         if (role == Qt::BackgroundRole) {
-            /// Retrieve "color"
-            QString colorName;
-            if (entry.isNull() || (colorName = PlainTextValue::text(entry->value(Entry::ftColor))) == QStringLiteral("#000000") || colorName.isEmpty())
+            if (!rowData->color.isValid())
                 return QVariant();
             else {
                 /// There is a valid color, set it as background
-                QColor color(colorName);
+                QColor color(rowData->color);
                 /// Use slightly different colors for even and odd rows
                 color.setAlphaF(index.row() % 2 == 0 ? 0.75 : 1.0);
                 return QVariant(color);
             }
         } else if (role == Qt::ForegroundRole) {
-            /// Retrieve "color"
-            QString colorName;
-            if (entry.isNull() || (colorName = PlainTextValue::text(entry->value(Entry::ftColor))) == QStringLiteral("#000000") || colorName.isEmpty())
+            if (!rowData->color.isValid())
                 return QVariant();
             else {
-                /// There is a valid color ...
-                const QColor color(colorName);
                 /// Retrieve red, green, blue, and alpha components
                 int r = 0, g = 0, b = 0, a = 0;
-                color.getRgb(&r, &g, &b, &a);
+                rowData->color.getRgb(&r, &g, &b, &a);
                 /// If gray value is rather dark, return white as foreground color
                 if (qGray(r, g, b) < 128) return QColor(Qt::white);
                 /// For light gray values, return black as foreground color
                 else return QColor(Qt::black);
             }
         } else if (role == NumberRole) {
-            if (!entry.isNull() && raw.toLower() == Entry::ftStarRating) {
-                const QString text = PlainTextValue::text(entry->value(raw)).simplified();
-                bool ok = false;
-                const double numValue = text.toDouble(&ok);
-                if (ok)
-                    return QVariant::fromValue<double>(numValue);
-                else
-                    return QVariant();
-            } else
+            if (rowData->hasStarRating && raw.toLower() == Entry::ftStarRating)
+                return QVariant::fromValue<double>(rowData->starRating);
+            else
                 return QVariant();
         }
 
-        if (!entry.isNull()) {
-            return entryData(entry.data(), raw, rawAlt, role, true);
-        } else {
-            QSharedPointer<Macro> macro = element.dynamicCast<Macro>();
-            if (!macro.isNull()) {
-                if (raw == QStringLiteral("^id"))
-                    return QVariant(macro->key());
-                else if (raw == QStringLiteral("^type"))
-                    return QVariant(i18n("Macro"));
-                else if (raw == QStringLiteral("Title")) {
-                    const QString text = PlainTextValue::text(macro->value()).simplified();
-                    return QVariant(text);
-                } else
-                    return QVariant();
-            } else {
-                QSharedPointer<Comment> comment = element.dynamicCast<Comment>();
-                if (!comment.isNull()) {
-                    if (raw == QStringLiteral("^type"))
-                        return QVariant(i18n("Comment"));
-                    else if (raw == Entry::ftTitle) {
-                        const QString text = comment->text().simplified();
-                        return QVariant(text);
-                    } else
-                        return QVariant();
-                } else {
-                    QSharedPointer<Preamble> preamble = element.dynamicCast<Preamble>();
-                    if (!preamble.isNull()) {
-                        if (raw == QStringLiteral("^type"))
-                            return QVariant(i18n("Preamble"));
-                        else if (raw == Entry::ftTitle) {
-                            const QString text = PlainTextValue::text(preamble->value()).simplified();
-                            return QVariant(text);
-                        } else
-                            return QVariant();
-                    } else
-                        return QVariant("?");
-                }
-            }
+        const QVariant &display = rowData->display.at(index.column());
+        /// Only plain field values of entries are presented differently
+        /// for sorting and in tooltips
+        if (role == Qt::DisplayRole || display.isNull() || entry == nullptr || raw == QStringLiteral("^id") || raw == QStringLiteral("^type") || raw.toLower() == Entry::ftColor)
+            return display;
+        else if (role == FileModel::SortRole)
+            return QVariant(display.toString().toLower());
+        else {
+            // TODO: find a better solution, such as line-wrapping tooltips
+            return QVariant(KBibTeX::leftSqueezeText(display.toString(), 128));
         }
     } else
         return QVariant("?");
@@ -297,6 +481,9 @@ Qt::ItemFlags FileModel::flags(const QModelIndex &index) const
 void FileModel::clear() {
     beginResetModel();
     m_file->clear();
+    m_file->completionIndex()->invalidate();
+    invalidateCache();
+    m_journal->clear();
     endResetModel();
 }
 
@@ -307,11 +494,7 @@ bool FileModel::removeRow(int row, const QModelIndex &parent)
     if (parent != QModelIndex())
         return false;
 
-    beginRemoveRows(QModelIndex(), row, row);
-    m_file->removeAt(row);
-    endRemoveRows();
-
-    return true;
+    return removeRowList(QList<int>() << row);
 }
 
 bool FileModel::removeRowList(const QList<int> &rows)
@@ -320,22 +503,49 @@ bool FileModel::removeRowList(const QList<int> &rows)
 
     QList<int> internalRows = rows;
     std::sort(internalRows.begin(), internalRows.end(), std::greater<int>());
+    internalRows.erase(std::unique(internalRows.begin(), internalRows.end()), internalRows.end());
+    if (internalRows.isEmpty()) return true;
+    if (internalRows.last() < 0 || internalRows.first() >= m_file->count())
+        return false;
 
-    beginRemoveRows(QModelIndex(), internalRows.last(), internalRows.first());
-    for (int row : const_cast<const QList<int> &>(internalRows)) {
-        if (row < 0 || row >= rowCount() || row >= m_file->count())
-            return false;
-        m_file->removeAt(row);
+    m_journal->beginOperation(i18n("Remove Elements"));
+    QList<int> removedRows;
+    QList<QSharedPointer<Element> > removedElements;
+    removedRows.reserve(internalRows.count());
+    removedElements.reserve(internalRows.count());
+    for (int i = internalRows.count() - 1; i >= 0; --i) {
+        removedRows << internalRows[i];
+        removedElements << m_file->at(internalRows[i]);
     }
-    endRemoveRows();
+
+    /// Remove contiguous ranges of rows with a single notification each,
+    /// starting with the bottom-most range so that the rows of ranges
+    /// still to be removed do not change
+    int i = 0;
+    while (i < internalRows.count()) {
+        const int lastRow = internalRows[i];
+        int firstRow = lastRow;
+        while (++i < internalRows.count() && internalRows[i] == firstRow - 1)
+            firstRow = internalRows[i];
+
+        beginRemoveRows(QModelIndex(), firstRow, lastRow);
+        for (int row = firstRow; row <= lastRow; ++row) {
+            invalidateCachedData(m_file->at(row));
+            m_file->completionIndex()->removeElement(m_file->at(row));
+        }
+        m_file->erase(m_file->begin() + firstRow, m_file->begin() + lastRow + 1);
+        endRemoveRows();
+    }
+
+    m_journal->recordRemoval(removedRows, removedElements);
+    m_journal->endOperation();
 
     return true;
 }
 
-bool FileModel::insertRow(QSharedPointer<Element> element, int row, const QModelIndex &parent)
+void FileModel::makeKeyUnique(const QSharedPointer<Element> &element, QSet<QString> &usedKeys)
 {
-    if (m_file == nullptr || row < 0 || row > rowCount() || parent != QModelIndex())
-        return false;
+    static const QString pattern = QStringLiteral("%1_%2");
 
     /// Check for duplicate ids or keys when inserting a new element
     /// First, check entries
@@ -343,47 +553,147 @@ bool FileModel::insertRow(QSharedPointer<Element> element, int row, const QModel
     if (!entry.isNull()) {
         /// Fetch current entry's id
         const QString id = entry->id();
-        if (!m_file->containsKey(id).isNull()) {
+        if (usedKeys.contains(id)) {
             /// Same entry id used for an existing entry or macro
             int overflow = 2;
-            static const QString pattern = QStringLiteral("%1_%2");
             /// Test alternative ids with increasing "overflow" counter:
             /// id_2, id_3, id_4 ,...
             QString newId = pattern.arg(id).arg(overflow);
-            while (!m_file->containsKey(newId).isNull()) {
+            while (usedKeys.contains(newId)) {
                 ++overflow;
                 newId = pattern.arg(id).arg(overflow);
             }
             /// Guaranteed to find an alternative, apply it to entry
             entry->setId(newId);
         }
+        usedKeys.insert(entry->id());
     } else {
         /// Next, check macros
         QSharedPointer<Macro> macro = element.dynamicCast<Macro>();
         if (!macro.isNull()) {
             /// Fetch current macro's key
             const QString key = macro->key();
-            if (!m_file->containsKey(key).isNull()) {
+            if (usedKeys.contains(key)) {
                 /// Same entry key used for an existing entry or macro
                 int overflow = 2;
-                static const QString pattern = QStringLiteral("%1_%2");
                 /// Test alternative keys with increasing "overflow" counter:
                 /// key_2, key_3, key_4 ,...
                 QString newKey = pattern.arg(key).arg(overflow);
-                while (!m_file->containsKey(newKey).isNull()) {
+                while (usedKeys.contains(newKey)) {
                     ++overflow;
                     newKey = pattern.arg(key).arg(overflow);
                 }
                 /// Guaranteed to find an alternative, apply it to macro
                 macro->setKey(newKey);
             }
+            usedKeys.insert(macro->key());
         }
     }
+}
+
+bool FileModel::insertRow(QSharedPointer<Element> element, int row, const QModelIndex &parent)
+{
+    if (parent != QModelIndex())
+        return false;
+
+    return insertElements(QList<QSharedPointer<Element> >() << element, row);
+}
+
+bool FileModel::insertElements(const QList<QSharedPointer<Element> > &elements, int row)
+{
+    if (m_file == nullptr || row < 0 || row > rowCount() || elements.isEmpty())
+        return false;
+
+    /// Keys of new elements must neither clash with existing
+    /// elements' keys nor with each other
+    QSet<QString> usedKeys = m_file->allKeys().toSet();
+    for (const auto &element : elements) {
+        makeKeyUnique(element, usedKeys);
+        /// Entries referring to the new entry's id have to be resolved anew
+        invalidateCachedData(element);
+        m_file->completionIndex()->updateElement(element);
+    }
 
-    beginInsertRows(QModelIndex(), row, row);
-    m_file->insert(row, element);
+    beginInsertRows(QModelIndex(), row, row + elements.count() - 1);
+    if (row == m_file->count())
+        m_file->append(elements);
+    else {
+        m_file->reserve(m_file->count() + elements.count());
+        for (int i = 0; i < elements.count(); ++i)
+            m_file->insert(row + i, elements[i]);
+    }
     endInsertRows();
 
+    QList<int> insertedRows;
+    insertedRows.reserve(elements.count());
+    for (int i = 0; i < elements.count(); ++i)
+        insertedRows << row + i;
+    m_journal->beginOperation(i18n("Insert Elements"));
+    m_journal->recordInsertion(insertedRows, elements);
+    m_journal->endOperation();
+
+    return true;
+}
+
+bool FileModel::restoreElements(const QList<int> &rows, const QList<QSharedPointer<Element> > &elements)
+{
+    if (m_file == nullptr || rows.isEmpty() || rows.count() != elements.count())
+        return false;
+
+    /// Rows are ascending, so inserting in this order puts every
+    /// element back to the row it was originally removed from
+    int i = 0;
+    while (i < rows.count()) {
+        /// Insert each range of contiguous rows with a single notification
+        int j = i;
+        while (j + 1 < rows.count() && rows[j + 1] == rows[j] + 1)
+            ++j;
+        if (rows[i] < 0 || rows[i] > m_file->count())
+            return false;
+
+        beginInsertRows(QModelIndex(), rows[i], rows[j]);
+        for (int k = i; k <= j; ++k) {
+            invalidateCachedData(elements[k]);
+            m_file->completionIndex()->updateElement(elements[k]);
+            m_file->insert(rows[k], elements[k]);
+        }
+        endInsertRows();
+        i = j + 1;
+    }
+
+    return true;
+}
+
+bool FileModel::replaceElements(const QMap<int, QSharedPointer<Element> > &replacements)
+{
+    if (m_file == nullptr || replacements.isEmpty()) return false;
+    if (replacements.firstKey() < 0 || replacements.lastKey() >= m_file->count())
+        return false;
+
+    QList<QSharedPointer<Element> > previousElements;
+    previousElements.reserve(replacements.count());
+    int firstRow = -1, lastRow = -1;
+    for (QMap<int, QSharedPointer<Element> >::ConstIterator it = replacements.constBegin(); it != replacements.constEnd(); ++it) {
+        previousElements << m_file->at(it.key());
+        invalidateCachedData(m_file->at(it.key()));
+        invalidateCachedData(it.value());
+        /// Completions of the new element get added by elementsChanged
+        m_file->completionIndex()->removeElement(m_file->at(it.key()));
+        (*m_file)[it.key()] = it.value();
+
+        /// Notify about contiguous ranges of replaced rows at once
+        if (it.key() != lastRow + 1) {
+            elementsChanged(firstRow, lastRow);
+            firstRow = it.key();
+        }
+        lastRow = it.key();
+    }
+    elementsChanged(firstRow, lastRow);
+
+    m_journal->beginOperation(i18n("Replace Elements"));
+    m_journal->recordReplacement(replacements.keys(), previousElements, replacements.values());
+    m_journal->endOperation();
+
     return true;
 }
 
@@ -401,5 +711,16 @@ int FileModel::row(QSharedPointer<Element> element) const
 }
 
 void FileModel::elementChanged(int row) {
+    invalidateCachedData(element(row));
+    if (m_file != nullptr) m_file->completionIndex()->updateElement(element(row));
     emit dataChanged(createIndex(row, 0), createIndex(row, columnCount() - 1));
 }
+
+void FileModel::elementsChanged(int firstRow, int lastRow) {
+    if (firstRow < 0 || lastRow < firstRow) return;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        invalidateCachedData(element(row));
+        if (m_file != nullptr) m_file->completionIndex()->updateElement(element(row));
+    }
+    emit dataChanged(createIndex(firstRow, 0), createIndex(lastRow, columnCount() - 1));
+}
@@ -18,9 +18,16 @@
 #define KBIBTEX_GUI_FILEMODEL_H
 
 #include <QAbstractItemModel>
+#include <QCache>
+#include <QColor>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QLatin1String>
 #include <QList>
+#include <QPair>
+#include <QSet>
 #include <QStringList>
+#include <QVector>
 
 #include <KSharedConfig>
 
@@ -29,8 +36,10 @@
 #include "notificationhub.h"
 #include "file.h"
 #include "entry.h"
+#include "bibtexfields.h"
 
 class FileModel;
+class UndoJournal;
 
 /**
 @author Thomas Fischer
@@ -52,6 +61,9 @@ public:
     explicit FileModel(QObject *parent = nullptr);
 
     File *bibliographyFile() const;
+    /// Journal of modifications which can be undone, recording insertions,
+    /// removals and replacements of elements made through this model
+    UndoJournal *journal() const;
     virtual void setBibliographyFile(File *file);
 
     QModelIndex parent(const QModelIndex &index) const override;
@@ -66,11 +78,26 @@ public:
     virtual bool removeRow(int row, const QModelIndex &parent = QModelIndex());
     bool removeRowList(const QList<int> &rows);
     bool insertRow(QSharedPointer<Element> element, int row, const QModelIndex &parent = QModelIndex());
+    /// Inserts several elements as one block starting at the given row,
+    /// notifying views only once. Ids and keys are made unique like in insertRow
+    bool insertElements(const QList<QSharedPointer<Element> > &elements, int row);
+    /// Replaces the elements in the given rows by other elements in place,
+    /// which views see as modified rows rather than as removed and inserted ones
+    bool replaceElements(const QMap<int, QSharedPointer<Element> > &replacements);
 
     QSharedPointer<Element> element(int row) const;
     int row(QSharedPointer<Element> element) const;
     /// Notifies the model that a given element has been modifed
     void elementChanged(int row);
+    /// Notifies the model that elements in a range of rows have been modified,
+    /// using a single notification for all of them
+    void elementsChanged(int firstRow, int lastRow);
+    /// Discards all data the model has derived from its elements, to be
+    /// called after elements got modified without the model's involvement
+    void invalidateCache();
+    /// Computes the data of the given rows in a background thread, so that
+    /// it is readily available once those rows get shown, e.g. when scrolling
+    void prefetchRows(const QList<int> &rows);
 
     void notificationEvent(int eventId) override;
 
@@ -78,9 +105,66 @@ private:
     File *m_file;
     QMap<QString, QString> colorToLabel;
 
+    /// Entry completed with the fields inherited through its crossref
+    /// and xdata references, together with the keys it was resolved from
+    struct ResolvedEntry {
+        QString crossRef;
+        QStringList referencedKeys;
+        QSharedPointer<const Entry> entry;
+    };
+    /// Resolved entries by the entry they were created for, computed on first
+    /// use and dropped when the entry or one of the referenced entries changes
+    mutable QHash<const Entry *, ResolvedEntry> m_resolvedEntries;
+    /// Entries with a resolved entry by the keys looked up while resolving,
+    /// to find the resolutions depending on an entry without scanning all
+    mutable QHash<QString, QSet<const Entry *> > m_dependentEntries;
+
+    /// Data of a row as shown in a view, computed for all columns at once
+    struct RowData {
+        QVector<QVariant> display;
+        /// Color to highlight the row with, invalid if there is none
+        QColor color;
+        bool hasStarRating;
+        double starRating;
+    };
+    static const int maxCachedRows;
+    /// Row data by element, computed on demand or by prefetching
+    mutable QCache<const Element *, RowData> m_rowData;
+    /// Incremented on each invalidation to detect stale prefetch results
+    int m_cacheGeneration;
+
+    /// Copy of an entry to compute row data for in a background thread,
+    /// sharing none of its values with the original entry
+    struct PrefetchItem {
+        const Element *element;
+        Entry entry;
+    };
+    typedef QVector<QPair<const Element *, RowData> > PrefetchResult;
+    QFutureWatcher<PrefetchResult> *m_prefetchWatcher;
+    int m_prefetchGeneration;
+    QList<int> m_pendingPrefetchRows;
+
+    UndoJournal *m_journal;
+    friend class UndoJournal;
+
     void readConfiguration();
 
-    QVariant entryData(const Entry *entry, const QString &raw, const QString &rawAlt, int role, bool followCrossRef) const;
+    static void makeKeyUnique(const QSharedPointer<Element> &element, QSet<QString> &usedKeys);
+    /// Inserts elements at the given ascending rows as they were before
+    /// being removed, without altering their ids or keys
+    bool restoreElements(const QList<int> &rows, const QList<QSharedPointer<Element> > &elements);
+
+    const Entry *resolvedEntry(const Entry *entry) const;
+    void removeResolvedEntry(const Entry *entry) const;
+    void invalidateCachedData(const QSharedPointer<Element> &element);
+
+    /// Cached row data of the element if still valid, otherwise nullptr
+    const RowData *cachedRowData(const QSharedPointer<Element> &element) const;
+    const RowData *rowData(const QSharedPointer<Element> &element) const;
+    static void computeRowData(const Element *element, const Entry *resolvedEntry, const QVector<FieldDescription> &fields, const QMap<QString, QString> &colorToLabel, const QString &nameFormatting, RowData &rowData);
+    static QVariant entryData(const Entry *entry, const Entry *resolvedEntry, const QString &raw, const QString &rawAlt, const QMap<QString, QString> &colorToLabel, const QString &nameFormatting);
+    static PrefetchResult prefetchRowData(const QVector<PrefetchItem> &items, const QVector<FieldDescription> &fields, const QMap<QString, QString> &colorToLabel, const QString &nameFormatting);
+    void prefetchDone();
 };
 
 #endif // KBIBTEX_GUI_FILEMODEL_H
@@ -0,0 +1,490 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "undojournal.h"
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+
+#include "entry.h"
+#include "macro.h"
+#include "preamble.h"
+#include "comment.h"
+#include "file.h"
+#include "filemodel.h"
+
+/// Create a copy of a macro, preamble or comment which does not share any
+/// value items with the original, as value items may get modified in place
+static QSharedPointer<Element> copyElementState(const Element *element)
+{
+    if (const Macro *macro = dynamic_cast<const Macro *>(element))
+        return QSharedPointer<Macro>(new Macro(macro->key(), macro->value().deepCopy()));
+    else if (const Preamble *preamble = dynamic_cast<const Preamble *>(element))
+        return QSharedPointer<Preamble>(new Preamble(preamble->value().deepCopy()));
+    else if (const Comment *comment = dynamic_cast<const Comment *>(element))
+        return QSharedPointer<Comment>(new Comment(comment->text(), comment->useCommand()));
+    Q_ASSERT_X(false, "copyElementState", "Element is neither macro, preamble nor comment");
+    return QSharedPointer<Element>();
+}
+
+static bool sameElementState(const Element *element, const Element *state)
+{
+    if (const Macro *macro = dynamic_cast<const Macro *>(element))
+        return *macro == *static_cast<const Macro *>(state);
+    else if (const Preamble *preamble = dynamic_cast<const Preamble *>(element))
+        return *preamble == *static_cast<const Preamble *>(state);
+    else if (const Comment *comment = dynamic_cast<const Comment *>(element))
+        return comment->text() == static_cast<const Comment *>(state)->text() && comment->useCommand() == static_cast<const Comment *>(state)->useCommand();
+    return true;
+}
+
+static void restoreElementState(Element *element, const Element *state)
+{
+    if (Macro *macro = dynamic_cast<Macro *>(element)) {
+        macro->setKey(static_cast<const Macro *>(state)->key());
+        macro->setValue(static_cast<const Macro *>(state)->value().deepCopy());
+    } else if (Preamble *preamble = dynamic_cast<Preamble *>(element))
+        preamble->setValue(static_cast<const Preamble *>(state)->value().deepCopy());
+    else if (Comment *comment = dynamic_cast<Comment *>(element)) {
+        comment->setText(static_cast<const Comment *>(state)->text());
+        comment->setUseCommand(static_cast<const Comment *>(state)->useCommand());
+    }
+}
+
+class UndoJournal::Private
+{
+public:
+    /// Maximum number of operations which can be undone
+    static const int maxOperations;
+
+    /// Change of a single field, where a missing value means
+    /// that the field did not exist before or after the change
+    struct FieldDelta {
+        QString key;
+        bool hadBefore, hasAfter;
+        Value before, after;
+    };
+
+    /// One step of an operation, either a structural change of the
+    /// bibliography or a modification of an entry or another element in place
+    struct Step {
+        enum Kind {Insertion, Removal, Replacement, Modification, ElementModification};
+        Kind kind;
+        QList<int> rows;
+        QList<QSharedPointer<Element> > elements, previousElements;
+        QSharedPointer<Entry> entry;
+        /// Modified macro, preamble or comment with copies of its states
+        QSharedPointer<Element> element, stateBefore, stateAfter;
+        QString idBefore, idAfter, typeBefore, typeAfter;
+        QVector<FieldDelta> fieldDeltas;
+    };
+
+    struct Operation {
+        QString label;
+        QVector<Step> steps;
+    };
+
+    /// State of an entry when it was announced to be modified,
+    /// to be compared with its state at the end of the operation
+    struct Snapshot {
+        int stepIndex;
+        QString id, type;
+        bool allFields, watchId, watchType;
+        /// lower-case keys of fields to watch if not all fields are watched
+        QSet<QString> keys;
+        QMap<QString, Value> fields;
+    };
+
+    UndoJournal *p;
+    FileModel *model;
+
+    QVector<Operation> operations;
+    /// Number of operations which have been performed and not been undone,
+    /// operations from this index on can be redone
+    int position;
+
+    /// Nesting depth of operations being recorded
+    int depth;
+    Operation current;
+    QHash<Entry *, Snapshot> snapshots;
+    /// Steps of macros, preambles and comments announced to be modified,
+    /// which keep copies of the whole elements as they are small
+    QHash<Element *, int> elementSnapshots;
+    bool replaying;
+
+    Private(FileModel *m, UndoJournal *parent)
+            : p(parent), model(m), position(0), depth(0), replaying(false) {
+        /// nothing
+    }
+
+    bool isRecording() const {
+        return depth > 0 && !replaying;
+    }
+
+    void takeSnapshot(const QSharedPointer<Entry> &entry, const QString &key) {
+        QHash<Entry *, Snapshot>::Iterator it = snapshots.find(entry.data());
+        if (it == snapshots.end()) {
+            Step step;
+            step.kind = Step::Modification;
+            step.entry = entry;
+            current.steps.append(step);
+
+            Snapshot snapshot;
+            snapshot.stepIndex = current.steps.count() - 1;
+            snapshot.id = entry->id();
+            snapshot.type = entry->type();
+            snapshot.allFields = false;
+            snapshot.watchId = false;
+            snapshot.watchType = false;
+            it = snapshots.insert(entry.data(), snapshot);
+        } else if (it->allFields)
+            return; ///< everything is known already
+
+        if (key == QStringLiteral("^id")) {
+            it->watchId = true;
+            return;
+        } else if (key == QStringLiteral("^type")) {
+            it->watchType = true;
+            return;
+        }
+
+        if (key.isEmpty()) {
+            it->allFields = true;
+            it->watchId = true;
+            it->watchType = true;
+            for (Entry::ConstIterator eit = entry->constBegin(); eit != entry->constEnd(); ++eit)
+                if (!it->fields.contains(eit.key()) && !it->keys.contains(eit.key().toLower()))
+                    it->fields.insert(eit.key(), eit.value().deepCopy());
+        } else {
+            const QString lcKey = key.toLower();
+            if (it->keys.contains(lcKey)) return;
+            it->keys.insert(lcKey);
+            for (Entry::ConstIterator eit = entry->constBegin(); eit != entry->constEnd(); ++eit)
+                if (eit.key().toLower() == lcKey)
+                    it->fields.insert(eit.key(), eit.value().deepCopy());
+        }
+    }
+
+    void takeElementSnapshot(const QSharedPointer<Element> &element) {
+        if (elementSnapshots.contains(element.data())) return;
+        Step step;
+        step.kind = Step::ElementModification;
+        step.element = element;
+        step.stateBefore = copyElementState(element.data());
+        if (step.stateBefore.isNull()) return;
+        current.steps.append(step);
+        elementSnapshots.insert(element.data(), current.steps.count() - 1);
+    }
+
+    /// Compare the elements' current states with their snapshots
+    /// and fill the operation's steps with the differences
+    void resolveSnapshots() {
+        for (QHash<Element *, int>::ConstIterator it = elementSnapshots.constBegin(); it != elementSnapshots.constEnd(); ++it) {
+            Step &step = current.steps[it.value()];
+            if (!sameElementState(it.key(), step.stateBefore.data()))
+                step.stateAfter = copyElementState(it.key());
+        }
+        elementSnapshots.clear();
+
+        for (QHash<Entry *, Snapshot>::ConstIterator it = snapshots.constBegin(); it != snapshots.constEnd(); ++it) {
+            const Snapshot &snapshot = it.value();
+            const Entry *entry = it.key();
+            Step &step = current.steps[snapshot.stepIndex];
+
+            if (snapshot.watchId) {
+                step.idBefore = snapshot.id;
+                step.idAfter = entry->id();
+            }
+            if (snapshot.watchType) {
+                step.typeBefore = snapshot.type;
+                step.typeAfter = entry->type();
+            }
+
+            /// Fields which have been removed or modified
+            for (QMap<QString, Value>::ConstIterator fit = snapshot.fields.constBegin(); fit != snapshot.fields.constEnd(); ++fit) {
+                Entry::ConstIterator eit = entry->constFind(fit.key());
+                if (eit == entry->constEnd()) {
+                    FieldDelta delta {fit.key(), true, false, fit.value(), Value()};
+                    step.fieldDeltas.append(delta);
+                } else if (eit.value() != fit.value()) {
+                    FieldDelta delta {fit.key(), true, true, fit.value(), eit.value().deepCopy()};
+                    step.fieldDeltas.append(delta);
+                }
+            }
+            /// Fields which have been added
+            for (Entry::ConstIterator eit = entry->constBegin(); eit != entry->constEnd(); ++eit)
+                if (!snapshot.fields.contains(eit.key()) && (snapshot.allFields || snapshot.keys.contains(eit.key().toLower()))) {
+                    FieldDelta delta {eit.key(), false, true, Value(), eit.value().deepCopy()};
+                    step.fieldDeltas.append(delta);
+                }
+        }
+        snapshots.clear();
+
+        /// Drop modifications which did not change anything
+        for (QVector<Step>::Iterator it = current.steps.begin(); it != current.steps.end();)
+            if ((it->kind == Step::Modification && it->fieldDeltas.isEmpty() && it->idBefore == it->idAfter && it->typeBefore == it->typeAfter) || (it->kind == Step::ElementModification && it->stateAfter.isNull()))
+                it = current.steps.erase(it);
+            else
+                ++it;
+    }
+
+    void applyModification(const Step &step, bool undo, QList<QSharedPointer<Element> > &modifiedElements, bool &idChanged) {
+        Entry *entry = step.entry.data();
+        if (step.idBefore != step.idAfter) {
+            entry->setId(undo ? step.idBefore : step.idAfter);
+            idChanged = true;
+        }
+        if (step.typeBefore != step.typeAfter)
+            entry->setType(undo ? step.typeBefore : step.typeAfter);
+
+        /// Remove fields first, as a field may have been replaced
+        /// by one differing in its key's case only
+        for (const FieldDelta &delta : step.fieldDeltas)
+            if (!(undo ? delta.hadBefore : delta.hasAfter))
+                entry->QMap<QString, Value>::remove(delta.key);
+        /// Values get copied again, so that the journal's values
+        /// never get exposed to modifications in place
+        for (const FieldDelta &delta : step.fieldDeltas)
+            if (undo ? delta.hadBefore : delta.hasAfter)
+                entry->QMap<QString, Value>::insert(delta.key, (undo ? delta.before : delta.after).deepCopy());
+
+        modifiedElements.append(step.entry);
+    }
+
+    void apply(const Operation &operation, bool undo) {
+        replaying = true;
+
+        QList<QSharedPointer<Element> > modifiedElements;
+        bool idChanged = false;
+        const int count = operation.steps.count();
+        for (int i = 0; i < count; ++i) {
+            const Step &step = operation.steps[undo ? count - 1 - i : i];
+            switch (step.kind) {
+            case Step::Insertion:
+                if (undo)
+                    model->removeRowList(step.rows);
+                else
+                    model->restoreElements(step.rows, step.elements);
+                break;
+            case Step::Removal:
+                if (undo)
+                    model->restoreElements(step.rows, step.elements);
+                else
+                    model->removeRowList(step.rows);
+                break;
+            case Step::Replacement: {
+                QMap<int, QSharedPointer<Element> > replacements;
+                for (int r = 0; r < step.rows.count(); ++r)
+                    replacements.insert(step.rows[r], undo ? step.previousElements[r] : step.elements[r]);
+                model->replaceElements(replacements);
+                break;
+            }
+            case Step::Modification:
+                applyModification(step, undo, modifiedElements, idChanged);
+                break;
+            case Step::ElementModification:
+                restoreElementState(step.element.data(), (undo ? step.stateBefore : step.stateAfter).data());
+                modifiedElements.append(step.element);
+                break;
+            }
+        }
+
+        if (!modifiedElements.isEmpty()) {
+            /// Other entries may have referred to an entry by its previous id
+            if (idChanged)
+                model->invalidateCache();
+            notifyModified(modifiedElements);
+        }
+
+        replaying = false;
+    }
+
+    /// Notify the model about modified elements with a single
+    /// notification per range of contiguous rows
+    void notifyModified(const QList<QSharedPointer<Element> > &modifiedElements) {
+        const File *file = model->bibliographyFile();
+        if (file == nullptr) return;
+
+        QSet<const Element *> modified;
+        modified.reserve(modifiedElements.count());
+        for (const auto &element : modifiedElements)
+            modified.insert(element.data());
+        QList<int> rows;
+        for (int row = 0; row < file->count(); ++row)
+            if (modified.contains(file->at(row).data()))
+                rows << row;
+
+        int firstRow = -1, lastRow = -1;
+        for (int row : const_cast<const QList<int> &>(rows)) {
+            if (row != lastRow + 1) {
+                model->elementsChanged(firstRow, lastRow);
+                firstRow = row;
+            }
+            lastRow = row;
+        }
+        model->elementsChanged(firstRow, lastRow);
+    }
+};
+
+const int UndoJournal::Private::maxOperations = 256;
+
+
+UndoJournal::UndoJournal(FileModel *model)
+        : QObject(model), d(new UndoJournal::Private(model, this))
+{
+    /// nothing
+}
+
+UndoJournal::~UndoJournal()
+{
+    delete d;
+}
+
+void UndoJournal::beginOperation(const QString &label)
+{
+    if (d->replaying) return;
+
+    if (d->depth == 0) {
+        d->current.label = label;
+        d->current.steps.clear();
+    }
+    ++d->depth;
+}
+
+void UndoJournal::endOperation()
+{
+    if (d->replaying || d->depth == 0) return;
+    if (--d->depth > 0) return;
+
+    d->resolveSnapshots();
+    if (d->current.steps.isEmpty()) return;
+
+    /// A new operation makes all undone operations impossible to redo
+    d->operations.resize(d->position);
+    d->operations.append(d->current);
+    d->current = Private::Operation();
+    if (d->operations.count() > Private::maxOperations)
+        d->operations.remove(0, d->operations.count() - Private::maxOperations);
+    d->position = d->operations.count();
+
+    emit changed();
+}
+
+void UndoJournal::aboutToModify(const QSharedPointer<Entry> &entry, const QString &key)
+{
+    if (!d->isRecording() || entry.isNull()) return;
+    d->takeSnapshot(entry, key);
+}
+
+void UndoJournal::aboutToModify(const QSharedPointer<Element> &element)
+{
+    if (!d->isRecording() || element.isNull()) return;
+    const QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
+    if (!entry.isNull())
+        d->takeSnapshot(entry, QString());
+    else
+        d->takeElementSnapshot(element);
+}
+
+void UndoJournal::recordInsertion(const QList<int> &rows, const QList<QSharedPointer<Element> > &elements)
+{
+    if (!d->isRecording() || rows.isEmpty()) return;
+
+    Private::Step step;
+    step.kind = Private::Step::Insertion;
+    step.rows = rows;
+    step.elements = elements;
+    d->current.steps.append(step);
+}
+
+void UndoJournal::recordRemoval(const QList<int> &rows, const QList<QSharedPointer<Element> > &elements)
+{
+    if (!d->isRecording() || rows.isEmpty()) return;
+
+    Private::Step step;
+    step.kind = Private::Step::Removal;
+    step.rows = rows;
+    step.elements = elements;
+    d->current.steps.append(step);
+}
+
+void UndoJournal::recordReplacement(const QList<int> &rows, const QList<QSharedPointer<Element> > &previousElements, const QList<QSharedPointer<Element> > &elements)
+{
+    if (!d->isRecording() || rows.isEmpty()) return;
+
+    Private::Step step;
+    step.kind = Private::Step::Replacement;
+    step.rows = rows;
+    step.previousElements = previousElements;
+    step.elements = elements;
+    d->current.steps.append(step);
+}
+
+bool UndoJournal::canUndo() const
+{
+    return d->depth == 0 && d->position > 0;
+}
+
+bool UndoJournal::canRedo() const
+{
+    return d->depth == 0 && d->position < d->operations.count();
+}
+
+QString UndoJournal::undoLabel() const
+{
+    return canUndo() ? d->operations[d->position - 1].label : QString();
+}
+
+QString UndoJournal::redoLabel() const
+{
+    return canRedo() ? d->operations[d->position].label : QString();
+}
+
+void UndoJournal::undo()
+{
+    if (!canUndo()) return;
+
+    --d->position;
+    d->apply(d->operations[d->position], true);
+    emit changed();
+}
+
+void UndoJournal::redo()
+{
+    if (!canRedo()) return;
+
+    d->apply(d->operations[d->position], false);
+    ++d->position;
+    emit changed();
+}
+
+void UndoJournal::clear()
+{
+    if (d->replaying) return;
+
+    const bool hadOperations = !d->operations.isEmpty();
+    d->operations.clear();
+    d->position = 0;
+    d->depth = 0;
+    d->current = Private::Operation();
+    d->snapshots.clear();
+    d->elementSnapshots.clear();
+    if (hadOperations)
+        emit changed();
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_DATA_UNDOJOURNAL_H
+#define KBIBTEX_DATA_UNDOJOURNAL_H
+
+#include <QObject>
+#include <QList>
+#include <QSharedPointer>
+
+#include "kbibtexdata_export.h"
+
+class Element;
+class Entry;
+class FileModel;
+
+/**
+ * Records modifications of a @see FileModel's bibliography as operations
+ * which can be undone and redone.
+ *
+ * Insertions, removals and replacements of elements are recorded by the
+ * model itself. Modifications of elements in place have to be announced
+ * by calling @see aboutToModify before modifying an element, which lets the
+ * journal record the modifications only once the operation has ended.
+ * Only the fields of entries which actually changed are kept, no copies
+ * of entries. The model gets notified about elements modified by undoing
+ * or redoing, invalidating any data it derived from them.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXDATA_EXPORT UndoJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UndoJournal(FileModel *model);
+    ~UndoJournal() override;
+
+    /**
+     * Start recording an operation shown to the user as @p label.
+     * All changes up to the matching call of @see endOperation will be
+     * undone and redone together. Operations may be nested, in which case
+     * the outermost operation includes all changes of nested ones.
+     */
+    void beginOperation(const QString &label);
+    void endOperation();
+
+    /**
+     * Announce that @p entry is about to be modified in place as part of
+     * the current operation. If @p key is given, only changes to this field
+     * will be recorded, with "^id" and "^type" referring to the entry's id
+     * and type. Otherwise changes to any field, the id or the type will be.
+     * Has no effect if no operation is being recorded.
+     */
+    void aboutToModify(const QSharedPointer<Entry> &entry, const QString &key = QString());
+    /// Announce that @p element, which may be an entry, a macro, a preamble
+    /// or a comment, is about to be modified in place as a whole
+    void aboutToModify(const QSharedPointer<Element> &element);
+
+    /// Record that @p elements got inserted at @p rows (ascending)
+    void recordInsertion(const QList<int> &rows, const QList<QSharedPointer<Element> > &elements);
+    /// Record that @p elements got removed from @p rows (ascending)
+    void recordRemoval(const QList<int> &rows, const QList<QSharedPointer<Element> > &elements);
+    /// Record that the elements in @p rows (ascending) got replaced
+    void recordReplacement(const QList<int> &rows, const QList<QSharedPointer<Element> > &previousElements, const QList<QSharedPointer<Element> > &elements);
+
+    bool canUndo() const;
+    bool canRedo() const;
+    QString undoLabel() const;
+    QString redoLabel() const;
+
+public slots:
+    void undo();
+    void redo();
+    /// Forget all recorded operations, e.g. when another file gets loaded
+    void clear();
+
+signals:
+    /// The availability or labels of undo and redo have changed
+    void changed();
+
+private:
+    class Private;
+    Private *d;
+};
+
+#endif // KBIBTEX_DATA_UNDOJOURNAL_H
@@ -540,6 +540,30 @@ bool Value::contains(const ValueItem &item) const
     return false;
 }
 
+Value Value::deepCopy() const
+{
+    Value result;
+    result.reserve(count());
+    for (const QSharedPointer<ValueItem> &item : *this) {
+        if (const Person *person = dynamic_cast<const Person *>(item.data()))
+            result.append(QSharedPointer<Person>(new Person(*person)));
+        else if (const Keyword *keyword = dynamic_cast<const Keyword *>(item.data()))
+            result.append(QSharedPointer<Keyword>(new Keyword(*keyword)));
+        else if (const MacroKey *macroKey = dynamic_cast<const MacroKey *>(item.data()))
+            result.append(QSharedPointer<MacroKey>(new MacroKey(*macroKey)));
+        else if (const VerbatimText *verbatimText = dynamic_cast<const VerbatimText *>(item.data()))
+            result.append(QSharedPointer<VerbatimText>(new VerbatimText(*verbatimText)));
+        else if (const PlainText *plainText = dynamic_cast<const PlainText *>(item.data()))
+            result.append(QSharedPointer<PlainText>(new PlainText(*plainText)));
+        else {
+            /// Sharing an item is better than losing it
+            Q_ASSERT_X(false, "Value::deepCopy", "Unknown ValueItem subclass");
+            result.append(item);
+        }
+    }
+    return result;
+}
+
 Value &Value::operator=(const Value &rhs)
 {
     return static_cast<Value &>(QVector<QSharedPointer<ValueItem> >::operator =((rhs)));
@@ -630,13 +654,18 @@ QDebug operator<<(QDebug dbg, const Value &value) {
 
 
 QString PlainTextValue::text(const Value &value)
+{
+    return text(value, currentPersonNameFormatting());
+}
+
+QString PlainTextValue::text(const Value &value, const QString &nameFormatting)
 {
     ValueItemType vit = VITOther;
     ValueItemType lastVit = VITOther;
 
     QString result;
     for (const auto &valueItem : value) {
-        QString nextText = text(*valueItem, vit);
+        QString nextText = text(*valueItem, nameFormatting, vit);
         if (!nextText.isEmpty()) {
             if (lastVit == VITPerson && vit == VITPerson)
                 result.append(i18n(" and ")); // TODO proper list of authors/editors, not just joined by "and"
@@ -664,19 +693,24 @@ QString PlainTextValue::text(const QSharedPointer<const ValueItem> &valueItem)
 QString PlainTextValue::text(const ValueItem &valueItem)
 {
     ValueItemType vit;
-    return text(valueItem, vit);
+    return text(valueItem, currentPersonNameFormatting(), vit);
 }
 
-QString PlainTextValue::text(const ValueItem &valueItem, ValueItemType &vit)
+QString PlainTextValue::currentPersonNameFormatting()
 {
-    QString result;
-    vit = VITOther;
-
 #ifdef HAVE_KF5
     if (notificationListener == nullptr)
         notificationListener = new PlainTextValue();
 #endif // HAVE_KF5
 
+    return personNameFormatting;
+}
+
+QString PlainTextValue::text(const ValueItem &valueItem, const QString &nameFormatting, ValueItemType &vit)
+{
+    QString result;
+    vit = VITOther;
+
     bool isVerbatim = false;
     const PlainText *plainText = dynamic_cast<const PlainText *>(&valueItem);
     if (plainText != nullptr) {
@@ -688,7 +722,7 @@ QString PlainTextValue::text(const ValueItem &valueItem, ValueItemType &vit)
         } else {
             const Person *person = dynamic_cast<const Person *>(&valueItem);
             if (person != nullptr) {
-                result = Person::transcribePersonName(person, personNameFormatting);
+                result = Person::transcribePersonName(person, nameFormatting);
                 vit = VITPerson;
             } else {
                 const Keyword *keyword = dynamic_cast<const Keyword *>(&valueItem);
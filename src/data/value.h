@@ -270,6 +270,13 @@ public:
 
     bool contains(const ValueItem &item) const;
 
+    /**
+      * Create a copy of this value whose items are copies as well,
+      * unlike the copy constructor which shares the items with this value.
+      * @return copy sharing no items with this value
+      */
+    Value deepCopy() const;
+
     Value &operator=(const Value &rhs);
     Value &operator=(Value &&rhs);
     Value &operator<<(const QSharedPointer<ValueItem> &value);
@@ -289,6 +296,13 @@ public:
     static QString text(const Value &value);
     static QString text(const ValueItem &valueItem);
     static QString text(const QSharedPointer<const ValueItem> &valueItem);
+    /// Variant not depending on the configured person name formatting,
+    /// safe to be used in background threads
+    static QString text(const Value &value, const QString &nameFormatting);
+
+    /// Snapshot of the configured person name formatting;
+    /// only to be called from the main thread
+    static QString currentPersonNameFormatting();
 
 #ifdef HAVE_KF5
     void notificationEvent(int eventId) override;
@@ -306,7 +320,7 @@ private:
     static const QString personNameFormatting;
 #endif // HAVE_KF5
 
-    static QString text(const ValueItem &valueItem, ValueItemType &vit);
+    static QString text(const ValueItem &valueItem, const QString &nameFormatting, ValueItemType &vit);
 
 };
 
@@ -32,6 +32,8 @@
 #include <QPushButton>
 #include <QFontDatabase>
 #include <QRegularExpression>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 
 #include <KLocalizedString>
 #include <KLineEdit>
@@ -39,6 +41,7 @@
 #include <KRun>
 #include <KTextEditor/Document>
 #include <KTextEditor/Editor>
+#include <KTextEditor/MarkInterface>
 #include <KTextEditor/View>
 #include <kio_version.h>
 
@@ -50,6 +53,7 @@
 #include "fileimporterbibtex.h"
 #include "fileexporterbibtex.h"
 #include "file.h"
+#include "completionindex.h"
 #include "fieldinput.h"
 #include "entry.h"
 #include "macro.h"
@@ -176,19 +180,13 @@ QIcon EntryConfiguredWidget::icon()
 
 void EntryConfiguredWidget::setFile(const File *file)
 {
+    /// Completions are shared between all widgets and kept up-to-date by
+    /// the file's index, so this does not require scanning the file
+    const CompletionIndex *completionIndex = file != nullptr ? file->completionIndex() : nullptr;
     for (QMap<QString, FieldInput *>::Iterator it = bibtexKeyToWidget.begin(); it != bibtexKeyToWidget.end(); ++it) {
         it.value()->setFile(file);
-        if (file != nullptr) {
-            /// list of unique values for same field
-            QStringList list = file->uniqueEntryValuesList(it.key());
-            /// for crossref fields, add all entries' ids
-            if (it.key().toLower() == Entry::ftCrossRef)
-                list.append(file->allKeys(File::etEntry));
-            /// add macro keys
-            list.append(file->allKeys(File::etMacro));
-
-            it.value()->setCompletionItems(list);
-        }
+        if (completionIndex != nullptr)
+            it.value()->setCompletionItems(completionIndex->completions(it.key()));
     }
 
     ElementWidget::setFile(file);
@@ -1150,17 +1148,120 @@ void PreambleWidget::createGUI()
 }
 
 
+/// Check that a parsed file consists of exactly one element of the given class
+static bool isSingleElementOfClass(const File *file, SourceWidget::ElementClass elementClass, QString &message)
+{
+    if (file == nullptr || file->count() != 1) {
+        message = i18n("Given source code does not parse as one single BibTeX element.");
+        return false;
+    }
+
+    bool result = false;
+    switch (elementClass) {
+    case SourceWidget::elementEntry: {
+        QSharedPointer<Entry> entry = file->first().dynamicCast<Entry>();
+        result = !entry.isNull();
+        if (!result) message = i18n("Given source code does not parse as one single BibTeX entry.");
+    }
+    break;
+    case SourceWidget::elementMacro: {
+        QSharedPointer<Macro> macro = file->first().dynamicCast<Macro>();
+        result = !macro.isNull();
+        if (!result) message = i18n("Given source code does not parse as one single BibTeX macro.");
+    }
+    break;
+    case SourceWidget::elementPreamble: {
+        QSharedPointer<Preamble> preamble = file->first().dynamicCast<Preamble>();
+        result = !preamble.isNull();
+        if (!result) message = i18n("Given source code does not parse as one single BibTeX preamble.");
+    }
+    break;
+    // case elementComment // TODO?
+    default:
+        message = QString(QStringLiteral("elementClass is unknown: %1")).arg(elementClass);
+        result = false;
+    }
+
+    return result;
+}
+
+/**
+ * Parses a SourceWidget's text to validate it, reusing the same
+ * importer for every run. Runs may happen in a background thread,
+ * but never more than one at a time.
+ */
+class SourceValidator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        bool isValid;
+        QString message;
+        QVector<QPair<FileImporter::MessageSeverity, QString> > importerMessages;
+    };
+
+    SourceValidator()
+            : QObject(nullptr), importer(new FileImporterBibTeX(this)) {
+        /// Messages are emitted in whichever thread validates
+        connect(importer, &FileImporterBibTeX::message, this, &SourceValidator::addMessage, Qt::DirectConnection);
+    }
+
+    Result validate(const QString &text, SourceWidget::ElementClass elementClass) {
+        collectedMessages.clear();
+        const QScopedPointer<const File> file(importer->fromString(text));
+
+        Result result;
+        result.isValid = isSingleElementOfClass(file.data(), elementClass, result.message);
+        result.importerMessages = collectedMessages;
+        collectedMessages.clear();
+        return result;
+    }
+
+    /// Abort the current run, may be called from any thread
+    void cancel() {
+        importer->cancel();
+    }
+
+private slots:
+    void addMessage(const FileImporter::MessageSeverity severity, const QString &messageText) {
+        collectedMessages.append(qMakePair(severity, messageText));
+    }
+
+private:
+    FileImporterBibTeX *importer;
+    QVector<QPair<FileImporter::MessageSeverity, QString> > collectedMessages;
+};
+
 class SourceWidget::Private
 {
+private:
+    SourceWidget *p;
+
 public:
     KComboBox *messages;
     QPushButton *buttonRestore;
     FileImporterBibTeX *importerBibTeX;
+    FileExporterBibTeX *exporterBibTeX;
     DelayedExecutionTimer *delayedExecutionTimer;
+    SourceValidator *validator;
+    QFutureWatcher<SourceValidator::Result> *validationWatcher;
+    /// Incremented on every change of text or element class,
+    /// results of validations started before are stale
+    int revision, validationRevision;
+    bool validationPending;
 
     Private(SourceWidget *parent)
-            : messages(nullptr), buttonRestore(nullptr), importerBibTeX(new FileImporterBibTeX(parent)), delayedExecutionTimer(new DelayedExecutionTimer(1500, 500, parent)) {
-        /// nothing
+            : p(parent), messages(nullptr), buttonRestore(nullptr), importerBibTeX(new FileImporterBibTeX(parent)), exporterBibTeX(new FileExporterBibTeX(parent)), delayedExecutionTimer(new DelayedExecutionTimer(1500, 500, parent)), validator(new SourceValidator()), validationWatcher(new QFutureWatcher<SourceValidator::Result>(parent)), revision(0), validationRevision(-1), validationPending(false) {
+        exporterBibTeX->setEncoding(QStringLiteral("utf-8"));
+    }
+
+    ~Private() {
+        if (validationWatcher->isRunning()) {
+            validator->cancel();
+            validationWatcher->waitForFinished();
+        }
+        delete validator;
     }
 
     void addMessage(const FileImporter::MessageSeverity severity, const QString &messageText)
@@ -1168,6 +1269,56 @@ public:
         const QIcon icon = severity == FileImporter::SeverityInfo ? QIcon::fromTheme(QStringLiteral("dialog-information")) : (severity == FileImporter::SeverityWarning ? QIcon::fromTheme(QStringLiteral("dialog-warning")) : (severity == FileImporter::SeverityError ? QIcon::fromTheme(QStringLiteral("dialog-error")) : QIcon::fromTheme(QStringLiteral("dialog-question"))));
         messages->addItem(icon, messageText);
     }
+
+    void startValidation() {
+        /// Only one validation at a time, the pending one
+        /// will be started once the current one is finished
+        validationPending = true;
+        if (validationWatcher->isRunning()) return;
+
+        validationPending = false;
+        validationRevision = revision;
+        validationWatcher->setFuture(QtConcurrent::run(validator, &SourceValidator::validate, p->document->text(), p->elementClass));
+    }
+
+    void cancelValidation() {
+        ++revision;
+        if (validationWatcher->isRunning())
+            validator->cancel();
+    }
+
+    SourceValidator::Result validateNow() {
+        /// Validator is not thread-safe, so wait for any background run
+        cancelValidation();
+        validationWatcher->waitForFinished();
+        return validator->validate(p->document->text(), p->elementClass);
+    }
+
+    void showResult(const SourceValidator::Result &result) {
+        static const QRegularExpression lineNumberRegExp(QStringLiteral("\\bline (\\d+)"));
+
+        messages->clear();
+        KTextEditor::MarkInterface *markInterface = qobject_cast<KTextEditor::MarkInterface *>(p->document);
+        if (markInterface != nullptr)
+            markInterface->clearMarks();
+
+        for (const auto &importerMessage : result.importerMessages) {
+            addMessage(importerMessage.first, importerMessage.second);
+
+            /// Mark the lines of warnings and errors in the document,
+            /// the importer counts lines starting at 1
+            if (markInterface == nullptr || importerMessage.first == FileImporter::SeverityInfo) continue;
+            const QRegularExpressionMatch match = lineNumberRegExp.match(importerMessage.second);
+            const int line = match.hasMatch() ? match.captured(1).toInt() - 1 : -1;
+            if (line >= 0 && line < p->document->lines())
+                markInterface->addMark(line, importerMessage.first == FileImporter::SeverityWarning ? KTextEditor::MarkInterface::Warning : KTextEditor::MarkInterface::Error);
+        }
+
+        if (!result.message.isEmpty())
+            addMessage(result.isValid ? FileImporter::SeverityInfo : FileImporter::SeverityError, result.message);
+        else if (messages->count() == 0)
+            addMessage(FileImporter::SeverityInfo, i18n("No issues detected"));
+    }
 };
 
 SourceWidget::SourceWidget(QWidget *parent)
@@ -1177,7 +1328,9 @@ SourceWidget::SourceWidget(QWidget *parent)
 
     connect(document, &KTextEditor::Document::textChanged, d->delayedExecutionTimer, &DelayedExecutionTimer::trigger);
     connect(document, &KTextEditor::Document::textChanged, d->messages, &KComboBox::clear);
+    connect(document, &KTextEditor::Document::textChanged, this, &SourceWidget::cancelValidation);
     connect(d->delayedExecutionTimer, &DelayedExecutionTimer::triggered, this, &SourceWidget::updateMessage);
+    connect(d->validationWatcher, &QFutureWatcher<SourceValidator::Result>::finished, this, &SourceWidget::validationFinished);
 }
 
 SourceWidget::~SourceWidget()
@@ -1189,6 +1342,7 @@ SourceWidget::~SourceWidget()
 void SourceWidget::setElementClass(ElementClass elementClass)
 {
     this->elementClass = elementClass;
+    d->cancelValidation();
     updateMessage();
 }
 
@@ -1234,9 +1388,7 @@ bool SourceWidget::reset(QSharedPointer<const Element> element)
     /// resetting the widget's value
     disconnect(document, &KTextEditor::Document::textChanged, this, &SourceWidget::gotModified);
 
-    FileExporterBibTeX exporter(this);
-    exporter.setEncoding(QStringLiteral("utf-8"));
-    const QString exportedText = exporter.toString(element, m_file);
+    const QString exportedText = d->exporterBibTeX->toString(element, m_file);
     if (!exportedText.isEmpty()) {
         originalText = exportedText;
         document->setText(originalText);
@@ -1249,52 +1401,14 @@ bool SourceWidget::reset(QSharedPointer<const Element> element)
 
 bool SourceWidget::validate(QWidget **widgetWithIssue, QString &message) const
 {
-    message.clear();
-    d->messages->clear();
+    const SourceValidator::Result result = d->validateNow();
+    d->showResult(result);
 
-    const QString text = document->text();
-    connect(d->importerBibTeX, &FileImporterBibTeX::message, this, &SourceWidget::addMessage);
-    const QScopedPointer<const File> file(d->importerBibTeX->fromString(text));
-    disconnect(d->importerBibTeX, &FileImporterBibTeX::message, this, &SourceWidget::addMessage);
-    if (file.isNull() || file->count() != 1) {
-        if (widgetWithIssue != nullptr) *widgetWithIssue = document->views().first(); ///< We create one view initially, so this should never fail
-        message = i18n("Given source code does not parse as one single BibTeX element.");
-        return false;
-    }
-
-    bool result = false;
-    switch (elementClass) {
-    case elementEntry: {
-        QSharedPointer<Entry> entry = file->first().dynamicCast<Entry>();
-        result = !entry.isNull();
-        if (!result) message = i18n("Given source code does not parse as one single BibTeX entry.");
-    }
-    break;
-    case elementMacro: {
-        QSharedPointer<Macro> macro = file->first().dynamicCast<Macro>();
-        result = !macro.isNull();
-        if (!result) message = i18n("Given source code does not parse as one single BibTeX macro.");
-    }
-    break;
-    case elementPreamble: {
-        QSharedPointer<Preamble> preamble = file->first().dynamicCast<Preamble>();
-        result = !preamble.isNull();
-        if (!result) message = i18n("Given source code does not parse as one single BibTeX preamble.");
-    }
-    break;
-    // case elementComment // TODO?
-    default:
-        message = QString(QStringLiteral("elementClass is unknown: %1")).arg(elementClass);
-        result = false;
-    }
-
-    if (!result && widgetWithIssue != nullptr)
+    message = result.isValid ? QString() : result.message;
+    if (!result.isValid && widgetWithIssue != nullptr)
         *widgetWithIssue = document->views().first(); ///< We create one view initially, so this should never fail
 
-    if (message.isEmpty() && d->messages->count() == 0)
-        d->addMessage(FileImporter::SeverityInfo, i18n("No issues detected"));
-
-    return result;
+    return result.isValid;
 }
 
 void SourceWidget::setReadOnly(bool isReadOnly)
@@ -1335,6 +1449,13 @@ void SourceWidget::createGUI()
     KTextEditor::View *view = document->createView(this);
     layout->addWidget(view, 0, 0, 1, 2);
 
+    /// Lines with issues found during validation get marked
+    KTextEditor::MarkInterface *markInterface = qobject_cast<KTextEditor::MarkInterface *>(document);
+    if (markInterface != nullptr) {
+        markInterface->setMarkPixmap(KTextEditor::MarkInterface::Warning, QIcon::fromTheme(QStringLiteral("dialog-warning")).pixmap(16, 16));
+        markInterface->setMarkPixmap(KTextEditor::MarkInterface::Error, QIcon::fromTheme(QStringLiteral("dialog-error")).pixmap(16, 16));
+    }
+
     d->messages = new KComboBox(this);
     layout->addWidget(d->messages, 1, 0, 1, 1);
 
@@ -1356,22 +1477,23 @@ void SourceWidget::reset()
     connect(document, &KTextEditor::Document::textChanged, this, &SourceWidget::gotModified);
 }
 
-void SourceWidget::addMessage(const FileImporter::MessageSeverity severity, const QString &messageText)
+void SourceWidget::updateMessage()
 {
-    d->addMessage(severity, messageText);
+    d->startValidation();
 }
 
-void SourceWidget::updateMessage()
+void SourceWidget::cancelValidation()
 {
-    QString message;
-    const bool validationResult = validate(nullptr, message);
+    d->cancelValidation();
+}
 
-    if (!message.isEmpty()) {
-        if (validationResult)
-            addMessage(FileImporter::SeverityInfo, message);
-        else
-            addMessage(FileImporter::SeverityError, message);
-    }
+void SourceWidget::validationFinished()
+{
+    /// Discard results for text which has been changed in the meantime
+    if (d->validationRevision == d->revision)
+        d->showResult(d->validationWatcher->result());
+    if (d->validationPending)
+        d->startValidation();
 }
 
 #include "elementwidgets.moc"
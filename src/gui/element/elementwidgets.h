@@ -326,8 +326,9 @@ public:
 
 private slots:
     void reset();
-    void addMessage(const FileImporter::MessageSeverity severity, const QString &messageText);
     void updateMessage();
+    void cancelValidation();
+    void validationFinished();
 
 private:
     class Private;
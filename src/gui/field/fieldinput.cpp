@@ -29,6 +29,7 @@
 #include <KLocalizedString>
 
 #include "file.h"
+#include "completionindex.h"
 #include "entry.h"
 #include "fieldlineedit.h"
 #include "fieldlistedit.h"
@@ -254,8 +255,7 @@ public:
 
         /// create a standard input dialog with a list of all keys (ids of entries)
         bool ok = false;
-        QStringList list = bibtexFile->allKeys(File::etEntry);
-        list.sort();
+        QStringList list = bibtexFile->completionIndex()->keys(File::etEntry);
 
         /// remove own id
         const Entry *entry = dynamic_cast<const Entry *>(element);
@@ -105,8 +105,7 @@ public:
         if (!value.isEmpty()) {
             if (typeFlag == KBibTeX::tfSource) {
                 /// simple case: field's value is to be shown as BibTeX code, including surrounding curly braces
-                FileExporterBibTeX exporter(parent);
-                text = exporter.valueToBibTeX(value);
+                text = FileExporterBibTeX::valueToBibTeX(value);
                 result = true;
             } else {
                 /// except for the source view type flag, type flag views do not support composed values,
@@ -152,6 +151,10 @@ public:
         return result;
     }
 
+    void resetTypeFlag() {
+        typeFlag = determineTypeFlag(Value(), preferredTypeFlag, typeFlags);
+    }
+
     bool apply(Value &value) const {
         value.clear();
         /// Remove unnecessary white space from input
@@ -480,6 +483,11 @@ bool FieldLineEdit::validate(QWidget **widgetWithIssue, QString &message) const
     return d->validate(widgetWithIssue, message);
 }
 
+void FieldLineEdit::resetTypeFlag()
+{
+    d->resetTypeFlag();
+}
+
 void FieldLineEdit::setReadOnly(bool isReadOnly)
 {
     MenuLineEdit::setReadOnly(isReadOnly);
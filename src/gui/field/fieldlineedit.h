@@ -44,6 +44,8 @@ public:
     bool reset(const Value &value);
     bool apply(Value &value) const;
     bool validate(QWidget **widgetWithIssue, QString &message) const;
+    /// Forget the type of a previous value, as if this line edit was new
+    void resetTypeFlag();
     void setReadOnly(bool) override;
 
     void setFile(const File *file);
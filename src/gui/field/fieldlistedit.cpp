@@ -21,7 +21,8 @@
 
 #include <QApplication>
 #include <QClipboard>
-#include <QScrollArea>
+#include <QScrollBar>
+#include <QEvent>
 #include <QLayout>
 #include <QSignalMapper>
 #include <QCheckBox>
@@ -44,6 +45,7 @@
 
 #include "fileinfo.h"
 #include "file.h"
+#include "completionindex.h"
 #include "entry.h"
 #include "fileimporterbibtex.h"
 #include "fileexporterbibtex.h"
@@ -57,12 +59,31 @@ class FieldListEdit::FieldListEditProtected
 private:
     FieldListEdit *p;
     const int innerSpacing;
-    QSignalMapper *smRemove, *smGoUp, *smGoDown;
-    QVBoxLayout *layout;
+    QSignalMapper *smRemove, *smGoUp, *smGoDown, *smTextChanged;
     KBibTeX::TypeFlag preferredTypeFlag;
     KBibTeX::TypeFlags typeFlags;
 
+    /// One row per value item, shown in a line edit only while visible
+    struct Row {
+        Value value;
+        /// Text entered by the user which did not validate when
+        /// the row was scrolled out of view; empty otherwise
+        QString invalidText;
+    };
+    QVector<Row> rows;
+    /// Row shown in the first line edit of the pool
+    int firstRow;
+    /// Number of line edits currently showing a row
+    int visibleCount;
+    int rowHeight;
+    /// Row each line edit of the pool has been reset to, -1 if none
+    QVector<int> boundRows;
+    /// Line edits whose text got modified by the user since last reset
+    QSet<FieldLineEdit *> modifiedLineEdits;
+    bool isBinding;
+
 public:
+    /// Pool of line edits, only as many as rows fit into the visible area
     QList<FieldLineEdit *> lineEditList;
     QWidget *pushButtonContainer;
     QBoxLayout *pushButtonContainerLayout;
@@ -70,15 +91,16 @@ public:
     const File *file;
     QString fieldKey;
     QWidget *container;
-    QScrollArea *scrollArea;
+    QScrollBar *scrollBar;
     bool m_isReadOnly;
     QStringList completionItems;
 
     FieldListEditProtected(KBibTeX::TypeFlag ptf, KBibTeX::TypeFlags tf, FieldListEdit *parent)
-            : p(parent), innerSpacing(4), preferredTypeFlag(ptf), typeFlags(tf), file(nullptr), m_isReadOnly(false) {
+            : p(parent), innerSpacing(4), preferredTypeFlag(ptf), typeFlags(tf), firstRow(0), visibleCount(0), rowHeight(0), isBinding(false), file(nullptr), m_isReadOnly(false) {
         smRemove = new QSignalMapper(parent);
         smGoUp = new QSignalMapper(parent);
         smGoDown = new QSignalMapper(parent);
+        smTextChanged = new QSignalMapper(parent);
         setupGUI();
     }
 
@@ -88,21 +110,31 @@ public:
     void setupGUI() {
         QBoxLayout *outerLayout = new QVBoxLayout(p);
         outerLayout->setMargin(0);
-        outerLayout->setSpacing(0);
-        scrollArea = new QScrollArea(p);
-        outerLayout->addWidget(scrollArea);
-
-        container = new QWidget(scrollArea->viewport());
-        container->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Minimum);
-        scrollArea->setWidget(container);
-        layout = new QVBoxLayout(container);
-        layout->setMargin(0);
-        layout->setSpacing(innerSpacing);
-
-        pushButtonContainer = new QWidget(container);
+        outerLayout->setSpacing(innerSpacing);
+
+        QBoxLayout *listLayout = new QHBoxLayout();
+        listLayout->setMargin(0);
+        listLayout->setSpacing(0);
+        outerLayout->addLayout(listLayout, 100);
+
+        /// Line edits get positioned manually inside this container,
+        /// see layoutLineEdits()
+        container = new QWidget(p);
+        container->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
+        container->setBackgroundRole(QPalette::Base);
+        container->setAutoFillBackground(true);
+        container->installEventFilter(p);
+        listLayout->addWidget(container);
+
+        scrollBar = new QScrollBar(Qt::Vertical, p);
+        scrollBar->setVisible(false);
+        listLayout->addWidget(scrollBar);
+        connect(scrollBar, &QScrollBar::valueChanged, p, &FieldListEdit::firstVisibleRowChanged);
+
+        pushButtonContainer = new QWidget(p);
         pushButtonContainerLayout = new QHBoxLayout(pushButtonContainer);
         pushButtonContainerLayout->setMargin(0);
-        layout->addWidget(pushButtonContainer);
+        outerLayout->addWidget(pushButtonContainer);
 
         addLineButton = new QPushButton(QIcon::fromTheme(QStringLiteral("list-add")), i18n("Add"), pushButtonContainer);
         addLineButton->setObjectName(QStringLiteral("addButton"));
@@ -110,15 +142,10 @@ public:
         connect(addLineButton, &QPushButton::clicked, p, &FieldListEdit::modified);
         pushButtonContainerLayout->addWidget(addLineButton);
 
-        layout->addStretch(100);
-
         connect(smRemove, static_cast<void(QSignalMapper::*)(QWidget *)>(&QSignalMapper::mapped), p, &FieldListEdit::lineRemove);
         connect(smGoDown, static_cast<void(QSignalMapper::*)(QWidget *)>(&QSignalMapper::mapped), p, &FieldListEdit::lineGoDown);
         connect(smGoUp, static_cast<void(QSignalMapper::*)(QWidget *)>(&QSignalMapper::mapped), p, &FieldListEdit::lineGoUp);
-
-        scrollArea->setBackgroundRole(QPalette::Base);
-        scrollArea->ensureWidgetVisible(container);
-        scrollArea->setWidgetResizable(true);
+        connect(smTextChanged, static_cast<void(QSignalMapper::*)(QWidget *)>(&QSignalMapper::mapped), p, &FieldListEdit::lineTextChanged);
     }
 
     void addButton(QPushButton *button) {
@@ -126,26 +153,18 @@ public:
         pushButtonContainerLayout->addWidget(button);
     }
 
-    int recommendedHeight() {
-        int heightHint = 0;
-
-        for (const auto *fieldLineEdit : const_cast<const QList<FieldLineEdit *> &>(lineEditList))
-            heightHint += fieldLineEdit->sizeHint().height();
-
-        heightHint += lineEditList.count() * innerSpacing;
-        heightHint += addLineButton->sizeHint().height();
-
-        return heightHint;
-    }
-
     FieldLineEdit *addFieldLineEdit() {
         FieldLineEdit *le = new FieldLineEdit(preferredTypeFlag, typeFlags, false, container);
         le->setFile(file);
+        le->setElement(p->m_element);
+        le->setFieldKey(fieldKey);
+        le->setCompletionItems(completionItems);
         le->setAcceptDrops(false);
         le->setReadOnly(m_isReadOnly);
         le->setInnerWidgetsTransparency(true);
-        layout->insertWidget(layout->count() - 2, le);
+        le->setVisible(false);
         lineEditList.append(le);
+        boundRows.append(-1);
 
         QPushButton *remove = new QPushButton(QIcon::fromTheme(QStringLiteral("list-remove")), QString(), le);
         remove->setToolTip(i18n("Remove value"));
@@ -165,56 +184,191 @@ public:
         connect(goUp, &QPushButton::clicked, smGoUp, static_cast<void(QSignalMapper::*)()>(&QSignalMapper::map));
         smGoUp->setMapping(goUp, le);
 
-        connect(le, &FieldLineEdit::textChanged, p, &FieldListEdit::modified);
+        connect(le, &FieldLineEdit::textChanged, smTextChanged, static_cast<void(QSignalMapper::*)()>(&QSignalMapper::map));
+        smTextChanged->setMapping(le, le);
 
         return le;
     }
 
-    void removeAllFieldLineEdits() {
-        while (!lineEditList.isEmpty()) {
-            FieldLineEdit *fieldLineEdit = *lineEditList.begin();
-            layout->removeWidget(fieldLineEdit);
-            lineEditList.removeFirst();
-            delete fieldLineEdit;
+    int rowCount() const {
+        return rows.count();
+    }
+
+    /// Line edit currently showing @p row, or nullptr if row is not visible
+    FieldLineEdit *lineEditForRow(int row) const {
+        const int slot = row - firstRow;
+        return slot >= 0 && slot < visibleCount ? lineEditList[slot] : nullptr;
+    }
+
+    /// Row shown by @p widget, or -1 if widget does not show any row
+    int rowForLineEdit(QWidget *widget) const {
+        const int slot = lineEditList.indexOf(static_cast<FieldLineEdit *>(widget));
+        return slot >= 0 && slot < visibleCount ? firstRow + slot : -1;
+    }
+
+    void lineEditModified(QWidget *widget) {
+        if (!isBinding)
+            modifiedLineEdits.insert(static_cast<FieldLineEdit *>(widget));
+    }
+
+    bool isBindingRows() const {
+        return isBinding;
+    }
+
+    /// Write the text of modified line edits back into their rows,
+    /// must be called before the visible rows or the rows themselves change
+    void commitLineEdits() {
+        for (int slot = 0; slot < visibleCount; ++slot) {
+            FieldLineEdit *fieldLineEdit = lineEditList[slot];
+            if (!modifiedLineEdits.contains(fieldLineEdit)) continue;
+
+            Row &row = rows[firstRow + slot];
+            QString message;
+            fieldLineEdit->apply(row.value);
+            row.invalidText = fieldLineEdit->validate(nullptr, message) ? QString() : fieldLineEdit->text();
         }
+        modifiedLineEdits.clear();
+    }
 
-        /// This fixes a layout problem where the container element
-        /// does not shrink correctly once the line edits have been
-        /// removed
-        QSize pSize = container->size();
-        pSize.setHeight(addLineButton->height());
-        container->resize(pSize);
+    /// Show the rows starting at firstRow in the pool's line edits.
+    /// Line edits already showing their row keep their text unless
+    /// @p force is set.
+    void bindLineEdits(bool force) {
+        isBinding = true;
+        for (int slot = 0; slot < lineEditList.count(); ++slot) {
+            FieldLineEdit *fieldLineEdit = lineEditList[slot];
+            if (slot >= visibleCount) {
+                fieldLineEdit->setVisible(false);
+                boundRows[slot] = -1;
+                continue;
+            }
+
+            const int row = firstRow + slot;
+            if (force || boundRows[slot] != row) {
+                /// Do not let the type of the previously shown row
+                /// determine how this row's value is shown
+                fieldLineEdit->resetTypeFlag();
+                fieldLineEdit->reset(rows[row].value);
+                if (!rows[row].invalidText.isEmpty())
+                    fieldLineEdit->setText(rows[row].invalidText);
+                boundRows[slot] = row;
+            }
+            fieldLineEdit->setGeometry(0, slot * rowHeight, container->width(), rowHeight - innerSpacing);
+            fieldLineEdit->setVisible(true);
+        }
+        modifiedLineEdits.clear();
+        isBinding = false;
     }
 
-    void removeFieldLineEdit(FieldLineEdit *fieldLineEdit) {
-        lineEditList.removeOne(fieldLineEdit);
-        layout->removeWidget(fieldLineEdit);
-        delete fieldLineEdit;
+    /// Determine how many rows fit into the container, grow the pool of
+    /// line edits if necessary, and update the scroll bar accordingly
+    void layoutLineEdits(bool force) {
+        commitLineEdits();
+
+        int capacity = 1;
+        if (!rows.isEmpty()) {
+            if (lineEditList.isEmpty())
+                p->addFieldLineEdit();
+            rowHeight = lineEditList.first()->sizeHint().height() + innerSpacing;
+            capacity = qMax(1, (container->height() + innerSpacing) / rowHeight);
+        }
+        visibleCount = qMin(capacity, rows.count());
+        while (lineEditList.count() < visibleCount)
+            p->addFieldLineEdit();
+        firstRow = qBound(0, firstRow, rows.count() - visibleCount);
+
+        scrollBar->blockSignals(true);
+        scrollBar->setRange(0, rows.count() - visibleCount);
+        scrollBar->setPageStep(qMax(1, visibleCount));
+        scrollBar->setSingleStep(1);
+        scrollBar->setValue(firstRow);
+        scrollBar->blockSignals(false);
+        scrollBar->setVisible(rows.count() > visibleCount);
+
+        bindLineEdits(force);
+    }
+
+    void setFirstRow(int row) {
+        row = qBound(0, row, rows.count() - visibleCount);
+        if (row == firstRow) return;
+        commitLineEdits();
+        firstRow = row;
+        bindLineEdits(false);
     }
 
-    void goDownFieldLineEdit(FieldLineEdit *fieldLineEdit) {
-        int idx = lineEditList.indexOf(fieldLineEdit);
-        if (idx < lineEditList.count() - 1) {
-            layout->removeWidget(fieldLineEdit);
-            lineEditList.removeOne(fieldLineEdit);
-            lineEditList.insert(idx + 1, fieldLineEdit);
-            layout->insertWidget(idx + 1, fieldLineEdit);
+    void ensureRowVisible(int row) {
+        if (row < firstRow)
+            scrollBar->setValue(row);
+        else if (row >= firstRow + visibleCount)
+            scrollBar->setValue(row - visibleCount + 1);
+    }
+
+    void resetRows(const Value &value) {
+        commitLineEdits();
+        rows.clear();
+        rows.reserve(value.count());
+        for (const auto &valueItem : value) {
+            Row row;
+            row.value.append(valueItem);
+            rows.append(row);
         }
+        firstRow = 0;
+        layoutLineEdits(true);
+    }
+
+    void appendRow(const Value &value) {
+        commitLineEdits();
+        Row row;
+        row.value = value;
+        rows.append(row);
+        layoutLineEdits(true);
+        ensureRowVisible(rows.count() - 1);
     }
 
-    void goUpFieldLineEdit(FieldLineEdit *fieldLineEdit) {
-        int idx = lineEditList.indexOf(fieldLineEdit);
-        if (idx > 0) {
-            layout->removeWidget(fieldLineEdit);
-            lineEditList.removeOne(fieldLineEdit);
-            lineEditList.insert(idx - 1, fieldLineEdit);
-            layout->insertWidget(idx - 1, fieldLineEdit);
+    void removeRow(int row) {
+        commitLineEdits();
+        rows.remove(row);
+        layoutLineEdits(true);
+    }
+
+    void swapRows(int row, int otherRow) {
+        commitLineEdits();
+        qSwap(rows[row], rows[otherRow]);
+        bindLineEdits(true);
+        ensureRowVisible(otherRow);
+    }
+
+    void applyRows(Value &value) {
+        commitLineEdits();
+        value.clear();
+        for (const Row &row : const_cast<const QVector<Row> &>(rows))
+            for (const auto &valueItem : row.value)
+                value.append(valueItem);
+    }
+
+    bool validateRows(QWidget **widgetWithIssue, QString &message) {
+        for (int slot = 0; slot < visibleCount; ++slot) {
+            const bool v = lineEditList[slot]->validate(widgetWithIssue, message);
+            if (!v) return false;
         }
+
+        commitLineEdits();
+        /// Rows outside the visible area only need to be validated if
+        /// they were left with invalid text, which will be shown then
+        for (int row = 0; row < rows.count(); ++row)
+            if (!rows[row].invalidText.isEmpty()) {
+                ensureRowVisible(row);
+                FieldLineEdit *fieldLineEdit = lineEditForRow(row);
+                if (fieldLineEdit != nullptr)
+                    return fieldLineEdit->validate(widgetWithIssue, message);
+            }
+
+        return true;
     }
 };
 
 FieldListEdit::FieldListEdit(KBibTeX::TypeFlag preferredTypeFlag, KBibTeX::TypeFlags typeFlags, QWidget *parent)
-        : QWidget(parent), d(new FieldListEditProtected(preferredTypeFlag, typeFlags, this))
+        : QWidget(parent), m_element(nullptr), d(new FieldListEditProtected(preferredTypeFlag, typeFlags, this))
 {
     setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
     setMinimumSize(fontMetrics().averageCharWidth() * 30, fontMetrics().averageCharWidth() * 10);
@@ -228,46 +382,24 @@ FieldListEdit::~FieldListEdit()
 
 bool FieldListEdit::reset(const Value &value)
 {
-    d->removeAllFieldLineEdits();
-    for (const auto &valueItem : value) {
-        Value v;
-        v.append(valueItem);
-        FieldLineEdit *fieldLineEdit = addFieldLineEdit();
-        fieldLineEdit->setFile(d->file);
-        fieldLineEdit->reset(v);
-    }
-    QSize size(d->container->width(), d->recommendedHeight());
-    d->container->resize(size);
-
+    d->resetRows(value);
     return true;
 }
 
 bool FieldListEdit::apply(Value &value) const
 {
-    value.clear();
-
-    for (const auto *fieldLineEdit : const_cast<const QList<FieldLineEdit *> &>(d->lineEditList)) {
-        Value v;
-        fieldLineEdit->apply(v);
-        for (const auto &valueItem : const_cast<const Value &>(v))
-            value.append(valueItem);
-    }
-
+    d->applyRows(value);
     return true;
 }
 
 bool FieldListEdit::validate(QWidget **widgetWithIssue, QString &message) const
 {
-    for (const auto *fieldLineEdit : const_cast<const QList<FieldLineEdit *> &>(d->lineEditList)) {
-        const bool v = fieldLineEdit->validate(widgetWithIssue, message);
-        if (!v) return false;
-    }
-    return true;
+    return d->validateRows(widgetWithIssue, message);
 }
 
 void FieldListEdit::clear()
 {
-    d->removeAllFieldLineEdits();
+    d->resetRows(Value());
 }
 
 void FieldListEdit::setReadOnly(bool isReadOnly)
@@ -354,53 +486,82 @@ void FieldListEdit::dropEvent(QDropEvent *event)
 
     if (file == nullptr || file->count() == 0) {
         /// fall-back case: single field line edit with text
-        d->removeAllFieldLineEdits();
-        FieldLineEdit *fle = addFieldLineEdit();
-        fle->setText(clipboardText);
+        d->resetRows(Value());
+        d->appendRow(Value());
+        FieldLineEdit *fle = d->lineEditForRow(0);
+        if (fle != nullptr) {
+            fle->setText(clipboardText);
+            /// Setting text programmatically does not count as modification
+            d->lineEditModified(fle);
+        }
         emit modified();
     }
 }
 
+bool FieldListEdit::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == d->container) {
+        if (event->type() == QEvent::Resize)
+            d->layoutLineEdits(false);
+        else if (event->type() == QEvent::Wheel) {
+            /// Line edits ignore wheel events, scroll through the rows instead
+            QApplication::sendEvent(d->scrollBar, event);
+            return true;
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
 void FieldListEdit::lineAdd(Value *value)
 {
-    FieldLineEdit *le = addFieldLineEdit();
-    le->setCompletionItems(d->completionItems);
-    if (value != nullptr)
-        le->reset(*value);
+    d->appendRow(value != nullptr ? *value : Value());
 }
 
 void FieldListEdit::lineAdd()
 {
-    FieldLineEdit *newEdit = addFieldLineEdit();
-    newEdit->setCompletionItems(d->completionItems);
-    QSize size(d->container->width(), d->recommendedHeight());
-    d->container->resize(size);
-    newEdit->setFocus(Qt::ShortcutFocusReason);
+    d->appendRow(Value());
+    FieldLineEdit *newEdit = d->lineEditForRow(d->rowCount() - 1);
+    if (newEdit != nullptr)
+        newEdit->setFocus(Qt::ShortcutFocusReason);
 }
 
 void FieldListEdit::lineRemove(QWidget *widget)
 {
-    FieldLineEdit *fieldLineEdit = static_cast<FieldLineEdit *>(widget);
-    d->removeFieldLineEdit(fieldLineEdit);
-    QSize size(d->container->width(), d->recommendedHeight());
-    d->container->resize(size);
+    const int row = d->rowForLineEdit(widget);
+    if (row < 0) return;
+    d->removeRow(row);
     emit modified();
 }
 
 void FieldListEdit::lineGoDown(QWidget *widget)
 {
-    FieldLineEdit *fieldLineEdit = static_cast<FieldLineEdit *>(widget);
-    d->goDownFieldLineEdit(fieldLineEdit);
+    const int row = d->rowForLineEdit(widget);
+    if (row < 0 || row >= d->rowCount() - 1) return;
+    d->swapRows(row, row + 1);
     emit modified();
 }
 
 void FieldListEdit::lineGoUp(QWidget *widget)
 {
-    FieldLineEdit *fieldLineEdit = static_cast<FieldLineEdit *>(widget);
-    d->goUpFieldLineEdit(fieldLineEdit);
+    const int row = d->rowForLineEdit(widget);
+    if (row <= 0) return;
+    d->swapRows(row, row - 1);
     emit modified();
 }
 
+void FieldListEdit::lineTextChanged(QWidget *widget)
+{
+    /// Resetting line edits to other rows while scrolling is no modification
+    if (d->isBindingRows()) return;
+    d->lineEditModified(widget);
+    emit modified();
+}
+
+void FieldListEdit::firstVisibleRowChanged(int row)
+{
+    d->setFirstRow(row);
+}
+
 PersonListEdit::PersonListEdit(KBibTeX::TypeFlag preferredTypeFlag, KBibTeX::TypeFlags typeFlags, QWidget *parent)
         : FieldListEdit(preferredTypeFlag, typeFlags, parent)
 {
@@ -725,7 +886,7 @@ void KeywordListEdit::setFile(const File *file)
     if (file == nullptr)
         m_keywordsFromFile.clear();
     else
-        m_keywordsFromFile = file->uniqueEntryValuesSet(Entry::ftKeywords);
+        m_keywordsFromFile = file->completionIndex()->values(Entry::ftKeywords).toSet();
 
     FieldListEdit::setFile(file);
 }
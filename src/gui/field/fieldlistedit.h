@@ -38,6 +38,10 @@ class Element;
 class FieldLineEdit;
 
 /**
+ * Editor for a list of values, such as authors or keywords, with one
+ * line edit per value item. Only the rows fitting into the visible area
+ * get a line edit, which are reused while scrolling through the list.
+ *
  * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
  */
 class FieldListEdit : public QWidget
@@ -70,6 +74,7 @@ protected:
     void lineAdd(Value *value);
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dropEvent(QDropEvent *) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
     const Element *m_element;
 
@@ -78,6 +83,8 @@ private slots:
     void lineRemove(QWidget *widget);
     void lineGoDown(QWidget *widget);
     void lineGoUp(QWidget *widget);
+    void lineTextChanged(QWidget *widget);
+    void firstVisibleRowChanged(int row);
 
 protected:
     class FieldListEditProtected;
@@ -108,6 +108,27 @@ public:
         }
         bf->save();
     }
+
+    void prefetchVisibleRows() {
+        QAbstractItemModel *model = p->model();
+        if (fileModel == nullptr || model == nullptr) return;
+
+        const QModelIndex firstIndex = p->indexAt(QPoint(0, 0));
+        if (!firstIndex.isValid()) return;
+        const QModelIndex lastIndex = p->indexAt(QPoint(0, p->viewport()->height() - 1));
+        const int firstVisibleRow = firstIndex.row();
+        const int lastVisibleRow = lastIndex.isValid() ? lastIndex.row() : model->rowCount() - 1;
+        /// Prefetch one page of rows above and below the visible ones
+        const int margin = lastVisibleRow - firstVisibleRow + 1;
+        const int firstRow = qMax(0, firstVisibleRow - margin);
+        const int lastRow = qMin(model->rowCount() - 1, lastVisibleRow + margin);
+
+        QList<int> rows;
+        rows.reserve(lastRow - firstRow + 1);
+        for (int row = firstRow; row <= lastRow; ++row)
+            rows << (sortFilterProxyModel != nullptr ? sortFilterProxyModel->mapToSource(model->index(row, 0)).row() : row);
+        fileModel->prefetchRows(rows);
+    }
 };
 
 BasicFileView::BasicFileView(const QString &name, QWidget *parent)
@@ -130,6 +151,7 @@ BasicFileView::BasicFileView(const QString &name, QWidget *parent)
     header()->setSectionsMovable(false);
     header()->setSectionResizeMode(QHeaderView::Fixed);
     connect(header(), &QHeaderView::sortIndicatorChanged, this, &BasicFileView::sort);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &BasicFileView::prefetchVisibleRows);
     header()->setContextMenuPolicy(Qt::ActionsContextMenu);
 
     /// build context menu for header to show/hide single columns
@@ -191,6 +213,7 @@ void BasicFileView::setModel(QAbstractItemModel *model)
         sort(header()->sortIndicatorSection(), header()->sortIndicatorOrder());
 
     d->loadColumnProperties();
+    d->prefetchVisibleRows();
 }
 
 FileModel *BasicFileView::fileModel()
@@ -223,6 +246,7 @@ void BasicFileView::resizeEvent(QResizeEvent *event) {
     header()->setMinimumWidth(w);
     header()->setMaximumWidth(w);
     d->balanceColumns();
+    d->prefetchVisibleRows();
 }
 
 void BasicFileView::headerActionToggled()
@@ -237,6 +261,11 @@ void BasicFileView::headerActionToggled()
     d->balanceColumns();
 }
 
+void BasicFileView::prefetchVisibleRows()
+{
+    d->prefetchVisibleRows();
+}
+
 void BasicFileView::headerResetToDefaults()
 {
     d->resetColumnProperties();
@@ -53,6 +53,7 @@ private:
 private slots:
     void headerActionToggled();
     void headerResetToDefaults();
+    void prefetchVisibleRows();
     void sort(int, Qt::SortOrder);
     void noSorting();
 };
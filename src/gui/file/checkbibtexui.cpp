@@ -0,0 +1,184 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "checkbibtexui.h"
+
+#include <QAction>
+#include <QBoxLayout>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPointer>
+#include <QPushButton>
+#include <QRegularExpression>
+#include <QTreeWidget>
+
+#include <KActionCollection>
+#include <KLocalizedString>
+#include <kparts/part.h>
+#include <KMessageBox>
+
+#include "checkbibtex.h"
+#include "file.h"
+#include "entry.h"
+#include "fileview.h"
+#include "models/filemodel.h"
+
+class CheckBibTeXUI::CheckBibTeXUIPrivate
+{
+private:
+    CheckBibTeXUI *p;
+
+public:
+    KParts::Part *part;
+    FileView *view;
+    QAction *action;
+    CheckBibTeXBatch *batch;
+    /// Non-modal, so the user can keep editing while the check runs
+    QPointer<QDialog> dialog;
+    QLabel *summaryLabel;
+    QTreeWidget *findingsList;
+
+    enum Column { IdColumn = 0, SeverityColumn = 1, MessageColumn = 2 };
+
+    CheckBibTeXUIPrivate(CheckBibTeXUI *parent, KParts::Part *kpart, FileView *fileView)
+            : p(parent), part(kpart), view(fileView), action(nullptr), batch(new CheckBibTeXBatch(parent)), summaryLabel(nullptr), findingsList(nullptr) {
+        /// nothing
+    }
+
+    void showDialog() {
+        if (dialog.isNull()) {
+            dialog = new QDialog(part->widget());
+            dialog->setWindowTitle(i18n("Check with BibTeX"));
+            QBoxLayout *layout = new QVBoxLayout(dialog);
+            summaryLabel = new QLabel(dialog);
+            summaryLabel->setWordWrap(true);
+            layout->addWidget(summaryLabel);
+            findingsList = new QTreeWidget(dialog);
+            findingsList->setRootIsDecorated(false);
+            findingsList->setHeaderLabels(QStringList() << i18n("Entry") << i18n("Severity") << i18n("Problem"));
+            findingsList->setSortingEnabled(true);
+            findingsList->header()->setStretchLastSection(true);
+            layout->addWidget(findingsList);
+            QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal, dialog);
+            layout->addWidget(buttonBox);
+            connect(buttonBox, &QDialogButtonBox::rejected, dialog.data(), &QDialog::reject);
+            connect(findingsList, &QTreeWidget::itemActivated, p, &CheckBibTeXUI::findingActivated);
+        }
+        dialog->show();
+        dialog->raise();
+    }
+};
+
+CheckBibTeXUI::CheckBibTeXUI(KParts::Part *part, FileView *fileView)
+        : QObject(), d(new CheckBibTeXUIPrivate(this, part, fileView))
+{
+    d->action = new QAction(QIcon::fromTheme(QStringLiteral("tools-check-spelling")), i18n("Check with BibTeX"), this);
+    part->actionCollection()->addAction(QStringLiteral("checkbibtex"), d->action);
+    connect(d->action, &QAction::triggered, this, &CheckBibTeXUI::startCheck);
+    connect(d->batch, &CheckBibTeXBatch::finished, this, &CheckBibTeXUI::checkFinished);
+}
+
+CheckBibTeXUI::~CheckBibTeXUI()
+{
+    delete d->dialog;
+    delete d;
+}
+
+void CheckBibTeXUI::startCheck()
+{
+    FileModel *model = d->view->fileModel();
+    if (model == nullptr || d->batch->isRunning()) return;
+    const File *bibliographyFile = model->bibliographyFile();
+
+    /// If more than one element but not all are selected in the main list view,
+    /// ask the user if only the selection is to be checked
+    QList<QSharedPointer<Entry> > entries;
+    const int selectedRowsCount = d->view->selectedElements().count();
+    if (selectedRowsCount > 1 && selectedRowsCount < d->view->sortFilterProxyModel()->sourceModel()->rowCount() && KMessageBox::questionYesNo(d->part->widget(), i18n("Multiple elements are selected. Do you want to check only the selection or the whole document?"), i18n("Check only selection?"), KGuiItem(i18n("Only selection")), KGuiItem(i18n("Whole document"))) == KMessageBox::Yes) {
+        for (const QSharedPointer<Element> &element : d->view->selectedElements()) {
+            const QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
+            if (!entry.isNull())
+                entries.append(entry);
+        }
+    } else
+        for (const QSharedPointer<Element> &element : *bibliographyFile) {
+            const QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
+            if (!entry.isNull())
+                entries.append(entry);
+        }
+
+    if (entries.isEmpty()) {
+        KMessageBox::information(d->part->widget(), i18n("There are no entries to check."), i18n("No Entries"));
+        return;
+    }
+
+    d->showDialog();
+    d->findingsList->clear();
+    d->summaryLabel->setText(i18np("Running BibTeX for one entry...", "Running BibTeX for %1 entries...", entries.count()));
+    d->action->setEnabled(false);
+    d->batch->start(entries, bibliographyFile);
+}
+
+void CheckBibTeXUI::checkFinished()
+{
+    d->action->setEnabled(true);
+
+    if (d->batch->result() == CheckBibTeX::FailedToCheck) {
+        if (!d->dialog.isNull()) d->dialog->hide();
+        KMessageBox::errorList(d->part->widget(), i18n("Running BibTeX failed.\n\nSee the following output to trace the error:"), d->batch->errorLog(), i18n("Running BibTeX failed."));
+        return;
+    }
+
+    d->showDialog();
+    const QVector<CheckBibTeXBatch::Finding> findings = d->batch->findings();
+    if (findings.isEmpty()) {
+        d->summaryLabel->setText(i18n("No warnings or errors were found."));
+        return;
+    }
+
+    static const QRegularExpression markup(QStringLiteral("</?b>"));
+    QList<QTreeWidgetItem *> items;
+    items.reserve(findings.count());
+    for (const CheckBibTeXBatch::Finding &finding : findings) {
+        QTreeWidgetItem *item = new QTreeWidgetItem();
+        item->setText(CheckBibTeXUIPrivate::IdColumn, finding.id);
+        item->setText(CheckBibTeXUIPrivate::SeverityColumn, finding.severity == CheckBibTeX::BibTeXError ? i18n("Error") : i18n("Warning"));
+        item->setIcon(CheckBibTeXUIPrivate::SeverityColumn, QIcon::fromTheme(finding.severity == CheckBibTeX::BibTeXError ? QStringLiteral("dialog-error") : QStringLiteral("dialog-warning")));
+        item->setText(CheckBibTeXUIPrivate::MessageColumn, QString(finding.message).remove(markup));
+        items.append(item);
+    }
+    d->findingsList->addTopLevelItems(items);
+    d->findingsList->sortByColumn(CheckBibTeXUIPrivate::IdColumn, Qt::AscendingOrder);
+    d->findingsList->resizeColumnToContents(CheckBibTeXUIPrivate::IdColumn);
+    d->findingsList->resizeColumnToContents(CheckBibTeXUIPrivate::SeverityColumn);
+    d->summaryLabel->setText(i18np("One problem was found. Activate it to select the entry.", "%1 problems were found. Activate one to select its entry.", findings.count()));
+}
+
+void CheckBibTeXUI::findingActivated(QTreeWidgetItem *item)
+{
+    FileModel *model = d->view->fileModel();
+    const QString id = item->text(CheckBibTeXUIPrivate::IdColumn);
+    if (model == nullptr || id.isEmpty()) return;
+
+    const QSharedPointer<Element> element = model->bibliographyFile()->containsKey(id, File::etEntry);
+    if (!element.isNull()) {
+        d->view->setSelectedElement(element);
+        d->view->scrollTo(d->view->currentIndex(), QAbstractItemView::PositionAtCenter);
+    }
+}
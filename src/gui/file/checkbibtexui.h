@@ -0,0 +1,57 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_GUI_CHECKBIBTEXUI_H
+#define KBIBTEX_GUI_CHECKBIBTEXUI_H
+
+#include "kbibtexgui_export.h"
+
+#include <QObject>
+
+namespace KParts
+{
+class Part;
+}
+class QTreeWidgetItem;
+
+class FileView;
+
+/**
+ * Checks the selected entries or all entries of a bibliography with
+ * a single run of BibTeX in the background and lists the problems found.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXGUI_EXPORT CheckBibTeXUI : public QObject
+{
+    Q_OBJECT
+
+public:
+    CheckBibTeXUI(KParts::Part *part, FileView *fileView);
+    ~CheckBibTeXUI() override;
+
+private slots:
+    void startCheck();
+    void checkFinished();
+    void findingActivated(QTreeWidgetItem *item);
+
+private:
+    class CheckBibTeXUIPrivate;
+    CheckBibTeXUIPrivate *d;
+};
+
+#endif // KBIBTEX_GUI_CHECKBIBTEXUI_H
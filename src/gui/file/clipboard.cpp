@@ -45,10 +45,14 @@ public:
     QPoint previousPosition;
     KSharedConfigPtr config;
     const QString configGroupName;
+    /// Kept for all copy and drag operations, so that the configuration
+    /// does not have to be read again for each of them
+    FileExporterBibTeX exporter;
 
     ClipboardPrivate(FileView *fv, Clipboard *parent)
-            : fileView(fv), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), configGroupName(QStringLiteral("General")) {
+            : fileView(fv), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), configGroupName(QStringLiteral("General")), exporter(nullptr) {
         Q_UNUSED(parent)
+        exporter.setEncoding(QStringLiteral("latex"));
     }
 
     QString selectionToText() {
@@ -60,8 +64,8 @@ public:
         for (const QModelIndex &index : mil)
             file->append(model->element(fileView->sortFilterProxyModel()->mapToSource(index).row()));
 
-        FileExporterBibTeX exporter(fileView);
-        exporter.setEncoding(QStringLiteral("latex"));
+        /// Saving as a whole file puts macros and preambles first and
+        /// crossref'ed entries last, so pasted text can be parsed again
         QBuffer buffer(fileView);
         buffer.open(QBuffer::WriteOnly);
         const bool success = exporter.save(&buffer, file.data());
@@ -121,10 +125,9 @@ public:
             if (!file->isEmpty()) {
                 QSortFilterProxyModel *sfpModel = fileView->sortFilterProxyModel();
 
-                /// Insert new elements one by one
+                /// Insert new elements as one block at the end
                 const int startRow = fileModel->rowCount(); ///< Memorize row where insertion started
-                for (const auto &element : const_cast<const File &>(*file))
-                    fileModel->insertRow(element, fileView->model()->rowCount());
+                fileModel->insertElements(*file, startRow);
                 const int endRow = fileModel->rowCount() - 1; ///< Memorize row where insertion ended
 
                 /// Select newly inserted elements
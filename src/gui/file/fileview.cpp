@@ -35,7 +35,9 @@
 #include "elementeditor.h"
 #include "entry.h"
 #include "macro.h"
+#include "completionindex.h"
 #include "models/filemodel.h"
+#include "models/undojournal.h"
 #include "fileexporterbibtex.h"
 #include "valuelistmodel.h"
 
@@ -134,15 +136,27 @@ bool FileView::editElement(QSharedPointer<Element> element)
     File *bibliographyFile = model != nullptr ? model->bibliographyFile() : nullptr;
     m_elementEditor->setElement(element, bibliographyFile);
 
+    /// Changes applied to an element in the editor can be undone
+    UndoJournal *journal = model != nullptr && !isReadOnly() ? model->journal() : nullptr;
+    if (journal != nullptr) {
+        journal->beginOperation(i18n("Edit Element"));
+        journal->aboutToModify(element);
+    }
+
     m_elementEditor->setCurrentPage(m_lastEditorPage);
     m_elementEditorDialog->exec();
     m_lastEditorPage = m_elementEditor->currentPage();
 
+    if (journal != nullptr)
+        journal->endOperation();
+
     if (!isReadOnly()) {
         bool changed = m_elementEditor->elementChanged();
         if (changed) {
             FileModel *model = fileModel();
+            if (model != nullptr) model->invalidateCache();
             const File *bibliographyFile = model != nullptr ? model->bibliographyFile() : nullptr;
+            if (bibliographyFile != nullptr) bibliographyFile->completionIndex()->updateElement(element);
             emit currentElementChanged(currentElement(), bibliographyFile);
             emit selectedElementsChanged();
             emit modified(true);
@@ -232,9 +246,37 @@ void FileView::selectionDelete()
     emit modified(true);
 }
 
+void FileView::undo()
+{
+    FileModel *model = fileModel();
+    if (model == nullptr || !model->journal()->canUndo()) return;
+
+    model->journal()->undo();
+    emit selectedElementsChanged();
+    emit modified(true);
+}
+
+void FileView::redo()
+{
+    FileModel *model = fileModel();
+    if (model == nullptr || !model->journal()->canRedo()) return;
+
+    model->journal()->redo();
+    emit selectedElementsChanged();
+    emit modified(true);
+}
+
 /// FIXME the existence of this function is basically just one big hack
 void FileView::externalModification()
 {
+    /// Elements may have been changed in any way, including their ids
+    FileModel *model = fileModel();
+    if (model != nullptr) {
+        model->invalidateCache();
+        if (model->bibliographyFile() != nullptr)
+            model->bibliographyFile()->completionIndex()->invalidate();
+    }
+
     emit modified(true);
 }
 
@@ -253,6 +295,7 @@ ValueListModel *FileView::valueListModel(const QString &field)
     FileModel *model = fileModel();
     if (model != nullptr) {
         ValueListModel *result = new ValueListModel(model->bibliographyFile(), field, this);
+        result->setJournal(model->journal());
         /// Keep track of external changes through modifications in this ValueListModel instance
         connect(result, &ValueListModel::dataChanged, this, &FileView::externalModification);
         return result;
@@ -72,6 +72,9 @@ public slots:
     void setSelectedElement(QSharedPointer<Element>);
     void selectionDelete();
     void externalModification();
+    /// Undo or redo the most recent operation recorded in the model's journal
+    void undo();
+    void redo();
     void setFilterBarFilter(const SortFilterFileModel::FilterQuery &);
 
 protected:
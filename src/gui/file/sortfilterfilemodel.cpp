@@ -27,15 +27,22 @@
 #include "preamble.h"
 #include "comment.h"
 #include "fileinfo.h"
+#include "pdftextindex.h"
+#include "delayedexecutiontimer.h"
 
 const QString SortFilterFileModel::configGroupName = QStringLiteral("User Interface");
 
 SortFilterFileModel::SortFilterFileModel(QObject *parent)
-        : QSortFilterProxyModel(parent), m_internalModel(nullptr), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc")))
+        : QSortFilterProxyModel(parent), m_internalModel(nullptr), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), m_pdfTextTimer(new DelayedExecutionTimer(2000, 500, this))
 {
     m_filterQuery.combination = AnyTerm;
+    m_filterQuery.searchPDFfiles = false;
     loadState();
     setSortRole(FileModel::SortRole);
+
+    /// Include PDF files in the filter as they get indexed
+    connect(&PDFTextIndex::instance(), &PDFTextIndex::indexChanged, this, &SortFilterFileModel::pdfTextAvailable);
+    connect(m_pdfTextTimer, &DelayedExecutionTimer::triggered, this, &SortFilterFileModel::invalidateFilter);
 }
 
 void SortFilterFileModel::setSourceModel(QAbstractItemModel *model)
@@ -56,6 +63,12 @@ void SortFilterFileModel::updateFilter(const SortFilterFileModel::FilterQuery &f
     invalidate();
 }
 
+void SortFilterFileModel::pdfTextAvailable()
+{
+    if (m_filterQuery.searchPDFfiles && !m_filterQuery.terms.isEmpty())
+        m_pdfTextTimer->trigger();
+}
+
 bool SortFilterFileModel::simpleLessThan(const QModelIndex &left, const QModelIndex &right) const
 {
     const QString leftString = left.data(Qt::DisplayRole).toString().toLower();
@@ -205,10 +218,10 @@ bool SortFilterFileModel::filterAcceptsRow(int source_row, const QModelIndex &so
             const auto entryUrlList = FileInfo::entryUrls(entry, fileSourceModel()->bibliographyFile()->property(File::Url, QUrl()).toUrl(), FileInfo::TestExistenceYes);
             for (const QUrl &url : entryUrlList) {
                 if (url.isLocalFile() && url.fileName().endsWith(QStringLiteral(".pdf"))) {
-                    const QString text = FileInfo::pdfToText(url.toLocalFile());
+                    const QString pdfFilename = url.toLocalFile();
                     int i = 0;
                     for (QStringList::ConstIterator itsl = m_filterQuery.terms.constBegin(); itsl != m_filterQuery.terms.constEnd(); ++itsl, ++i)
-                        eachTerm[i] |= (*itsl).isEmpty() ? true : text.contains(*itsl, Qt::CaseInsensitive);
+                        eachTerm[i] |= (*itsl).isEmpty() ? true : (!eachTerm[i] && PDFTextIndex::instance().documentContains(pdfFilename, *itsl));
                 }
             }
         }
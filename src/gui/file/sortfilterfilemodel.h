@@ -24,6 +24,8 @@
 
 #include "models/filemodel.h"
 
+class DelayedExecutionTimer;
+
 /**
  * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
  */
@@ -48,6 +50,9 @@ public:
 public slots:
     void updateFilter(const SortFilterFileModel::FilterQuery &);
 
+private slots:
+    void pdfTextAvailable();
+
 protected:
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
     bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
@@ -59,6 +64,8 @@ private:
     KSharedConfigPtr config;
     static const QString configGroupName;
     bool m_showComments, m_showMacros, m_showXDatas;
+    /// Collects PDF files indexed in bursts to filter again only once
+    DelayedExecutionTimer *m_pdfTextTimer;
 
     void loadState();
     bool simpleLessThan(const QModelIndex &left, const QModelIndex &right) const;
@@ -37,6 +37,7 @@
 #include "fileview.h"
 #include "colorlabelwidget.h"
 #include "models/filemodel.h"
+#include "models/undojournal.h"
 #include "preferences.h"
 
 class ColorLabelSettingsDelegate : public QStyledItemDelegate
@@ -528,6 +529,9 @@ void ColorLabelContextMenu::colorActivated(const QString &colorString)
     FileModel *model = sfbfm->fileSourceModel();
     Q_ASSERT_X(model != nullptr, "ColorLabelContextMenu::colorActivated(const QString &colorString)", "FileModel *model is NULL");
 
+    UndoJournal *journal = model->journal();
+    journal->beginOperation(i18n("Set Color Label"));
+
     /// Apply color change to all selected rows
     const QModelIndexList list = d->fileView->selectionModel()->selectedIndexes();
     for (const QModelIndex &index : list) {
@@ -538,6 +542,7 @@ void ColorLabelContextMenu::colorActivated(const QString &colorString)
             const int row = mappedIndex.row();
             QSharedPointer<Entry> entry = model->element(row).dynamicCast<Entry>();
             if (!entry.isNull()) {
+                journal->aboutToModify(entry, Entry::ftColor);
                 /// Clear old color entry
                 bool modifying = entry->remove(Entry::ftColor) > 0;
                 if (colorString != QStringLiteral("#000000")) { ///< black is a special color that means "no color"
@@ -552,6 +557,8 @@ void ColorLabelContextMenu::colorActivated(const QString &colorString)
             }
         }
     }
+
+    journal->endOperation();
 }
 
 #include "settingscolorlabelwidget.moc"
@@ -42,6 +42,7 @@
 #include "entry.h"
 #include "preferences.h"
 #include "models/filemodel.h"
+#include "models/undojournal.h"
 #include "logging_gui.h"
 
 QWidget *ValueListDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &sovi, const QModelIndex &index) const
@@ -183,14 +184,30 @@ void ValueListDelegate::paint(QPainter *painter, const QStyleOptionViewItem &_op
     painter->restore();
 }
 
+/// Whether a value as a whole or one of its items is shown as the given text
+static bool valueShowsText(const Value &value, const QString &text)
+{
+    if (PlainTextValue::text(value) == text)
+        return true;
+    for (const QSharedPointer<ValueItem> &item : value)
+        if (PlainTextValue::text(item) == text)
+            return true;
+    return false;
+}
+
 ValueListModel::ValueListModel(const File *bibtexFile, const QString &fieldName, QObject *parent)
-        : QAbstractTableModel(parent), file(bibtexFile), fName(fieldName.toLower()), showCountColumn(true), sortBy(SortByText)
+        : QAbstractTableModel(parent), file(bibtexFile), fName(fieldName.toLower()), showCountColumn(true), sortBy(SortByText), journal(nullptr)
 {
     readConfiguration();
     updateValues();
     NotificationHub::registerNotificationListener(this, NotificationHub::EventConfigurationChanged);
 }
 
+void ValueListModel::setJournal(UndoJournal *journal)
+{
+    this->journal = journal;
+}
+
 int ValueListModel::rowCount(const QModelIndex &parent) const
 {
     return parent == QModelIndex() ? values.count() : 0;
@@ -425,6 +442,7 @@ bool ValueListModel::searchAndReplaceValueInEntries(const QModelIndex &index, co
         if (!color.isEmpty()) origText = color;
     }
 
+    if (journal != nullptr) journal->beginOperation(i18n("Replace Value"));
     /// Go through all elements in the current file
     for (const QSharedPointer<Element> &element : const_cast<const File &>(*file)) {
         QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
@@ -436,12 +454,15 @@ bool ValueListModel::searchAndReplaceValueInEntries(const QModelIndex &index, co
                 const QString key = eit.key().toLower();
                 /// Process only key-value pairs that are filtered for (e.g. only keywords)
                 if (key == fName) {
+                    if (journal != nullptr && valueShowsText(eit.value(), origText))
+                        journal->aboutToModify(entry, key);
                     eit.value().replace(origText, newValue.first());
                     break;
                 }
             }
         }
     }
+    if (journal != nullptr) journal->endOperation();
 
     return true;
 }
@@ -507,6 +528,7 @@ void ValueListModel::removeValueFromEntries(const QModelIndex &index)
         return;
     }
 
+    if (journal != nullptr) journal->beginOperation(i18n("Remove Value"));
     /// Go through all elements in the current file
     for (const QSharedPointer<Element> &element : const_cast<const File &>(*file)) {
         QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
@@ -518,6 +540,8 @@ void ValueListModel::removeValueFromEntries(const QModelIndex &index)
                 const QString key = eit.key().toLower();
                 /// Process only key-value pairs that are filtered for (e.g. only keywords)
                 if (key == fName) {
+                    if (journal != nullptr && valueShowsText(eit.value(), toBeDeletedText))
+                        journal->aboutToModify(entry, key);
                     /// Fetch the key-value pair's value's textual representation
                     const QString valueFullText = PlainTextValue::text(eit.value());
                     if (valueFullText == toBeDeletedText) {
@@ -555,6 +579,7 @@ void ValueListModel::removeValueFromEntries(const QModelIndex &index)
             }
         }
     }
+    if (journal != nullptr) journal->endOperation();
 }
 
 void ValueListModel::removeValueFromModel(const QModelIndex &index)
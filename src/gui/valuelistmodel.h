@@ -27,6 +27,8 @@
 #include "notificationhub.h"
 #include "models/filemodel.h"
 
+class UndoJournal;
+
 class KBIBTEXGUI_EXPORT ValueListDelegate : public QStyledItemDelegate
 {
     Q_OBJECT
@@ -86,10 +88,14 @@ private:
     QMap<QString, QString> colorToLabel;
     bool showCountColumn;
     SortBy sortBy;
+    UndoJournal *journal;
 
 public:
     ValueListModel(const File *bibtexFile, const QString &fieldName, QObject *parent);
 
+    /// Record modifications of entries in this journal to allow undoing them
+    void setJournal(UndoJournal *journal);
+
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
@@ -33,6 +33,7 @@
 
 #include "bibtexfields.h"
 #include "delayedexecutiontimer.h"
+#include "pdftextindex.h"
 
 static bool sortStringsLocaleAware(const QString &s1, const QString &s2) {
     return QString::localeAwareCompare(s1, s2) < 0;
@@ -262,6 +263,8 @@ FilterBar::FilterBar(QWidget *parent)
     setFocusProxy(d->comboBoxFilterText);
 
     QTimer::singleShot(250, this, &FilterBar::buttonHeight);
+
+    connect(&PDFTextIndex::instance(), &PDFTextIndex::indexChanged, this, &FilterBar::pdfIndexChanged);
 }
 
 FilterBar::~FilterBar()
@@ -316,3 +319,13 @@ void FilterBar::buttonHeight()
     d->buttonSearchPDFfiles->setSizePolicy(sp.horizontalPolicy(), QSizePolicy::MinimumExpanding);
     d->buttonClearAll->setSizePolicy(sp.horizontalPolicy(), QSizePolicy::MinimumExpanding);
 }
+
+void FilterBar::pdfIndexChanged()
+{
+    /// Let the user know that searching in PDF files may give more results soon
+    const int pendingCount = PDFTextIndex::instance().pendingCount();
+    if (pendingCount > 0)
+        d->buttonSearchPDFfiles->setToolTip(i18np("Include PDF files in full-text search (one file is being indexed)", "Include PDF files in full-text search (%1 files are being indexed)", pendingCount));
+    else
+        d->buttonSearchPDFfiles->setToolTip(i18n("Include PDF files in full-text search"));
+}
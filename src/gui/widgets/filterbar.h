@@ -58,6 +58,7 @@ private slots:
     void userPressedEnter();
     void publishFilter();
     void buttonHeight();
+    void pdfIndexChanged();
 };
 
 #endif // KBIBTEX_GUI_FILTERBAR_H
@@ -47,9 +47,13 @@ public:
     QPushButton *m_pushButtonType;
     KLineEdit *m_singleLineEditText;
     KTextEdit *m_multiLineEditText;
+    /// Completion items not yet passed to the line edit's completion
+    /// object, which is done only once the line edit gets focus
+    QStringList completionItems;
+    bool completionItemsPending;
 
     MenuLineEditPrivate(bool isMultiLine, MenuLineEdit *parent)
-            : p(parent), m_isReadOnly(false), makeInnerWidgetsTransparent(false), m_singleLineEditText(nullptr), m_multiLineEditText(nullptr) {
+            : p(parent), m_isReadOnly(false), makeInnerWidgetsTransparent(false), m_singleLineEditText(nullptr), m_multiLineEditText(nullptr), completionItemsPending(false) {
         this->isMultiLine = isMultiLine;
         /// listen to configuration change events specifically concerning a MenuLineEdit widget
         NotificationHub::registerNotificationListener(this, MenuLineEdit::MenuLineConfigurationChangedEvent);
@@ -110,6 +114,7 @@ public:
             m_singleLineEditText->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
             m_singleLineEditText->setCompletionMode(KCompletion::CompletionPopup);
             m_singleLineEditText->completionObject()->setIgnoreCase(true);
+            m_singleLineEditText->installEventFilter(p);
             p->setFocusProxy(m_singleLineEditText);
             connect(m_singleLineEditText, &KLineEdit::textEdited, p, &MenuLineEdit::textChanged);
         }
@@ -118,6 +123,13 @@ public:
         p->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
     }
 
+    void applyCompletionItems() {
+        if (!completionItemsPending || m_singleLineEditText == nullptr) return;
+        m_singleLineEditText->completionObject()->setItems(completionItems);
+        completionItems.clear();
+        completionItemsPending = false;
+    }
+
     void prependWidget(QWidget *widget) {
         widget->setParent(p);
         hLayout->insertWidget(0, widget);
@@ -297,8 +309,21 @@ bool MenuLineEdit::isModified() const
 
 void MenuLineEdit::setCompletionItems(const QStringList &items)
 {
-    if (d->m_singleLineEditText != nullptr)
-        d->m_singleLineEditText->completionObject()->setItems(items);
+    if (d->m_singleLineEditText != nullptr) {
+        /// Building the completion object's tree takes time for long lists,
+        /// so delay it until the user is about to type into this line edit
+        d->completionItems = items;
+        d->completionItemsPending = true;
+        if (d->m_singleLineEditText->hasFocus())
+            d->applyCompletionItems();
+    }
+}
+
+bool MenuLineEdit::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == d->m_singleLineEditText && event->type() == QEvent::FocusIn)
+        d->applyCompletionItems();
+    return QFrame::eventFilter(watched, event);
 }
 
 void MenuLineEdit::focusInEvent(QFocusEvent *)
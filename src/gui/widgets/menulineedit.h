@@ -67,6 +67,7 @@ public:
 
 protected:
     void focusInEvent(QFocusEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 signals:
     void textChanged(const QString &);
@@ -0,0 +1,289 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "attachmentresolver.h"
+
+#include <QHash>
+#include <QFileInfo>
+#include <QDir>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include "entry.h"
+#include "fileinfo.h"
+#include "logging_io.h"
+
+/// Listing of a single directory's files
+struct DirectoryListing {
+    QSet<QString> filenames;
+    QElapsedTimer age;
+    /// Changes to the directory get reported by the file system watcher
+    bool watched;
+};
+
+/// Directory listings shared by all threads, guarded by the mutex
+struct DirectoryListings {
+    QMutex mutex;
+    QHash<QString, DirectoryListing> byDirectory;
+    /// Number of changes reported per directory, to detect changes while listing
+    QHash<QString, int> changeCount;
+    /// Directories listed since the watcher was last updated
+    QSet<QString> toWatch;
+
+    /// Listings of directories not being watched are kept only briefly
+    static const qint64 unwatchedLifetime;
+    /// File system watchers miss changes made by other hosts on network
+    /// file systems, so even watched listings get refreshed eventually
+    static const qint64 watchedLifetime;
+};
+
+const qint64 DirectoryListings::unwatchedLifetime = 5000;
+const qint64 DirectoryListings::watchedLifetime = 300000;
+
+static DirectoryListings &directoryListings()
+{
+    static DirectoryListings listings;
+    return listings;
+}
+
+/**
+ * Retrieve the names of all files in the given directory, reading the
+ * directory only if no recent listing is known. Safe to be called from
+ * any thread.
+ */
+static QSet<QString> directoryListing(const QString &directory)
+{
+    DirectoryListings &listings = directoryListings();
+    int changeCount = 0;
+    {
+        QMutexLocker locker(&listings.mutex);
+        const QHash<QString, DirectoryListing>::ConstIterator it = listings.byDirectory.constFind(directory);
+        if (it != listings.byDirectory.constEnd() && it->age.elapsed() < (it->watched ? DirectoryListings::watchedLifetime : DirectoryListings::unwatchedLifetime))
+            return it->filenames;
+        changeCount = listings.changeCount.value(directory, 0);
+    }
+
+    /// Single read of the directory instead of testing each file on its own
+    DirectoryListing listing;
+    listing.filenames = QDir(directory).entryList(QDir::Files | QDir::Hidden).toSet();
+    listing.age.start();
+    listing.watched = false;
+
+    QMutexLocker locker(&listings.mutex);
+    /// Do not keep a listing that may have become outdated while being read
+    if (listings.changeCount.value(directory, 0) == changeCount) {
+        listings.byDirectory.insert(directory, listing);
+        listings.toWatch.insert(directory);
+    }
+    return listing.filenames;
+}
+
+/// Outcome of resolving a single entry's URLs in a worker thread
+struct ResolvedUrls {
+    /// Identifies the request only, not to be dereferenced
+    const Entry *entry;
+    QSet<QUrl> urls;
+};
+
+static ResolvedUrls resolveUrls(const Entry *key, const QSharedPointer<const Entry> &entry, const QUrl &bibTeXUrl)
+{
+    ResolvedUrls result;
+    result.entry = key;
+    result.urls = FileInfo::entryUrls(entry, bibTeXUrl, FileInfo::TestExistenceYes);
+    return result;
+}
+
+class AttachmentResolver::AttachmentResolverPrivate
+{
+private:
+    AttachmentResolver *p;
+
+public:
+    struct Request {
+        QSharedPointer<const Entry> entry;
+        QUrl bibTeXUrl;
+        /// Entry got requested again while being resolved
+        bool repeat;
+    };
+
+    /// Requests queued or running by entry
+    QHash<const Entry *, Request> requests;
+    QThreadPool threadPool;
+    QFileSystemWatcher fileSystemWatcher;
+    /// Merges bursts of changes, e.g. while a file is being downloaded
+    QTimer changeTimer;
+    static const int maxWatchedDirectories;
+
+    AttachmentResolverPrivate(AttachmentResolver *parent)
+            : p(parent) {
+        /// Resolving is mostly waiting for the file system
+        threadPool.setMaxThreadCount(2);
+
+        changeTimer.setSingleShot(true);
+        changeTimer.setInterval(500);
+    }
+
+    void start(const Request &request) {
+        /// Worker operates on a copy, as the entry may get modified meanwhile
+        const QSharedPointer<const Entry> entryCopy(new Entry(*request.entry));
+        QFutureWatcher<ResolvedUrls> *watcher = new QFutureWatcher<ResolvedUrls>(p);
+        connect(watcher, &QFutureWatcher<ResolvedUrls>::finished, p, &AttachmentResolver::resolvingFinished);
+        watcher->setFuture(QtConcurrent::run(&threadPool, resolveUrls, request.entry.data(), entryCopy, request.bibTeXUrl));
+    }
+
+    /// Let the file system watcher report changes to directories listed recently
+    void watchListedDirectories() {
+        DirectoryListings &listings = directoryListings();
+        QMutexLocker locker(&listings.mutex);
+        if (listings.toWatch.isEmpty()) return;
+        const QSet<QString> toWatch = listings.toWatch;
+        listings.toWatch.clear();
+
+        QStringList watchedDirectories = fileSystemWatcher.directories();
+        for (const QString &directory : toWatch) {
+            const QHash<QString, DirectoryListing>::Iterator it = listings.byDirectory.find(directory);
+            if (it == listings.byDirectory.end()) continue;
+            if (!watchedDirectories.contains(directory)) {
+                /// Too many watches would exhaust the system's limits,
+                /// listings of further directories expire quickly instead
+                if (watchedDirectories.count() >= maxWatchedDirectories || !fileSystemWatcher.addPath(directory))
+                    continue;
+                watchedDirectories.append(directory);
+            }
+            it->watched = true;
+        }
+    }
+};
+
+const int AttachmentResolver::AttachmentResolverPrivate::maxWatchedDirectories = 256;
+
+AttachmentResolver &AttachmentResolver::instance()
+{
+    static AttachmentResolver self;
+    return self;
+}
+
+AttachmentResolver::AttachmentResolver(QObject *parent)
+        : QObject(parent), d(new AttachmentResolverPrivate(this))
+{
+    connect(&d->fileSystemWatcher, &QFileSystemWatcher::directoryChanged, this, &AttachmentResolver::directoryChanged);
+    connect(&d->changeTimer, &QTimer::timeout, this, &AttachmentResolver::attachmentsChanged);
+}
+
+AttachmentResolver::~AttachmentResolver()
+{
+    d->threadPool.clear();
+    d->threadPool.waitForDone();
+    delete d;
+}
+
+void AttachmentResolver::resolve(const QSharedPointer<const Entry> &entry, const QUrl &bibTeXUrl)
+{
+    if (entry.isNull()) return;
+
+    const QHash<const Entry *, AttachmentResolverPrivate::Request>::Iterator it = d->requests.find(entry.data());
+    if (it != d->requests.end()) {
+        /// Resolving is running already, but entry or bibliography may have changed since
+        it->bibTeXUrl = bibTeXUrl;
+        it->repeat = true;
+        return;
+    }
+
+    AttachmentResolverPrivate::Request request;
+    request.entry = entry;
+    request.bibTeXUrl = bibTeXUrl;
+    request.repeat = false;
+    d->requests.insert(entry.data(), request);
+    d->start(request);
+}
+
+QString AttachmentResolver::existingFile(const QString &filename)
+{
+    if (filename.isEmpty()) return QString();
+
+    /// Only string operations, QFileInfo does not access the file system here
+    const QFileInfo fileInfo(filename);
+    const QString name = fileInfo.fileName();
+    if (name.isEmpty()) return QString();
+    const QString directory = QDir::cleanPath(fileInfo.absolutePath());
+
+    const QSet<QString> filenames = directoryListing(directory);
+    QString existingName = filenames.contains(name) ? name : QString();
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    /// File systems are usually case-insensitive on these platforms,
+    /// report the file by the name it is listed with
+    if (existingName.isEmpty())
+        for (const QString &listedName : filenames)
+            if (listedName.compare(name, Qt::CaseInsensitive) == 0) {
+                existingName = listedName;
+                break;
+            }
+#endif // defined(Q_OS_WIN) || defined(Q_OS_MAC)
+
+    /// File system watcher can only be updated from the main thread,
+    /// worker threads' listings get watched once their request is finished
+    if (QCoreApplication::instance() != nullptr && QThread::currentThread() == QCoreApplication::instance()->thread())
+        instance().d->watchListedDirectories();
+
+    return existingName.isEmpty() ? QString() : directory + QLatin1Char('/') + existingName;
+}
+
+void AttachmentResolver::resolvingFinished()
+{
+    QFutureWatcher<ResolvedUrls> *watcher = static_cast<QFutureWatcher<ResolvedUrls> *>(sender());
+    const ResolvedUrls resolvedUrls = watcher->result();
+    watcher->deleteLater();
+
+    d->watchListedDirectories();
+
+    const QHash<const Entry *, AttachmentResolverPrivate::Request>::Iterator it = d->requests.find(resolvedUrls.entry);
+    if (it == d->requests.end()) {
+        qCWarning(LOG_KBIBTEX_IO) << "Resolved URLs for an entry that was not requested";
+        return;
+    }
+    if (it->repeat) {
+        it->repeat = false;
+        d->start(*it);
+        return;
+    }
+
+    const QSharedPointer<const Entry> entry = it->entry;
+    d->requests.erase(it);
+    emit urlsResolved(entry, resolvedUrls.urls);
+}
+
+void AttachmentResolver::directoryChanged(const QString &path)
+{
+    DirectoryListings &listings = directoryListings();
+    {
+        QMutexLocker locker(&listings.mutex);
+        listings.byDirectory.remove(path);
+        ++listings.changeCount[path];
+    }
+    /// If the directory got removed, watching it ends, but
+    /// listing it again will watch it again once it exists
+
+    d->changeTimer.start();
+}
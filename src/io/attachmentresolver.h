@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_IO_ATTACHMENTRESOLVER_H
+#define KBIBTEX_IO_ATTACHMENTRESOLVER_H
+
+#include <QObject>
+#include <QSet>
+#include <QUrl>
+#include <QSharedPointer>
+
+#include "kbibtexio_export.h"
+
+class Entry;
+
+/**
+ * Shared service determining the documents attached to entries
+ * without blocking the GUI.
+ *
+ * Resolving an entry's URLs computes the same result as
+ * @see FileInfo::entryUrls with existence tests enabled, but in a
+ * worker thread, and delivers it through signal @see urlsResolved.
+ *
+ * Tests for the existence of local files, including those made by
+ * @see FileInfo::entryUrls itself, are answered from directory
+ * listings: each directory gets read once instead of testing each
+ * candidate file on its own, which matters on network file systems.
+ * Listings are kept until a file system watcher reports a change to
+ * their directory, upon which @see attachmentsChanged gets emitted.
+ *
+ * To be used from the main thread only, except for @see existingFile.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXIO_EXPORT AttachmentResolver : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AttachmentResolver &instance();
+    ~AttachmentResolver() override;
+
+    /**
+     * Determine the URLs of documents attached to the given entry in
+     * the background. Requests for an entry already being resolved are
+     * merged, in which case the entry is resolved once more to pick up
+     * any modifications made in between.
+     * @param entry entry to resolve URLs for, must not be null
+     * @param bibTeXUrl location of the bibliography to resolve relative paths
+     */
+    void resolve(const QSharedPointer<const Entry> &entry, const QUrl &bibTeXUrl);
+
+    /**
+     * Test if a local file exists, using cached directory listings.
+     * May be called from any thread.
+     * @param filename absolute or relative filename
+     * @return the file's absolute, cleaned path or an empty string if the file does not exist
+     */
+    static QString existingFile(const QString &filename);
+
+signals:
+    /**
+     * Result of a previous call to @see resolve.
+     * @param entry entry as passed to @see resolve
+     * @param urls URLs of documents attached to the entry
+     */
+    void urlsResolved(const QSharedPointer<const Entry> &entry, const QSet<QUrl> &urls);
+
+    /// Files in a directory that was listed before have changed
+    void attachmentsChanged();
+
+private:
+    explicit AttachmentResolver(QObject *parent = nullptr);
+
+    class AttachmentResolverPrivate;
+    AttachmentResolverPrivate *const d;
+
+private slots:
+    void resolvingFinished();
+    void directoryChanged(const QString &path);
+};
+
+#endif // KBIBTEX_IO_ATTACHMENTRESOLVER_H
@@ -22,6 +22,12 @@
 #include <QTextCodec>
 #include <QTextStream>
 #include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QThread>
+#include <QAtomicInt>
+#include <QtConcurrentMap>
 
 #ifdef HAVE_KF5
 #include <KSharedConfig>
@@ -29,6 +35,7 @@
 #endif // HAVE_KF5
 
 #include "preferences.h"
+#include "notificationhub.h"
 #include "file.h"
 #include "element.h"
 #include "entry.h"
@@ -44,6 +51,41 @@
 
 FileExporterBibTeX *FileExporterBibTeX::staticFileExporterBibTeX = nullptr;
 
+/// Bibliographies with fewer elements are serialized without worker threads
+static const int minElementsForParallelSerialization = 1024;
+/// Number of elements serialized into one buffer, written to the output device in one go
+static const int elementsPerChunk = 256;
+
+/**
+ * Counts changes of the configuration, so that exporters in any thread
+ * can tell if the settings they have read are outdated without having
+ * to register with the NotificationHub themselves, which may only be
+ * used from the main thread.
+ */
+class ConfigurationGeneration : private NotificationListener
+{
+public:
+    ConfigurationGeneration()
+            : generation(0) {
+        NotificationHub::registerNotificationListener(this, NotificationHub::EventConfigurationChanged);
+    }
+
+    void notificationEvent(int eventId) override {
+        if (eventId == NotificationHub::EventConfigurationChanged)
+            generation.ref();
+    }
+
+    int current() const {
+        return generation.loadAcquire();
+    }
+
+private:
+    QAtomicInt generation;
+};
+
+/// Created while the library gets loaded, i.e. by the main thread
+static ConfigurationGeneration configurationGeneration;
+
 class FileExporterBibTeX::FileExporterBibTeXPrivate
 {
 private:
@@ -58,52 +100,97 @@ public:
     Qt::CheckState protectCasing;
     QString personNameFormatting;
     QString listSeparator;
-    bool cancelFlag;
+    /// Set from the main thread while worker threads may be serializing elements
+    QAtomicInt cancelFlag;
     QTextCodec *destinationCodec;
+
+    /// Settings as read from the configuration, before being
+    /// overridden by a bibliography's properties. Kept until
+    /// the configuration gets changed.
+    struct ConfiguredState {
+        QString encoding;
+        QChar stringOpenDelimiter;
+        QChar stringCloseDelimiter;
+        KBibTeX::Casing keywordCasing;
+        Preferences::QuoteComment quoteComment;
+        Qt::CheckState protectCasing;
+        QString personNameFormatting;
+        QString listSeparator;
+    } configured;
+    /// Configuration generation the configured state was read in, -1 if not read yet
+    int configuredGeneration;
+
+    /// Formatted entry type and field names (ASCII), valid for cachedNamesCasing only.
+    /// Filled in before serialization starts, read-only while serializing in parallel
+    KBibTeX::Casing cachedNamesCasing;
+    QHash<QString, QByteArray> entryTypeNames;
+    QHash<QString, QByteArray> fieldNames;
 #ifdef HAVE_KF5
     KSharedConfigPtr config;
     const QString configGroupName, configGroupNameGeneral;
 #endif // HAVE_KF5
 
     FileExporterBibTeXPrivate(FileExporterBibTeX *parent)
-            : p(parent), keywordCasing(KBibTeX::cLowerCase), quoteComment(Preferences::qcNone), protectCasing(Qt::PartiallyChecked), cancelFlag(false), destinationCodec(nullptr), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), configGroupName(QStringLiteral("FileExporterBibTeX")), configGroupNameGeneral(QStringLiteral("General")) {
+            : p(parent), keywordCasing(KBibTeX::cLowerCase), quoteComment(Preferences::qcNone), protectCasing(Qt::PartiallyChecked), cancelFlag(0), destinationCodec(nullptr), configuredGeneration(-1), cachedNamesCasing(KBibTeX::cLowerCase), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), configGroupName(QStringLiteral("FileExporterBibTeX")), configGroupNameGeneral(QStringLiteral("General")) {
         /// nothing
     }
 
-    void loadState() {
+    void readConfiguration() {
+        /// Changes made while reading will cause another reading next time
+        configuredGeneration = configurationGeneration.current();
 #ifdef HAVE_KF5
+        config->reparseConfiguration();
         KConfigGroup configGroup(config, configGroupName);
-        encoding = configGroup.readEntry(Preferences::keyEncoding, Preferences::defaultEncoding);
+        configured.encoding = configGroup.readEntry(Preferences::keyEncoding, Preferences::defaultEncoding);
         QString stringDelimiter = configGroup.readEntry(Preferences::keyStringDelimiter, Preferences::defaultStringDelimiter);
         if (stringDelimiter.length() != 2)
             stringDelimiter = Preferences::defaultStringDelimiter;
 #else // HAVE_KF5
-        encoding = QStringLiteral("LaTeX");
+        configured.encoding = QStringLiteral("LaTeX");
         const QString stringDelimiter = QStringLiteral("{}");
 #endif // HAVE_KF5
-        stringOpenDelimiter = stringDelimiter[0];
-        stringCloseDelimiter = stringDelimiter[1];
+        configured.stringOpenDelimiter = stringDelimiter[0];
+        configured.stringCloseDelimiter = stringDelimiter[1];
 #ifdef HAVE_KF5
-        keywordCasing = static_cast<KBibTeX::Casing>(configGroup.readEntry(Preferences::keyKeywordCasing, static_cast<int>(Preferences::defaultKeywordCasing)));
-        quoteComment = static_cast<Preferences::QuoteComment>(configGroup.readEntry(Preferences::keyQuoteComment, static_cast<int>(Preferences::defaultQuoteComment)));
-        protectCasing = static_cast<Qt::CheckState>(configGroup.readEntry(Preferences::keyProtectCasing, static_cast<int>(Preferences::defaultProtectCasing)));
-        personNameFormatting = configGroup.readEntry(Preferences::keyPersonNameFormatting, QString());
-        listSeparator = configGroup.readEntry(Preferences::keyListSeparator, Preferences::defaultListSeparator);
+        configured.keywordCasing = static_cast<KBibTeX::Casing>(configGroup.readEntry(Preferences::keyKeywordCasing, static_cast<int>(Preferences::defaultKeywordCasing)));
+        configured.quoteComment = static_cast<Preferences::QuoteComment>(configGroup.readEntry(Preferences::keyQuoteComment, static_cast<int>(Preferences::defaultQuoteComment)));
+        configured.protectCasing = static_cast<Qt::CheckState>(configGroup.readEntry(Preferences::keyProtectCasing, static_cast<int>(Preferences::defaultProtectCasing)));
+        configured.personNameFormatting = configGroup.readEntry(Preferences::keyPersonNameFormatting, QString());
+        configured.listSeparator = configGroup.readEntry(Preferences::keyListSeparator, Preferences::defaultListSeparator);
 
-        if (personNameFormatting.isEmpty()) {
+        if (configured.personNameFormatting.isEmpty()) {
             /// no person name formatting is specified for BibTeX, fall back to general setting
             KConfigGroup configGroupGeneral(config, configGroupNameGeneral);
-            personNameFormatting = configGroupGeneral.readEntry(Preferences::keyPersonNameFormatting, Preferences::defaultPersonNameFormatting);
+            configured.personNameFormatting = configGroupGeneral.readEntry(Preferences::keyPersonNameFormatting, Preferences::defaultPersonNameFormatting);
         }
 #else // HAVE_KF5
-        keywordCasing = KBibTeX::cLowerCase;
-        quoteComment = qcNone;
-        protectCasing = Qt::PartiallyChecked;
-        personNameFormatting = QStringLiteral("<%l><, %s><, %f>");
-        listSeparator = QStringLiteral("; ");
+        configured.keywordCasing = KBibTeX::cLowerCase;
+        configured.quoteComment = qcNone;
+        configured.protectCasing = Qt::PartiallyChecked;
+        configured.personNameFormatting = QStringLiteral("<%l><, %s><, %f>");
+        configured.listSeparator = QStringLiteral("; ");
 #endif // HAVE_KF5
     }
 
+    /**
+     * Reset the exporter's settings to those from the configuration.
+     * The configuration is read only on first use and after
+     * it has been changed.
+     */
+    void loadState() {
+        if (configuredGeneration != configurationGeneration.current())
+            readConfiguration();
+
+        encoding = configured.encoding;
+        stringOpenDelimiter = configured.stringOpenDelimiter;
+        stringCloseDelimiter = configured.stringCloseDelimiter;
+        keywordCasing = configured.keywordCasing;
+        quoteComment = configured.quoteComment;
+        protectCasing = configured.protectCasing;
+        personNameFormatting = configured.personNameFormatting;
+        listSeparator = configured.listSeparator;
+    }
+
     void loadStateFromFile(const File *bibtexfile) {
         if (bibtexfile == nullptr) return;
 
@@ -139,16 +226,62 @@ public:
             listSeparator = bibtexfile->property(File::ListSeparator).toString();
     }
 
-    bool writeEntry(QIODevice *iodevice, const Entry &entry) {
-        const BibTeXEntries *be = BibTeXEntries::self();
-        const BibTeXFields *bf = BibTeXFields::self();
+    /**
+     * Make formatted names for the given entry available to
+     * @see entryTypeName and @see fieldName without recomputing
+     * them for every entry. Must not be called while serializing.
+     */
+    void cacheNames(const Entry &entry) {
+        cacheEntryTypeName(entry.type());
+        for (Entry::ConstIterator it = entry.constBegin(); it != entry.constEnd(); ++it)
+            if (!fieldNames.contains(it.key()))
+                fieldNames.insert(it.key(), EncoderLaTeX::instance().convertToPlainAscii(BibTeXFields::self()->format(it.key(), keywordCasing)).toLatin1());
+    }
+
+    void cacheEntryTypeName(const QString &type) {
+        if (cachedNamesCasing != keywordCasing) {
+            /// Names formatted for a different casing are of no use
+            entryTypeNames.clear();
+            fieldNames.clear();
+            cachedNamesCasing = keywordCasing;
+        }
+        if (!entryTypeNames.contains(type))
+            entryTypeNames.insert(type, BibTeXEntries::self()->format(type, keywordCasing).toLatin1());
+    }
+
+    /**
+     * Cache the formatted names of non-entry elements.
+     */
+    void cacheNames() {
+        cacheEntryTypeName(QStringLiteral("String"));
+        cacheEntryTypeName(QStringLiteral("Comment"));
+        cacheEntryTypeName(QStringLiteral("Preamble"));
+    }
+
+    QByteArray entryTypeName(const QString &type) const {
+        if (cachedNamesCasing == keywordCasing) {
+            const QHash<QString, QByteArray>::ConstIterator it = entryTypeNames.constFind(type);
+            if (it != entryTypeNames.constEnd()) return it.value();
+        }
+        return BibTeXEntries::self()->format(type, keywordCasing).toLatin1();
+    }
+
+    QByteArray fieldName(const QString &key) const {
+        if (cachedNamesCasing == keywordCasing) {
+            const QHash<QString, QByteArray>::ConstIterator it = fieldNames.constFind(key);
+            if (it != fieldNames.constEnd()) return it.value();
+        }
+        return EncoderLaTeX::instance().convertToPlainAscii(BibTeXFields::self()->format(key, keywordCasing)).toLatin1();
+    }
+
+    bool writeEntry(QByteArray &output, const Entry &entry) const {
         const EncoderLaTeX &laTeXEncoder = EncoderLaTeX::instance();
 
         /// write start of a entry (entry type and id) in plain ASCII
-        iodevice->putChar('@');
-        iodevice->write(be->format(entry.type(), keywordCasing).toLatin1().data());
-        iodevice->putChar('{');
-        iodevice->write(laTeXEncoder.convertToPlainAscii(entry.id()).toLatin1());
+        output.append('@');
+        output.append(entryTypeName(entry.type()));
+        output.append('{');
+        output.append(laTeXEncoder.convertToPlainAscii(entry.id()).toLatin1());
 
         for (Entry::ConstIterator it = entry.constBegin(); it != entry.constEnd(); ++it) {
             const QString key = it.key();
@@ -171,60 +304,43 @@ public:
                     removeProtectiveCasing(text);
             }
 
-            iodevice->putChar(',');
-            iodevice->putChar('\n');
-            iodevice->putChar('\t');
-            iodevice->write(laTeXEncoder.convertToPlainAscii(bf->format(key, keywordCasing)).toLatin1());
-            iodevice->putChar(' ');
-            iodevice->putChar('=');
-            iodevice->putChar(' ');
-            iodevice->write(TextEncoder::encode(text, destinationCodec));
+            output.append(",\n\t");
+            output.append(fieldName(key));
+            output.append(" = ");
+            output.append(TextEncoder::encode(text, destinationCodec));
         }
-        iodevice->putChar('\n');
-        iodevice->putChar('}');
-        iodevice->putChar('\n');
-        iodevice->putChar('\n');
+        output.append("\n}\n\n");
 
         return true;
     }
 
-    bool writeMacro(QIODevice *iodevice, const Macro &macro) {
-        const BibTeXEntries *be = BibTeXEntries::self();
-
+    bool writeMacro(QByteArray &output, const Macro &macro) const {
         QString text = p->internalValueToBibTeX(macro.value(), QString(), leUTF8);
         if (protectCasing == Qt::Checked)
             addProtectiveCasing(text);
         else if (protectCasing == Qt::Unchecked)
             removeProtectiveCasing(text);
 
-        iodevice->putChar('@');
-        iodevice->write(be->format(QStringLiteral("String"), keywordCasing).toLatin1().data());
-        iodevice->putChar('{');
-        iodevice->write(TextEncoder::encode(macro.key(), destinationCodec));
-        iodevice->putChar(' ');
-        iodevice->putChar('=');
-        iodevice->putChar(' ');
-        iodevice->write(TextEncoder::encode(text, destinationCodec));
-        iodevice->putChar('}');
-        iodevice->putChar('\n');
-        iodevice->putChar('\n');
+        output.append('@');
+        output.append(entryTypeName(QStringLiteral("String")));
+        output.append('{');
+        output.append(TextEncoder::encode(macro.key(), destinationCodec));
+        output.append(" = ");
+        output.append(TextEncoder::encode(text, destinationCodec));
+        output.append("}\n\n");
 
         return true;
     }
 
-    bool writeComment(QIODevice *iodevice, const Comment &comment) {
-        const BibTeXEntries *be = BibTeXEntries::self();
-
+    bool writeComment(QByteArray &output, const Comment &comment) const {
         QString text = comment.text() ;
 
         if (comment.useCommand() || quoteComment == Preferences::qcCommand) {
-            iodevice->putChar('@');
-            iodevice->write(be->format(QStringLiteral("Comment"), keywordCasing).toLatin1().data());
-            iodevice->putChar('{');
-            iodevice->write(TextEncoder::encode(text, destinationCodec));
-            iodevice->putChar('}');
-            iodevice->putChar('\n');
-            iodevice->putChar('\n');
+            output.append('@');
+            output.append(entryTypeName(QStringLiteral("Comment")));
+            output.append('{');
+            output.append(TextEncoder::encode(text, destinationCodec));
+            output.append("}\n\n");
         } else if (quoteComment == Preferences::qcPercentSign) {
             QStringList commentLines = text.split('\n', QString::SkipEmptyParts);
             for (QStringList::Iterator it = commentLines.begin(); it != commentLines.end(); ++it) {
@@ -232,38 +348,78 @@ public:
                 if (line.length() == 0 || line[0] != QLatin1Char('%')) {
                     /// Guarantee that every line starts with
                     /// a percent sign
-                    iodevice->putChar('%');
+                    output.append('%');
                 }
-                iodevice->write(line);
-                iodevice->putChar('\n');
+                output.append(line);
+                output.append('\n');
             }
-            iodevice->putChar('\n');
+            output.append('\n');
         } else {
-            iodevice->write(TextEncoder::encode(text, destinationCodec));
-            iodevice->putChar('\n');
-            iodevice->putChar('\n');
+            output.append(TextEncoder::encode(text, destinationCodec));
+            output.append("\n\n");
         }
 
         return true;
     }
 
-    bool writePreamble(QIODevice *iodevice, const Preamble &preamble) {
-        const BibTeXEntries *be = BibTeXEntries::self();
-
-        iodevice->putChar('@');
-        iodevice->write(be->format(QStringLiteral("Preamble"), keywordCasing).toLatin1().data());
-        iodevice->putChar('{');
+    bool writePreamble(QByteArray &output, const Preamble &preamble) const {
+        output.append('@');
+        output.append(entryTypeName(QStringLiteral("Preamble")));
+        output.append('{');
         /// Remember: strings from preamble do not get encoded,
         /// may contain raw LaTeX commands and code
-        iodevice->write(TextEncoder::encode(p->internalValueToBibTeX(preamble.value(), QString(), leRaw), destinationCodec));
-        iodevice->putChar('}');
-        iodevice->putChar('\n');
-        iodevice->putChar('\n');
+        output.append(TextEncoder::encode(p->internalValueToBibTeX(preamble.value(), QString(), leRaw), destinationCodec));
+        output.append("}\n\n");
 
         return true;
     }
 
-    QString addProtectiveCasing(QString &text) {
+    bool writeElement(QByteArray &output, const QSharedPointer<const Element> &element) const {
+        const QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
+        if (!entry.isNull())
+            return writeEntry(output, *entry);
+        const QSharedPointer<const Macro> macro = element.dynamicCast<const Macro>();
+        if (!macro.isNull())
+            return writeMacro(output, *macro);
+        const QSharedPointer<const Comment> comment = element.dynamicCast<const Comment>();
+        if (!comment.isNull())
+            return writeComment(output, *comment);
+        const QSharedPointer<const Preamble> preamble = element.dynamicCast<const Preamble>();
+        if (!preamble.isNull())
+            return writePreamble(output, *preamble);
+        return false;
+    }
+
+    /**
+     * Serializes a consecutive range of elements into one buffer.
+     * Entries do not depend on each other once their order is fixed,
+     * so multiple ranges can be serialized in parallel.
+     */
+    class ChunkSerializer
+    {
+    public:
+        typedef QByteArray result_type;
+
+        ChunkSerializer(const FileExporterBibTeXPrivate *_d, const QVector<QSharedPointer<const Element> > &_elements)
+                : d(_d), elements(_elements) {
+            /// nothing
+        }
+
+        QByteArray operator()(const QPair<int, int> &range) const {
+            QByteArray output;
+            /// Rough estimate to avoid most reallocations
+            output.reserve((range.second - range.first) * 512);
+            for (int i = range.first; i < range.second && d->cancelFlag.load() == 0; ++i)
+                d->writeElement(output, elements[i]);
+            return output;
+        }
+
+    private:
+        const FileExporterBibTeXPrivate *d;
+        const QVector<QSharedPointer<const Element> > &elements;
+    };
+
+    QString addProtectiveCasing(QString &text) const {
         /// Check if either
         ///  - text is too short (less than two characters)  or
         ///  - text neither starts/stops with double quotation marks
@@ -292,7 +448,7 @@ public:
         return text;
     }
 
-    QString removeProtectiveCasing(QString &text) {
+    QString removeProtectiveCasing(QString &text) const {
         /// Check if either
         ///  - text is too short (less than two characters)  or
         ///  - text neither starts/stops with double quotation marks
@@ -321,7 +477,7 @@ public:
         return text;
     }
 
-    QString &protectQuotationMarks(QString &text) {
+    QString &protectQuotationMarks(QString &text) const {
         int p = -1;
         while ((p = text.indexOf(QLatin1Char('"'), p + 1)) > 0)
             if (p == 0 || text[p - 1] != QLatin1Char('\\')) {
@@ -336,7 +492,7 @@ public:
         destinationCodec = QTextCodec::codecForName(encoding == QStringLiteral("latex") ? "us-ascii" : encoding.toLatin1());
     }
 
-    bool requiresPersonQuoting(const QString &text, bool isLastName) {
+    bool requiresPersonQuoting(const QString &text, bool isLastName) const {
         if (isLastName && !text.contains(QChar(' ')))
             /** Last name contains NO spaces, no quoting necessary */
             return false;
@@ -392,90 +548,73 @@ bool FileExporterBibTeX::save(QIODevice *iodevice, const File *bibtexfile, QStri
 
     bool result = true;
     const int totalElements = bibtexfile->count();
-    int currentPos = 0;
 
+    d->cancelFlag.store(0);
     d->loadState();
     d->loadStateFromFile(bibtexfile);
+    d->cacheNames();
 
-    if (d->encoding != QStringLiteral("latex")) {
-        Comment encodingComment(QStringLiteral("x-kbibtex-encoding=") + d->encoding, true);
-        result &= d->writeComment(iodevice, encodingComment);
-    }
-
-    /// Memorize which entries are used in a crossref field
-    QStringList crossRefIdList;
-    for (File::ConstIterator it = bibtexfile->constBegin(); it != bibtexfile->constEnd() && result && !d->cancelFlag; ++it) {
+    /// Memorize which entries are used in a crossref field;
+    /// on the way, cache the formatted names used by all entries
+    QSet<QString> crossRefIds;
+    for (File::ConstIterator it = bibtexfile->constBegin(); it != bibtexfile->constEnd() && d->cancelFlag.load() == 0; ++it) {
         QSharedPointer<const Entry> entry = (*it).dynamicCast<const Entry>();
         if (!entry.isNull()) {
+            d->cacheNames(*entry);
             const QString crossRef = PlainTextValue::text(entry->value(Entry::ftCrossRef));
             if (!crossRef.isEmpty())
-                crossRefIdList << crossRef;
+                crossRefIds.insert(crossRef);
         }
     }
 
+    /// Determine the order in which elements get written
+    QVector<QSharedPointer<const Element> > orderedElements;
+    orderedElements.reserve(totalElements + 1);
+
+    if (d->encoding != QStringLiteral("latex"))
+        orderedElements << QSharedPointer<const Element>(new Comment(QStringLiteral("x-kbibtex-encoding=") + d->encoding, true));
+
     bool allPreamblesAndMacrosProcessed = false;
-    for (File::ConstIterator it = bibtexfile->constBegin(); it != bibtexfile->constEnd() && result && !d->cancelFlag; ++it) {
+    for (File::ConstIterator it = bibtexfile->constBegin(); it != bibtexfile->constEnd() && d->cancelFlag.load() == 0; ++it) {
         QSharedPointer<const Element> element = (*it);
         QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
 
         if (!entry.isNull()) {
             /// Postpone entries that are crossref'ed
-            if (crossRefIdList.contains(entry->id())) continue;
+            if (crossRefIds.contains(entry->id())) continue;
 
             if (!allPreamblesAndMacrosProcessed) {
                 /// Guarantee that all macros and the preamble are written
                 /// before the first entry (@article, ...) is written
-                for (File::ConstIterator msit = it + 1; msit != bibtexfile->constEnd() && result && !d->cancelFlag; ++msit) {
-                    QSharedPointer<const Preamble> preamble = (*msit).dynamicCast<const Preamble>();
-                    if (!preamble.isNull()) {
-                        result &= d->writePreamble(iodevice, *preamble);
-                        emit progress(++currentPos, totalElements);
-                    } else {
-                        QSharedPointer<const Macro> macro = (*msit).dynamicCast<const Macro>();
-                        if (!macro.isNull()) {
-                            result &= d->writeMacro(iodevice, *macro);
-                            emit progress(++currentPos, totalElements);
-                        }
-                    }
+                for (File::ConstIterator msit = it + 1; msit != bibtexfile->constEnd(); ++msit) {
+                    if (Preamble::isPreamble(**msit) || Macro::isMacro(**msit))
+                        orderedElements << *msit;
                 }
                 allPreamblesAndMacrosProcessed = true;
             }
 
-            result &= d->writeEntry(iodevice, *entry);
-            emit progress(++currentPos, totalElements);
+            orderedElements << element;
         } else {
             QSharedPointer<const Comment> comment = element.dynamicCast<const Comment>();
-            if (!comment.isNull() && !comment->text().startsWith(QStringLiteral("x-kbibtex-"))) {
-                result &= d->writeComment(iodevice, *comment);
-                emit progress(++currentPos, totalElements);
-            } else if (!allPreamblesAndMacrosProcessed) {
-                QSharedPointer<const Preamble> preamble = element.dynamicCast<const Preamble>();
-                if (!preamble.isNull()) {
-                    result &= d->writePreamble(iodevice, *preamble);
-                    emit progress(++currentPos, totalElements);
-                } else {
-                    QSharedPointer<const Macro> macro = element.dynamicCast<const Macro>();
-                    if (!macro.isNull()) {
-                        result &= d->writeMacro(iodevice, *macro);
-                        emit progress(++currentPos, totalElements);
-                    }
-                }
-            }
+            if (!comment.isNull() && !comment->text().startsWith(QStringLiteral("x-kbibtex-")))
+                orderedElements << element;
+            else if (!allPreamblesAndMacrosProcessed && (Preamble::isPreamble(*element) || Macro::isMacro(*element)))
+                orderedElements << element;
         }
     }
 
     /// Crossref'ed entries are written last
-    for (File::ConstIterator it = bibtexfile->constBegin(); it != bibtexfile->constEnd() && result && !d->cancelFlag; ++it) {
-        QSharedPointer<const Entry> entry = (*it).dynamicCast<const Entry>();
-        if (entry.isNull()) continue;
-        if (!crossRefIdList.contains(entry->id())) continue;
+    if (!crossRefIds.isEmpty())
+        for (File::ConstIterator it = bibtexfile->constBegin(); it != bibtexfile->constEnd() && d->cancelFlag.load() == 0; ++it) {
+            QSharedPointer<const Entry> entry = (*it).dynamicCast<const Entry>();
+            if (!entry.isNull() && crossRefIds.contains(entry->id()))
+                orderedElements << entry;
+        }
 
-        result &= d->writeEntry(iodevice, *entry);
-        emit progress(++currentPos, totalElements);
-    }
+    result &= writeElements(iodevice, orderedElements, totalElements);
 
     iodevice->close();
-    return result && !d->cancelFlag;
+    return result && d->cancelFlag.load() == 0;
 }
 
 bool FileExporterBibTeX::save(QIODevice *iodevice, const QSharedPointer<const Element> element, const File *bibtexfile, QStringList *errorLog)
@@ -487,8 +626,7 @@ bool FileExporterBibTeX::save(QIODevice *iodevice, const QSharedPointer<const El
         return false;
     }
 
-    bool result = false;
-
+    d->cancelFlag.store(0);
     d->loadState();
     d->loadStateFromFile(bibtexfile);
 
@@ -496,40 +634,64 @@ bool FileExporterBibTeX::save(QIODevice *iodevice, const QSharedPointer<const El
         d->encoding = d->forcedEncoding;
     d->applyEncoding(d->encoding);
 
+    d->cacheNames();
     const QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
     if (!entry.isNull())
-        result |= d->writeEntry(iodevice, *entry);
-    else {
-        const QSharedPointer<const Macro> macro = element.dynamicCast<const Macro>();
-        if (!macro.isNull())
-            result |= d->writeMacro(iodevice, *macro);
-        else {
-            const QSharedPointer<const Comment> comment = element.dynamicCast<const Comment>();
-            if (!comment.isNull())
-                result |= d->writeComment(iodevice, *comment);
-            else {
-                const QSharedPointer<const Preamble> preamble = element.dynamicCast<const Preamble>();
-                if (!preamble.isNull())
-                    result |= d->writePreamble(iodevice, *preamble);
-            }
+        d->cacheNames(*entry);
+
+    const bool result = writeElements(iodevice, QVector<QSharedPointer<const Element> >() << element, 1);
+
+    iodevice->close();
+    return result && d->cancelFlag.load() == 0;
+}
+
+bool FileExporterBibTeX::writeElements(QIODevice *iodevice, const QVector<QSharedPointer<const Element> > &elements, int totalElements)
+{
+    bool result = true;
+    int currentPos = 0;
+
+    /// Serialize elements chunk by chunk, each chunk written to the device at once
+    QVector<QPair<int, int> > chunks;
+    chunks.reserve(elements.count() / elementsPerChunk + 1);
+    for (int from = 0; from < elements.count(); from += elementsPerChunk)
+        chunks << qMakePair(from, qMin(from + elementsPerChunk, elements.count()));
+    const FileExporterBibTeXPrivate::ChunkSerializer serializer(d, elements);
+
+    if (elements.count() < minElementsForParallelSerialization || QThread::idealThreadCount() < 2) {
+        for (const QPair<int, int> &chunk : const_cast<const QVector<QPair<int, int> > &>(chunks)) {
+            if (d->cancelFlag.load() != 0) break;
+            result &= iodevice->write(serializer(chunk)) >= 0;
+            currentPos = qMin(currentPos + chunk.second - chunk.first, totalElements);
+            emit progress(currentPos, totalElements);
         }
+    } else {
+        /// Encoder gets initialized before worker threads start using it
+        EncoderLaTeX::instance();
+        QFuture<QByteArray> future = QtConcurrent::mapped(chunks, serializer);
+        /// Chunks are written in order as soon as each one is ready
+        for (int i = 0; i < chunks.count() && result; ++i) {
+            result &= iodevice->write(future.resultAt(i)) >= 0;
+            currentPos = qMin(currentPos + chunks[i].second - chunks[i].first, totalElements);
+            emit progress(currentPos, totalElements);
+        }
+        if (!result) future.cancel();
+        future.waitForFinished();
     }
 
-    iodevice->close();
-    return result && !d->cancelFlag;
+    return result;
 }
 
 void FileExporterBibTeX::cancel()
 {
-    d->cancelFlag = true;
+    d->cancelFlag.store(1);
 }
 
 QString FileExporterBibTeX::valueToBibTeX(const Value &value, const QString &key, UseLaTeXEncoding useLaTeXEncoding)
 {
-    if (staticFileExporterBibTeX == nullptr) {
+    if (staticFileExporterBibTeX == nullptr)
         staticFileExporterBibTeX = new FileExporterBibTeX(nullptr);
-        staticFileExporterBibTeX->d->loadState();
-    }
+    /// Cheap unless the configuration has changed since the last call
+    staticFileExporterBibTeX->d->loadState();
     return staticFileExporterBibTeX->internalValueToBibTeX(value, key, useLaTeXEncoding);
 }
 
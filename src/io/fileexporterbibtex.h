@@ -19,6 +19,7 @@
 #define BIBTEXFILEEXPORTERBIBTEX_H
 
 #include <QTextStream>
+#include <QVector>
 
 #include "kbibtex.h"
 #include "element.h"
@@ -66,6 +67,7 @@ private:
     class FileExporterBibTeXPrivate;
     FileExporterBibTeXPrivate *d;
 
+    bool writeElements(QIODevice *iodevice, const QVector<QSharedPointer<const Element> > &elements, int totalElements);
     inline QString applyEncoder(const QString &input, UseLaTeXEncoding useLaTeXEncoding) const;
     QString internalValueToBibTeX(const Value &value, const QString &fieldType = QString(), UseLaTeXEncoding useLaTeXEncoding = leLaTeX);
 
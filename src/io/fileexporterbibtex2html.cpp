@@ -33,9 +33,12 @@ public:
     QString bibTeXFilename;
     QString outputFilename;
     QString bibStyle;
+    /// Created along with this exporter, so saving may happen in another thread
+    FileExporterBibTeX *bibtexExporter;
 
     FileExporterBibTeX2HTMLPrivate(FileExporterBibTeX2HTML *parent, const QString &workingDir)
-            : p(parent) {
+            : p(parent), bibtexExporter(new FileExporterBibTeX(parent)) {
+        bibtexExporter->setEncoding(QStringLiteral("latex"));
         bibTeXFilename = QString(workingDir).append("/bibtex-to-html.bib");
         outputFilename = QString(workingDir).append("/bibtex-to-html.html");
         bibStyle = QStringLiteral("plain");
@@ -117,9 +120,7 @@ bool FileExporterBibTeX2HTML::save(QIODevice *iodevice, const File *bibtexfile,
 
     QFile output(d->bibTeXFilename);
     if (output.open(QIODevice::WriteOnly)) {
-        FileExporterBibTeX bibtexExporter(this);
-        bibtexExporter.setEncoding(QStringLiteral("latex"));
-        result = bibtexExporter.save(&output, bibtexfile, errorLog);
+        result = d->bibtexExporter->save(&output, bibtexfile, errorLog);
         output.close();
     }
 
@@ -141,9 +142,7 @@ bool FileExporterBibTeX2HTML::save(QIODevice *iodevice, const QSharedPointer<con
 
     QFile output(d->bibTeXFilename);
     if (output.open(QIODevice::WriteOnly)) {
-        FileExporterBibTeX bibtexExporter(this);
-        bibtexExporter.setEncoding(QStringLiteral("latex"));
-        result = bibtexExporter.save(&output, element, bibtexfile, errorLog);
+        result = d->bibtexExporter->save(&output, element, bibtexfile, errorLog);
         output.close();
     }
 
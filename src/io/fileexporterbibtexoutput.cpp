@@ -35,6 +35,10 @@ FileExporterBibTeXOutput::FileExporterBibTeXOutput(OutputType outputType, QObjec
 {
     m_fileBasename = QStringLiteral("bibtex-to-output");
     m_fileStem = tempDir.path() + QDir::separator() + m_fileBasename;
+    /// Created along with this exporter, as exporters must not be
+    /// constructed in the background threads this exporter may be used in
+    m_bibtexExporter = new FileExporterBibTeX(this);
+    m_bibtexExporter->setEncoding(QStringLiteral("utf-8"));
 }
 
 FileExporterBibTeXOutput::~FileExporterBibTeXOutput()
@@ -58,9 +62,7 @@ bool FileExporterBibTeXOutput::save(QIODevice *ioDevice, const File *bibtexfile,
 
     QFile bibTeXFile(m_fileStem + KBibTeX::extensionBibTeX);
     if (bibTeXFile.open(QIODevice::WriteOnly)) {
-        FileExporterBibTeX bibtexExporter(this);
-        bibtexExporter.setEncoding(QStringLiteral("utf-8"));
-        result = bibtexExporter.save(&bibTeXFile, bibtexfile, errorLog);
+        result = m_bibtexExporter->save(&bibTeXFile, bibtexfile, errorLog);
         bibTeXFile.close();
     }
 
@@ -85,9 +87,7 @@ bool FileExporterBibTeXOutput::save(QIODevice *ioDevice, const QSharedPointer<co
 
     QFile bibTeXFile(m_fileStem + KBibTeX::extensionBibTeX);
     if (bibTeXFile.open(QIODevice::WriteOnly)) {
-        FileExporterBibTeX bibtexExporter(this);
-        bibtexExporter.setEncoding(QStringLiteral("utf-8"));
-        result = bibtexExporter.save(&bibTeXFile, element, bibtexfile, errorLog);
+        result = m_bibtexExporter->save(&bibTeXFile, element, bibtexfile, errorLog);
         bibTeXFile.close();
     }
 
@@ -21,6 +21,8 @@
 
 #include "fileexportertoolchain.h"
 
+class FileExporterBibTeX;
+
 /**
 @author Thomas Fischer
  */
@@ -47,6 +49,7 @@ private:
     QString m_fileStem;
     QString m_latexLanguage;
     QString m_latexBibStyle;
+    FileExporterBibTeX *m_bibtexExporter;
 
     bool generateOutput(QStringList *errorLog);
     bool writeLatexFile(const QString &filename);
@@ -17,7 +17,6 @@
 
 #include "fileexportertoolchain.h"
 
-#include <QCoreApplication>
 #include <QStringList>
 #include <QFile>
 #include <QDir>
@@ -25,6 +24,11 @@
 #include <QTextStream>
 #include <QProcess>
 #include <QProcessEnvironment>
+#include <QEventLoop>
+#include <QTimer>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include <KLocalizedString>
 
@@ -39,27 +43,110 @@ FileExporterToolchain::FileExporterToolchain(QObject *parent)
     tempDir.setAutoRemove(true);
 }
 
+void FileExporterToolchain::cancel()
+{
+    m_cancelled.store(1);
+}
+
 bool FileExporterToolchain::runProcesses(const QStringList &progs, QStringList *errorLog)
 {
+    beginRun();
+
     bool result = true;
     int i = 0;
 
     emit progress(0, progs.size());
     for (QStringList::ConstIterator it = progs.constBegin(); result && it != progs.constEnd(); ++it) {
-        QCoreApplication::instance()->processEvents();
         QStringList args = (*it).split(' ');
         QString cmd = args.first();
         args.erase(args.begin());
-        result &= runProcess(cmd, args, errorLog);
-        emit progress(i++, progs.size());
+        result &= runStage(i, cmd, args, errorLog);
+        emit progress(++i, progs.size());
     }
-    QCoreApplication::instance()->processEvents();
     return result;
 }
 
 bool FileExporterToolchain::runProcess(const QString &cmd, const QStringList &args, QStringList *errorLog)
 {
-    QProcess process(this);
+    beginRun();
+    return runStage(0, cmd, args, errorLog);
+}
+
+void FileExporterToolchain::beginRun()
+{
+    m_cancelled.store(0);
+    /// Output files of the previous run stay in place, but their contents
+    /// depend on that run's data; leaving them out of the fingerprints
+    /// makes stages see the same inputs as last time if the data did not
+    /// change, in which case restoring a stage replaces them anyway
+    m_leftoverFilenames.clear();
+    const QStringList filenames = QDir(tempDir.path()).entryList(QDir::Files);
+    for (const QString &filename : filenames)
+        if (m_outputFilenames.contains(filename))
+            m_leftoverFilenames.insert(filename);
+}
+
+QHash<QString, QByteArray> FileExporterToolchain::workingDirectoryHashes() const
+{
+    QHash<QString, QByteArray> result;
+    const QDir workingDir(tempDir.path());
+    const QStringList filenames = workingDir.entryList(QDir::Files, QDir::Name);
+    for (const QString &filename : filenames) {
+        QFile file(workingDir.filePath(filename));
+        if (!file.open(QIODevice::ReadOnly)) continue;
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(&file);
+        result.insert(filename, hash.result());
+    }
+    return result;
+}
+
+bool FileExporterToolchain::runStage(int index, const QString &cmd, const QStringList &args, QStringList *errorLog)
+{
+    /// Assemble the full command line (program name + arguments)
+    /// for use in log messages and debug output
+    const QString fullCommandLine = cmd + QLatin1Char(' ') + args.join(QStringLiteral(" "));
+
+    if (m_cancelled.load() != 0) {
+        if (errorLog != nullptr)
+            errorLog->append(i18n("Command '%1' was cancelled", fullCommandLine));
+        return false;
+    }
+
+    const QHash<QString, QByteArray> inputHashes = workingDirectoryHashes();
+    QCryptographicHash fingerprintHash(QCryptographicHash::Sha1);
+    fingerprintHash.addData(fullCommandLine.toUtf8());
+    QStringList inputFilenames = inputHashes.keys();
+    inputFilenames.sort();
+    for (const QString &filename : const_cast<const QStringList &>(inputFilenames)) {
+        if (m_leftoverFilenames.contains(filename)) continue;
+        fingerprintHash.addData(filename.toUtf8());
+        fingerprintHash.addData(inputHashes.value(filename));
+    }
+    const QByteArray fingerprint = fingerprintHash.result();
+
+    const QDir workingDir(tempDir.path());
+    const QPair<int, QString> stageKey(index, fullCommandLine);
+    const QHash<QPair<int, QString>, StageResult>::ConstIterator previousResult = m_stageResults.constFind(stageKey);
+    if (previousResult != m_stageResults.constEnd() && previousResult->fingerprint == fingerprint) {
+        /// Same input as last time, so restore last time's output
+        bool restored = true;
+        for (QHash<QString, QByteArray>::ConstIterator it = previousResult->outputFiles.constBegin(); restored && it != previousResult->outputFiles.constEnd(); ++it) {
+            QFile file(workingDir.filePath(it.key()));
+            restored = file.open(QIODevice::WriteOnly) && file.write(it.value()) == it.value().size();
+            m_leftoverFilenames.remove(it.key());
+        }
+        if (restored) {
+            if (errorLog != nullptr) {
+                errorLog->append(previousResult->log);
+                errorLog->append(i18n("Command '%1' skipped, its input files are unchanged", fullCommandLine));
+            }
+            return true;
+        }
+    }
+    m_stageResults.remove(stageKey);
+
+    QProcess process;
     QProcessEnvironment processEnvironment = QProcessEnvironment::systemEnvironment();
     /// Avoid some paranoid security settings in BibTeX
     processEnvironment.insert(QStringLiteral("openout_any"), QStringLiteral("r"));
@@ -68,46 +155,91 @@ bool FileExporterToolchain::runProcess(const QString &cmd, const QStringList &ar
     processEnvironment.insert(QStringLiteral("TEMPDIR"), tempDir.path());
     process.setProcessEnvironment(processEnvironment);
     process.setWorkingDirectory(tempDir.path());
-    /// Assemble the full command line (program name + arguments)
-    /// for use in log messages and debug output
-    const QString fullCommandLine = cmd + QLatin1Char(' ') + args.join(QStringLiteral(" "));
 
     if (errorLog != nullptr)
         errorLog->append(i18n("Running command '%1' using working directory '%2'", fullCommandLine, process.workingDirectory()));
-    process.start(cmd, args);
 
-    if (errorLog != nullptr) {
-        /// Redirect any standard output from process into errorLog
-        connect(&process, &QProcess::readyReadStandardOutput, [errorLog, &process] {
-            QTextStream ts(process.readAllStandardOutput());
-            while (!ts.atEnd())
-                errorLog->append(ts.readLine());
-        });
-        /// Redirect any standard error from process into errorLog
-        connect(&process, &QProcess::readyReadStandardError, [errorLog, &process] {
-            QTextStream ts(process.readAllStandardError());
-            while (!ts.atEnd())
-                errorLog->append(ts.readLine());
-        });
-    }
+    /// Collect any standard output and standard error from process,
+    /// kept to be replayed if this stage gets skipped later
+    QStringList log;
+    connect(&process, &QProcess::readyReadStandardOutput, [&log, &process] {
+        QTextStream ts(process.readAllStandardOutput());
+        while (!ts.atEnd())
+            log.append(ts.readLine());
+    });
+    connect(&process, &QProcess::readyReadStandardError, [&log, &process] {
+        QTextStream ts(process.readAllStandardError());
+        while (!ts.atEnd())
+            log.append(ts.readLine());
+    });
 
-    bool result = process.waitForStarted(3000);
-    if (!result) {
+    /// Wait for the process in an event loop instead of blocking,
+    /// checking regularly if the stage got cancelled or took too long
+    QEventLoop eventLoop;
+    QTimer cancelTimer;
+    cancelTimer.setInterval(100);
+    QTimer timeoutTimer;
+    timeoutTimer.setSingleShot(true);
+    bool timedOut = false;
+    connect(&process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &eventLoop, &QEventLoop::quit);
+    connect(&process, &QProcess::errorOccurred, &eventLoop, &QEventLoop::quit);
+    connect(&cancelTimer, &QTimer::timeout, [this, &process] {
+        if (m_cancelled.load() != 0)
+            process.kill();
+    });
+    connect(&timeoutTimer, &QTimer::timeout, [&timedOut, &process] {
+        timedOut = true;
+        process.kill();
+    });
+
+    process.start(cmd, args);
+    if (!process.waitForStarted(3000)) {
         if (errorLog != nullptr)
             errorLog->append(i18n("Starting command '%1' failed: %2", fullCommandLine, process.errorString()));
         return false;
     }
 
-    if (process.waitForFinished(30000))
-        result = process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    cancelTimer.start();
+    timeoutTimer.start(30000);
+    if (process.state() != QProcess::NotRunning)
+        eventLoop.exec();
+    cancelTimer.stop();
+    timeoutTimer.stop();
+    /// Read any output not processed yet
+    process.waitForFinished(0);
+
+    const bool cancelled = m_cancelled.load() != 0;
+    const bool result = !cancelled && !timedOut && process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
 
     if (errorLog != nullptr) {
+        errorLog->append(log);
         if (result)
             errorLog->append(i18n("Command '%1' succeeded", fullCommandLine));
+        else if (cancelled)
+            errorLog->append(i18n("Command '%1' was cancelled", fullCommandLine));
+        else if (timedOut)
+            errorLog->append(i18n("Command '%1' did not finish in time", fullCommandLine));
         else
             errorLog->append(i18n("Command '%1' failed with exit code %2: %3", fullCommandLine, process.exitCode(), process.errorString()));
     }
 
+    if (result) {
+        /// Remember which files this stage created or modified
+        StageResult stageResult;
+        stageResult.fingerprint = fingerprint;
+        stageResult.log = log;
+        const QHash<QString, QByteArray> outputHashes = workingDirectoryHashes();
+        for (QHash<QString, QByteArray>::ConstIterator it = outputHashes.constBegin(); it != outputHashes.constEnd(); ++it)
+            if (inputHashes.value(it.key()) != it.value()) {
+                QFile file(workingDir.filePath(it.key()));
+                if (file.open(QIODevice::ReadOnly))
+                    stageResult.outputFiles.insert(it.key(), file.readAll());
+                m_outputFilenames.insert(it.key());
+                m_leftoverFilenames.remove(it.key());
+            }
+        m_stageResults.insert(stageKey, stageResult);
+    }
+
     return result;
 }
 
@@ -137,9 +269,15 @@ bool FileExporterToolchain::writeFileToIODevice(const QString &filename, QIODevi
 
 bool FileExporterToolchain::kpsewhich(const QString &filename)
 {
+    /// Exporters may run in several threads at the same time
+    static QMutex kpsewhichMutex;
     static QHash<QString, bool> kpsewhichMap;
-    if (kpsewhichMap.contains(filename))
-        return kpsewhichMap.value(filename, false);
+    {
+        QMutexLocker locker(&kpsewhichMutex);
+        const QHash<QString, bool>::ConstIterator it = kpsewhichMap.constFind(filename);
+        if (it != kpsewhichMap.constEnd())
+            return it.value();
+    }
 
     bool result = false;
     QProcess kpsewhich;
@@ -148,8 +286,10 @@ bool FileExporterToolchain::kpsewhich(const QString &filename)
     if (kpsewhich.waitForStarted(3000) && kpsewhich.waitForFinished(30000)) {
         const QString standardOut = QString::fromUtf8(kpsewhich.readAllStandardOutput());
         result = kpsewhich.exitStatus() == QProcess::NormalExit && kpsewhich.exitCode() == 0 && standardOut.endsWith(QDir::separator() + filename + QChar('\n'));
-        kpsewhichMap.insert(filename, result);
     }
 
+    /// Remember failures as well, e.g. if kpsewhich is not installed at all
+    QMutexLocker locker(&kpsewhichMutex);
+    kpsewhichMap.insert(filename, result);
     return result;
 }
@@ -19,12 +19,31 @@
 #define BIBTEXFILEEXPORTERTOOLCHAIN_H
 
 #include <QTemporaryDir>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QAtomicInt>
 
 #include "fileexporter.h"
 
 class QString;
 
 /**
+ * Base class for exporters running external programs such as LaTeX or
+ * BibTeX in a temporary working directory, which is kept for the
+ * exporter's lifetime.
+ *
+ * Each program run is a stage whose output files are remembered. If a
+ * stage is run again at the same position with the same command line
+ * on working directory contents identical to last time, its output
+ * files are restored instead of running the program again, which makes
+ * repeated exports of unchanged data cheap. To benefit from this, keep
+ * an exporter alive for as long as the data it exports may be exported
+ * again instead of creating a new one for each export.
+ *
+ * Output files of earlier runs, such as LaTeX's auxiliary files, are
+ * kept in the working directory for programs to make use of them.
+ *
 @author Thomas Fischer
  */
 class KBIBTEXIO_EXPORT FileExporterToolchain : public FileExporter
@@ -42,14 +61,45 @@ public:
 
     virtual void reloadConfig() = 0;
 
+    /// Results are cached, as the set of installed files rarely changes
     static bool kpsewhich(const QString &filename);
 
+public slots:
+    /// Kill the running program and skip all further stages, may be called from any thread
+    void cancel() override;
+
 protected:
     QTemporaryDir tempDir;
 
+    /// Run each command line as a stage, see @see runProcess
     bool runProcesses(const QStringList &progs, QStringList *errorLog = nullptr);
+    /// Run a single command as the only stage
     bool runProcess(const QString &cmd, const QStringList &args, QStringList *errorLog = nullptr);
     bool writeFileToIODevice(const QString &filename, QIODevice *device, QStringList *errorLog = nullptr);
+
+private:
+    struct StageResult {
+        /// Hash of command line and working directory contents before running
+        QByteArray fingerprint;
+        /// Files created or modified by the stage, by name
+        QHash<QString, QByteArray> outputFiles;
+        /// Program output, replayed when restoring the stage
+        QStringList log;
+    };
+    /// Last successful run of each stage, by its position within
+    /// the run and its command line, as a run may contain the same
+    /// command line several times like repeated LaTeX passes
+    QHash<QPair<int, QString>, StageResult> m_stageResults;
+    /// Names of all files any stage has created or modified so far
+    QSet<QString> m_outputFilenames;
+    /// Output files left over from earlier runs, which are not part of
+    /// fingerprints until a stage of the current run writes them again
+    QSet<QString> m_leftoverFilenames;
+    QAtomicInt m_cancelled;
+
+    void beginRun();
+    QHash<QString, QByteArray> workingDirectoryHashes() const;
+    bool runStage(int index, const QString &cmd, const QStringList &args, QStringList *errorLog);
 };
 
 #endif
@@ -39,7 +39,7 @@
 const char *FileImporterBibTeX::defaultCodecName = "utf-8";
 
 FileImporterBibTeX::FileImporterBibTeX(QObject *parent)
-        : FileImporter(parent), m_cancelFlag(false), m_textStream(nullptr), m_commentHandling(IgnoreComments), m_keywordCasing(KBibTeX::cLowerCase), m_lineNo(1)
+        : FileImporter(parent), m_cancelFlag(0), m_textStream(nullptr), m_commentHandling(IgnoreComments), m_keywordCasing(KBibTeX::cLowerCase), m_lineNo(1)
 {
     m_keysForPersonDetection.append(Entry::ftAuthor);
     m_keysForPersonDetection.append(Entry::ftEditor);
@@ -48,7 +48,7 @@ FileImporterBibTeX::FileImporterBibTeX(QObject *parent)
 
 File *FileImporterBibTeX::load(QIODevice *iodevice)
 {
-    m_cancelFlag = false;
+    m_cancelFlag.store(0);
 
     if (!iodevice->isReadable() && !iodevice->open(QIODevice::ReadOnly)) {
         qCWarning(LOG_KBIBTEX_IO) << "Input device not readable";
@@ -107,7 +107,7 @@ File *FileImporterBibTeX::load(QIODevice *iodevice)
     m_knownElementIds.clear();
     readChar();
 
-    while (!m_nextChar.isNull() && !m_cancelFlag && !m_textStream->atEnd()) {
+    while (!m_nextChar.isNull() && m_cancelFlag.load() == 0 && !m_textStream->atEnd()) {
         emit progress(m_textStream->pos(), rawText.length());
         Element *element = nextElement();
 
@@ -120,7 +120,7 @@ File *FileImporterBibTeX::load(QIODevice *iodevice)
     }
     emit progress(100, 100);
 
-    if (m_cancelFlag) {
+    if (m_cancelFlag.load() != 0) {
         qCWarning(LOG_KBIBTEX_IO) << "Loading bibliography data has been canceled";
         emit message(SeverityError, QStringLiteral("Loading bibliography data has been canceled"));
         delete result;
@@ -163,7 +163,7 @@ bool FileImporterBibTeX::guessCanDecode(const QString &rawText)
 
 void FileImporterBibTeX::cancel()
 {
-    m_cancelFlag = true;
+    m_cancelFlag.store(1);
 }
 
 Element *FileImporterBibTeX::nextElement()
@@ -26,6 +26,7 @@
 #include <QSharedPointer>
 #include <QStringList>
 #include <QSet>
+#include <QAtomicInt>
 
 #include "kbibtex.h"
 #include "fileimporter.h"
@@ -119,7 +120,7 @@ private:
         QString mostRecentListSeparator;
     } m_statistics;
 
-    bool m_cancelFlag;
+    QAtomicInt m_cancelFlag;
     QTextStream *m_textStream;
     CommentHandling m_commentHandling;
     KBibTeX::Casing m_keywordCasing;
@@ -17,20 +17,17 @@
 
 #include "fileinfo.h"
 
-#include <poppler-qt5.h>
-
-#include <QFileInfo>
 #include <QDir>
 #include <QTextStream>
-#include <QStandardPaths>
 #include <QRegularExpression>
-#include <QtConcurrentRun>
 
 #include <KSharedConfig>
 #include <KConfigGroup>
 
 #include "kbibtex.h"
 #include "entry.h"
+#include "pdftextextractor.h"
+#include "attachmentresolver.h"
 #include "logging_io.h"
 
 FileInfo::FileInfo()
@@ -97,18 +94,62 @@ QMimeType FileInfo::mimeTypeForUrl(const QUrl &url)
     return result;
 }
 
+/// Fragments any DOI, URL, domain name, or filename has to contain
+struct TextFeatures {
+    /// "10." followed by a digit as required by KBibTeX::doiRegExp
+    bool doiPrefix;
+    /// "://" as required by KBibTeX::urlRegExp
+    bool schemeSeparator;
+    /// Dot followed by a word character as required by
+    /// KBibTeX::domainNameRegExp and KBibTeX::fileRegExp
+    bool dotWord;
+};
+
+/**
+ * Determine in a single pass over the text which of the regular
+ * expressions used in @see FileInfo::urlsInText could match at all.
+ * Most field values like titles or names contain none of the
+ * fragments, sparing the expensive matching.
+ */
+static TextFeatures scanTextFeatures(const QString &text)
+{
+    TextFeatures result = {false, false, false};
+    const QChar *const end = text.constData() + text.length();
+    for (const QChar *c = text.constData(); c + 1 < end; ++c) {
+        const ushort u = c->unicode();
+        if (u == '.') {
+            /// Characters outside the BMP are not tested, but may be letters
+            if (c[1].isLetterOrNumber() || c[1] == QLatin1Char('_') || c[1].isHighSurrogate())
+                result.dotWord = true;
+        } else if (u == ':') {
+            if (c + 2 < end && c[1] == QLatin1Char('/') && c[2] == QLatin1Char('/'))
+                result.schemeSeparator = true;
+        } else if (u == '1') {
+            if (c + 3 < end && c[1] == QLatin1Char('0') && c[2] == QLatin1Char('.') && c[3].unicode() >= '0' && c[3].unicode() <= '9')
+                result.doiPrefix = true;
+        }
+    }
+    return result;
+}
+
 void FileInfo::urlsInText(const QString &text, const TestExistence testExistence, const QString &baseDirectory, QSet<QUrl> &result)
 {
     if (text.isEmpty())
         return;
 
+    /// Without any of the required fragments, only filenames
+    /// that exist as given could be found in the text
+    const TextFeatures textFeatures = scanTextFeatures(text);
+    if (testExistence == TestExistenceNo && !textFeatures.doiPrefix && !textFeatures.schemeSeparator && !textFeatures.dotWord)
+        return;
+
     /// DOI identifiers have to extracted first as KBibTeX::fileListSeparatorRegExp
     /// contains characters that can be part of a DOI (e.g. ';') and thus could split
     /// a DOI in between.
     QString internalText = text;
     int pos = 0;
     QRegularExpressionMatch doiRegExpMatch;
-    while ((doiRegExpMatch = KBibTeX::doiRegExp.match(internalText, pos)).hasMatch()) {
+    while (textFeatures.doiPrefix && (doiRegExpMatch = KBibTeX::doiRegExp.match(internalText, pos)).hasMatch()) {
         pos = doiRegExpMatch.capturedStart(0);
         QString doiMatch = doiRegExpMatch.captured(0);
         const int semicolonHttpPos = doiMatch.indexOf(QStringLiteral(";http"));
@@ -141,10 +182,9 @@ void FileInfo::urlsInText(const QString &text, const TestExistence testExistence
             /// If a base directory (e.g. the location of the parent .bib file) is given
             /// and the potential filename fragment is NOT an absolute path, ...
             if (internalText.startsWith(QStringLiteral("~") + QDir::separator())) {
-                const QString fullFilename = QDir::homePath() + internalText.mid(1);
-                const QFileInfo fileInfo(fullFilename);
-                const QUrl url = QUrl::fromLocalFile(fileInfo.canonicalFilePath());
-                if (fileInfo.exists() && fileInfo.isFile() && url.isValid() && !result.contains(url)) {
+                const QString fullFilename = AttachmentResolver::existingFile(QDir::homePath() + internalText.mid(1));
+                const QUrl url = QUrl::fromLocalFile(fullFilename);
+                if (!fullFilename.isEmpty() && url.isValid() && !result.contains(url)) {
                     result << url;
                     /// Stop searching for URLs or filenames in current internal text
                     continue;
@@ -156,10 +196,9 @@ void FileInfo::urlsInText(const QString &text, const TestExistence testExistence
                        // second is ":", third is "\"' may be necessary.
                        !internalText.startsWith(QDir::separator())) {
                 /// To get the absolute path, prepend filename fragment with base directory
-                const QString fullFilename = baseDirectory + QDir::separator() + internalText;
-                const QFileInfo fileInfo(fullFilename);
-                const QUrl url = QUrl::fromLocalFile(fileInfo.canonicalFilePath());
-                if (fileInfo.exists() && fileInfo.isFile() && url.isValid() && !result.contains(url)) {
+                const QString fullFilename = AttachmentResolver::existingFile(baseDirectory + QDir::separator() + internalText);
+                const QUrl url = QUrl::fromLocalFile(fullFilename);
+                if (!fullFilename.isEmpty() && url.isValid() && !result.contains(url)) {
                     result << url;
                     /// Stop searching for URLs or filenames in current internal text
                     continue;
@@ -167,9 +206,9 @@ void FileInfo::urlsInText(const QString &text, const TestExistence testExistence
             } else {
                 /// Either the filename fragment is an absolute path OR no base directory
                 /// was given (current working directory is assumed), ...
-                const QFileInfo fileInfo(internalText);
-                const QUrl url = QUrl::fromLocalFile(fileInfo.canonicalFilePath());
-                if (fileInfo.exists() && fileInfo.isFile() && url.isValid() && !result.contains(url)) {
+                const QString fullFilename = AttachmentResolver::existingFile(internalText);
+                const QUrl url = QUrl::fromLocalFile(fullFilename);
+                if (!fullFilename.isEmpty() && url.isValid() && !result.contains(url)) {
                     result << url;
                     /// stop searching for URLs or filenames in current internal text
                     continue;
@@ -177,23 +216,26 @@ void FileInfo::urlsInText(const QString &text, const TestExistence testExistence
             }
         }
 
+        /// Removing DOIs above may have joined fragments, so test each part on its own
+        const TextFeatures features = scanTextFeatures(internalText);
+
         /// extract URL from current field
         pos = 0;
         QRegularExpressionMatch urlRegExpMatch;
-        while ((urlRegExpMatch = KBibTeX::urlRegExp.match(internalText, pos)).hasMatch()) {
+        while (features.schemeSeparator && (urlRegExpMatch = KBibTeX::urlRegExp.match(internalText, pos)).hasMatch()) {
             pos = urlRegExpMatch.capturedStart(0);
             const QString match = urlRegExpMatch.captured(0);
             QUrl url(match);
-            if (url.isValid() && (testExistence == TestExistenceNo || !url.isLocalFile() || QFileInfo::exists(url.toLocalFile())) && !result.contains(url))
+            if (url.isValid() && (testExistence == TestExistenceNo || !url.isLocalFile() || !AttachmentResolver::existingFile(url.toLocalFile()).isEmpty()) && !result.contains(url))
                 result << url;
             /// remove match from internal text to avoid duplicates
-            internalText = internalText.left(pos) + internalText.mid(pos + match.length());
+            internalText.remove(pos, match.length());
         }
 
         /// explicitly check URL entry, may be an URL even if http:// or alike is missing
         pos = 0;
         QRegularExpressionMatch domainNameRegExpMatch;
-        while ((domainNameRegExpMatch = KBibTeX::domainNameRegExp.match(internalText, pos)).hasMatch()) {
+        while (features.dotWord && (domainNameRegExpMatch = KBibTeX::domainNameRegExp.match(internalText, pos)).hasMatch()) {
             pos = domainNameRegExpMatch.capturedStart(0);
             int pos2 = internalText.indexOf(QStringLiteral(" "), pos + 1);
             if (pos2 < 0) pos2 = internalText.length();
@@ -202,20 +244,20 @@ void FileInfo::urlsInText(const QString &text, const TestExistence testExistence
             if (url.isValid() && !result.contains(url))
                 result << url;
             /// remove match from internal text to avoid duplicates
-            internalText = internalText.left(pos) + internalText.mid(pos + match.length());
+            internalText.remove(pos, match.length());
         }
 
         /// extract general file-like patterns
         pos = 0;
         QRegularExpressionMatch fileRegExpMatch;
-        while ((fileRegExpMatch = KBibTeX::fileRegExp.match(internalText, pos)).hasMatch()) {
+        while (features.dotWord && (fileRegExpMatch = KBibTeX::fileRegExp.match(internalText, pos)).hasMatch()) {
             pos = fileRegExpMatch.capturedStart(0);
             const QString match = fileRegExpMatch.captured(0);
             QUrl url(match);
-            if (url.isValid() && (testExistence == TestExistenceNo || !url.isLocalFile() || QFileInfo::exists(url.toLocalFile())) && !result.contains(url))
+            if (url.isValid() && (testExistence == TestExistenceNo || !url.isLocalFile() || !AttachmentResolver::existingFile(url.toLocalFile()).isEmpty()) && !result.contains(url))
                 result << url;
             /// remove match from internal text to avoid duplicates
-            internalText = internalText.left(pos) + internalText.mid(pos + match.length());
+            internalText.remove(pos, match.length());
         }
     }
 }
@@ -266,7 +308,8 @@ QSet<QUrl> FileInfo::entryUrls(const QSharedPointer<const Entry> &entry, const Q
             QString plainText = PlainTextValue::text(*valueItem);
 
             static const QRegularExpression regExpEscapedChars = QRegularExpression(QStringLiteral("\\\\+([&_~])"));
-            plainText.replace(regExpEscapedChars, QStringLiteral("\\1"));
+            if (plainText.contains(QLatin1Char('\\')))
+                plainText.replace(regExpEscapedChars, QStringLiteral("\\1"));
 
             urlsInText(plainText, testExistence, baseDirectory, result);
         }
@@ -280,9 +323,9 @@ QSet<QUrl> FileInfo::entryUrls(const QSharedPointer<const Entry> &entry, const Q
         /// check if in the same directory as the BibTeX file
         /// a PDF file exists which filename is based on the entry's id
         for (const QString &extension : documentFileExtensions) {
-            const QFileInfo fi(baseDirectory + QDir::separator() + entry->id() + extension);
-            if (fi.exists()) {
-                const QUrl url = QUrl::fromLocalFile(fi.canonicalFilePath());
+            const QString filename = AttachmentResolver::existingFile(baseDirectory + QDir::separator() + entry->id() + extension);
+            if (!filename.isEmpty()) {
+                const QUrl url = QUrl::fromLocalFile(filename);
                 if (!result.contains(url))
                     result << url;
             }
@@ -295,9 +338,9 @@ QSet<QUrl> FileInfo::entryUrls(const QSharedPointer<const Entry> &entry, const Q
         const QString basename = bibTeXUrl.fileName().remove(filenameExtension);
         QString directory = baseDirectory + QDir::separator() + basename;
         for (const QString &extension : documentFileExtensions) {
-            const QFileInfo fi(directory + QDir::separator() + entry->id() + extension);
-            if (fi.exists()) {
-                const QUrl url = QUrl::fromLocalFile(fi.canonicalFilePath());
+            const QString filename = AttachmentResolver::existingFile(directory + QDir::separator() + entry->id() + extension);
+            if (!filename.isEmpty()) {
+                const QUrl url = QUrl::fromLocalFile(filename);
                 if (!result.contains(url))
                     result << url;
             }
@@ -309,67 +352,7 @@ QSet<QUrl> FileInfo::entryUrls(const QSharedPointer<const Entry> &entry, const Q
 
 QString FileInfo::pdfToText(const QString &pdfFilename)
 {
-    /// Build filename for text file where PDF file's plain text is cached
-    const QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/pdftotext");
-    if (!QDir(cacheDirectory).exists() && !QDir::home().mkdir(cacheDirectory))
-        /// Could not create cache directory
-        return QString();
-    static const QRegularExpression invalidChars(QStringLiteral("[^-a-z0-9_]"), QRegularExpression::CaseInsensitiveOption);
-    const QString textFilename = QString(pdfFilename).remove(invalidChars).append(QStringLiteral(".txt")).prepend(QStringLiteral("/")).prepend(cacheDirectory);
-
-    /// First, check if there is a cache text file
-    if (QFileInfo::exists(textFilename)) {
-        /// Load text from cache file
-        QFile f(textFilename);
-        if (f.open(QFile::ReadOnly)) {
-            const QString text = QString::fromUtf8(f.readAll());
-            f.close();
-            return text;
-        }
-    } else
-        /// No cache file exists, so run text extraction in another thread
-        QtConcurrent::run(extractPDFTextToCache, pdfFilename, textFilename);
-
-    return QString();
-}
-
-void FileInfo::extractPDFTextToCache(const QString &pdfFilename, const QString &cacheFilename) {
-    /// In case of multiple calls, skip text extraction if cache file already exists
-    if (QFile(cacheFilename).exists()) return;
-
-    QString text;
-    QStringList msgList;
-
-    /// Load PDF file through Poppler
-    Poppler::Document *doc = Poppler::Document::load(pdfFilename);
-    if (doc != nullptr) {
-        static const int maxPages = 64;
-        /// Build text by appending each page's text
-        for (int i = 0; i < qMin(maxPages, doc->numPages()); ++i)
-            text.append(doc->page(i)->text(QRect())).append(QStringLiteral("\n\n"));
-        if (doc->numPages() > maxPages)
-            msgList << QString(QStringLiteral("### Skipped %1 pages as PDF file contained too many pages (limit is %2 pages) ###")).arg(doc->numPages() - maxPages).arg(maxPages);
-        delete doc;
-    } else
-        msgList << QStringLiteral("### Skipped as file could not be opened as PDF file ###");
-
-    /// Save text in cache file
-    QFile f(cacheFilename);
-    if (f.open(QFile::WriteOnly)) {
-        static const int maxCharacters = 1 << 18;
-        f.write(text.left(maxCharacters).toUtf8()); ///< keep only the first 2^18 many characters
-
-        if (text.length() > maxCharacters)
-            msgList << QString(QStringLiteral("### Text too long, skipping %1 characters ###")).arg(text.length() - maxCharacters);
-        /// Write all messages (warnings) to end of text file
-        for (const QString &msg : const_cast<const QStringList &>(msgList)) {
-            static const char linebreak = '\n';
-            f.write(&linebreak, 1);
-            f.write(msg.toUtf8());
-        }
-
-        f.close();
-    }
+    return PDFTextExtractor::instance().text(pdfFilename);
 }
 
 QString FileInfo::doiUrlPrefix()
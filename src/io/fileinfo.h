@@ -86,11 +86,11 @@ public:
     static QSet<QUrl> entryUrls(const QSharedPointer<const Entry> &entry, const QUrl &bibTeXUrl, TestExistence testExistence);
 
     /**
-     * Load the given PDF file and return the contained plain text.
-     * Makes use of Poppler to load and parse the file. All text
-     * will be cached and loaded from cache if possible.
-     * @param pdfFilename PDF file to load and extract text from
-     * @return extracted plain text, either directly from PDF file or from cache OR QString() if there was an error
+     * Return the plain text contained in the given PDF file if it has
+     * been extracted before. Otherwise, the text gets extracted in the
+     * background, see @see PDFTextExtractor for details.
+     * @param pdfFilename PDF file to extract text from
+     * @return extracted plain text OR QString() if not extracted yet or if there was an error
      */
     static QString pdfToText(const QString &pdfFilename);
 
@@ -98,9 +98,6 @@ public:
 
 protected:
     FileInfo();
-
-private:
-    static void extractPDFTextToCache(const QString &pdfFilename, const QString &cacheFilename);
 };
 
 #endif // KBIBTEX_IO_FILEINFO_H
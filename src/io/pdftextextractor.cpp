@@ -0,0 +1,244 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "pdftextextractor.h"
+
+#include <poppler-qt5.h>
+
+#include <QHash>
+#include <QCache>
+#include <QStringList>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QThread>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include "logging_io.h"
+
+/// Outcome of extracting a single PDF file's text in a worker thread
+struct ExtractedText {
+    QString fileKey;
+    QByteArray contentHash;
+    QString text;
+};
+
+/// Text of a PDF file gets cached under the hash of the file's content
+static QString cacheFilename(const QString &cacheDirectory, const QByteArray &contentHash)
+{
+    return cacheDirectory + QString::fromLatin1(contentHash.toHex()) + QStringLiteral(".txt");
+}
+
+/**
+ * Load a PDF file's text from the on-disk cache or extract it using
+ * Poppler and store it in the cache. To be run in a worker thread.
+ * If the hash of the file's content is known, it is not computed again.
+ */
+static ExtractedText extractText(const QString &pdfFilename, const QString &fileKey, const QByteArray &knownContentHash, const QString &cacheDirectory)
+{
+    ExtractedText result;
+    result.fileKey = fileKey;
+    result.contentHash = knownContentHash;
+
+    if (result.contentHash.isEmpty()) {
+        QFile pdfFile(pdfFilename);
+        if (!pdfFile.open(QFile::ReadOnly)) return result;
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(&pdfFile);
+        result.contentHash = hash.result();
+    }
+
+    /// Text gets cached under the PDF file's content hash,
+    /// so any change to the PDF file will miss the cache
+    const QString textCacheFilename = cacheFilename(cacheDirectory, result.contentHash);
+    QFile cacheFile(textCacheFilename);
+    if (cacheFile.open(QFile::ReadOnly)) {
+        result.text = QString::fromUtf8(cacheFile.readAll());
+        return result;
+    }
+
+    static const int maxCharacters = 1 << 20;
+    QStringList msgList;
+
+    /// Load PDF file through Poppler
+    QScopedPointer<Poppler::Document> doc(Poppler::Document::load(pdfFilename));
+    if (!doc.isNull()) {
+        /// Build text by appending each page's text until enough text is collected
+        const int numPages = doc->numPages();
+        int page = 0;
+        for (; page < numPages && result.text.length() < maxCharacters; ++page) {
+            QScopedPointer<Poppler::Page> popplerPage(doc->page(page));
+            if (!popplerPage.isNull())
+                result.text.append(popplerPage->text(QRect())).append(QStringLiteral("\n\n"));
+        }
+        if (page < numPages)
+            msgList << QString(QStringLiteral("### Skipped %1 pages as PDF file contained too much text (limit is %2 characters) ###")).arg(numPages - page).arg(maxCharacters);
+    } else
+        msgList << QStringLiteral("### Skipped as file could not be opened as PDF file ###");
+
+    if (result.text.length() > maxCharacters)
+        result.text = result.text.left(maxCharacters); ///< keep only the first 2^20 many characters
+
+    /// Append all messages (warnings), so that the text is the
+    /// same no matter if freshly extracted or loaded from the cache
+    for (const QString &msg : const_cast<const QStringList &>(msgList))
+        result.text.append(QLatin1Char('\n')).append(msg);
+
+    /// Save text in cache file
+    QSaveFile saveFile(textCacheFilename);
+    if (saveFile.open(QFile::WriteOnly)) {
+        saveFile.write(result.text.toUtf8());
+        if (!saveFile.commit())
+            qCWarning(LOG_KBIBTEX_IO) << "Could not write cache file" << textCacheFilename;
+    }
+
+    return result;
+}
+
+class PDFTextExtractor::PDFTextExtractorPrivate
+{
+public:
+    /// Extracted texts by file key, cost is the text's length
+    QCache<QString, QString> texts;
+    static const int maxCachedCharacters;
+    /// Content hashes by file key, kept to avoid re-hashing files whose text got evicted
+    QHash<QString, QByteArray> contentHashes;
+    /// Files requested by callers by file key, for extractions queued or running
+    QHash<QString, QStringList> pendingFilenames;
+    QThreadPool threadPool;
+    QString cacheDirectory;
+
+    PDFTextExtractorPrivate()
+            : texts(maxCachedCharacters) {
+        /// Extraction is mostly bound by CPU, but should leave room for the GUI
+        threadPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+
+        cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/pdftotext/");
+        QDir().mkpath(cacheDirectory);
+    }
+};
+
+const int PDFTextExtractor::PDFTextExtractorPrivate::maxCachedCharacters = 1 << 24;
+
+PDFTextExtractor &PDFTextExtractor::instance()
+{
+    static PDFTextExtractor self;
+    return self;
+}
+
+PDFTextExtractor::PDFTextExtractor(QObject *parent)
+        : QObject(parent), d(new PDFTextExtractorPrivate())
+{
+    /// nothing
+}
+
+PDFTextExtractor::~PDFTextExtractor()
+{
+    d->threadPool.clear();
+    d->threadPool.waitForDone();
+    delete d;
+}
+
+QString PDFTextExtractor::fileKey(const QString &pdfFilename)
+{
+    const QFileInfo fileInfo(pdfFilename);
+    if (!fileInfo.isFile()) return QString();
+    return fileInfo.canonicalFilePath() + QLatin1Char('|') + QString::number(fileInfo.size()) + QLatin1Char('|') + QString::number(fileInfo.lastModified().toMSecsSinceEpoch());
+}
+
+QString PDFTextExtractor::text(const QString &pdfFilename)
+{
+    const QString key = fileKey(pdfFilename);
+    if (key.isEmpty()) return QString();
+
+    const QString *cachedText = d->texts.object(key);
+    if (cachedText != nullptr)
+        return *cachedText;
+
+    const QHash<QString, QStringList>::Iterator it = d->pendingFilenames.find(key);
+    if (it != d->pendingFilenames.end()) {
+        /// Extraction for this file is queued or running already
+        if (!it->contains(pdfFilename))
+            it->append(pdfFilename);
+        return QString();
+    }
+
+    d->pendingFilenames.insert(key, QStringList() << pdfFilename);
+    QFutureWatcher<ExtractedText> *watcher = new QFutureWatcher<ExtractedText>(this);
+    connect(watcher, &QFutureWatcher<ExtractedText>::finished, this, &PDFTextExtractor::extractionFinished);
+    watcher->setFuture(QtConcurrent::run(&d->threadPool, extractText, pdfFilename, key, d->contentHashes.value(key), d->cacheDirectory));
+
+    return QString();
+}
+
+QString PDFTextExtractor::cachedText(const QString &pdfFilename, const QByteArray &contentHash)
+{
+    const QString key = fileKey(pdfFilename);
+    if (key.isEmpty()) return QString();
+
+    const QString *cachedText = d->texts.object(key);
+    if (cachedText != nullptr)
+        return *cachedText;
+    if (contentHash.isEmpty()) return QString();
+
+    /// Text got evicted from memory or was extracted in a previous session
+    QFile cacheFile(cacheFilename(d->cacheDirectory, contentHash));
+    if (!cacheFile.open(QFile::ReadOnly)) return QString();
+    const QString text = QString::fromUtf8(cacheFile.readAll());
+    d->contentHashes.insert(key, contentHash);
+    d->texts.insert(key, new QString(text), qMax(1, text.length()));
+    return text;
+}
+
+bool PDFTextExtractor::isPending(const QString &pdfFilename) const
+{
+    const QString key = fileKey(pdfFilename);
+    return !key.isEmpty() && d->pendingFilenames.contains(key);
+}
+
+int PDFTextExtractor::pendingCount() const
+{
+    return d->pendingFilenames.count();
+}
+
+QByteArray PDFTextExtractor::contentHash(const QString &pdfFilename) const
+{
+    const QString key = fileKey(pdfFilename);
+    return key.isEmpty() ? QByteArray() : d->contentHashes.value(key);
+}
+
+void PDFTextExtractor::extractionFinished()
+{
+    QFutureWatcher<ExtractedText> *watcher = static_cast<QFutureWatcher<ExtractedText> *>(sender());
+    const ExtractedText extractedText = watcher->result();
+    watcher->deleteLater();
+
+    if (!extractedText.contentHash.isEmpty())
+        d->contentHashes.insert(extractedText.fileKey, extractedText.contentHash);
+    /// Failures are cached too, to not try again until the file changes
+    d->texts.insert(extractedText.fileKey, new QString(extractedText.text), qMax(1, extractedText.text.length()));
+
+    const QStringList pdfFilenames = d->pendingFilenames.take(extractedText.fileKey);
+    for (const QString &pdfFilename : pdfFilenames)
+        emit textAvailable(pdfFilename);
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_IO_PDFTEXTEXTRACTOR_H
+#define KBIBTEX_IO_PDFTEXTEXTRACTOR_H
+
+#include <QObject>
+
+#include "kbibtexio_export.h"
+
+/**
+ * Shared service extracting the plain text of PDF files.
+ *
+ * Requesting a file's text never blocks: text extracted before is
+ * returned immediately, otherwise the extraction is queued and an
+ * empty string is returned. Extraction runs in a bounded number of
+ * worker threads, and requests for a file already being processed
+ * are merged. Extracted text is cached on disk under the hash of the
+ * PDF file's content, so renamed or copied files do not get extracted
+ * again, while modified files do. Once a file's text has become
+ * available, signal @see textAvailable gets emitted.
+ *
+ * To be used from the main thread only.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXIO_EXPORT PDFTextExtractor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PDFTextExtractor &instance();
+    ~PDFTextExtractor() override;
+
+    /**
+     * Retrieve the plain text of the given PDF file.
+     * @param pdfFilename local PDF file to extract text from
+     * @return the text if extracted before, otherwise an empty string
+     */
+    QString text(const QString &pdfFilename);
+
+    /**
+     * Retrieve the plain text of the given PDF file if extracted before,
+     * loading it synchronously from the on-disk cache if it is no longer
+     * held in memory. Unlike @see text, no extraction gets queued.
+     * @param pdfFilename local PDF file to retrieve the text of
+     * @param contentHash hash of the file's content as returned by @see contentHash, possibly in a previous session
+     * @return the text if extracted before, otherwise an empty string
+     */
+    QString cachedText(const QString &pdfFilename, const QByteArray &contentHash);
+
+    /**
+     * Test if text extraction for the given file is queued or running.
+     * @param pdfFilename local PDF file as passed to @see text
+     * @return true if @see textAvailable will be emitted for this file
+     */
+    bool isPending(const QString &pdfFilename) const;
+
+    /// Number of text extractions queued or running
+    int pendingCount() const;
+
+    /**
+     * Hash of the given PDF file's content, known once its text has been
+     * extracted. Files with identical content have identical hashes.
+     * @param pdfFilename local PDF file as passed to @see text
+     * @return SHA1 hash of the file's content or an empty array if unknown
+     */
+    QByteArray contentHash(const QString &pdfFilename) const;
+
+    /**
+     * Identify a file's current state by its location, size, and time of
+     * last modification, which is cheap to determine and changes whenever
+     * the file's content changes.
+     * @return key for the file's current state or an empty string if the file does not exist
+     */
+    static QString fileKey(const QString &pdfFilename);
+
+signals:
+    /**
+     * Notification that the text of a PDF file previously requested
+     * through @see text has been extracted or loaded from the cache.
+     * Also emitted if extraction failed, with an empty text.
+     * @param pdfFilename local PDF file as passed to @see text
+     */
+    void textAvailable(const QString &pdfFilename);
+
+private:
+    explicit PDFTextExtractor(QObject *parent = nullptr);
+
+    class PDFTextExtractorPrivate;
+    PDFTextExtractorPrivate *const d;
+
+private slots:
+    void extractionFinished();
+};
+
+#endif // KBIBTEX_IO_PDFTEXTEXTRACTOR_H
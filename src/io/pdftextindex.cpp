@@ -0,0 +1,370 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "pdftextindex.h"
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QStringList>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QDataStream>
+#include <QTimer>
+#include <QStandardPaths>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include "pdftextextractor.h"
+#include "logging_io.h"
+
+/// Words of a document's text, each word once, to be added to the index
+struct TokenizedDocument {
+    QByteArray contentHash;
+    QStringList tokens;
+};
+
+/// To be run in a worker thread, as large texts take a while to split
+static TokenizedDocument tokenizeDocument(const QByteArray &contentHash, const QString &text)
+{
+    TokenizedDocument result;
+    result.contentHash = contentHash;
+    result.tokens = PDFTextIndex::tokenize(text);
+    return result;
+}
+
+static const quint32 indexFileMagic = 0x4b425449;
+static const quint32 indexFileVersion = 1;
+
+/// Index as stored on disk, without files modified or removed since
+struct LoadedIndex {
+    /// Content hash of each document, the document's id is its position
+    QVector<QByteArray> documentHashes;
+    /// Document of each file's state, see @see PDFTextExtractor::fileKey
+    QHash<QString, int> documentForFileKey;
+    /// Ids of all documents containing a word, in ascending order
+    QHash<QString, QVector<int> > postings;
+    /// Outdated files or documents got dropped, so the index should be saved
+    bool modified;
+};
+
+/// To be run in a worker thread, as reading a large index and
+/// checking every indexed file on disk takes a while
+static LoadedIndex loadIndex(const QString &indexFilename)
+{
+    LoadedIndex result;
+    result.modified = false;
+
+    QFile file(indexFilename);
+    if (!file.open(QFile::ReadOnly)) return result;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != indexFileMagic || version != indexFileVersion) return result;
+    stream >> result.documentHashes >> result.documentForFileKey >> result.postings;
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(LOG_KBIBTEX_IO) << "Could not read PDF text index" << indexFilename;
+        result.documentHashes.clear();
+        result.documentForFileKey.clear();
+        result.postings.clear();
+        return result;
+    }
+
+    /// Forget files which got modified or removed since
+    QSet<int> referencedDocuments;
+    for (QHash<QString, int>::Iterator it = result.documentForFileKey.begin(); it != result.documentForFileKey.end();) {
+        const QString pdfFilename = it.key().section(QLatin1Char('|'), 0, -3);
+        if (PDFTextExtractor::fileKey(pdfFilename) != it.key())
+            it = result.documentForFileKey.erase(it);
+        else {
+            referencedDocuments.insert(it.value());
+            ++it;
+        }
+    }
+
+    if (referencedDocuments.count() < result.documentHashes.count()) {
+        /// Drop documents no file refers to any longer, renumbering the remaining ones
+        QVector<int> newDocument(result.documentHashes.count(), -1);
+        QVector<QByteArray> remainingHashes;
+        for (int document = 0; document < result.documentHashes.count(); ++document)
+            if (referencedDocuments.contains(document)) {
+                newDocument[document] = remainingHashes.count();
+                remainingHashes.append(result.documentHashes[document]);
+            }
+        result.documentHashes = remainingHashes;
+        for (QHash<QString, int>::Iterator it = result.documentForFileKey.begin(); it != result.documentForFileKey.end(); ++it)
+            it.value() = newDocument[it.value()];
+        for (QHash<QString, QVector<int> >::Iterator it = result.postings.begin(); it != result.postings.end();) {
+            QVector<int> remainingDocuments;
+            for (int document : const_cast<const QVector<int> &>(it.value()))
+                if (newDocument[document] >= 0)
+                    remainingDocuments.append(newDocument[document]);
+            if (remainingDocuments.isEmpty())
+                it = result.postings.erase(it);
+            else {
+                it.value() = remainingDocuments;
+                ++it;
+            }
+        }
+        result.modified = true;
+    }
+
+    return result;
+}
+
+class PDFTextIndex::PDFTextIndexPrivate
+{
+public:
+    /// Content hash of each document, the document's id is its position
+    QVector<QByteArray> documentHashes;
+    QHash<QByteArray, int> documentForHash;
+    /// Document of each file's state, see @see PDFTextExtractor::fileKey
+    QHash<QString, int> documentForFileKey;
+    /// Ids of all documents containing a word, in ascending order
+    QHash<QString, QVector<int> > postings;
+
+    /// Index on disk gets loaded in the background on the first search
+    enum LoadState { lsNotLoaded, lsLoading, lsLoaded };
+    LoadState loadState;
+    QFutureWatcher<LoadedIndex> loadWatcher;
+
+    struct TermDocuments {
+        QSet<int> documents;
+        /// Terms spanning several words have to be looked up in the
+        /// documents' texts, as the index does not know about word order
+        bool needsVerification;
+    };
+    /// Results for terms searched since the index last changed
+    QHash<QString, TermDocuments> termDocuments;
+
+    /// File keys waiting for their document to be tokenized, by content hash
+    QHash<QByteArray, QStringList> tokenizingFileKeys;
+
+    QString indexFilename;
+    QTimer saveTimer;
+
+    PDFTextIndexPrivate()
+            : loadState(lsNotLoaded) {
+        const QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        QDir().mkpath(cacheDirectory);
+        indexFilename = cacheDirectory + QStringLiteral("/pdftextindex.dat");
+        /// Save changes in batches, not after every document
+        saveTimer.setSingleShot(true);
+        saveTimer.setInterval(10000);
+    }
+
+    int addDocument(const QByteArray &contentHash, const QStringList &tokens) {
+        const int document = documentHashes.count();
+        documentHashes.append(contentHash);
+        documentForHash.insert(contentHash, document);
+        for (const QString &token : tokens)
+            postings[token].append(document);
+        termDocuments.clear();
+        return document;
+    }
+
+    const TermDocuments &documentsForTerm(const QString &term) {
+        const QString lowerTerm = term.toLower();
+        const QHash<QString, TermDocuments>::ConstIterator it = termDocuments.constFind(lowerTerm);
+        if (it != termDocuments.constEnd())
+            return it.value();
+
+        TermDocuments result;
+        const QStringList termTokens = PDFTextIndex::tokenize(lowerTerm);
+        /// Anything but a single word, e.g. "e.g." or "neural net", requires verification
+        result.needsVerification = termTokens.count() != 1 || termTokens.first() != lowerTerm;
+        if (termTokens.isEmpty()) {
+            /// Terms without any word, e.g. "++", are not in the index,
+            /// so every document's text has to be searched
+            for (int document = 0; document < documentHashes.count(); ++document)
+                result.documents.insert(document);
+            return termDocuments.insert(lowerTerm, result).value();
+        }
+        bool first = true;
+        for (const QString &termToken : termTokens) {
+            /// Terms may be parts of words, so check the whole vocabulary
+            QSet<int> tokenDocuments;
+            for (QHash<QString, QVector<int> >::ConstIterator pit = postings.constBegin(); pit != postings.constEnd(); ++pit)
+                if (pit.key().contains(termToken))
+                    for (int document : pit.value())
+                        tokenDocuments.insert(document);
+            if (first) {
+                result.documents = tokenDocuments;
+                first = false;
+            } else
+                result.documents.intersect(tokenDocuments);
+            if (result.documents.isEmpty()) break;
+        }
+
+        return termDocuments.insert(lowerTerm, result).value();
+    }
+
+    void save() {
+        saveTimer.stop();
+        QSaveFile file(indexFilename);
+        if (!file.open(QFile::WriteOnly)) return;
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_6);
+        stream << indexFileMagic << indexFileVersion << documentHashes << documentForFileKey << postings;
+        if (!file.commit())
+            qCWarning(LOG_KBIBTEX_IO) << "Could not write PDF text index" << indexFilename;
+    }
+};
+
+PDFTextIndex &PDFTextIndex::instance()
+{
+    static PDFTextIndex self;
+    return self;
+}
+
+PDFTextIndex::PDFTextIndex(QObject *parent)
+        : QObject(parent), d(new PDFTextIndexPrivate())
+{
+    connect(&d->loadWatcher, &QFutureWatcher<LoadedIndex>::finished, this, &PDFTextIndex::loadingFinished);
+    connect(&d->saveTimer, &QTimer::timeout, this, &PDFTextIndex::save);
+    connect(&PDFTextExtractor::instance(), &PDFTextExtractor::textAvailable, this, &PDFTextIndex::textAvailable);
+}
+
+PDFTextIndex::~PDFTextIndex()
+{
+    if (d->saveTimer.isActive())
+        d->save();
+    delete d;
+}
+
+bool PDFTextIndex::documentContains(const QString &pdfFilename, const QString &term)
+{
+    if (d->loadState != PDFTextIndexPrivate::lsLoaded) {
+        /// Signal indexChanged will tell when searching is worthwhile
+        if (d->loadState == PDFTextIndexPrivate::lsNotLoaded) {
+            d->loadState = PDFTextIndexPrivate::lsLoading;
+            d->loadWatcher.setFuture(QtConcurrent::run(loadIndex, d->indexFilename));
+        }
+        return false;
+    }
+
+    const QString fileKey = PDFTextExtractor::fileKey(pdfFilename);
+    if (fileKey.isEmpty()) return false;
+
+    const QHash<QString, int>::ConstIterator it = d->documentForFileKey.constFind(fileKey);
+    if (it == d->documentForFileKey.constEnd()) {
+        /// Not indexed yet, so request the file's text; if it is
+        /// available already, index it right away
+        if (!PDFTextExtractor::instance().text(pdfFilename).isEmpty())
+            textAvailable(pdfFilename);
+        return false;
+    }
+
+    const PDFTextIndexPrivate::TermDocuments &termDocuments = d->documentsForTerm(term);
+    if (!termDocuments.documents.contains(it.value()))
+        return false;
+    if (!termDocuments.needsVerification)
+        return true;
+    /// Text may have been evicted from memory or extracted in a previous session
+    return PDFTextExtractor::instance().cachedText(pdfFilename, d->documentHashes[it.value()]).contains(term, Qt::CaseInsensitive);
+}
+
+QStringList PDFTextIndex::tokenize(const QString &text)
+{
+    QSet<QString> tokens;
+    const QString lowerText = text.toLower();
+    const int length = lowerText.length();
+    int start = -1;
+    for (int i = 0; i <= length; ++i) {
+        const bool isWordChar = i < length && lowerText[i].isLetterOrNumber();
+        if (isWordChar && start < 0)
+            start = i;
+        else if (!isWordChar && start >= 0) {
+            tokens.insert(lowerText.mid(start, i - start));
+            start = -1;
+        }
+    }
+    return tokens.toList();
+}
+
+int PDFTextIndex::pendingCount() const
+{
+    return PDFTextExtractor::instance().pendingCount() + d->tokenizingFileKeys.count();
+}
+
+void PDFTextIndex::textAvailable(const QString &pdfFilename)
+{
+    /// Files get looked up again once the index has been loaded
+    if (d->loadState != PDFTextIndexPrivate::lsLoaded) return;
+
+    const QString fileKey = PDFTextExtractor::fileKey(pdfFilename);
+    const QByteArray contentHash = PDFTextExtractor::instance().contentHash(pdfFilename);
+    if (fileKey.isEmpty() || contentHash.isEmpty() || d->documentForFileKey.contains(fileKey)) return;
+
+    const QHash<QByteArray, int>::ConstIterator it = d->documentForHash.constFind(contentHash);
+    if (it != d->documentForHash.constEnd()) {
+        /// Same content as a file indexed before
+        d->documentForFileKey.insert(fileKey, it.value());
+        d->saveTimer.start();
+        emit indexChanged();
+        return;
+    }
+
+    const QHash<QByteArray, QStringList>::Iterator tit = d->tokenizingFileKeys.find(contentHash);
+    if (tit != d->tokenizingFileKeys.end()) {
+        if (!tit->contains(fileKey))
+            tit->append(fileKey);
+        return;
+    }
+
+    d->tokenizingFileKeys.insert(contentHash, QStringList() << fileKey);
+    QFutureWatcher<TokenizedDocument> *watcher = new QFutureWatcher<TokenizedDocument>(this);
+    connect(watcher, &QFutureWatcher<TokenizedDocument>::finished, this, &PDFTextIndex::tokenizingFinished);
+    watcher->setFuture(QtConcurrent::run(tokenizeDocument, contentHash, PDFTextExtractor::instance().text(pdfFilename)));
+}
+
+void PDFTextIndex::tokenizingFinished()
+{
+    QFutureWatcher<TokenizedDocument> *watcher = static_cast<QFutureWatcher<TokenizedDocument> *>(sender());
+    const TokenizedDocument tokenizedDocument = watcher->result();
+    watcher->deleteLater();
+
+    const int document = d->addDocument(tokenizedDocument.contentHash, tokenizedDocument.tokens);
+    const QStringList fileKeys = d->tokenizingFileKeys.take(tokenizedDocument.contentHash);
+    for (const QString &fileKey : fileKeys)
+        d->documentForFileKey.insert(fileKey, document);
+
+    d->saveTimer.start();
+    emit indexChanged();
+}
+
+void PDFTextIndex::loadingFinished()
+{
+    const LoadedIndex loadedIndex = d->loadWatcher.result();
+    d->documentHashes = loadedIndex.documentHashes;
+    d->documentForFileKey = loadedIndex.documentForFileKey;
+    d->postings = loadedIndex.postings;
+    for (int document = 0; document < d->documentHashes.count(); ++document)
+        d->documentForHash.insert(d->documentHashes[document], document);
+    d->loadState = PDFTextIndexPrivate::lsLoaded;
+    if (loadedIndex.modified)
+        d->saveTimer.start();
+
+    emit indexChanged();
+}
+
+void PDFTextIndex::save()
+{
+    d->save();
+}
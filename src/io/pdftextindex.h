@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_IO_PDFTEXTINDEX_H
+#define KBIBTEX_IO_PDFTEXTINDEX_H
+
+#include <QObject>
+#include <QStringList>
+
+#include "kbibtexio_export.h"
+
+/**
+ * Inverted index over the words in PDF files' plain text, as provided
+ * by @see PDFTextExtractor, to search many PDF files interactively.
+ *
+ * Documents are identified by their content's hash, so copies of a file
+ * are indexed once. Files not indexed yet, including files modified since
+ * being indexed, get queued for text extraction when first looked up and
+ * are added to the index once their text is available, after which
+ * signal @see indexChanged gets emitted. The index is kept on disk
+ * between sessions and loaded in the background on the first lookup.
+ *
+ * To be used from the main thread only.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXIO_EXPORT PDFTextIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PDFTextIndex &instance();
+    ~PDFTextIndex() override;
+
+    /**
+     * Test if the given PDF file's text contains the given term,
+     * ignoring case. Terms may be parts of words or span several words.
+     * @param pdfFilename local PDF file to search in
+     * @param term text to search for
+     * @return true if the term is contained, false if not or if the file is not indexed yet
+     */
+    bool documentContains(const QString &pdfFilename, const QString &term);
+
+    /**
+     * Split text into lower-case words, i.e. maximal sequences of
+     * letters and digits, as stored in the index.
+     * @param text text to split
+     * @return each word contained in the text once, in no particular order
+     */
+    static QStringList tokenize(const QString &text);
+
+    /// Number of PDF files waiting for their text to be extracted or indexed
+    int pendingCount() const;
+
+signals:
+    /// Documents have been added to the index, so searches may give more results
+    void indexChanged();
+
+private:
+    explicit PDFTextIndex(QObject *parent = nullptr);
+
+    class PDFTextIndexPrivate;
+    PDFTextIndexPrivate *const d;
+
+private slots:
+    void loadingFinished();
+    void textAvailable(const QString &pdfFilename);
+    void tokenizingFinished();
+    void save();
+};
+
+#endif // KBIBTEX_IO_PDFTEXTINDEX_H
@@ -0,0 +1,252 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "faviconcache.h"
+
+#include <QHash>
+#include <QSet>
+#include <QQueue>
+#include <QStringList>
+#include <QImage>
+#include <QPixmap>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTimer>
+#include <QStandardPaths>
+#include <QRegularExpression>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include "internalnetworkaccessmanager.h"
+#include "logging_networking.h"
+
+typedef QHash<QString, QImage> FavIconImages;
+
+/**
+ * Determine the filename (without extension) under which the
+ * favicon downloaded from the given URL is stored on disk.
+ */
+static QString favIconFileNameStem(const QString &cacheDirectory, const QString &favIconUrl)
+{
+    static const QRegularExpression invalidChars(QStringLiteral("[^-a-z0-9_]"), QRegularExpression::CaseInsensitiveOption);
+    return cacheDirectory + QString(favIconUrl).remove(invalidChars);
+}
+
+/**
+ * Look up the given favicon URLs in the on-disk cache.
+ * To be run in a worker thread, therefore only images
+ * (no pixmaps or icons) get loaded.
+ */
+static FavIconImages lookupFavIconsOnDisk(const QString &cacheDirectory, const QStringList &favIconUrls)
+{
+    static const QStringList fileNameExtensions {QStringLiteral(".ico"), QStringLiteral(".png"), QString()};
+
+    FavIconImages result;
+    QDir().mkpath(cacheDirectory);
+    for (const QString &favIconUrl : favIconUrls) {
+        const QString fileNameStem = favIconFileNameStem(cacheDirectory, favIconUrl);
+        for (const QString &extension : fileNameExtensions) {
+            const QString fileName = fileNameStem + extension;
+            if (!QFileInfo::exists(fileName)) continue;
+            const QImage image(fileName);
+            if (!image.isNull()) {
+                result.insert(favIconUrl, image);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+class FavIconCache::FavIconCachePrivate
+{
+public:
+    static const int maxConcurrentDownloads;
+
+    const QString cacheDirectory;
+    const QIcon placeholderIcon;
+
+    /// Icons loaded so far, either from disk or from the Internet
+    QHash<QString, QIcon> loadedIcons;
+    /// Icons requested, but neither loaded nor failed to load yet
+    QSet<QString> requestedIcons;
+    /// Icons to be looked up in the next batch on disk
+    QStringList pendingDiskLookups;
+    /// Icons not found on disk, waiting to be downloaded
+    QQueue<QString> pendingDownloads;
+    int runningDownloads;
+
+    QTimer *batchTimer;
+    QFutureWatcher<FavIconImages> *diskLookupWatcher;
+    QStringList diskLookupBatch;
+
+    FavIconCachePrivate(FavIconCache *parent)
+            : cacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/favicons/")),
+          placeholderIcon(QIcon::fromTheme(QStringLiteral("applications-internet"))), runningDownloads(0),
+          batchTimer(new QTimer(parent)), diskLookupWatcher(new QFutureWatcher<FavIconImages>(parent)) {
+        batchTimer->setSingleShot(true);
+        batchTimer->setInterval(0);
+        QObject::connect(batchTimer, &QTimer::timeout, parent, &FavIconCache::lookupPendingIcons);
+        QObject::connect(diskLookupWatcher, &QFutureWatcher<FavIconImages>::finished, parent, &FavIconCache::diskLookupDone);
+    }
+
+    void startDownloads(FavIconCache *parent) {
+        while (runningDownloads < maxConcurrentDownloads && !pendingDownloads.isEmpty()) {
+            const QString favIconUrl = pendingDownloads.dequeue();
+            startDownload(parent, QUrl(favIconUrl), favIconUrl);
+        }
+    }
+
+    void startDownload(FavIconCache *parent, const QUrl &url, const QString &favIconUrl) {
+        QNetworkRequest request(url);
+        QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
+        InternalNetworkAccessManager::instance().setNetworkReplyTimeout(reply);
+        reply->setObjectName(favIconUrl);
+        ++runningDownloads;
+        QObject::connect(reply, &QNetworkReply::finished, parent, &FavIconCache::downloadFinished);
+    }
+
+    void iconLoaded(FavIconCache *parent, const QString &favIconUrl, const QIcon &icon) {
+        requestedIcons.remove(favIconUrl);
+        loadedIcons.insert(favIconUrl, icon);
+        emit parent->iconAvailable(favIconUrl, icon);
+    }
+};
+
+const int FavIconCache::FavIconCachePrivate::maxConcurrentDownloads = 4;
+
+FavIconCache &FavIconCache::instance()
+{
+    static FavIconCache self;
+    return self;
+}
+
+FavIconCache::FavIconCache(QObject *parent)
+        : QObject(parent), d(new FavIconCachePrivate(this))
+{
+    /// nothing
+}
+
+FavIconCache::~FavIconCache()
+{
+    d->diskLookupWatcher->waitForFinished();
+    delete d;
+}
+
+QIcon FavIconCache::icon(const QString &favIconUrl)
+{
+    const QHash<QString, QIcon>::ConstIterator it = d->loadedIcons.constFind(favIconUrl);
+    if (it != d->loadedIcons.constEnd())
+        return it.value();
+
+    if (!d->requestedIcons.contains(favIconUrl)) {
+        d->requestedIcons.insert(favIconUrl);
+        d->pendingDiskLookups.append(favIconUrl);
+        /// Collect all requests made until control returns to the event loop
+        d->batchTimer->start();
+    }
+
+    return d->placeholderIcon;
+}
+
+void FavIconCache::lookupPendingIcons()
+{
+    /// Only one batch is looked up at a time, remaining
+    /// requests will be processed once this batch is done
+    if (d->pendingDiskLookups.isEmpty() || d->diskLookupWatcher->isRunning()) return;
+
+    d->diskLookupBatch = d->pendingDiskLookups;
+    d->pendingDiskLookups.clear();
+    d->diskLookupWatcher->setFuture(QtConcurrent::run(lookupFavIconsOnDisk, d->cacheDirectory, d->diskLookupBatch));
+}
+
+void FavIconCache::diskLookupDone()
+{
+    const FavIconImages images = d->diskLookupWatcher->result();
+    for (const QString &favIconUrl : const_cast<const QStringList &>(d->diskLookupBatch)) {
+        const FavIconImages::ConstIterator it = images.constFind(favIconUrl);
+        if (it != images.constEnd())
+            /// Pixmaps can only be created in the GUI thread
+            d->iconLoaded(this, favIconUrl, QIcon(QPixmap::fromImage(it.value())));
+        else
+            d->pendingDownloads.enqueue(favIconUrl);
+    }
+    d->diskLookupBatch.clear();
+
+    d->startDownloads(this);
+    /// Process requests that arrived while this batch was looked up
+    lookupPendingIcons();
+}
+
+void FavIconCache::downloadFinished()
+{
+    QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
+    --d->runningDownloads;
+    const QString favIconUrl = reply->objectName();
+
+    if (reply->error() == QNetworkReply::NoError) {
+        const QUrl redirUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+        if (redirUrl.isValid()) {
+            d->startDownload(this, reply->url().resolved(redirUrl), favIconUrl);
+            return;
+        }
+
+        const QByteArray iconData = reply->readAll();
+        QString extension;
+        if (iconData.size() < 10) {
+            /// Unlikely that an icon's data is less than 10 bytes,
+            /// must be an error.
+            qCWarning(LOG_KBIBTEX_NETWORKING) << "Received invalid icon data from " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString();
+        } else if (iconData[1] == 'P' && iconData[2] == 'N' && iconData[3] == 'G') {
+            /// PNG files have string "PNG" at second to fourth byte
+            extension = QStringLiteral(".png");
+        } else if (iconData[0] == (char)0x00 && iconData[1] == (char)0x00 && iconData[2] == (char)0x01 && iconData[3] == (char)0x00) {
+            /// Microsoft Icon have first two bytes always 0x0000,
+            /// third and fourth byte is 0x0001 (for .ico)
+            extension = QStringLiteral(".ico");
+        } else if (iconData[0] == '<') {
+            /// HTML or XML code
+            const QString htmlCode = QString::fromUtf8(iconData);
+            qCDebug(LOG_KBIBTEX_NETWORKING) << "Received XML or HTML data from " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString() << ": " << htmlCode.left(128);
+        } else
+            qCWarning(LOG_KBIBTEX_NETWORKING) << "Favicon is of unknown format: " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString();
+
+        if (!extension.isEmpty()) {
+            const QString filename = favIconFileNameStem(d->cacheDirectory, favIconUrl) + extension;
+            QFile iconFile(filename);
+            if (iconFile.open(QFile::WriteOnly)) {
+                iconFile.write(iconData);
+                iconFile.close();
+            } else
+                qCWarning(LOG_KBIBTEX_NETWORKING) << "Could not save icon data from URL" << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString() << "to file" << filename;
+
+            const QImage image = QImage::fromData(iconData);
+            if (!image.isNull())
+                d->iconLoaded(this, favIconUrl, QIcon(QPixmap::fromImage(image)));
+        }
+    } else
+        qCWarning(LOG_KBIBTEX_NETWORKING) << "Could not download icon from URL " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString() << ": " << reply->errorString();
+
+    /// Allow a later request to retry if icon could not be loaded
+    d->requestedIcons.remove(favIconUrl);
+
+    d->startDownloads(this);
+}
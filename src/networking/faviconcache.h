@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_NETWORKING_FAVICONCACHE_H
+#define KBIBTEX_NETWORKING_FAVICONCACHE_H
+
+#include <QObject>
+#include <QIcon>
+
+#ifdef HAVE_KF5
+#include "kbibtexnetworking_export.h"
+#endif // HAVE_KF5
+
+/**
+ * Shared cache for favicons of web sites such as search engines.
+ *
+ * Requesting an icon never blocks: an icon loaded before is returned
+ * immediately, otherwise a placeholder icon is returned and the actual
+ * icon is loaded in the background. Requests arriving in quick
+ * succession (e.g. while a list of search engines is being built) are
+ * collected into one batch, which is looked up in the on-disk cache by
+ * a worker thread. Only icons missing on disk are downloaded, with a
+ * limited number of downloads running in parallel. Once an icon has
+ * become available, signal @see iconAvailable gets emitted.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXNETWORKING_EXPORT FavIconCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FavIconCache &instance();
+    ~FavIconCache() override;
+
+    /**
+     * Retrieve the icon located at the given URL.
+     * @param favIconUrl URL of the favicon as provided by the web site
+     * @return the icon if already loaded, a generic placeholder icon otherwise
+     */
+    QIcon icon(const QString &favIconUrl);
+
+signals:
+    /**
+     * Notification that an icon previously requested through @see icon
+     * has been loaded from the on-disk cache or downloaded.
+     * @param favIconUrl URL of the favicon as passed to @see icon
+     * @param icon the icon loaded
+     */
+    void iconAvailable(const QString &favIconUrl, const QIcon &icon);
+
+private:
+    explicit FavIconCache(QObject *parent = nullptr);
+
+    class FavIconCachePrivate;
+    FavIconCachePrivate *const d;
+
+private slots:
+    void lookupPendingIcons();
+    void diskLookupDone();
+    void downloadFinished();
+};
+
+#endif // KBIBTEX_NETWORKING_FAVICONCACHE_H
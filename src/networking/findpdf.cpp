@@ -25,6 +25,11 @@
 #include <QUrlQuery>
 #include <QStandardPaths>
 #include <QDir>
+#include <QQueue>
+#include <QHash>
+#include <QCryptographicHash>
+
+#include <algorithm>
 
 #include <poppler-qt5.h>
 
@@ -35,9 +40,16 @@
 #include "logging_networking.h"
 
 int maxDepth = 5;
+/// Number of downloads running in parallel, further URLs get queued
+static const int maxConcurrentDownloads = 8;
+/// Upper limit of URLs visited in a single search, bounding time spent per entry
+static const int maxVisitedUrls = 96;
+/// PDF files larger than this are not downloaded, bounding memory consumption
+static const qint64 maxPDFSize = 32 * 1024 * 1024;
 static const char *depthProperty = "depth";
 static const char *termProperty = "term";
 static const char *originProperty = "origin";
+static const char *skippedProperty = "skipped";
 
 
 class FindPDF::Private
@@ -45,12 +57,24 @@ class FindPDF::Private
 private:
     FindPDF *p;
 
+    typedef struct {
+        QUrl url;
+        QString term;
+        QString origin;
+        int depth;
+    } PendingDownload;
+
 public:
+    /// Number of downloads either running or queued
     int aliveCounter;
     QList<ResultItem> result;
     Entry currentEntry;
-    QSet<QUrl> knownUrls;
+    /// Canonical forms of all URLs visited or queued so far
+    QSet<QString> knownUrls;
+    /// SHA-256 hashes of all PDF files found so far, mapped to their position in the result list
+    QHash<QByteArray, int> knownPDFHashes;
     QSet<QNetworkReply *> runningDownloads;
+    QQueue<PendingDownload> pendingDownloads;
 
     Private(FindPDF *parent)
             : p(parent), aliveCounter(0)
@@ -58,22 +82,102 @@ public:
         /// nothing
     }
 
+    /**
+     * Reduce an URL to a form where URLs pointing to the same
+     * resource become equal: no fragment, no tracking parameters,
+     * no default ports, no distinction between HTTP and HTTPS,
+     * and query items in a well-defined order.
+     */
+    static QString canonicalUrl(const QUrl &url)
+    {
+        QUrl canonical = url.adjusted(QUrl::RemoveFragment | QUrl::RemoveUserInfo | QUrl::NormalizePathSegments);
+        const QString scheme = canonical.scheme().toLower();
+        if ((scheme == QStringLiteral("http") && canonical.port() == 80) || (scheme == QStringLiteral("https") && canonical.port() == 443))
+            canonical.setPort(-1);
+
+        QUrlQuery query(canonical);
+        QList<QPair<QString, QString> > queryItems = query.queryItems(QUrl::FullyEncoded);
+        for (QList<QPair<QString, QString> >::Iterator it = queryItems.begin(); it != queryItems.end();) {
+            if (it->first.startsWith(QStringLiteral("utm_")))
+                it = queryItems.erase(it);
+            else
+                ++it;
+        }
+        std::sort(queryItems.begin(), queryItems.end());
+        query.setQueryItems(queryItems);
+        canonical.setQuery(query);
+
+        QString path = canonical.path(QUrl::FullyEncoded);
+        if (path.isEmpty()) path = QStringLiteral("/");
+        const QString queryString = canonical.query(QUrl::FullyEncoded);
+        return (scheme == QStringLiteral("https") ? QStringLiteral("http") : scheme) + QStringLiteral("://") + canonical.host().toLower() + (canonical.port() >= 0 ? QStringLiteral(":") + QString::number(canonical.port()) : QString()) + path + (queryString.isEmpty() ? QString() : QStringLiteral("?") + queryString);
+    }
+
     bool queueUrl(const QUrl &url, const QString &term, const QString &origin, int depth)
     {
-        if (!knownUrls.contains(url) && depth > 0) {
-            knownUrls.insert(url);
-            QNetworkRequest request = QNetworkRequest(url);
+        if (depth <= 0 || !url.isValid() || knownUrls.count() >= maxVisitedUrls)
+            return false;
+
+        const QString canonical = canonicalUrl(url);
+        if (knownUrls.contains(canonical))
+            return false;
+
+        knownUrls.insert(canonical);
+        PendingDownload pendingDownload;
+        pendingDownload.url = url;
+        pendingDownload.term = term;
+        pendingDownload.origin = origin;
+        pendingDownload.depth = depth;
+        pendingDownloads.enqueue(pendingDownload);
+        ++aliveCounter;
+        startPendingDownloads();
+        return true;
+    }
+
+    void startPendingDownloads()
+    {
+        while (runningDownloads.count() < maxConcurrentDownloads && !pendingDownloads.isEmpty()) {
+            const PendingDownload pendingDownload = pendingDownloads.dequeue();
+            QNetworkRequest request = QNetworkRequest(pendingDownload.url);
             QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
             InternalNetworkAccessManager::instance().setNetworkReplyTimeout(reply, 15); ///< set a timeout on network connections
-            reply->setProperty(depthProperty, QVariant::fromValue<int>(depth));
-            reply->setProperty(termProperty, term);
-            reply->setProperty(originProperty, origin);
+            reply->setProperty(depthProperty, QVariant::fromValue<int>(pendingDownload.depth));
+            reply->setProperty(termProperty, pendingDownload.term);
+            reply->setProperty(originProperty, pendingDownload.origin);
             runningDownloads.insert(reply);
+            connect(reply, &QNetworkReply::metaDataChanged, p, &FindPDF::downloadMetaDataChanged);
             connect(reply, &QNetworkReply::finished, p, &FindPDF::downloadFinished);
-            ++aliveCounter;
+        }
+    }
+
+    /**
+     * Decide based on a reply's HTTP headers only whether
+     * the reply's body is worth downloading at all.
+     */
+    bool isDownloadWorthwhile(QNetworkReply *reply) const
+    {
+        /// Redirections are handled once the download has finished
+        if (reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid())
             return true;
-        } else
-            return false;
+
+        const QString contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString().toLower();
+        if (contentType.isEmpty())
+            return true; ///< no information available, check content later
+
+        if (contentType.contains(QStringLiteral("pdf")) || contentType.contains(QStringLiteral("octet-stream"))) {
+            /// Skip PDF files which are too large to be processed
+            bool ok = false;
+            const qint64 contentLength = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+            return !ok || contentLength <= maxPDFSize;
+        } else if (contentType.contains(QStringLiteral("html"))) {
+            /// HTML pages are only of interest if links get followed from them
+            bool ok = false;
+            const int depth = reply->property(depthProperty).toInt(&ok);
+            return ok && depth > 1;
+        }
+
+        /// Images, scripts, style sheets, ... cannot contain a PDF file
+        return false;
     }
 
     void processGeneralHTML(QNetworkReply *reply, const QString &text)
@@ -189,16 +293,25 @@ public:
         const QString origin = reply->property(originProperty).toString();
         const QUrl url = reply->url();
 
-        /// Search for duplicate URLs
-        bool containsUrl = false;
-        for (const ResultItem &ri :  const_cast<const QList<ResultItem> &>(result)) {
-            containsUrl |= ri.url == url;
-            /// Skip already visited URLs
-            if (containsUrl) break;
-        }
-
-        if (!containsUrl) {
+        /// The same document may be offered under several URLs,
+        /// so use a hash of the content to skip duplicates
+        const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+        const float relevance = origin == Entry::ftDOI ? 1.0 : (origin == QStringLiteral("eprint") ? 0.75 : 0.5);
+
+        const QHash<QByteArray, int>::ConstIterator knownPDFIt = knownPDFHashes.constFind(hash);
+        if (knownPDFIt != knownPDFHashes.constEnd()) {
+            /// Document found before, but maybe from a less relevant origin
+            ResultItem &knownResultItem = result[knownPDFIt.value()];
+            if (relevance > knownResultItem.relevance) {
+                knownResultItem.relevance = relevance;
+                knownResultItem.url = url;
+            }
+        } else {
             Poppler::Document *doc = Poppler::Document::loadFromData(data);
+            if (doc == nullptr) {
+                qCWarning(LOG_KBIBTEX_NETWORKING) << "Could not load PDF file downloaded from" << url.toDisplayString();
+                return false;
+            }
 
             ResultItem resultItem;
             resultItem.tempFilename = new QTemporaryFile(QStandardPaths::writableLocation(QStandardPaths::TempLocation) + QDir::separator() + QStringLiteral("kbibtex_findpdf_XXXXXX.pdf"));
@@ -229,7 +342,8 @@ public:
             }
             resultItem.textPreview.remove(QStringLiteral("Microsoft Word - ")); ///< Some word processors need to put their name everywhere ...
             resultItem.downloadMode = NoDownload;
-            resultItem.relevance = origin == Entry::ftDOI ? 1.0 : (origin == QStringLiteral("eprint") ? 0.75 : 0.5);
+            resultItem.relevance = relevance;
+            knownPDFHashes.insert(hash, result.count());
             result << resultItem;
             progress = true;
 
@@ -273,6 +387,7 @@ bool FindPDF::search(const Entry &entry)
     if (d->aliveCounter > 0) return false;
 
     d->knownUrls.clear();
+    d->knownPDFHashes.clear();
     d->result.clear();
     d->currentEntry = entry;
 
@@ -364,6 +479,10 @@ QList<FindPDF::ResultItem> FindPDF::results()
 }
 
 void FindPDF::abort() {
+    /// Forget about downloads which have not been started yet
+    d->aliveCounter -= d->pendingDownloads.count();
+    d->pendingDownloads.clear();
+
     QSet<QNetworkReply *>::Iterator it = d->runningDownloads.begin();
     while (it != d->runningDownloads.end()) {
         QNetworkReply *reply = *it;
@@ -372,6 +491,16 @@ void FindPDF::abort() {
     }
 }
 
+void FindPDF::downloadMetaDataChanged()
+{
+    QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
+    if (!d->isDownloadWorthwhile(reply)) {
+        qCDebug(LOG_KBIBTEX_NETWORKING) << "Skipping download of" << reply->url().toDisplayString() << "with content type" << reply->header(QNetworkRequest::ContentTypeHeader).toString();
+        reply->setProperty(skippedProperty, true);
+        reply->abort();
+    }
+}
+
 void FindPDF::downloadFinished()
 {
     static const char *htmlHead1 = "<html", *htmlHead2 = "<HTML", *htmlHead3 = "<!doctype html>" /** ACM Digital Library */;
@@ -381,6 +510,7 @@ void FindPDF::downloadFinished()
     emit progress(d->knownUrls.count(), d->aliveCounter, d->result.count());
 
     QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
     d->runningDownloads.remove(reply);
     const QString term = reply->property(termProperty).toString();
     const QString origin = reply->property(originProperty).toString();
@@ -445,9 +575,12 @@ void FindPDF::downloadFinished()
             const QString text = QString::fromUtf8(data.constData());
             qCWarning(LOG_KBIBTEX_NETWORKING) << "don't know how to handle " << text.left(256);
         }
-    } else
+    } else if (!reply->property(skippedProperty).toBool())
         qCWarning(LOG_KBIBTEX_NETWORKING) << "error from reply: " << reply->errorString() << "(" << reply->url().toDisplayString() << ")" << "  term=" << term << "  origin=" << origin << "  depth=" << depth;
 
+    /// Free slot in download pool may be used by a queued URL
+    d->startPendingDownloads();
+
     if (d->aliveCounter == 0) {
         /// no more running downloads left
         emit finished();
@@ -34,6 +34,10 @@ class QTemporaryFile;
 /**
  * Search known Internet resources (search engines) for PDF files
  * matching a given bibliography entry.
+ * Web pages are crawled with a limited number of parallel downloads
+ * and a limit on the number of visited pages. Downloads whose HTTP
+ * headers reveal uninteresting content are aborted early, and PDF
+ * files found under different URLs are reported only once.
  *
  * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
  */
@@ -100,6 +104,7 @@ public slots:
     void abort();
 
 private slots:
+    void downloadMetaDataChanged();
     void downloadFinished();
 
 private:
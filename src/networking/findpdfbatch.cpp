@@ -0,0 +1,321 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "findpdfbatch.h"
+
+#include <QHash>
+#include <QSet>
+#include <QQueue>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QPointer>
+#include <QVector>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include <KLocalizedString>
+
+#include "file.h"
+#include "fileinfo.h"
+#include "findpdf.h"
+#include "associatedfiles.h"
+#include "models/undojournal.h"
+#include "logging_networking.h"
+
+const int FindPDFBatch::defaultConcurrentSearches = 4;
+const float FindPDFBatch::defaultRelevanceThreshold = 0.75f;
+
+/**
+ * Test which entries have no PDF file on disk associated yet, as
+ * searching for the others is pointless. Runs in a worker thread,
+ * as testing the existence of files may be slow.
+ * @return positions of entries without local PDF file
+ */
+static QVector<int> entriesWithoutLocalPDF(const QVector<QSharedPointer<const Entry> > &entries, const QUrl &bibTeXUrl)
+{
+    QVector<int> result;
+    for (int i = 0; i < entries.count(); ++i) {
+        bool hasLocalPDF = false;
+        const QSet<QUrl> urls = FileInfo::entryUrls(entries[i], bibTeXUrl, FileInfo::TestExistenceYes);
+        for (const QUrl &url : urls)
+            if (url.isLocalFile() && url.path().endsWith(QStringLiteral(".pdf"), Qt::CaseInsensitive)) {
+                hasLocalPDF = true;
+                break;
+            }
+        if (!hasLocalPDF)
+            result.append(i);
+    }
+    return result;
+}
+
+class FindPDFBatch::Private
+{
+private:
+    FindPDFBatch *p;
+
+public:
+    File *bibTeXFile;
+    int concurrentSearches;
+    float relevanceThreshold;
+    QPointer<UndoJournal> journal;
+
+    /// Entries being tested for local PDF files in a worker thread
+    QList<QSharedPointer<Entry> > candidateEntries;
+    QFutureWatcher<QVector<int> > *filterWatcher;
+    /// Entries waiting for their search to be started
+    QQueue<QSharedPointer<Entry> > pendingEntries;
+    /// Searches currently running and the entries they are searching for
+    QHash<FindPDF *, QSharedPointer<Entry> > runningSearches;
+    /// Ids of entries processed in this or a previous, interrupted batch
+    QSet<QString> processedIds;
+    QFile progressFile;
+    int numProcessed, numTotal, numAttached;
+    bool aborted;
+
+    Private(File *_bibTeXFile, FindPDFBatch *parent)
+            : p(parent), bibTeXFile(_bibTeXFile), concurrentSearches(FindPDFBatch::defaultConcurrentSearches), relevanceThreshold(FindPDFBatch::defaultRelevanceThreshold), filterWatcher(new QFutureWatcher<QVector<int> >(parent)), numProcessed(0), numTotal(0), numAttached(0), aborted(false) {
+        QObject::connect(filterWatcher, &QFutureWatcher<QVector<int> >::finished, p, &FindPDFBatch::filteringFinished);
+    }
+
+    /**
+     * Determine the progress file for the current bibliography.
+     * Bibliographies without a filename (i.e. not yet saved)
+     * share a common progress file.
+     */
+    QString progressFileName() const {
+        const QString bibTeXUrl = bibTeXFile->property(File::Url).toUrl().toString();
+        const QByteArray hash = QCryptographicHash::hash(bibTeXUrl.toUtf8(), QCryptographicHash::Sha1).toHex();
+        return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/findpdfbatch/") + QString::fromLatin1(hash) + QStringLiteral(".txt");
+    }
+
+    void loadProgress() {
+        processedIds.clear();
+        progressFile.setFileName(progressFileName());
+        QDir().mkpath(QFileInfo(progressFile.fileName()).absolutePath());
+        if (progressFile.open(QFile::ReadOnly)) {
+            while (!progressFile.atEnd()) {
+                const QString id = QString::fromUtf8(progressFile.readLine()).trimmed();
+                if (!id.isEmpty())
+                    processedIds.insert(id);
+            }
+            progressFile.close();
+        }
+        if (!progressFile.open(QFile::WriteOnly | QFile::Append))
+            qCWarning(LOG_KBIBTEX_NETWORKING) << "Cannot record progress of PDF search in file" << progressFile.fileName();
+    }
+
+    void recordProgress(const QString &id) {
+        processedIds.insert(id);
+        if (progressFile.isOpen()) {
+            progressFile.write(id.toUtf8() + '\n');
+            /// Flush immediately to be able to resume after a crash
+            progressFile.flush();
+        }
+    }
+
+    void startSearches() {
+        while (!aborted && runningSearches.count() < concurrentSearches && !pendingEntries.isEmpty()) {
+            const QSharedPointer<Entry> entry = pendingEntries.dequeue();
+            FindPDF *findPDF = new FindPDF(p);
+            runningSearches.insert(findPDF, entry);
+            /// Queued connection, as a search may finish right within FindPDF::search
+            QObject::connect(findPDF, &FindPDF::finished, p, &FindPDFBatch::searchFinished, Qt::QueuedConnection);
+            findPDF->search(*entry);
+        }
+
+        if (runningSearches.isEmpty())
+            finish();
+    }
+
+    /**
+     * Associate the most relevant result above the threshold
+     * with the entry. The PDF file gets copied next to the
+     * bibliography file if this file has a local filename.
+     */
+    bool attachBestResult(QSharedPointer<Entry> &entry, const QList<FindPDF::ResultItem> &results) {
+        const FindPDF::ResultItem *best = nullptr;
+        for (const FindPDF::ResultItem &resultItem : results)
+            if (resultItem.relevance >= relevanceThreshold && (best == nullptr || resultItem.relevance > best->relevance))
+                best = &resultItem;
+        if (best == nullptr) return false;
+
+        if (!journal.isNull()) {
+            journal->beginOperation(i18n("Attach PDF File"));
+            journal->aboutToModify(entry);
+        }
+        const bool result = attachResult(entry, best);
+        if (!journal.isNull())
+            journal->endOperation();
+        return result;
+    }
+
+    /// Copy the PDF file of the chosen result and associate it with the entry
+    bool attachResult(QSharedPointer<Entry> &entry, const FindPDF::ResultItem *best) {
+        const QUrl bibTeXUrl = bibTeXFile->property(File::Url).toUrl();
+        if (best->tempFilename != nullptr && bibTeXUrl.isValid() && bibTeXUrl.isLocalFile()) {
+            const QUrl sourceUrl = QUrl::fromLocalFile(best->tempFilename->fileName());
+            /// Never overwrite existing files, e.g. another entry's PDF file
+            /// with the same name, but choose a name not in use yet
+            QUrl targetUrl = AssociatedFiles::copyDocument(sourceUrl, entry->id(), bibTeXFile, AssociatedFiles::roEntryId, AssociatedFiles::mcoCopy, nullptr, QString(), true);
+            const QString suffix = QFileInfo(targetUrl.path()).suffix();
+            for (int i = 2; targetUrl.isValid() && QFileInfo::exists(targetUrl.path()); ++i)
+                targetUrl = AssociatedFiles::copyDocument(sourceUrl, entry->id(), bibTeXFile, AssociatedFiles::roUserDefined, AssociatedFiles::mcoCopy, nullptr, QString(QStringLiteral("%1-%2.%3")).arg(entry->id()).arg(i).arg(suffix), true);
+            if (targetUrl.isValid())
+                targetUrl = AssociatedFiles::copyDocument(sourceUrl, entry->id(), bibTeXFile, AssociatedFiles::roUserDefined, AssociatedFiles::mcoCopy, nullptr, QFileInfo(targetUrl.path()).fileName());
+            if (targetUrl.isValid())
+                return !AssociatedFiles::associateDocumentURL(targetUrl, entry, bibTeXFile, AssociatedFiles::ptRelative).isEmpty();
+            qCWarning(LOG_KBIBTEX_NETWORKING) << "Failed to copy PDF file found for entry" << entry->id() << "next to bibliography file";
+        }
+        /// Fall back to referencing the PDF file's remote location
+        return !AssociatedFiles::associateDocumentURL(best->url, entry, bibTeXFile, AssociatedFiles::ptAbsolute).isEmpty();
+    }
+
+    void finish() {
+        if (progressFile.isOpen())
+            progressFile.close();
+        /// Progress needs to be kept only for interrupted batches
+        if (!aborted && pendingEntries.isEmpty())
+            progressFile.remove();
+        pendingEntries.clear();
+        emit p->finished();
+    }
+};
+
+FindPDFBatch::FindPDFBatch(File *bibTeXFile, QObject *parent)
+        : QObject(parent), d(new Private(bibTeXFile, this))
+{
+    /// nothing
+}
+
+FindPDFBatch::~FindPDFBatch()
+{
+    for (FindPDF *findPDF : d->runningSearches.keys()) {
+        disconnect(findPDF, &FindPDF::finished, this, &FindPDFBatch::searchFinished);
+        /// Results become available once all downloads have been aborted;
+        /// their temporary files would be left behind otherwise
+        findPDF->abort();
+        const QList<FindPDF::ResultItem> results = findPDF->results();
+        for (const FindPDF::ResultItem &resultItem : results)
+            delete resultItem.tempFilename;
+        delete findPDF;
+    }
+    delete d;
+}
+
+void FindPDFBatch::setConcurrentSearches(int concurrentSearches)
+{
+    d->concurrentSearches = qMax(1, concurrentSearches);
+}
+
+void FindPDFBatch::setRelevanceThreshold(float relevanceThreshold)
+{
+    d->relevanceThreshold = relevanceThreshold;
+}
+
+void FindPDFBatch::setJournal(UndoJournal *journal)
+{
+    d->journal = journal;
+}
+
+bool FindPDFBatch::start(const QList<QSharedPointer<Entry> > &entries)
+{
+    if (isRunning()) return false;
+
+    d->aborted = false;
+    d->numProcessed = d->numAttached = 0;
+    d->numTotal = entries.count();
+    d->loadProgress();
+
+    /// Worker operates on copies, as entries may get modified meanwhile
+    QVector<QSharedPointer<const Entry> > entryCopies;
+    entryCopies.reserve(entries.count());
+    d->candidateEntries.clear();
+    for (const QSharedPointer<Entry> &entry : entries) {
+        if (d->processedIds.contains(entry->id()))
+            ++d->numProcessed;
+        else {
+            d->candidateEntries.append(entry);
+            entryCopies.append(QSharedPointer<const Entry>(new Entry(*entry)));
+        }
+    }
+
+    if (d->candidateEntries.isEmpty()) {
+        emit progress(d->numProcessed, d->numTotal, d->numAttached);
+        d->startSearches();
+    } else
+        d->filterWatcher->setFuture(QtConcurrent::run(entriesWithoutLocalPDF, entryCopies, d->bibTeXFile->property(File::Url).toUrl()));
+    return true;
+}
+
+bool FindPDFBatch::isRunning() const
+{
+    return d->filterWatcher->isRunning() || !d->runningSearches.isEmpty() || !d->pendingEntries.isEmpty();
+}
+
+void FindPDFBatch::abort()
+{
+    d->aborted = true;
+    d->candidateEntries.clear();
+    d->pendingEntries.clear();
+    /// Searches will report being finished, see searchFinished
+    for (FindPDF *findPDF : d->runningSearches.keys())
+        findPDF->abort();
+}
+
+void FindPDFBatch::filteringFinished()
+{
+    if (!d->aborted) {
+        /// Entries already having a local PDF file count as processed
+        const QVector<int> positions = d->filterWatcher->result();
+        for (int i : positions)
+            d->pendingEntries.enqueue(d->candidateEntries[i]);
+        d->numProcessed += d->candidateEntries.count() - positions.count();
+        emit progress(d->numProcessed, d->numTotal, d->numAttached);
+    }
+    d->candidateEntries.clear();
+
+    d->startSearches();
+}
+
+void FindPDFBatch::searchFinished()
+{
+    FindPDF *findPDF = static_cast<FindPDF *>(sender());
+    QSharedPointer<Entry> entry = d->runningSearches.take(findPDF);
+    if (entry.isNull()) return;
+
+    const QList<FindPDF::ResultItem> results = findPDF->results();
+    if (!d->aborted) {
+        if (d->attachBestResult(entry, results)) {
+            ++d->numAttached;
+            emit entryChanged(entry);
+        }
+        d->recordProgress(entry->id());
+        ++d->numProcessed;
+        emit progress(d->numProcessed, d->numTotal, d->numAttached);
+    }
+
+    /// Temporary files are owned by whoever retrieves the results
+    for (const FindPDF::ResultItem &resultItem : results)
+        delete resultItem.tempFilename;
+    findPDF->deleteLater();
+
+    d->startSearches();
+}
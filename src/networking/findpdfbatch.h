@@ -0,0 +1,131 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_NETWORKING_FINDPDFBATCH_H
+#define KBIBTEX_NETWORKING_FINDPDFBATCH_H
+
+#include "kbibtexnetworking_export.h"
+
+#include <QObject>
+#include <QList>
+#include <QSharedPointer>
+
+#include "entry.h"
+
+class File;
+class UndoJournal;
+
+/**
+ * Run @see FindPDF for many entries of a bibliography in the background.
+ *
+ * A configurable number of searches runs in parallel. For each entry,
+ * the search results get ranked by their relevance; if the best result
+ * reaches the relevance threshold, the PDF file is copied next to the
+ * bibliography file (named after the entry's id, with a number appended
+ * if such a file exists already) and associated with the entry via
+ * @see AssociatedFiles. If the bibliography file has not been saved
+ * yet, only the PDF's URL gets associated.
+ *
+ * Processed entries are recorded in a progress file, so that a batch
+ * interrupted by closing the application or by @see abort will skip
+ * those entries when being started again for the same bibliography.
+ * The progress file is removed once a batch has completed.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXNETWORKING_EXPORT FindPDFBatch : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int defaultConcurrentSearches;
+    static const float defaultRelevanceThreshold;
+
+    explicit FindPDFBatch(File *bibTeXFile, QObject *parent = nullptr);
+    ~FindPDFBatch() override;
+
+    /**
+     * Set the number of entries searched for in parallel.
+     * Changes take effect for searches started afterwards.
+     * @param concurrentSearches number of parallel searches, at least 1
+     */
+    void setConcurrentSearches(int concurrentSearches);
+
+    /**
+     * Set the minimum relevance (@see FindPDF::ResultItem) a found
+     * PDF file must have to get associated with its entry.
+     * @param relevanceThreshold minimum relevance, between 0.0 and 1.0
+     */
+    void setRelevanceThreshold(float relevanceThreshold);
+
+    /**
+     * Record associating PDF files with entries in the given journal,
+     * one operation per entry, to allow undoing them.
+     * @param journal journal of the model showing the bibliography, may be @c nullptr
+     */
+    void setJournal(UndoJournal *journal);
+
+    /**
+     * Start searching PDF files for the given entries. Entries which
+     * already got processed in a previous, unfinished batch for the
+     * same bibliography file, and entries which already have a local
+     * PDF file associated, are skipped. Testing for existing PDF files
+     * happens in a background thread before the first search starts.
+     * @param entries entries to search PDF files for
+     * @return @c true if the batch could be started, @c false if another batch is still running
+     */
+    bool start(const QList<QSharedPointer<Entry> > &entries);
+
+    bool isRunning() const;
+
+public slots:
+    /**
+     * Stop all running searches. Entries processed so far remain
+     * recorded in the progress file, so the batch can be resumed.
+     */
+    void abort();
+
+signals:
+    /**
+     * Some update on the running batch.
+     * @param processed number of entries processed so far, including skipped entries
+     * @param total number of entries in this batch
+     * @param attached number of entries a PDF file got associated with
+     */
+    void progress(int processed, int total, int attached);
+
+    /**
+     * A PDF file has been associated with an entry,
+     * i.e. the entry has been modified.
+     */
+    void entryChanged(QSharedPointer<Entry> entry);
+
+    /**
+     * All entries have been processed or the batch has been aborted.
+     */
+    void finished();
+
+private slots:
+    void filteringFinished();
+    void searchFinished();
+
+private:
+    class Private;
+    Private *const d;
+};
+
+#endif // KBIBTEX_NETWORKING_FINDPDFBATCH_H
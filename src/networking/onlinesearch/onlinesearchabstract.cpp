@@ -21,7 +21,6 @@
 #include <QNetworkReply>
 #include <QDir>
 #include <QTimer>
-#include <QStandardPaths>
 #include <QRegularExpression>
 #ifdef HAVE_QTWIDGETS
 #include <QListWidgetItem>
@@ -35,6 +34,7 @@
 #endif // HAVE_KF5
 
 #include "encoderlatex.h"
+#include "faviconcache.h"
 #include "internalnetworkaccessmanager.h"
 #include "kbibtex.h"
 #include "logging_networking.h"
@@ -72,33 +72,25 @@ QStringList OnlineSearchQueryFormAbstract::authorLastNames(const Entry &entry)
 #endif // HAVE_QTWIDGETS
 
 OnlineSearchAbstract::OnlineSearchAbstract(QObject *parent)
-        : QObject(parent), m_hasBeenCanceled(false), numSteps(0), curStep(0), m_previousBusyState(false), m_delayedStoppedSearchReturnCode(0)
+        : QObject(parent), m_hasBeenCanceled(false), numSteps(0), curStep(0), m_previousBusyState(false), m_delayedStoppedSearchReturnCode(0), m_numResultsToSkip(0), m_prefetchState(psNone), m_prefetchNumResults(0), m_prefetchReturnCode(resultNoError)
 {
+#ifdef HAVE_QTWIDGETS
+    m_iconListWidgetItem = nullptr;
+#endif // HAVE_QTWIDGETS
     m_parent = parent;
 }
 
 #ifdef HAVE_QTWIDGETS
 QIcon OnlineSearchAbstract::icon(QListWidgetItem *listWidgetItem)
 {
-    static const QRegularExpression invalidChars(QStringLiteral("[^-a-z0-9_]"), QRegularExpression::CaseInsensitiveOption);
-    const QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/favicons/");
-    QDir().mkpath(cacheDirectory);
-    const QString fileNameStem = cacheDirectory + QString(favIconUrl()).remove(invalidChars);
-    const QStringList fileNameExtensions {QStringLiteral(".ico"), QStringLiteral(".png"), QString()};
-
-    for (const QString &extension : fileNameExtensions) {
-        const QString fileName = fileNameStem + extension;
-        if (QFileInfo::exists(fileName))
-            return QIcon(fileName);
+    /// Icon cache will not block: if the icon is not available yet,
+    /// a placeholder is returned and the list widget item will be
+    /// updated once the actual icon has been loaded
+    if (listWidgetItem != nullptr) {
+        m_iconListWidgetItem = listWidgetItem;
+        connect(&FavIconCache::instance(), &FavIconCache::iconAvailable, this, &OnlineSearchAbstract::iconAvailable, Qt::UniqueConnection);
     }
-
-    QNetworkRequest request(favIconUrl());
-    QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
-    reply->setObjectName(fileNameStem);
-    if (listWidgetItem != nullptr)
-        m_iconReplyToListWidgetItem.insert(reply, listWidgetItem);
-    connect(reply, &QNetworkReply::finished, this, &OnlineSearchAbstract::iconDownloadFinished);
-    return QIcon::fromTheme(QStringLiteral("applications-internet"));
+    return FavIconCache::instance().icon(favIconUrl());
 }
 
 OnlineSearchQueryFormAbstract *OnlineSearchAbstract::customWidget(QWidget *) {
@@ -113,6 +105,59 @@ void OnlineSearchAbstract::startSearchFromForm()
 }
 #endif // HAVE_QTWIDGETS
 
+void OnlineSearchAbstract::continueSearch(const OnlineSearchAbstract::ContinuationToken &token, int numResults)
+{
+    if (m_prefetchState != psNone && m_prefetchNumResults == numResults && m_prefetchToken.offset == token.offset && m_prefetchToken.query == token.query) {
+        /// Requested page of results has been prefetched before (or is being prefetched right now)
+        const bool prefetchIsDone = m_prefetchState == psDone;
+        m_prefetchState = psNone;
+        const QVector<QSharedPointer<Entry> > prefetchedEntries = m_prefetchedEntries;
+        m_prefetchedEntries.clear();
+        for (const QSharedPointer<Entry> &entry : prefetchedEntries)
+            emit foundEntry(entry);
+        if (prefetchIsDone)
+            delayedStoppedSearch(m_prefetchReturnCode);
+        /// else: prefetching search is still running and will
+        /// publish remaining results and stop as a regular search
+        return;
+    }
+
+    /// Any prefetched results do not match the requested page, discard them
+    m_prefetchState = psNone;
+    m_prefetchedEntries.clear();
+
+    if (token.offset < 0 || token.query.isEmpty() || numResults <= 0) {
+        m_hasBeenCanceled = false;
+        delayedStoppedSearch(resultInvalidArguments);
+        return;
+    }
+
+    startSearchFromOffset(token.query, numResults, token.offset);
+}
+
+void OnlineSearchAbstract::prefetchSearch(const OnlineSearchAbstract::ContinuationToken &token, int numResults)
+{
+    if (token.offset < 0 || token.query.isEmpty() || numResults <= 0 || busy())
+        return;
+
+    m_prefetchedEntries.clear();
+    m_prefetchToken = token;
+    m_prefetchNumResults = numResults;
+    m_prefetchReturnCode = resultNoError;
+    m_prefetchState = psRunning;
+
+    startSearchFromOffset(token.query, numResults, token.offset);
+}
+
+void OnlineSearchAbstract::startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset)
+{
+    /// Search engine cannot skip results on the server side,
+    /// so fetch all results up to the requested page and
+    /// drop those that have been published before
+    m_numResultsToSkip = offset;
+    startSearch(query, offset + numResults);
+}
+
 QString OnlineSearchAbstract::name()
 {
     static const QRegularExpression invalidChars(QStringLiteral("[^-a-z0-9]"), QRegularExpression::CaseInsensitiveOption);
@@ -128,10 +173,32 @@ bool OnlineSearchAbstract::busy() const
 
 void OnlineSearchAbstract::cancel()
 {
+    const bool wasSearching = busy() && m_prefetchState != psRunning;
     m_hasBeenCanceled = true;
 
+    /// Abort all requests this search engine is waiting for, so that
+    /// late replies cannot be mistaken for replies to a later search
+    const QList<QNetworkReply *> replies = InternalNetworkAccessManager::instance().findChildren<QNetworkReply *>(QString(), Qt::FindDirectChildrenOnly);
+    for (QNetworkReply *reply : replies)
+        if (disconnect(reply, nullptr, this, nullptr)) {
+            reply->abort();
+            reply->deleteLater();
+        }
+
+    m_numResultsToSkip = 0;
+    m_prefetchState = psNone;
+    m_prefetchedEntries.clear();
+
     curStep = numSteps = 0;
     refreshBusyProperty();
+
+    /// Aborted replies do not reach the search engine any longer,
+    /// so report the search as stopped here; prefetching searches
+    /// were never reported as running in the first place
+    if (wasSearching) {
+        emit progress(curStep, numSteps);
+        emit stoppedSearch(resultCancelled);
+    }
 }
 
 QStringList OnlineSearchAbstract::splitRespectingQuotationMarks(const QString &text)
@@ -409,65 +476,10 @@ QMap<QString, QString> OnlineSearchAbstract::formParameters(const QString &htmlT
 }
 
 #ifdef HAVE_QTWIDGETS
-void OnlineSearchAbstract::iconDownloadFinished()
+void OnlineSearchAbstract::iconAvailable(const QString &favIconUrl, const QIcon &icon)
 {
-    QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
-
-    if (reply->error() == QNetworkReply::NoError) {
-        const QUrl redirUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
-        if (redirUrl.isValid()) {
-            QNetworkRequest request(redirUrl);
-            QNetworkReply *newReply = InternalNetworkAccessManager::instance().get(request);
-            newReply->setObjectName(reply->objectName());
-            QListWidgetItem *listWidgetItem = m_iconReplyToListWidgetItem.value(reply, nullptr);
-            m_iconReplyToListWidgetItem.remove(reply);
-            if (listWidgetItem != nullptr)
-                m_iconReplyToListWidgetItem.insert(newReply, listWidgetItem);
-            connect(newReply, &QNetworkReply::finished, this, &OnlineSearchAbstract::iconDownloadFinished);
-            return;
-        }
-
-        const QByteArray iconData = reply->readAll();
-        if (iconData.size() < 10) {
-            /// Unlikely that an icon's data is less than 10 bytes,
-            /// must be an error.
-            qCWarning(LOG_KBIBTEX_NETWORKING) << "Received invalid icon data from " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString();
-            return;
-        }
-
-        QString extension;
-        if (iconData[1] == 'P' && iconData[2] == 'N' && iconData[3] == 'G') {
-            /// PNG files have string "PNG" at second to fourth byte
-            extension = QStringLiteral(".png");
-        } else if (iconData[0] == (char)0x00 && iconData[1] == (char)0x00 && iconData[2] == (char)0x01 && iconData[3] == (char)0x00) {
-            /// Microsoft Icon have first two bytes always 0x0000,
-            /// third and fourth byte is 0x0001 (for .ico)
-            extension = QStringLiteral(".ico");
-        } else if (iconData[0] == '<') {
-            /// HTML or XML code
-            const QString htmlCode = QString::fromUtf8(iconData);
-            qCDebug(LOG_KBIBTEX_NETWORKING) << "Received XML or HTML data from " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString() << ": " << htmlCode.left(128);
-            return;
-        } else {
-            qCWarning(LOG_KBIBTEX_NETWORKING) << "Favicon is of unknown format: " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString();
-            return;
-        }
-        const QString filename = reply->objectName() + extension;
-
-        QFile iconFile(filename);
-        if (iconFile.open(QFile::WriteOnly)) {
-            iconFile.write(iconData);
-            iconFile.close();
-
-            QListWidgetItem *listWidgetItem = m_iconReplyToListWidgetItem.value(reply, nullptr);
-            if (listWidgetItem != nullptr)
-                listWidgetItem->setIcon(QIcon(filename));
-        } else {
-            qCWarning(LOG_KBIBTEX_NETWORKING) << "Could not save icon data from URL" << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString() << "to file" << filename;
-            return;
-        }
-    } else
-        qCWarning(LOG_KBIBTEX_NETWORKING) << "Could not download icon from URL " << InternalNetworkAccessManager::removeApiKey(reply->url()).toDisplayString() << ": " << reply->errorString();
+    if (m_iconListWidgetItem != nullptr && favIconUrl == this->favIconUrl())
+        m_iconListWidgetItem->setIcon(icon);
 }
 #endif // HAVE_QTWIDGETS
 
@@ -617,22 +629,38 @@ bool OnlineSearchAbstract::publishEntry(QSharedPointer<Entry> entry)
 {
     if (entry.isNull()) return false;
 
+    if (m_numResultsToSkip > 0) {
+        /// Entry has been published already as part of a previous page of results
+        --m_numResultsToSkip;
+        return true;
+    }
+
     Value v;
     v.append(QSharedPointer<PlainText>(new PlainText(label())));
     entry->insert(QStringLiteral("x-fetchedfrom"), v);
 
     sanitizeEntry(entry);
 
-    emit foundEntry(entry);
+    if (m_prefetchState == psRunning)
+        m_prefetchedEntries.append(entry);
+    else
+        emit foundEntry(entry);
 
     return true;
 }
 
 void OnlineSearchAbstract::stopSearch(int errorCode) {
+    m_numResultsToSkip = 0;
     if (errorCode == resultNoError)
         curStep = numSteps;
     else
         curStep = numSteps = 0;
+    if (m_prefetchState == psRunning) {
+        /// Keep prefetched results until they get requested through continueSearch
+        m_prefetchState = psDone;
+        m_prefetchReturnCode = errorCode;
+        return;
+    }
     emit progress(curStep, numSteps);
     emit stoppedSearch(errorCode);
 }
@@ -24,6 +24,7 @@
 
 #include <QObject>
 #include <QMap>
+#include <QVector>
 #include <QString>
 #ifdef HAVE_QTWIDGETS
 #include <QWidget>
@@ -99,10 +100,44 @@ public:
     static const int resultNetworkError;
     static const int resultInvalidArguments;
 
+    /**
+     * Describes where a search has to continue to retrieve further
+     * results beyond those already found: the original query and
+     * the number of results that have been requested so far.
+     */
+    struct ContinuationToken {
+        QMap<QString, QString> query;
+        int offset;
+    };
+
 #ifdef HAVE_QTWIDGETS
     virtual void startSearchFromForm();
 #endif // HAVE_QTWIDGETS
     virtual void startSearch(const QMap<QString, QString> &query, int numResults) = 0;
+
+    /**
+     * Retrieve the next @p numResults results for a query previously
+     * passed to @see startSearch, skipping the results described by
+     * @p token. Results get reported through @see foundEntry and the
+     * search ends with @see stoppedSearch just like a regular search.
+     * If this page of results has already been retrieved by
+     * @see prefetchSearch, the results are published without further
+     * network access.
+     * @param token query and offset of the results page to retrieve
+     * @param numResults number of additional results to retrieve
+     */
+    void continueSearch(const OnlineSearchAbstract::ContinuationToken &token, int numResults);
+
+    /**
+     * Retrieve the next page of results like @see continueSearch
+     * does, but keep the results back instead of publishing them.
+     * A subsequent call to @see continueSearch with the same
+     * arguments publishes them, even if prefetching is still running.
+     * No @see stoppedSearch signal will be emitted for a prefetch.
+     * @param token query and offset of the results page to retrieve
+     * @param numResults number of additional results to retrieve
+     */
+    void prefetchSearch(const OnlineSearchAbstract::ContinuationToken &token, int numResults);
     virtual QString label() const = 0;
     QString name();
 #ifdef HAVE_QTWIDGETS
@@ -123,6 +158,16 @@ protected:
 
     virtual QString favIconUrl() const = 0;
 
+    /**
+     * Start a search for @p numResults results matching @p query,
+     * skipping the first @p offset results. Search engines whose
+     * web service accepts a start index should reimplement this
+     * function. The default implementation asks @see startSearch
+     * for offset+numResults results and suppresses the first
+     * @p offset results when publishing them.
+     */
+    virtual void startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset);
+
     /**
      * Split a string along spaces, but keep text in quotation marks together
      */
@@ -205,16 +250,26 @@ private:
     QString m_name;
     static const char *httpUnsafeChars;
 #ifdef HAVE_QTWIDGETS
-    QMap<QNetworkReply *, QListWidgetItem *> m_iconReplyToListWidgetItem;
+    QListWidgetItem *m_iconListWidgetItem;
 #endif // HAVE_QTWIDGETS
     int m_delayedStoppedSearchReturnCode;
 
+    /// Number of results to suppress when publishing, see startSearchFromOffset
+    int m_numResultsToSkip;
+    /// State of a search started through prefetchSearch
+    enum PrefetchState {psNone = 0, psRunning = 1, psDone = 2};
+    PrefetchState m_prefetchState;
+    ContinuationToken m_prefetchToken;
+    int m_prefetchNumResults;
+    int m_prefetchReturnCode;
+    QVector<QSharedPointer<Entry> > m_prefetchedEntries;
+
     QString htmlAttribute(const QString &htmlCode, const int startPos, const QString &attribute) const;
     bool htmlAttributeIsSelected(const QString &htmlCode, const int startPos, const QString &attribute) const;
 
 private slots:
 #ifdef HAVE_QTWIDGETS
-    void iconDownloadFinished();
+    void iconAvailable(const QString &favIconUrl, const QIcon &icon);
 #endif // HAVE_QTWIDGETS
     void delayedStoppedSearchTimer();
 
@@ -139,7 +139,7 @@ public:
     }
 #endif // HAVE_QTWIDGETS
 
-    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults) {
+    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset) {
         /// format search terms
         QStringList queryFragments;
         for (QMap<QString, QString>::ConstIterator it = query.constBegin(); it != query.constEnd(); ++it) {
@@ -147,7 +147,7 @@ public:
             for (const auto &queryFragment : respectingQuotationMarks)
                 queryFragments.append(OnlineSearchAbstract::encodeURL(queryFragment));
         }
-        return QUrl(QString(QStringLiteral("%1search_query=all:\"%3\"&start=0&max_results=%2")).arg(arXivQueryBaseUrl).arg(numResults).arg(queryFragments.join(QStringLiteral("\"+AND+all:\"")))); ///< join search terms with an AND operation
+        return QUrl(QString(QStringLiteral("%1search_query=all:\"%3\"&start=%4&max_results=%2")).arg(arXivQueryBaseUrl).arg(numResults).arg(queryFragments.join(QStringLiteral("\"+AND+all:\""))).arg(offset)); ///< join search terms with an AND operation
     }
 
     void interpreteJournal(Entry &entry) {
@@ -654,11 +654,16 @@ void OnlineSearchArXiv::startSearchFromForm()
 #endif // HAVE_QTWIDGETS
 
 void OnlineSearchArXiv::startSearch(const QMap<QString, QString> &query, int numResults)
+{
+    startSearchFromOffset(query, numResults, 0);
+}
+
+void OnlineSearchArXiv::startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset)
 {
     m_hasBeenCanceled = false;
     emit progress(curStep = 0, numSteps = 1);
 
-    QNetworkRequest request(d->buildQueryUrl(query, numResults));
+    QNetworkRequest request(d->buildQueryUrl(query, numResults, offset));
     QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
     InternalNetworkAccessManager::instance().setNetworkReplyTimeout(reply);
     connect(reply, &QNetworkReply::finished, this, &OnlineSearchArXiv::downloadDone);
@@ -43,6 +43,7 @@ public:
 
 protected:
     QString favIconUrl() const override;
+    void startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset) override;
     void sanitizeEntry(QSharedPointer<Entry> entry) override;
 
 private:
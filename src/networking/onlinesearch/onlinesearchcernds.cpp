@@ -45,7 +45,7 @@ QString OnlineSearchCERNDS::favIconUrl() const
     return QStringLiteral("http://cds.cern.ch/favicon.ico");
 }
 
-QUrl OnlineSearchCERNDS::buildQueryUrl(const QMap<QString, QString> &query, int numResults)
+QUrl OnlineSearchCERNDS::buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset)
 {
     /// Example for a search URL:
     /// http://cds.cern.ch/search?action_search=Search&sf=&so=d&rm=&sc=0&of=hx&f=&rg=10&ln=en&as=1&m1=a&p1=stone&f1=title&op1=a&m2=a&p2=smith&f2=author&op2=a&m3=a&p3=&f3=
@@ -64,6 +64,8 @@ QUrl OnlineSearchCERNDS::buildQueryUrl(const QMap<QString, QString> &query, int
     QUrlQuery q(url);
     /// Set number of expected results
     q.addQueryItem(QStringLiteral("rg"), QString::number(numResults));
+    /// Skip results already retrieved, first record has index 1
+    q.addQueryItem(QStringLiteral("jrec"), QString::number(offset + 1));
 
     /// Number search arguments
     int argumentCount = 0;
@@ -35,7 +35,7 @@ public:
 
 protected:
     QString favIconUrl() const override;
-    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults) override;
+    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset) override;
 };
 
 #endif // KBIBTEX_ONLINESEARCH_CERNDS_H
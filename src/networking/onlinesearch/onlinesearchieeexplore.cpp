@@ -49,7 +49,7 @@ public:
             qCWarning(LOG_KBIBTEX_NETWORKING) << "Failed to initialize XSL transformation based on file '" << xsltFilenameBase << "'";
     }
 
-    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults) {
+    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset) {
         QUrl queryUrl = apiUrl;
         QUrlQuery q(queryUrl.query());
 
@@ -77,8 +77,8 @@ public:
         /// Sort order of results: newest publications first
         q.addQueryItem(QStringLiteral("sort_field"), QStringLiteral("publication_year"));
         q.addQueryItem(QStringLiteral("sort_order"), QStringLiteral("desc"));
-        /// Request numResults many entries
-        q.addQueryItem(QStringLiteral("start_record"), QStringLiteral("1"));
+        /// Request numResults many entries, first record has index 1
+        q.addQueryItem(QStringLiteral("start_record"), QString::number(offset + 1));
         q.addQueryItem(QStringLiteral("max_records"), QString::number(numResults));
 
         queryUrl.setQuery(q);
@@ -102,11 +102,16 @@ OnlineSearchIEEEXplore::~OnlineSearchIEEEXplore()
 }
 
 void OnlineSearchIEEEXplore::startSearch(const QMap<QString, QString> &query, int numResults)
+{
+    startSearchFromOffset(query, numResults, 0);
+}
+
+void OnlineSearchIEEEXplore::startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset)
 {
     m_hasBeenCanceled = false;
     emit progress(curStep = 0, numSteps = 1);
 
-    QNetworkRequest request(d->buildQueryUrl(query, numResults));
+    QNetworkRequest request(d->buildQueryUrl(query, numResults, offset));
 
     // FIXME 'ieeexploreapi.ieee.org' uses a SSL/TLS certificate only valid for 'mashery.com'
     // TODO re-enable certificate validation once problem has been fix (already reported)
@@ -40,7 +40,7 @@ QString OnlineSearchInspireHep::favIconUrl() const
     return QStringLiteral("http://inspirehep.net/favicon.ico");
 }
 
-QUrl OnlineSearchInspireHep::buildQueryUrl(const QMap<QString, QString> &query, int numResults)
+QUrl OnlineSearchInspireHep::buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset)
 {
     static const QString typedSearch = QStringLiteral("%1 %2"); ///< no quotation marks for search term?
 
@@ -73,6 +73,8 @@ QUrl OnlineSearchInspireHep::buildQueryUrl(const QMap<QString, QString> &query,
     QString urlText = QStringLiteral("http://inspirehep.net/search?ln=en&ln=en&of=hx&action_search=Search&sf=&so=d&rm=&sc=0");
     /// Set number of expected results
     urlText.append(QString(QStringLiteral("&rg=%1")).arg(numResults));
+    /// Skip results already retrieved, first record has index 1
+    urlText.append(QString(QStringLiteral("&jrec=%1")).arg(offset + 1));
     /// Append actual query
     urlText.append(QStringLiteral("&p="));
     urlText.append(queryFragments.join(QStringLiteral(" and ")));
@@ -56,7 +56,7 @@ public:
             qCWarning(LOG_KBIBTEX_NETWORKING) << "Failed to initialize XSL transformation based on file '" << xsltFilenameBase << "'";
     }
 
-    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults) {
+    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset) {
         /// used to auto-detect PMIDs (unique identifiers for documents) in free text search
         static const QRegularExpression pmidRegExp(QStringLiteral("^[0-9]{6,}$"));
 
@@ -92,7 +92,7 @@ public:
         url = url.replace(QLatin1Char('"'), QStringLiteral("%22"));
 
         /// set number of expected results
-        url.append(QString(QStringLiteral("&retstart=0&retmax=%1&retmode=xml")).arg(numResults));
+        url.append(QString(QStringLiteral("&retstart=%2&retmax=%1&retmode=xml")).arg(numResults).arg(offset));
 
         return QUrl::fromUserInput(url);
     }
@@ -118,6 +118,11 @@ OnlineSearchPubMed::~OnlineSearchPubMed()
 }
 
 void OnlineSearchPubMed::startSearch(const QMap<QString, QString> &query, int numResults)
+{
+    startSearchFromOffset(query, numResults, 0);
+}
+
+void OnlineSearchPubMed::startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset)
 {
     m_hasBeenCanceled = false;
     emit progress(curStep = 0, numSteps = 2);
@@ -131,7 +136,7 @@ void OnlineSearchPubMed::startSearch(const QMap<QString, QString> &query, int nu
         return;
     }
 
-    QNetworkRequest request(d->buildQueryUrl(query, numResults));
+    QNetworkRequest request(d->buildQueryUrl(query, numResults, offset));
     QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
     InternalNetworkAccessManager::instance().setNetworkReplyTimeout(reply);
     connect(reply, &QNetworkReply::finished, this, &OnlineSearchPubMed::eSearchDone);
@@ -40,6 +40,7 @@ public:
 
 protected:
     QString favIconUrl() const override;
+    void startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset) override;
 
 private slots:
     void eSearchDone();
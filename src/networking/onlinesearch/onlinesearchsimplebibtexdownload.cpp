@@ -32,11 +32,16 @@ OnlineSearchSimpleBibTeXDownload::OnlineSearchSimpleBibTeXDownload(QWidget *pare
 }
 
 void OnlineSearchSimpleBibTeXDownload::startSearch(const QMap<QString, QString> &query, int numResults)
+{
+    startSearchFromOffset(query, numResults, 0);
+}
+
+void OnlineSearchSimpleBibTeXDownload::startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset)
 {
     m_hasBeenCanceled = false;
     emit progress(curStep = 0, numSteps = 2);
 
-    QNetworkRequest request(buildQueryUrl(query, numResults));
+    QNetworkRequest request(buildQueryUrl(query, numResults, offset));
     QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
     InternalNetworkAccessManager::instance().setNetworkReplyTimeout(reply);
     connect(reply, &QNetworkReply::finished, this, &OnlineSearchSimpleBibTeXDownload::downloadDone);
@@ -32,7 +32,8 @@ public:
     void startSearch(const QMap<QString, QString> &query, int numResults) override;
 
 protected:
-    virtual QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults) = 0;
+    void startSearchFromOffset(const QMap<QString, QString> &query, int numResults, int offset) override;
+    virtual QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset) = 0;
     virtual QString processRawDownload(const QString &download);
 
 private slots:
@@ -40,7 +40,7 @@ QString OnlineSearchSOANASAADS::favIconUrl() const
     return QStringLiteral("http://adsabs.harvard.edu/favicon.ico");
 }
 
-QUrl OnlineSearchSOANASAADS::buildQueryUrl(const QMap<QString, QString> &query, int numResults)
+QUrl OnlineSearchSOANASAADS::buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset)
 {
     static const QString globalSearch = QStringLiteral("\"%1\"");
     static const QString rangeSearch = QStringLiteral("%1:\"%2\"");
@@ -78,6 +78,8 @@ QUrl OnlineSearchSOANASAADS::buildQueryUrl(const QMap<QString, QString> &query,
     urlText.append(queryFragments.join(QStringLiteral("+")).replace(QLatin1Char('"'), QStringLiteral("%22")));
     /// set number of expected results
     urlText.append(QString(QStringLiteral("&nr_to_return=%1")).arg(numResults));
+    /// skip results already retrieved, first result has index 1
+    urlText.append(QString(QStringLiteral("&start_nr=%1")).arg(offset + 1));
 
     return QUrl(urlText);
 }
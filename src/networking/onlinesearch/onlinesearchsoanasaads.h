@@ -34,7 +34,7 @@ public:
 
 protected:
     QString favIconUrl() const override;
-    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults) override;
+    QUrl buildQueryUrl(const QMap<QString, QString> &query, int numResults, int offset) override;
     QString processRawDownload(const QString &download) override;
 };
 
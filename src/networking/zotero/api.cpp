@@ -39,6 +39,12 @@ public:
           apiKey(_apiKey), backoffElapseTime(QDateTime::currentDateTime().addSecs(-5)) {
         Q_UNUSED(parent)
     }
+
+    Private(const QUrl &baseUrl, const QString &_apiKey, Zotero::API *parent)
+            : apiBaseUrl(baseUrl), userOrGroupPrefix(-1),
+          apiKey(_apiKey), backoffElapseTime(QDateTime::currentDateTime().addSecs(-5)) {
+        Q_UNUSED(parent)
+    }
 };
 
 const int Zotero::API::limit = 45;
@@ -49,6 +55,12 @@ API::API(RequestScope requestScope, int userOrGroupPrefix, const QString &apiKey
     /// nothing
 }
 
+API::API(const QUrl &baseUrl, const QString &apiKey, QObject *parent)
+        : QObject(parent), d(new API::Private(baseUrl, apiKey, this))
+{
+    /// nothing
+}
+
 API::~API()
 {
     delete d;
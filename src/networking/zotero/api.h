@@ -57,6 +57,15 @@ public:
      */
     explicit API(RequestScope requestScope, int userOrGroupPrefix, const QString &apiKey, QObject *parent = nullptr);
 
+    /**
+     * Generate an API object talking to a Zotero-compatible server
+     * other than Zotero's own, for example a local mock for testing.
+     * @param baseUrl URL of the library, equivalent to 'https://api.zotero.org/users/12345'
+     * @param apiKey API key to send along each request
+     * @param parent used for Qt-internal operations
+     */
+    explicit API(const QUrl &baseUrl, const QString &apiKey, QObject *parent = nullptr);
+
     ~API() override;
 
     /**
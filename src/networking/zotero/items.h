@@ -33,6 +33,12 @@ namespace Zotero
 class API;
 
 /**
+ * Retrieve the items of a Zotero library, either of a specific
+ * collection or having a specific tag.
+ * Items are served from a local copy (@see ItemStore), which gets
+ * synchronized with Zotero before each retrieval, fetching only
+ * those items modified since the previous synchronization.
+ *
  * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
  */
 class KBIBTEXNETWORKING_EXPORT Items : public QObject
@@ -54,7 +60,7 @@ private:
     Private *const d;
 
 private slots:
-    void finishedFetchingItems();
+    void storeSynchronized(int errorCode);
 };
 
 } // end of namespace Zotero
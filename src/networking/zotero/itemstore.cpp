@@ -0,0 +1,383 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "itemstore.h"
+
+#include <QHash>
+#include <QSet>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QUrlQuery>
+#include <QTimer>
+
+#include "file.h"
+#include "fileimporterbibtex.h"
+#include "api.h"
+#include "internalnetworkaccessmanager.h"
+#include "logging_networking.h"
+
+using namespace Zotero;
+
+class Zotero::ItemStore::Private
+{
+private:
+    Zotero::ItemStore *p;
+
+public:
+    /// Everything known locally about a Zotero item
+    struct Item {
+        int version;
+        QStringList collections;
+        QStringList tags;
+        QString bibTeX;
+    };
+
+    QSharedPointer<Zotero::API> api;
+    const QString storeFilename;
+    int libraryVersion;
+    QHash<QString, Item> items;
+
+    /// Changes collected by a running synchronization,
+    /// applied to the local copy only if the synchronization succeeds
+    bool busy;
+    int newLibraryVersion;
+    QHash<QString, Item> modifiedItems;
+    QSet<QString> removedKeys;
+
+    Private(QSharedPointer<Zotero::API> a, Zotero::ItemStore *parent)
+            : p(parent), api(a), storeFilename(storeFilenameForUrl(a->baseUrl())), libraryVersion(0), busy(false), newLibraryVersion(0) {
+        load();
+    }
+
+    static QString storeFilenameForUrl(const QUrl &baseUrl) {
+        const QByteArray hash = QCryptographicHash::hash(baseUrl.toString().toUtf8(), QCryptographicHash::Sha1).toHex();
+        return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/zotero/") + QString::fromLatin1(hash) + QStringLiteral(".json");
+    }
+
+    static QStringList toStringList(const QJsonArray &array) {
+        QStringList result;
+        result.reserve(array.size());
+        for (const QJsonValue &value : array)
+            result << value.toString();
+        return result;
+    }
+
+    void load() {
+        QFile storeFile(storeFilename);
+        if (!storeFile.open(QFile::ReadOnly))
+            return; ///< nothing stored yet
+        const QJsonObject root = QJsonDocument::fromJson(storeFile.readAll()).object();
+        storeFile.close();
+
+        const QJsonObject itemsObject = root.value(QStringLiteral("items")).toObject();
+        for (QJsonObject::ConstIterator it = itemsObject.constBegin(); it != itemsObject.constEnd(); ++it) {
+            const QJsonObject itemObject = it.value().toObject();
+            Item item;
+            item.version = itemObject.value(QStringLiteral("version")).toInt();
+            item.collections = toStringList(itemObject.value(QStringLiteral("collections")).toArray());
+            item.tags = toStringList(itemObject.value(QStringLiteral("tags")).toArray());
+            item.bibTeX = itemObject.value(QStringLiteral("bibtex")).toString();
+            items.insert(it.key(), item);
+        }
+        libraryVersion = root.value(QStringLiteral("libraryVersion")).toInt();
+    }
+
+    void save() const {
+        QJsonObject itemsObject;
+        for (QHash<QString, Item>::ConstIterator it = items.constBegin(); it != items.constEnd(); ++it) {
+            QJsonObject itemObject;
+            itemObject.insert(QStringLiteral("version"), it.value().version);
+            itemObject.insert(QStringLiteral("collections"), QJsonArray::fromStringList(it.value().collections));
+            itemObject.insert(QStringLiteral("tags"), QJsonArray::fromStringList(it.value().tags));
+            itemObject.insert(QStringLiteral("bibtex"), it.value().bibTeX);
+            itemsObject.insert(it.key(), itemObject);
+        }
+        QJsonObject root;
+        root.insert(QStringLiteral("libraryVersion"), libraryVersion);
+        root.insert(QStringLiteral("items"), itemsObject);
+
+        QDir().mkpath(QFileInfo(storeFilename).absolutePath());
+        QSaveFile storeFile(storeFilename);
+        if (!storeFile.open(QFile::WriteOnly) || storeFile.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 || !storeFile.commit())
+            qCWarning(LOG_KBIBTEX_NETWORKING) << "Failed to write Zotero item store to" << storeFilename;
+    }
+
+    QNetworkReply *requestZoteroUrl(const QUrl &url, void (Zotero::ItemStore::*slot)()) {
+        QNetworkRequest request = api->request(url);
+        request.setRawHeader("Accept", "application/json");
+        if (libraryVersion > 0)
+            request.setRawHeader("If-Modified-Since-Version", QByteArray::number(libraryVersion));
+        QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
+        QObject::connect(reply, &QNetworkReply::finished, p, slot);
+        return reply;
+    }
+
+    void retrieveItems(int start) {
+        QUrl url = api->baseUrl().adjusted(QUrl::StripTrailingSlash);
+        url.setPath(url.path() + QStringLiteral("/items"));
+        QUrlQuery query(url);
+        query.addQueryItem(QStringLiteral("format"), QStringLiteral("json"));
+        query.addQueryItem(QStringLiteral("include"), QStringLiteral("bibtex"));
+        /// Items moved to the trash have to be removed from the local copy
+        query.addQueryItem(QStringLiteral("includeTrashed"), QStringLiteral("1"));
+        query.addQueryItem(QStringLiteral("since"), QString::number(libraryVersion));
+        query.addQueryItem(QStringLiteral("start"), QString::number(start));
+        url.setQuery(query);
+        api->addLimitToUrl(url);
+
+        if (api->inBackoffMode())
+            /// If Zotero asked to 'back off', wait until this period is over before issuing the next request
+            QTimer::singleShot((api->backoffSecondsLeft() + 1) * 1000, p, [ = ]() {
+                requestZoteroUrl(url, &Zotero::ItemStore::finishedFetchingItems);
+            });
+        else
+            requestZoteroUrl(url, &Zotero::ItemStore::finishedFetchingItems);
+    }
+
+    void retrieveDeletions() {
+        QUrl url = api->baseUrl().adjusted(QUrl::StripTrailingSlash);
+        url.setPath(url.path() + QStringLiteral("/deleted"));
+        QUrlQuery query(url);
+        query.addQueryItem(QStringLiteral("since"), QString::number(libraryVersion));
+        url.setQuery(query);
+
+        if (api->inBackoffMode())
+            QTimer::singleShot((api->backoffSecondsLeft() + 1) * 1000, p, [ = ]() {
+                requestZoteroUrl(url, &Zotero::ItemStore::finishedFetchingDeletions);
+            });
+        else
+            requestZoteroUrl(url, &Zotero::ItemStore::finishedFetchingDeletions);
+    }
+
+    void processBackoff(QNetworkReply *reply) {
+        if (reply->hasRawHeader("Backoff")) {
+            bool ok = false;
+            int time = QString::fromLatin1(reply->rawHeader("Backoff").constData()).toInt(&ok);
+            if (!ok) time = 10; ///< parsing argument of raw header 'Backoff' failed? 10 seconds is fallback
+            api->startBackoff(time);
+        } else if (reply->hasRawHeader("Retry-After")) {
+            bool ok = false;
+            int time = QString::fromLatin1(reply->rawHeader("Retry-After").constData()).toInt(&ok);
+            if (!ok) time = 10; ///< parsing argument of raw header 'Retry-After' failed? 10 seconds is fallback
+            api->startBackoff(time);
+        }
+    }
+
+    /**
+     * Record items as returned by Zotero in JSON format
+     * with BibTeX code included.
+     */
+    void collectItems(const QJsonArray &array) {
+        for (const QJsonValue &value : array) {
+            const QJsonObject itemObject = value.toObject();
+            const QString key = itemObject.value(QStringLiteral("key")).toString();
+            if (key.isEmpty()) continue;
+
+            const QJsonObject data = itemObject.value(QStringLiteral("data")).toObject();
+            const QString bibTeX = itemObject.value(QStringLiteral("bibtex")).toString().trimmed();
+            /// Trashed items as well as notes or attachments (no BibTeX code) are not kept
+            if (data.value(QStringLiteral("deleted")).toVariant().toBool() || bibTeX.isEmpty()) {
+                modifiedItems.remove(key);
+                removedKeys.insert(key);
+                continue;
+            }
+
+            Item item;
+            item.version = itemObject.value(QStringLiteral("version")).toInt();
+            item.collections = toStringList(data.value(QStringLiteral("collections")).toArray());
+            const QJsonArray tagArray = data.value(QStringLiteral("tags")).toArray();
+            for (const QJsonValue &tagValue : tagArray)
+                item.tags << tagValue.toObject().value(QStringLiteral("tag")).toString();
+            item.bibTeX = bibTeX;
+            removedKeys.remove(key);
+            modifiedItems.insert(key, item);
+        }
+    }
+
+    void finishSynchronization(int errorCode) {
+        if (errorCode == 0) {
+            for (const QString &key : const_cast<const QSet<QString> &>(removedKeys))
+                items.remove(key);
+            for (QHash<QString, Item>::ConstIterator it = modifiedItems.constBegin(); it != modifiedItems.constEnd(); ++it)
+                items.insert(it.key(), it.value());
+            const bool changed = !removedKeys.isEmpty() || !modifiedItems.isEmpty() || (newLibraryVersion > 0 && newLibraryVersion != libraryVersion);
+            if (newLibraryVersion > 0)
+                libraryVersion = newLibraryVersion;
+            if (changed)
+                save();
+        }
+        modifiedItems.clear();
+        removedKeys.clear();
+        busy = false;
+        emit p->synchronized(errorCode);
+    }
+
+    /**
+     * Parse the BibTeX code of the given items in one go.
+     */
+    QVector<QSharedPointer<Element> > toElements(const QStringList &bibTeXcode) const {
+        QVector<QSharedPointer<Element> > result;
+        if (bibTeXcode.isEmpty()) return result;
+
+        FileImporterBibTeX importer(p);
+        File *bibtexFile = importer.fromString(bibTeXcode.join(QStringLiteral("\n\n")));
+        if (bibtexFile != nullptr) {
+            result.reserve(bibtexFile->count());
+            for (const QSharedPointer<Element> &element : const_cast<const File &>(*bibtexFile))
+                result << element;
+            delete bibtexFile;
+        }
+        return result;
+    }
+};
+
+ItemStore::ItemStore(QSharedPointer<Zotero::API> api, QObject *parent)
+        : QObject(parent), d(new Zotero::ItemStore::Private(api, this))
+{
+    /// nothing
+}
+
+ItemStore::~ItemStore()
+{
+    delete d;
+}
+
+int ItemStore::libraryVersion() const
+{
+    return d->libraryVersion;
+}
+
+int ItemStore::count() const
+{
+    return d->items.count();
+}
+
+bool ItemStore::busy() const
+{
+    return d->busy;
+}
+
+void ItemStore::synchronize()
+{
+    if (d->busy) return;
+
+    d->busy = true;
+    d->newLibraryVersion = 0;
+    d->retrieveItems(0);
+}
+
+QVector<QSharedPointer<Element> > ItemStore::itemsByCollection(const QString &collectionId) const
+{
+    QStringList bibTeXcode;
+    for (QHash<QString, Private::Item>::ConstIterator it = d->items.constBegin(); it != d->items.constEnd(); ++it)
+        if (collectionId.isEmpty() || it.value().collections.contains(collectionId))
+            bibTeXcode << it.value().bibTeX;
+    return d->toElements(bibTeXcode);
+}
+
+QVector<QSharedPointer<Element> > ItemStore::itemsByTag(const QString &tag) const
+{
+    QStringList bibTeXcode;
+    for (QHash<QString, Private::Item>::ConstIterator it = d->items.constBegin(); it != d->items.constEnd(); ++it)
+        if (tag.isEmpty() || it.value().tags.contains(tag))
+            bibTeXcode << it.value().bibTeX;
+    return d->toElements(bibTeXcode);
+}
+
+void ItemStore::finishedFetchingItems()
+{
+    QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
+    d->processBackoff(reply);
+
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        /// Library has not been modified since last synchronization
+        d->finishSynchronization(0);
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qCWarning(LOG_KBIBTEX_NETWORKING) << reply->errorString(); ///< something went wrong
+        d->finishSynchronization(1); // TODO proper error codes
+        return;
+    }
+
+    /// All pages of one synchronization must refer to the same library version
+    const int version = reply->rawHeader("Last-Modified-Version").toInt();
+    if (d->newLibraryVersion == 0)
+        d->newLibraryVersion = version;
+    else if (version != d->newLibraryVersion) {
+        /// Library got modified while paging through it, start over
+        qCDebug(LOG_KBIBTEX_NETWORKING) << "Zotero library modified during synchronization, restarting";
+        d->modifiedItems.clear();
+        d->removedKeys.clear();
+        d->newLibraryVersion = 0;
+        d->retrieveItems(0);
+        return;
+    }
+
+    const QJsonArray array = QJsonDocument::fromJson(reply->readAll()).array();
+    d->collectItems(array);
+
+    const int start = QUrlQuery(reply->url()).queryItemValue(QStringLiteral("start")).toInt();
+    bool ok = false;
+    const int totalResults = reply->rawHeader("Total-Results").toInt(&ok);
+    const bool morePages = ok ? start + array.count() < totalResults : array.count() >= Zotero::API::limit;
+    if (morePages && !array.isEmpty())
+        d->retrieveItems(start + array.count());
+    else if (d->libraryVersion > 0)
+        /// Items deleted since last synchronization are not listed
+        /// among modified items, but have to be asked for separately
+        d->retrieveDeletions();
+    else
+        d->finishSynchronization(0);
+}
+
+void ItemStore::finishedFetchingDeletions()
+{
+    QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
+    d->processBackoff(reply);
+
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        d->finishSynchronization(0);
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qCWarning(LOG_KBIBTEX_NETWORKING) << reply->errorString();
+        d->finishSynchronization(1);
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(reply->readAll()).object();
+    const QJsonArray deletedItems = root.value(QStringLiteral("items")).toArray();
+    for (const QJsonValue &value : deletedItems) {
+        d->modifiedItems.remove(value.toString());
+        d->removedKeys.insert(value.toString());
+    }
+    d->finishSynchronization(0);
+}
@@ -0,0 +1,105 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KBIBTEX_NETWORKING_ZOTERO_ITEMSTORE_H
+#define KBIBTEX_NETWORKING_ZOTERO_ITEMSTORE_H
+
+#include <QObject>
+#include <QVector>
+#include <QSharedPointer>
+
+#include "kbibtexnetworking_export.h"
+
+class Element;
+
+namespace Zotero
+{
+
+class API;
+
+/**
+ * Local copy of the items in a Zotero library, stored on disk
+ * between sessions.
+ *
+ * Each item is stored under its Zotero key together with its version,
+ * the collections and tags it belongs to, and its BibTeX representation.
+ * When synchronizing, only items modified since the library version
+ * of the previous synchronization are fetched (Zotero's 'since'
+ * parameter), and items deleted in the meantime are removed.
+ * Browsing collections and tags is served from the local copy.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXNETWORKING_EXPORT ItemStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ItemStore(QSharedPointer<Zotero::API> api, QObject *parent = nullptr);
+    ~ItemStore() override;
+
+    /**
+     * @return library version the local copy corresponds to, 0 if never synchronized
+     */
+    int libraryVersion() const;
+
+    /**
+     * @return number of items in the local copy
+     */
+    int count() const;
+
+    bool busy() const;
+
+    /**
+     * Fetch changes from Zotero made since the last synchronization.
+     * Signal @see synchronized gets emitted once done. Calling this
+     * function while a synchronization is running has no effect.
+     */
+    void synchronize();
+
+    /**
+     * Retrieve items from the local copy.
+     * @param collectionId key of the collection, empty for all items
+     * @return newly created elements for all items in this collection
+     */
+    QVector<QSharedPointer<Element> > itemsByCollection(const QString &collectionId) const;
+
+    /**
+     * Retrieve items from the local copy.
+     * @param tag tag to look for, empty for all items
+     * @return newly created elements for all items having this tag
+     */
+    QVector<QSharedPointer<Element> > itemsByTag(const QString &tag) const;
+
+signals:
+    /**
+     * A synchronization has been finished.
+     * @param errorCode 0 on success, otherwise the local copy remains as before
+     */
+    void synchronized(int errorCode);
+
+private:
+    class Private;
+    Private *const d;
+
+private slots:
+    void finishedFetchingItems();
+    void finishedFetchingDeletions();
+};
+
+} // end of namespace Zotero
+
+#endif // KBIBTEX_NETWORKING_ZOTERO_ITEMSTORE_H
@@ -36,6 +36,8 @@
 #include <QPushButton>
 #include <QTemporaryFile>
 #include <QTimer>
+#include <QSet>
+#include <QHash>
 
 #include <KMessageBox> // FIXME deprecated
 #include <KLocalizedString>
@@ -59,6 +61,7 @@
 #include "preamble.h"
 #include "comment.h"
 #include "fileinfo.h"
+#include "attachmentresolver.h"
 #include "fileexporterbibtexoutput.h"
 #include "fileimporterbibtex.h"
 #include "fileexporterbibtex.h"
@@ -74,17 +77,21 @@
 #include "fileexporterxml.h"
 #include "fileexporterxslt.h"
 #include "models/filemodel.h"
+#include "models/undojournal.h"
 #include "filesettingswidget.h"
 #include "filterbar.h"
 #include "findduplicatesui.h"
+#include "checkbibtexui.h"
 #include "lyx.h"
 #include "preferences.h"
 #include "settingscolorlabelwidget.h"
 #include "settingsfileexporterpdfpswidget.h"
 #include "findpdfui.h"
+#include "findpdfbatch.h"
 #include "valuelistmodel.h"
 #include "clipboard.h"
 #include "idsuggestions.h"
+#include "journalabbreviations.h"
 #include "fileview.h"
 #include "browserextension.h"
 #include "logging_parts.h"
@@ -128,21 +135,31 @@ public:
     FileModel *model;
     SortFilterFileModel *sortFilterProxyModel;
     QSignalMapper *signalMapperNewElement;
-    QAction *editCutAction, *editDeleteAction, *editCopyAction, *editPasteAction, *editCopyReferencesAction, *elementEditAction, *elementViewDocumentAction, *fileSaveAction, *elementFindPDFAction, *entryApplyDefaultFormatString;
+    QAction *editUndoAction, *editRedoAction, *editCutAction, *editDeleteAction, *editCopyAction, *editPasteAction, *editCopyReferencesAction, *elementEditAction, *elementViewDocumentAction, *fileSaveAction, *elementFindPDFAction, *findPDFAllAction, *entryApplyDefaultFormatString, *entryAbbreviateJournalsAction, *entryExpandJournalsAction;
     QMenu *viewDocumentMenu;
     QSignalMapper *signalMapperViewDocument;
     QSet<QObject *> signalMapperViewDocumentSenders;
+    /// Entry the "View Document" menu is about and its resolved URLs
+    QSharedPointer<const Entry> viewDocumentEntry;
+    QSet<QUrl> viewDocumentUrls;
     bool isSaveAsOperation;
     LyX *lyx;
     FindDuplicatesUI *findDuplicatesUI;
+    CheckBibTeXUI *checkBibTeXUI;
     ColorLabelContextMenu *colorLabelContextMenu;
     QAction *colorLabelContextMenuAction;
     QFileSystemWatcher fileSystemWatcher;
+    FindPDFBatch *findPDFBatch;
+    /// Exporters running external programs by file ending, kept after saving
+    /// to reuse their programs' results when the same data gets saved again
+    QHash<QString, FileExporterToolchain *> toolchainExporters;
 
     KBibTeXPartPrivate(QWidget *parentWidget, KBibTeXPart *parent)
-            : p(parent), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), bibTeXFile(nullptr), model(nullptr), sortFilterProxyModel(nullptr), signalMapperNewElement(new QSignalMapper(parent)), viewDocumentMenu(new QMenu(i18n("View Document"), parent->widget())), signalMapperViewDocument(new QSignalMapper(parent)), isSaveAsOperation(false), fileSystemWatcher(p) {
+            : p(parent), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), bibTeXFile(nullptr), model(nullptr), sortFilterProxyModel(nullptr), signalMapperNewElement(new QSignalMapper(parent)), viewDocumentMenu(new QMenu(i18n("View Document"), parent->widget())), signalMapperViewDocument(new QSignalMapper(parent)), isSaveAsOperation(false), fileSystemWatcher(p), findPDFBatch(nullptr) {
         connect(signalMapperViewDocument, static_cast<void(QSignalMapper::*)(QObject *)>(&QSignalMapper::mapped), p, &KBibTeXPart::elementViewDocumentMenu);
         connect(&fileSystemWatcher, &QFileSystemWatcher::fileChanged, p, &KBibTeXPart::fileExternallyChange);
+        connect(&AttachmentResolver::instance(), &AttachmentResolver::urlsResolved, p, &KBibTeXPart::viewDocumentUrlsResolved);
+        connect(&AttachmentResolver::instance(), &AttachmentResolver::attachmentsChanged, p, &KBibTeXPart::updateActions);
 
         partWidget = new PartWidget(parentWidget);
         partWidget->fileView()->setReadOnly(!p->isReadWrite());
@@ -152,12 +169,14 @@ public:
     }
 
     ~KBibTeXPartPrivate() {
+        delete findPDFBatch;
         delete bibTeXFile;
         delete model;
         delete signalMapperNewElement;
         delete viewDocumentMenu;
         delete signalMapperViewDocument;
         delete findDuplicatesUI;
+        delete checkBibTeXUI;
     }
 
 
@@ -223,11 +242,28 @@ public:
         p->actionCollection()->addAction(QStringLiteral("element_findpdf"), elementFindPDFAction);
         connect(elementFindPDFAction, &QAction::triggered, p, &KBibTeXPart::elementFindPDF);
 
+        /// Action to find PDFs for all entries in the background
+        findPDFAllAction = new QAction(QIcon::fromTheme(QStringLiteral("application-pdf")), i18n("Find PDFs for All Entries"), p);
+        p->actionCollection()->addAction(QStringLiteral("file_findpdf_all"), findPDFAllAction);
+        connect(findPDFAllAction, &QAction::triggered, p, &KBibTeXPart::findPDFsForAllEntries);
+
         /// Action to reformat the selected elements' ids
         entryApplyDefaultFormatString = new QAction(QIcon::fromTheme(QStringLiteral("favorites")), i18n("Format entry ids"), p);
         p->actionCollection()->addAction(QStringLiteral("entry_applydefaultformatstring"), entryApplyDefaultFormatString);
         connect(entryApplyDefaultFormatString, &QAction::triggered, p, &KBibTeXPart::applyDefaultFormatString);
 
+        /// Actions to rewrite journal names of the selected or all entries
+        entryAbbreviateJournalsAction = new QAction(i18n("Abbreviate Journal Names"), p);
+        p->actionCollection()->addAction(QStringLiteral("entry_abbreviatejournals"), entryAbbreviateJournalsAction);
+        connect(entryAbbreviateJournalsAction, &QAction::triggered, p, &KBibTeXPart::abbreviateJournalNames);
+        entryExpandJournalsAction = new QAction(i18n("Expand Journal Names"), p);
+        p->actionCollection()->addAction(QStringLiteral("entry_expandjournals"), entryExpandJournalsAction);
+        connect(entryExpandJournalsAction, &QAction::triggered, p, &KBibTeXPart::expandJournalNames);
+
+        /// Actions to undo and redo modifications recorded in the model's journal
+        editUndoAction = p->actionCollection()->addAction(KStandardAction::Undo, partWidget->fileView(), SLOT(undo()));
+        editRedoAction = p->actionCollection()->addAction(KStandardAction::Redo, partWidget->fileView(), SLOT(redo()));
+
         /// Clipboard object, required for various copy&paste operations
         Clipboard *clipboard = new Clipboard(partWidget->fileView());
 
@@ -271,12 +307,36 @@ public:
         colorLabelContextMenuAction = p->actionCollection()->addAction(QStringLiteral("entry_colorlabel"), colorLabelContextMenu->menuAction());
 
         findDuplicatesUI = new FindDuplicatesUI(p, partWidget->fileView());
+        checkBibTeXUI = new CheckBibTeXUI(p, partWidget->fileView());
         lyx = new LyX(p, partWidget->fileView());
 
         connect(partWidget->fileView(), &FileView::selectedElementsChanged, p, &KBibTeXPart::updateActions);
         connect(partWidget->fileView(), &FileView::currentElementChanged, p, &KBibTeXPart::updateActions);
     }
 
+    /**
+     * Search PDF files for the given entries in the background,
+     * attaching the best-ranked ones to their entries.
+     * A batch search already running gets resumed instead,
+     * as entries processed so far will be skipped.
+     */
+    void startFindPDFBatch(const QList<QSharedPointer<Entry> > &entries) {
+        if (findPDFBatch == nullptr) {
+            findPDFBatch = new FindPDFBatch(bibTeXFile, p);
+            connect(findPDFBatch, &FindPDFBatch::progress, p, &KBibTeXPart::findPDFBatchProgress);
+            connect(findPDFBatch, &FindPDFBatch::entryChanged, p, &KBibTeXPart::findPDFBatchEntryChanged);
+            connect(findPDFBatch, &FindPDFBatch::finished, p, &KBibTeXPart::findPDFBatchFinished);
+        } else if (findPDFBatch->isRunning())
+            return;
+
+        const KConfigGroup configGroup(config, QStringLiteral("FindPDF"));
+        findPDFBatch->setConcurrentSearches(configGroup.readEntry(QStringLiteral("concurrentSearches"), FindPDFBatch::defaultConcurrentSearches));
+        findPDFBatch->setRelevanceThreshold(configGroup.readEntry(QStringLiteral("relevanceThreshold"), FindPDFBatch::defaultRelevanceThreshold));
+        findPDFBatch->setJournal(model != nullptr ? model->journal() : nullptr);
+        findPDFBatch->start(entries);
+        p->updateActions();
+    }
+
     FileImporter *fileImporterFactory(const QUrl &url) {
         QString ending = url.path().toLower();
         const auto pos = ending.lastIndexOf(QStringLiteral("."));
@@ -338,6 +398,7 @@ public:
         bibTeXFile = new File();
         model = new FileModel();
         model->setBibliographyFile(bibTeXFile);
+        connect(model->journal(), &UndoJournal::changed, p, &KBibTeXPart::updateActions);
 
         if (sortFilterProxyModel != nullptr) delete sortFilterProxyModel;
         sortFilterProxyModel = new SortFilterFileModel(p);
@@ -351,6 +412,10 @@ public:
 
         qApp->setOverrideCursor(Qt::WaitCursor);
 
+        /// A running batch search for PDF files refers to the old bibliography
+        delete findPDFBatch;
+        findPDFBatch = nullptr;
+
         if (bibTeXFile != nullptr) {
             const QUrl oldUrl = bibTeXFile->property(File::Url, QUrl()).toUrl();
             if (oldUrl.isValid() && oldUrl.isLocalFile()) {
@@ -514,7 +579,12 @@ public:
     }
 
     FileExporter *saveFileExporter(const QString &ending) {
-        FileExporter *exporter = fileExporterFactory(ending);
+        FileExporter *exporter = toolchainExporters.value(ending, nullptr);
+        if (exporter == nullptr)
+            exporter = fileExporterFactory(ending);
+        else
+            /// Settings may have changed since the exporter was last used
+            toolchainExporters.value(ending)->reloadConfig();
 
         if (isSaveAsOperation) {
             /// only show export dialog at SaveAs or SaveCopyAs operations
@@ -625,7 +695,11 @@ public:
 
         qApp->restoreOverrideCursor();
 
-        delete exporter;
+        FileExporterToolchain *toolchainExporter = qobject_cast<FileExporterToolchain *>(exporter);
+        if (toolchainExporter != nullptr)
+            toolchainExporters.insert(ending, toolchainExporter);
+        else
+            delete exporter;
 
         if (!result) {
             QString msg = i18n("Saving the bibliography to file '%1' failed.", url.toDisplayString());
@@ -640,9 +714,97 @@ public:
         return result;
     }
 
+    /**
+     * Rewrite the journal names of all selected entries or, if no
+     * entry is selected, of all entries in the bibliography.
+     * Journal names that could not be translated are reported.
+     */
+    void normalizeJournalNames(JournalAbbreviations::NameForm form) {
+        FileModel *model = partWidget != nullptr && partWidget->fileView() != nullptr ? partWidget->fileView()->fileModel() : nullptr;
+        if (model == nullptr) return;
+
+        QVector<QSharedPointer<Entry> > entries;
+        QHash<const Entry *, int> entryRows;
+        const QModelIndexList mil = partWidget->fileView()->selectionModel()->selectedRows();
+        if (!mil.isEmpty()) {
+            for (const QModelIndex &index : mil) {
+                const int row = partWidget->fileView()->sortFilterProxyModel()->mapToSource(index).row();
+                const QSharedPointer<Entry> entry = model->element(row).dynamicCast<Entry>();
+                if (!entry.isNull()) {
+                    entries.append(entry);
+                    entryRows.insert(entry.data(), row);
+                }
+            }
+        } else {
+            for (int row = 0; row < model->rowCount(); ++row) {
+                const QSharedPointer<Entry> entry = model->element(row).dynamicCast<Entry>();
+                if (!entry.isNull()) {
+                    entries.append(entry);
+                    entryRows.insert(entry.data(), row);
+                }
+            }
+        }
+        if (entries.isEmpty()) return;
+
+        qApp->setOverrideCursor(Qt::WaitCursor);
+        model->journal()->beginOperation(form == JournalAbbreviations::nfAbbreviation ? i18n("Abbreviate Journal Names") : i18n("Expand Journal Names"));
+        for (const QSharedPointer<Entry> &entry : const_cast<const QVector<QSharedPointer<Entry> > &>(entries))
+            if (entry->contains(Entry::ftJournal))
+                model->journal()->aboutToModify(entry, Entry::ftJournal);
+        const JournalAbbreviations::NormalizationResult result = JournalAbbreviations::self()->normalizeJournalNames(entries, form);
+        model->journal()->endOperation();
+        qApp->restoreOverrideCursor();
+
+        if (!result.changedEntries.isEmpty()) {
+            /// Single update for all changed rows instead of one per entry
+            int firstRow = model->rowCount(), lastRow = -1;
+            for (const QSharedPointer<Entry> &entry : result.changedEntries) {
+                const int row = entryRows.value(entry.data(), -1);
+                firstRow = qMin(firstRow, row);
+                lastRow = qMax(lastRow, row);
+            }
+            model->elementsChanged(firstRow, lastRow);
+            partWidget->fileView()->externalModification();
+        }
+
+        if (!result.ambiguousNames.isEmpty())
+            KMessageBox::informationList(p->widget(), i18n("The following journal abbreviations are used for several journals and have been left unchanged:"), result.ambiguousNames, i18n("Ambiguous Journal Names"));
+        if (!result.unknownNames.isEmpty())
+            KMessageBox::informationList(p->widget(), i18n("The following journal names could not be found in the list of journal abbreviations and have been left unchanged:"), result.unknownNames, i18n("Unknown Journal Names"));
+    }
+
+    /**
+     * Request the references (URLs, files) of the current entry
+     * in the background. Once resolved, the "View Document" menu
+     * gets updated through @see updateViewDocumentActions.
+     */
+    void resolveViewDocumentUrls() {
+        File *bibliographyFile = partWidget != nullptr && partWidget->fileView() != nullptr && partWidget->fileView()->fileModel() != nullptr ? partWidget->fileView()->fileModel()->bibliographyFile() : nullptr;
+        const QSharedPointer<const Entry> entry = bibliographyFile != nullptr ? partWidget->fileView()->currentElement().dynamicCast<const Entry>() : QSharedPointer<const Entry>();
+        if (entry != viewDocumentEntry) {
+            /// References of previous entry must not be offered meanwhile
+            viewDocumentEntry = entry;
+            viewDocumentUrls.clear();
+        }
+        /// Resolve even if entry is unchanged, its references may have been edited
+        if (!entry.isNull())
+            AttachmentResolver::instance().resolve(entry, bibliographyFile->property(File::Url).toUrl());
+    }
+
+    void updateViewDocumentActions() {
+        const bool emptySelection = partWidget->fileView()->selectedElements().isEmpty();
+        int numDocumentsToView = updateViewDocumentMenu();
+        /// enable menu item only if there is at least one document to view
+        elementViewDocumentAction->setEnabled(!emptySelection && numDocumentsToView > 0);
+        /// activate sub-menu only if there are at least two documents to view
+        elementViewDocumentAction->setMenu(numDocumentsToView > 1 ? viewDocumentMenu : nullptr);
+        elementViewDocumentAction->setToolTip(numDocumentsToView == 1 ? (*viewDocumentMenu->actions().constBegin())->text() : QString());
+    }
+
     /**
      * Builds or resets the menu with local and remote
-     * references (URLs, files) of an entry.
+     * references (URLs, files) of an entry as resolved
+     * by @see resolveViewDocumentUrls.
      *
      * @return Number of known references
      */
@@ -650,9 +812,6 @@ public:
         viewDocumentMenu->clear();
         int result = 0; ///< Initially, no references are known
 
-        File *bibliographyFile = partWidget != nullptr && partWidget->fileView() != nullptr && partWidget->fileView()->fileModel() != nullptr ? partWidget->fileView()->fileModel()->bibliographyFile() : nullptr;
-        if (bibliographyFile == nullptr) return result;
-
         /// Clean signal mapper of old mappings
         /// as stored in QSet signalMapperViewDocumentSenders
         /// and identified by their QAction*'s
@@ -662,13 +821,10 @@ public:
             it = signalMapperViewDocumentSenders.erase(it);
         }
 
-        /// Retrieve Entry object of currently selected line
-        /// in main list view
-        QSharedPointer<const Entry> entry = partWidget->fileView()->currentElement().dynamicCast<const Entry>();
-        /// Test and continue if there was an Entry to retrieve
-        if (!entry.isNull()) {
-            /// Get list of URLs associated with this entry
-            const auto urlList = FileInfo::entryUrls(entry, bibliographyFile->property(File::Url).toUrl(), FileInfo::TestExistenceYes);
+        /// Test and continue if there is an Entry with resolved URLs
+        if (!viewDocumentEntry.isNull()) {
+            /// List of URLs associated with this entry
+            const QSet<QUrl> &urlList = viewDocumentUrls;
             if (!urlList.isEmpty()) {
                 /// Memorize first action, necessary to set menu title
                 QAction *firstAction = nullptr;
@@ -931,10 +1087,57 @@ void KBibTeXPart::elementFindPDF()
 {
     QModelIndexList mil = d->partWidget->fileView()->selectionModel()->selectedRows();
     if (mil.count() == 1) {
-        QSharedPointer<Entry> entry = d->partWidget->fileView()->fileModel()->element(d->partWidget->fileView()->sortFilterProxyModel()->mapToSource(*mil.constBegin()).row()).dynamicCast<Entry>();
-        if (!entry.isNull())
+        FileModel *model = d->partWidget->fileView()->fileModel();
+        QSharedPointer<Entry> entry = model->element(d->partWidget->fileView()->sortFilterProxyModel()->mapToSource(*mil.constBegin()).row()).dynamicCast<Entry>();
+        if (!entry.isNull()) {
+            /// Record the entry's changes to allow undoing them
+            model->journal()->beginOperation(i18n("Find PDF"));
+            model->journal()->aboutToModify(entry);
             FindPDFUI::interactiveFindPDF(*entry, *d->bibTeXFile, widget());
+            model->journal()->endOperation();
+        }
+    } else if (mil.count() > 1) {
+        /// Too many entries to review search results interactively
+        QList<QSharedPointer<Entry> > entries;
+        entries.reserve(mil.count());
+        for (const QModelIndex &index : const_cast<const QModelIndexList &>(mil)) {
+            QSharedPointer<Entry> entry = d->partWidget->fileView()->fileModel()->element(d->partWidget->fileView()->sortFilterProxyModel()->mapToSource(index).row()).dynamicCast<Entry>();
+            if (!entry.isNull())
+                entries << entry;
+        }
+        d->startFindPDFBatch(entries);
+    }
+}
+
+void KBibTeXPart::findPDFsForAllEntries()
+{
+    QList<QSharedPointer<Entry> > entries;
+    for (const QSharedPointer<Element> &element : const_cast<const File &>(*d->bibTeXFile)) {
+        QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
+        if (!entry.isNull())
+            entries << entry;
     }
+    d->startFindPDFBatch(entries);
+}
+
+void KBibTeXPart::findPDFBatchProgress(int processed, int total, int attached)
+{
+    emit setStatusBarText(i18n("Searching PDF files: %1 of %2 entries processed, %3 files attached", processed, total, attached));
+}
+
+void KBibTeXPart::findPDFBatchEntryChanged(QSharedPointer<Entry> entry)
+{
+    FileModel *model = d->partWidget->fileView()->fileModel();
+    const int row = model != nullptr ? model->row(entry) : -1;
+    if (row >= 0)
+        model->elementChanged(row);
+    d->partWidget->fileView()->externalModification();
+}
+
+void KBibTeXPart::findPDFBatchFinished()
+{
+    emit setStatusBarText(QString());
+    updateActions();
 }
 
 void KBibTeXPart::applyDefaultFormatString()
@@ -942,25 +1145,65 @@ void KBibTeXPart::applyDefaultFormatString()
     FileModel *model = d->partWidget != nullptr && d->partWidget->fileView() != nullptr ? d->partWidget->fileView()->fileModel() : nullptr;
     if (model == nullptr) return;
 
-    bool documentModified = false;
+    static IdSuggestions idSuggestions;
+    if (!idSuggestions.hasDefaultFormat()) {
+        KMessageBox::information(widget(), i18n("Cannot apply default formatting for entry ids: No default format specified."), i18n("Cannot Apply Default Formatting"));
+        return;
+    }
+
+    QVector<QSharedPointer<Entry> > entries;
+    QVector<QSharedPointer<const Entry> > constEntries;
+    QSet<const Entry *> selectedEntries;
     const QModelIndexList mil = d->partWidget->fileView()->selectionModel()->selectedRows();
+    entries.reserve(mil.count());
+    constEntries.reserve(mil.count());
     for (const QModelIndex &index : mil) {
         QSharedPointer<Entry> entry = model->element(d->partWidget->fileView()->sortFilterProxyModel()->mapToSource(index).row()).dynamicCast<Entry>();
         if (!entry.isNull()) {
-            static IdSuggestions idSuggestions;
-            bool success = idSuggestions.applyDefaultFormatId(*entry.data());
-            documentModified |= success;
-            if (!success) {
-                KMessageBox::information(widget(), i18n("Cannot apply default formatting for entry ids: No default format specified."), i18n("Cannot Apply Default Formatting"));
-                break;
-            }
+            entries.append(entry);
+            constEntries.append(entry);
+            selectedEntries.insert(entry.data());
         }
     }
+    if (entries.isEmpty()) return;
+
+    /// Ids of entries not getting reformatted must not be re-used
+    QSet<QString> existingIds;
+    const File *bibliographyFile = model->bibliographyFile();
+    for (File::ConstIterator it = bibliographyFile->constBegin(); it != bibliographyFile->constEnd(); ++it) {
+        const QSharedPointer<const Entry> entry = (*it).dynamicCast<const Entry>();
+        if (!entry.isNull() && !selectedEntries.contains(entry.data()))
+            existingIds.insert(entry->id());
+    }
+
+    /// Format all ids in one go, then resolve collisions by appending suffixes
+    QStringList ids = idSuggestions.defaultFormatIds(constEntries);
+    IdSuggestions::makeIdsUnique(ids, existingIds);
+
+    bool documentModified = false;
+    model->journal()->beginOperation(i18n("Apply Default Formatting"));
+    for (int i = 0; i < entries.count(); ++i)
+        if (entries[i]->id() != ids[i]) {
+            model->journal()->aboutToModify(entries[i], QStringLiteral("^id"));
+            entries[i]->setId(ids[i]);
+            documentModified = true;
+        }
+    model->journal()->endOperation();
 
     if (documentModified)
         d->partWidget->fileView()->externalModification();
 }
 
+void KBibTeXPart::abbreviateJournalNames()
+{
+    d->normalizeJournalNames(JournalAbbreviations::nfAbbreviation);
+}
+
+void KBibTeXPart::expandJournalNames()
+{
+    d->normalizeJournalNames(JournalAbbreviations::nfFullName);
+}
+
 bool KBibTeXPart::openFile()
 {
     const bool success = d->openFile(url(), localFilePath());
@@ -1064,23 +1307,25 @@ void KBibTeXPart::updateActions()
     if (model == nullptr) return;
 
     bool emptySelection = d->partWidget->fileView()->selectedElements().isEmpty();
+    d->editUndoAction->setEnabled(isReadWrite() && model->journal()->canUndo());
+    d->editRedoAction->setEnabled(isReadWrite() && model->journal()->canRedo());
     d->elementEditAction->setEnabled(!emptySelection);
     d->editCopyAction->setEnabled(!emptySelection);
     d->editCopyReferencesAction->setEnabled(!emptySelection);
     d->editCutAction->setEnabled(!emptySelection && isReadWrite());
     d->editPasteAction->setEnabled(isReadWrite());
     d->editDeleteAction->setEnabled(!emptySelection && isReadWrite());
-    d->elementFindPDFAction->setEnabled(!emptySelection && isReadWrite());
+    const bool findPDFBatchRunning = d->findPDFBatch != nullptr && d->findPDFBatch->isRunning();
+    d->elementFindPDFAction->setEnabled(!emptySelection && isReadWrite() && !findPDFBatchRunning);
+    d->findPDFAllAction->setEnabled(isReadWrite() && !findPDFBatchRunning);
     d->entryApplyDefaultFormatString->setEnabled(!emptySelection && isReadWrite());
+    d->entryAbbreviateJournalsAction->setEnabled(isReadWrite());
+    d->entryExpandJournalsAction->setEnabled(isReadWrite());
     d->colorLabelContextMenu->menuAction()->setEnabled(!emptySelection && isReadWrite());
     d->colorLabelContextMenuAction->setEnabled(!emptySelection && isReadWrite());
 
-    int numDocumentsToView = d->updateViewDocumentMenu();
-    /// enable menu item only if there is at least one document to view
-    d->elementViewDocumentAction->setEnabled(!emptySelection && numDocumentsToView > 0);
-    /// activate sub-menu only if there are at least two documents to view
-    d->elementViewDocumentAction->setMenu(numDocumentsToView > 1 ? d->viewDocumentMenu : nullptr);
-    d->elementViewDocumentAction->setToolTip(numDocumentsToView == 1 ? (*d->viewDocumentMenu->actions().constBegin())->text() : QString());
+    d->resolveViewDocumentUrls();
+    d->updateViewDocumentActions();
 
     /// update list of references which can be sent to LyX
     QStringList references;
@@ -1096,6 +1341,15 @@ void KBibTeXPart::updateActions()
     d->lyx->setReferences(references);
 }
 
+void KBibTeXPart::viewDocumentUrlsResolved(const QSharedPointer<const Entry> &entry, const QSet<QUrl> &urls)
+{
+    /// Results may be for entries requested by other views
+    if (entry.isNull() || entry != d->viewDocumentEntry || urls == d->viewDocumentUrls) return;
+
+    d->viewDocumentUrls = urls;
+    d->updateViewDocumentActions();
+}
+
 void KBibTeXPart::fileExternallyChange(const QString &path)
 {
     /// Should never happen: triggering this slot for non-local or invalid URLs
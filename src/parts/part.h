@@ -19,11 +19,14 @@
 #define KBIBTEX_PART_PART_H
 
 #include <QObject>
+#include <QSet>
+#include <QUrl>
 
 #include <KParts/Part>
 #include <KParts/ReadWritePart>
 #include <KAboutData>
 
+#include "entry.h"
 #include "notificationhub.h"
 #include "partwidget.h"
 
@@ -55,7 +58,10 @@ protected slots:
     void elementViewDocument();
     void elementViewDocumentMenu(QObject *);
     void elementFindPDF();
+    void findPDFsForAllEntries();
     void applyDefaultFormatString();
+    void abbreviateJournalNames();
+    void expandJournalNames();
 
 private slots:
     void newElementTriggered(int event);
@@ -65,7 +71,11 @@ private slots:
     void newPreambleTriggered();
     void newXDataTriggered();
     void updateActions();
+    void viewDocumentUrlsResolved(const QSharedPointer<const Entry> &entry, const QSet<QUrl> &urls);
     void fileExternallyChange(const QString &path);
+    void findPDFBatchProgress(int processed, int total, int attached);
+    void findPDFBatchEntryChanged(QSharedPointer<Entry> entry);
+    void findPDFBatchFinished();
 
 private:
     class KBibTeXPartPrivate;
@@ -21,16 +21,56 @@
 #include <QBuffer>
 #include <QTextStream>
 #include <QRegularExpression>
+#include <QSet>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 
 #include <KLocalizedString>
 #include <KMessageBox>
 
 #include "fileexporterbibtexoutput.h"
+#include "fileexporterbibtex.h"
 #include "file.h"
 #include "entry.h"
 #include "element.h"
 #include "macro.h"
 
+/// Describe a BibTeX warning like "Warning--empty journal in smith2000"
+static QString warningMessage(const QString &line)
+{
+    static const QString warningStart = QStringLiteral("Warning--");
+    static const QRegularExpression warningEmptyField(QStringLiteral("empty (\\w+) in "));
+    static const QRegularExpression warningEmptyField2(QStringLiteral("empty (\\w+) or (\\w+) in "));
+    static const QRegularExpression warningThereIsBut(QStringLiteral("there's a (\\w+) but no (\\w+) in"));
+    static const QRegularExpression warningCantUseBoth(QStringLiteral("can't use both (\\w+) and (\\w+) fields"));
+    static const QRegularExpression warningSort2(QStringLiteral("to sort, need (\\w+) or (\\w+) in "));
+    static const QRegularExpression warningSort3(QStringLiteral("to sort, need (\\w+), (\\w+), or (\\w+) in "));
+
+    QRegularExpressionMatch match;
+    if ((match = warningEmptyField.match(line)).hasMatch()) {
+        /// empty/missing field
+        return i18n("Field <b>%1</b> is empty", match.captured(1));
+    } else if ((match = warningEmptyField2.match(line)).hasMatch()) {
+        /// two empty/missing fields
+        return i18n("Fields <b>%1</b> and <b>%2</b> are empty, but at least one is required", match.captured(1), match.captured(2));
+    } else if ((match = warningThereIsBut.match(line)).hasMatch()) {
+        /// there is a field which exists but another does not exist
+        return i18n("Field <b>%1</b> exists, but <b>%2</b> does not exist", match.captured(1), match.captured(2));
+    } else if ((match = warningCantUseBoth.match(line)).hasMatch()) {
+        /// there are two conflicting fields, only one may be used
+        return i18n("Fields <b>%1</b> and <b>%2</b> cannot be used at the same time", match.captured(1), match.captured(2));
+    } else if ((match = warningSort2.match(line)).hasMatch()) {
+        /// one out of two fields missing for sorting
+        return i18n("Fields <b>%1</b> or <b>%2</b> are required to sort entry", match.captured(1), match.captured(2));
+    } else if ((match = warningSort3.match(line)).hasMatch()) {
+        /// one out of three fields missing for sorting
+        return i18n("Fields <b>%1</b>, <b>%2</b>, <b>%3</b> are required to sort entry", match.captured(1), match.captured(2), match.captured(3));
+    } else {
+        /// generic/unknown warning
+        return i18n("Unknown warning: %1", line.mid(warningStart.length()));
+    }
+}
+
 CheckBibTeX::CheckBibTeXResult CheckBibTeX::checkBibTeX(QSharedPointer<Element> &element, const File *file, QWidget *parent)
 {
     /// only entries are supported, no macros, preambles, ...
@@ -86,13 +126,6 @@ CheckBibTeX::CheckBibTeXResult CheckBibTeX::checkBibTeX(QSharedPointer<Entry> &e
     }
 
     /// define variables how to parse BibTeX's output
-    static const QString warningStart = QStringLiteral("Warning--");
-    static const QRegularExpression warningEmptyField(QStringLiteral("empty (\\w+) in "));
-    static const QRegularExpression warningEmptyField2(QStringLiteral("empty (\\w+) or (\\w+) in "));
-    static const QRegularExpression warningThereIsBut(QStringLiteral("there's a (\\w+) but no (\\w+) in"));
-    static const QRegularExpression warningCantUseBoth(QStringLiteral("can't use both (\\w+) and (\\w+) fields"));
-    static const QRegularExpression warningSort2(QStringLiteral("to sort, need (\\w+) or (\\w+) in "));
-    static const QRegularExpression warningSort3(QStringLiteral("to sort, need (\\w+), (\\w+), or (\\w+) in "));
     static const QRegularExpression errorLine(QStringLiteral("---line (\\d+)"));
 
     /// go line-by-line through BibTeX output and collect warnings/errors
@@ -110,29 +143,7 @@ CheckBibTeX::CheckBibTeXResult CheckBibTeX::checkBibTeX(QSharedPointer<Entry> &e
             }
         } else if (line.startsWith(QStringLiteral("Warning--"))) {
             /// is a warning ...
-
-            if ((match = warningEmptyField.match(line)).hasMatch()) {
-                /// empty/missing field
-                warnings << i18n("Field <b>%1</b> is empty", match.captured(1));
-            } else if ((match = warningEmptyField2.match(line)).hasMatch()) {
-                /// two empty/missing fields
-                warnings << i18n("Fields <b>%1</b> and <b>%2</b> are empty, but at least one is required", match.captured(1), match.captured(2));
-            } else if ((match = warningThereIsBut.match(line)).hasMatch()) {
-                /// there is a field which exists but another does not exist
-                warnings << i18n("Field <b>%1</b> exists, but <b>%2</b> does not exist", match.captured(1), match.captured(2));
-            } else if ((match = warningCantUseBoth.match(line)).hasMatch()) {
-                /// there are two conflicting fields, only one may be used
-                warnings << i18n("Fields <b>%1</b> and <b>%2</b> cannot be used at the same time", match.captured(1), match.captured(2));
-            } else if ((match = warningSort2.match(line)).hasMatch()) {
-                /// one out of two fields missing for sorting
-                warnings << i18n("Fields <b>%1</b> or <b>%2</b> are required to sort entry", match.captured(1), match.captured(2));
-            } else if ((match = warningSort3.match(line)).hasMatch()) {
-                /// one out of three fields missing for sorting
-                warnings << i18n("Fields <b>%1</b>, <b>%2</b>, <b>%3</b> are required to sort entry", match.captured(1), match.captured(2), match.captured(3));
-            } else {
-                /// generic/unknown warning
-                warnings << i18n("Unknown warning: %1", line.mid(warningStart.length()));
-            }
+            warnings << warningMessage(line);
         }
     }
 
@@ -149,3 +160,192 @@ CheckBibTeX::CheckBibTeXResult CheckBibTeX::checkBibTeX(QSharedPointer<Entry> &e
 
     return result;
 }
+
+
+/// Outcome of a batch check, computed in a background thread
+struct CheckBibTeXBatchResult {
+    CheckBibTeX::CheckBibTeXResult result;
+    QVector<CheckBibTeXBatch::Finding> findings;
+    QStringList errorLog;
+};
+
+/**
+ * Run LaTeX and BibTeX once on @p batchFile, which must not be accessed
+ * by any other thread, and collect all problems BibTeX reports for
+ * the entries in @p checkedIds. Both exporters must have been created
+ * in the main thread and must not be used by any other thread meanwhile.
+ */
+static CheckBibTeXBatchResult runBatchCheck(FileExporterBibTeX *bibtexExporter, FileExporterBibTeXOutput *exporter, QSharedPointer<File> batchFile, const QSet<QString> &checkedIds)
+{
+    CheckBibTeXBatchResult batchResult;
+    batchResult.result = CheckBibTeX::FailedToCheck;
+
+    /// Serialize the file the same way as FileExporterBibTeXOutput does
+    /// to find out which entry line numbers in BibTeX's errors refer to
+    QBuffer bibBuffer;
+    bibBuffer.open(QIODevice::WriteOnly);
+    if (!bibtexExporter->save(&bibBuffer, batchFile.data(), &batchResult.errorLog))
+        return batchResult;
+    bibBuffer.close();
+
+    /// Single run of the toolchain for all entries
+    QByteArray logData;
+    QBuffer logBuffer(&logData);
+    logBuffer.open(QIODevice::WriteOnly);
+    if (!exporter->save(&logBuffer, batchFile.data(), &batchResult.errorLog))
+        return batchResult;
+    batchResult.errorLog.clear();
+
+    batchResult.findings = CheckBibTeXBatch::findingsFromLog(QString::fromUtf8(bibBuffer.data()), QString::fromUtf8(logData), checkedIds);
+    batchResult.result = CheckBibTeX::NoProblem;
+    for (const CheckBibTeXBatch::Finding &finding : const_cast<const QVector<CheckBibTeXBatch::Finding> &>(batchResult.findings)) {
+        batchResult.result = finding.severity;
+        if (finding.severity == CheckBibTeX::BibTeXError) break;
+    }
+
+    return batchResult;
+}
+
+class CheckBibTeXBatch::Private
+{
+public:
+    QFutureWatcher<CheckBibTeXBatchResult> watcher;
+    CheckBibTeXBatchResult lastResult;
+    /// Exporters get created here in the main thread and are used by
+    /// one background check at a time, see CheckBibTeXBatch::start
+    FileExporterBibTeX *bibtexExporter;
+    FileExporterBibTeXOutput *exporter;
+
+    explicit Private(CheckBibTeXBatch *parent)
+            : bibtexExporter(new FileExporterBibTeX(parent)), exporter(new FileExporterBibTeXOutput(FileExporterBibTeXOutput::BibTeXLogFile, parent)) {
+        lastResult.result = CheckBibTeX::NoProblem;
+        bibtexExporter->setEncoding(QStringLiteral("utf-8"));
+    }
+};
+
+CheckBibTeXBatch::CheckBibTeXBatch(QObject *parent)
+        : QObject(parent), d(new Private(this))
+{
+    connect(&d->watcher, &QFutureWatcher<CheckBibTeXBatchResult>::finished, this, &CheckBibTeXBatch::checkFinished);
+}
+
+CheckBibTeXBatch::~CheckBibTeXBatch()
+{
+    /// The toolchain's processes cannot be interrupted,
+    /// but they must not outlive the objects they report to
+    d->watcher.waitForFinished();
+    delete d;
+}
+
+void CheckBibTeXBatch::start(const QList<QSharedPointer<Entry> > &entries, const File *file)
+{
+    if (isRunning()) return;
+
+    /// Copy everything the check needs, as the bibliography may
+    /// be modified while the check is running in the background
+    QSharedPointer<File> batchFile(new File());
+    QSet<QString> checkedIds;
+    for (const QSharedPointer<Entry> &entry : entries) {
+        batchFile->append(QSharedPointer<Entry>(new Entry(*entry)));
+        checkedIds.insert(entry->id());
+    }
+
+    if (file != nullptr) {
+        /// Add crossref'ed entries not checked themselves, each once
+        QSet<QString> crossRefIds;
+        for (const QSharedPointer<Entry> &entry : entries) {
+            const QString crossRef = PlainTextValue::text(entry->value(Entry::ftCrossRef));
+            if (crossRef.isEmpty() || checkedIds.contains(crossRef) || crossRefIds.contains(crossRef)) continue;
+            const QSharedPointer<const Entry> crossRefEntry = file->containsKey(crossRef, File::etEntry).dynamicCast<const Entry>();
+            if (!crossRefEntry.isNull()) {
+                batchFile->append(QSharedPointer<Entry>(new Entry(*crossRefEntry)));
+                crossRefIds.insert(crossRef);
+            }
+        }
+
+        /// Include all macro definitions, in case they are referenced
+        for (const QSharedPointer<Element> &element : *file) {
+            const QSharedPointer<const Macro> macro = element.dynamicCast<const Macro>();
+            if (!macro.isNull())
+                batchFile->append(QSharedPointer<Macro>(new Macro(*macro)));
+        }
+    }
+
+    d->watcher.setFuture(QtConcurrent::run(runBatchCheck, d->bibtexExporter, d->exporter, batchFile, checkedIds));
+}
+
+bool CheckBibTeXBatch::isRunning() const
+{
+    return d->watcher.isRunning();
+}
+
+CheckBibTeX::CheckBibTeXResult CheckBibTeXBatch::result() const
+{
+    return d->lastResult.result;
+}
+
+QVector<CheckBibTeXBatch::Finding> CheckBibTeXBatch::findings() const
+{
+    return d->lastResult.findings;
+}
+
+QStringList CheckBibTeXBatch::errorLog() const
+{
+    return d->lastResult.errorLog;
+}
+
+QVector<CheckBibTeXBatch::Finding> CheckBibTeXBatch::findingsFromLog(const QString &bibText, const QString &blgText, const QSet<QString> &checkedIds)
+{
+    static const QRegularExpression elementStart(QStringLiteral("^\\s*@(\\w+)\\s*[{(]\\s*([^,\\s]*)"));
+    const QStringList bibLines = bibText.split(QLatin1Char('\n'));
+    QVector<QString> idForLine;
+    idForLine.reserve(bibLines.count());
+    QString currentId;
+    for (const QString &line : bibLines) {
+        const QRegularExpressionMatch match = elementStart.match(line);
+        if (match.hasMatch()) {
+            const QString type = match.captured(1).toLower();
+            /// Lines of macros, preambles, and comments do not belong to any entry
+            currentId = type == QStringLiteral("string") || type == QStringLiteral("preamble") || type == QStringLiteral("comment") ? QString() : match.captured(2);
+        }
+        idForLine.append(currentId);
+    }
+
+    static const QRegularExpression errorLine(QStringLiteral("^(.*)---line (\\d+) of file"));
+    static const QRegularExpression warningEntryId(QStringLiteral("\\bin (\\S+)$"));
+    static const QRegularExpression warningMissingEntry(QStringLiteral("database entry for \"([^\"]+)\""));
+
+    QVector<Finding> findings;
+    const QStringList logLines = blgText.split(QLatin1Char('\n'));
+    for (const QString &line : logLines) {
+        Finding finding;
+        QRegularExpressionMatch match;
+        if ((match = errorLine.match(line)).hasMatch()) {
+            bool ok = false;
+            const int lineNumber = match.captured(2).toInt(&ok);
+            finding.id = ok && lineNumber > 0 && lineNumber <= idForLine.count() ? idForLine[lineNumber - 1] : QString();
+            finding.severity = CheckBibTeX::BibTeXError;
+            finding.message = match.captured(1).trimmed();
+        } else if (line.startsWith(QStringLiteral("Warning--"))) {
+            if ((match = warningMissingEntry.match(line)).hasMatch() || (match = warningEntryId.match(line)).hasMatch())
+                finding.id = match.captured(1);
+            finding.severity = CheckBibTeX::BibTeXWarning;
+            finding.message = warningMessage(line);
+        } else
+            continue;
+
+        /// Skip problems of crossref'ed entries which were not to be checked
+        if (!finding.id.isEmpty() && !checkedIds.contains(finding.id))
+            continue;
+
+        findings.append(finding);
+    }
+
+    return findings;
+}
+
+void CheckBibTeXBatch::checkFinished()
+{
+    d->lastResult = d->watcher.result();
+    emit finished();
+}
@@ -18,7 +18,11 @@
 #ifndef KBIBTEX_PROC_CHECKBIBTEX_H
 #define KBIBTEX_PROC_CHECKBIBTEX_H
 
+#include <QObject>
 #include <QSharedPointer>
+#include <QVector>
+#include <QStringList>
+#include <QSet>
 
 #include "kbibtexproc_export.h"
 
@@ -38,4 +42,60 @@ public:
     static CheckBibTeXResult checkBibTeX(QSharedPointer<Entry> &entry, const File *file, QWidget *parent);
 };
 
+/**
+ * Checks many entries with a single run of LaTeX and BibTeX in the
+ * background, mapping each warning or error in BibTeX's log back to
+ * the entry it refers to.
+ *
+ * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
+ */
+class KBIBTEXPROC_EXPORT CheckBibTeXBatch : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Finding {
+        /// Id of the entry the problem was reported for, empty if unknown
+        QString id;
+        /// Either CheckBibTeX::BibTeXWarning or CheckBibTeX::BibTeXError
+        CheckBibTeX::CheckBibTeXResult severity;
+        QString message;
+    };
+
+    explicit CheckBibTeXBatch(QObject *parent);
+    ~CheckBibTeXBatch() override;
+
+    /**
+     * Start checking @p entries, with macros and crossref'ed entries taken
+     * from @p file. The entries get copied, so they may be modified while
+     * the check is running. Has no effect if a check is running already.
+     */
+    void start(const QList<QSharedPointer<Entry> > &entries, const File *file);
+    bool isRunning() const;
+
+    /// Result of the last check, FailedToCheck if LaTeX or BibTeX failed
+    CheckBibTeX::CheckBibTeXResult result() const;
+    /// Problems found in the last check, ordered as in BibTeX's log
+    QVector<Finding> findings() const;
+    /// Output of the toolchain if the last check failed
+    QStringList errorLog() const;
+
+    /**
+     * Map the warnings and errors in BibTeX's log @p blgText back to the
+     * entries in @p bibText, the BibTeX source BibTeX was run on. Problems
+     * of entries whose id is not in @p checkedIds get skipped.
+     */
+    static QVector<Finding> findingsFromLog(const QString &bibText, const QString &blgText, const QSet<QString> &checkedIds);
+
+signals:
+    void finished();
+
+private slots:
+    void checkFinished();
+
+private:
+    class Private;
+    Private *const d;
+};
+
 #endif // KBIBTEX_PROC_CHECKBIBTEX_H
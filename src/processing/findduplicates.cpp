@@ -29,6 +29,7 @@
 
 #include "file.h"
 #include "models/filemodel.h"
+#include "models/undojournal.h"
 #include "entry.h"
 
 EntryClique::EntryClique()
@@ -482,6 +483,12 @@ MergeDuplicates::MergeDuplicates()
 bool MergeDuplicates::mergeDuplicateEntries(const QVector<EntryClique *> &entryCliques, FileModel *fileModel)
 {
     bool didMerge = false;
+    /// Collect all changes to the model to apply them in bulk: each merged
+    /// entry replaces the first of its clique's entries, the remaining
+    /// entries get removed
+    QMap<int, QSharedPointer<Element> > replacements;
+    QList<int> removals;
+    QList<QSharedPointer<Element> > appendices;
 
     for (EntryClique *entryClique : entryCliques) {
         /// Avoid adding fields 20 lines below
@@ -530,18 +537,32 @@ bool MergeDuplicates::mergeDuplicateEntries(const QVector<EntryClique *> &entryC
                         coveredFields << it.key();
                     }
                 const int row = fileModel->row(entry);
+                if (row < 0) continue;
                 if (preferredInsertionRow < 0) preferredInsertionRow = row;
-                fileModel->removeRow(row);
+                else removals << row;
             }
         }
 
         if (actuallyMerged) {
-            if (preferredInsertionRow < 0) preferredInsertionRow = fileModel->rowCount();
-            fileModel->insertRow(QSharedPointer<Entry>(mergedEntry), preferredInsertionRow);
+            if (preferredInsertionRow < 0)
+                appendices << QSharedPointer<Entry>(mergedEntry);
+            else
+                replacements.insert(preferredInsertionRow, QSharedPointer<Entry>(mergedEntry));
         } else
             delete mergedEntry;
         didMerge |= actuallyMerged;
     }
 
+    /// Replace first, as removing rows shifts the rows below;
+    /// all changes get undone together
+    fileModel->journal()->beginOperation(i18n("Merge Duplicates"));
+    if (!replacements.isEmpty())
+        fileModel->replaceElements(replacements);
+    if (!removals.isEmpty())
+        fileModel->removeRowList(removals);
+    if (!appendices.isEmpty())
+        fileModel->insertElements(appendices, fileModel->rowCount());
+    fileModel->journal()->endOperation();
+
     return didMerge;
 }
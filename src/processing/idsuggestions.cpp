@@ -18,6 +18,9 @@
 #include "idsuggestions.h"
 
 #include <QRegularExpression>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include <KSharedConfig>
 #include <KConfigGroup>
@@ -26,22 +29,125 @@
 #include "journalabbreviations.h"
 #include "encoderlatex.h"
 
+/// Minimum number of entries for which ids get formatted in parallel
+static const int minEntriesForParallelFormatting = 256;
+
 class IdSuggestions::IdSuggestionsPrivate
 {
 private:
     IdSuggestions *p;
     KSharedConfigPtr config;
     const KConfigGroup group;
-    static const QStringList smallWords;
+    static const QSet<QString> smallWords;
 
 public:
+    /// Single token of a format string like 'A2' or 'T', parsed once
+    /// and then evaluated for any number of entries
+    struct CompiledToken {
+        char type;
+        struct IdSuggestionTokenInfo info;
+        QString text;
+
+        /// Tokens like 'y' or 'v' do not set any information,
+        /// so have it initialized for all tokens
+        CompiledToken()
+                : type('\0'), info() {
+            /// nothing
+        }
+    };
+
+    /**
+     * Words and names of a single entry as required to evaluate tokens.
+     * Each list gets normalized only once when first needed and is then
+     * shared by all tokens and format strings evaluated for this entry.
+     */
+    class EntryWords
+    {
+    public:
+        const Entry &entry;
+
+        explicit EntryWords(const Entry &_entry)
+                : entry(_entry), hasTitleWords(false), hasAuthors(false), hasJournalWords(false) {
+            /// nothing
+        }
+
+        /// Title words, normalized and in lower case
+        const QStringList &titleWords() {
+            if (!hasTitleWords) {
+                static const QRegularExpression sequenceOfSpaces(QStringLiteral("\\s+"));
+                const QStringList words = PlainTextValue::text(entry.value(Entry::ftTitle)).split(sequenceOfSpaces, QString::SkipEmptyParts);
+                titleWordList.reserve(words.count());
+                for (const QString &word : words)
+                    titleWordList.append(normalizeText(word).toLower());
+                hasTitleWords = true;
+            }
+            return titleWordList;
+        }
+
+        /// Authors' last names, normalized
+        const QStringList &authors() {
+            if (!hasAuthors) {
+                const QStringList lastNames = entry.authorsLastName();
+                authorList.reserve(lastNames.count());
+                for (const QString &lastName : lastNames)
+                    authorList.append(normalizeText(lastName));
+                hasAuthors = true;
+            }
+            return authorList;
+        }
+
+        /// Words of the journal's abbreviated name, normalized
+        const QStringList &journalWords() {
+            if (!hasJournalWords) {
+                static const QRegularExpression sequenceOfSpaces(QStringLiteral("\\s+"));
+                const QString journalShortName = JournalAbbreviations::self()->toShortName(PlainTextValue::text(entry.value(Entry::ftJournal)));
+                const QStringList words = journalShortName.split(sequenceOfSpaces, QString::SkipEmptyParts);
+                journalWordList.reserve(words.count());
+                for (const QString &word : words)
+                    journalWordList.append(normalizeText(word));
+                hasJournalWords = true;
+            }
+            return journalWordList;
+        }
+
+    private:
+        bool hasTitleWords, hasAuthors, hasJournalWords;
+        QStringList titleWordList, authorList, journalWordList;
+    };
 
+    /// Formats the id of one entry after another, used with QtConcurrent
+    class BulkFormatter
+    {
+    public:
+        typedef QString result_type;
+
+        BulkFormatter(const IdSuggestionsPrivate *_d, const QVector<CompiledToken> &_program)
+                : d(_d), program(_program) {
+            /// nothing
+        }
+
+        QString operator()(const QSharedPointer<const Entry> &entry) const {
+            EntryWords words(*entry);
+            return d->evaluate(words, program);
+        }
+
+    private:
+        const IdSuggestionsPrivate *d;
+        const QVector<CompiledToken> &program;
+    };
+
+private:
+    /// Format strings compiled so far, see @see program
+    mutable QHash<QString, QVector<CompiledToken> > programCache;
+    mutable QMutex programCacheMutex;
+
+public:
     IdSuggestionsPrivate(IdSuggestions *parent)
             : p(parent), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), group(config, IdSuggestions::configGroupName) {
         /// nothing
     }
 
-    QString normalizeText(const QString &input) const {
+    static QString normalizeText(const QString &input) {
         static const QRegularExpression unwantedChars(QStringLiteral("[^-_:/=+a-zA-Z0-9]+"));
         return EncoderLaTeX::instance().convertToPlainAscii(input).remove(unwantedChars);
     }
@@ -66,14 +172,13 @@ public:
         return match.captured(0);
     }
 
-    QString translateTitleToken(const Entry &entry, const struct IdSuggestionTokenInfo &tti, bool removeSmallWords) const {
+    QString translateTitleToken(EntryWords &words, const struct IdSuggestionTokenInfo &tti, bool removeSmallWords) const {
         QString result;
         bool first = true;
-        static const QRegularExpression sequenceOfSpaces(QStringLiteral("\\s+"));
-        const QStringList titleWords = PlainTextValue::text(entry.value(Entry::ftTitle)).split(sequenceOfSpaces, QString::SkipEmptyParts);
+        const QStringList &titleWords = words.titleWords();
         int index = 0;
         for (QStringList::ConstIterator it = titleWords.begin(); it != titleWords.end(); ++it, ++index) {
-            const QString lowerText = normalizeText(*it).toLower();
+            const QString &lowerText = *it;
             if ((removeSmallWords && smallWords.contains(lowerText)) || index < tti.startWord || index > tti.endWord)
                 continue;
 
@@ -106,18 +211,18 @@ public:
         return result;
     }
 
-    QString translateAuthorsToken(const Entry &entry, const struct IdSuggestionTokenInfo &ati) const {
+    QString translateAuthorsToken(EntryWords &words, const struct IdSuggestionTokenInfo &ati) const {
         QString result;
         /// Already some author inserted into result?
         bool firstInserted = false;
-        /// Get list of authors' last names
-        const QStringList authors = entry.authorsLastName();
+        /// Get list of authors' last names, already normalized (unwanted characters removed)
+        const QStringList &authors = words.authors();
         /// Keep track of which author (number/position) is processed
         int index = 0;
         /// Go through all authors
         for (QStringList::ConstIterator it = authors.constBegin(); it != authors.constEnd(); ++it, ++index) {
-            /// Get current author, normalize name (remove unwanted characters), cut to maximum length
-            QString author = normalizeText(*it).left(ati.len);
+            /// Get current author, cut to maximum length
+            QString author = it->left(ati.len);
             /// Check if camel case is requests
             if (ati.caseChange == IdSuggestions::ccToCamelCase) {
                 /// Get components of the author's last name
@@ -160,16 +265,13 @@ public:
         return result;
     }
 
-    QString translateJournalToken(const Entry &entry, const struct IdSuggestionTokenInfo &jti, bool removeSmallWords) const {
-        static const QRegularExpression sequenceOfSpaces(QStringLiteral("\\s+"));
-        QString journalName = PlainTextValue::text(entry.value(Entry::ftJournal));
-        journalName = JournalAbbreviations::self()->toShortName(journalName);
-        const QStringList journalWords = journalName.split(sequenceOfSpaces, QString::SkipEmptyParts);
+    QString translateJournalToken(EntryWords &words, const struct IdSuggestionTokenInfo &jti, bool removeSmallWords) const {
+        const QStringList &journalWords = words.journalWords();
         bool first = true;
         int index = 0;
         QString result;
         for (QStringList::ConstIterator it = journalWords.begin(); it != journalWords.end(); ++it, ++index) {
-            QString journalComponent = normalizeText(*it);
+            QString journalComponent = *it;
             const QString lowerText = journalComponent.toLower();
             if ((removeSmallWords && smallWords.contains(lowerText)) || index < jti.startWord || index > jti.endWord)
                 continue;
@@ -232,70 +334,103 @@ public:
         }
     }
 
-    QString translateToken(const Entry &entry, const QString &token) const {
-        switch (token[0].toLatin1()) {
+    /// Parse a single token of a format string
+    CompiledToken compileToken(const QString &token) const {
+        CompiledToken result;
+        result.type = token[0].toLatin1();
+        switch (result.type) {
         case 'a': ///< deprecated but still supported case
-        {
-            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo ati
-            struct IdSuggestionTokenInfo ati = p->evalToken(token.mid(1));
-            ati.startWord = ati.endWord = 0; ///< only first author
-            return translateAuthorsToken(entry, ati);
-        }
-        case 'A': {
-            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo ati
-            const struct IdSuggestionTokenInfo ati = p->evalToken(token.mid(1));
-            return translateAuthorsToken(entry, ati);
-        }
+            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo
+            result.info = p->evalToken(token.mid(1));
+            result.info.startWord = result.info.endWord = 0; ///< only first author
+            break;
         case 'z': ///< deprecated but still supported case
-        {
-            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo ati
-            struct IdSuggestionTokenInfo ati = p->evalToken(token.mid(1));
+            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo
+            result.info = p->evalToken(token.mid(1));
             /// All but first author
-            ati.startWord = 1;
-            ati.endWord = 0x00ffffff;
-            return translateAuthorsToken(entry, ati);
+            result.info.startWord = 1;
+            result.info.endWord = 0x00ffffff;
+            break;
+        case 'A':
+        case 't':
+        case 'T':
+        case 'j':
+        case 'J':
+        case 'e':
+            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo
+            result.info = p->evalToken(token.mid(1));
+            break;
+        case '"':
+            result.text = token.mid(1);
+            break;
         }
+        return result;
+    }
+
+    /**
+     * Get the compiled program for a format string, i.e. the sequence
+     * of its parsed tokens. Format strings get compiled only once.
+     */
+    QVector<CompiledToken> program(const QString &formatStr) const {
+        QMutexLocker locker(&programCacheMutex);
+        const auto it = programCache.constFind(formatStr);
+        if (it != programCache.constEnd())
+            return *it;
+
+        QVector<CompiledToken> result;
+        const QStringList tokenList = formatStr.split(QStringLiteral("|"), QString::SkipEmptyParts);
+        result.reserve(tokenList.count());
+        for (const QString &token : tokenList)
+            result.append(compileToken(token));
+        programCache.insert(formatStr, result);
+        return result;
+    }
+
+    QString translateToken(EntryWords &words, const CompiledToken &token) const {
+        switch (token.type) {
+        case 'a':
+        case 'A':
+        case 'z':
+            return translateAuthorsToken(words, token.info);
         case 'y': {
-            int year = numberFromEntry(entry, Entry::ftYear);
+            int year = numberFromEntry(words.entry, Entry::ftYear);
             if (year > -1)
                 return QString::number(year % 100 + 100).mid(1);
             break;
         }
         case 'Y': {
-            const int year = numberFromEntry(entry, Entry::ftYear);
+            const int year = numberFromEntry(words.entry, Entry::ftYear);
             if (year > -1)
                 return QString::number(year % 10000 + 10000).mid(1);
             break;
         }
         case 't':
-        case 'T': {
-            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo jti
-            const struct IdSuggestionTokenInfo tti = p->evalToken(token.mid(1));
-            return translateTitleToken(entry, tti, token[0].isUpper());
-        }
+        case 'T':
+            return translateTitleToken(words, token.info, token.type == 'T');
         case 'j':
-        case 'J': {
-            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo jti
-            const struct IdSuggestionTokenInfo jti = p->evalToken(token.mid(1));
-            return translateJournalToken(entry, jti, token[0].isUpper());
-        }
-        case 'e': {
-            /// Evaluate the token string, store information in struct IdSuggestionTokenInfo eti
-            const struct IdSuggestionTokenInfo eti = p->evalToken(token.mid(1));
-            return translateTypeToken(entry, eti);
-        }
+        case 'J':
+            return translateJournalToken(words, token.info, token.type == 'J');
+        case 'e':
+            return translateTypeToken(words.entry, token.info);
         case 'v': {
-            return normalizeText(PlainTextValue::text(entry.value(Entry::ftVolume)));
+            return normalizeText(PlainTextValue::text(words.entry.value(Entry::ftVolume)));
         }
         case 'p': {
-            return pageNumberFromEntry(entry);
+            return pageNumberFromEntry(words.entry);
         }
-        case '"': return token.mid(1);
+        case '"': return token.text;
         }
 
         return QString();
     }
 
+    QString evaluate(EntryWords &words, const QVector<CompiledToken> &program) const {
+        QString id;
+        for (const CompiledToken &token : program)
+            id.append(translateToken(words, token));
+        return id;
+    }
+
     QString defaultFormatString() const {
         return group.readEntry(keyDefaultFormatString, defaultDefaultFormatString);
     }
@@ -307,7 +442,7 @@ public:
 
 /// List of small words taken from OCLC:
 /// https://www.oclc.org/developer/develop/web-services/worldcat-search-api/bibliographic-resource.en.html
-const QStringList IdSuggestions::IdSuggestionsPrivate::smallWords = i18nc("Small words that can be removed from titles when generating id suggestions; separated by pipe symbol", "a|als|am|an|are|as|at|auf|aus|be|but|by|das|dass|de|der|des|dich|dir|du|er|es|for|from|had|have|he|her|his|how|ihr|ihre|ihres|im|in|is|ist|it|kein|la|le|les|mein|mich|mir|mit|of|on|sein|sie|that|the|this|to|un|une|von|was|wer|which|wie|wird|with|yousie|that|the|this|to|un|une|von|was|wer|which|wie|wird|with|you").split(QStringLiteral("|"), QString::SkipEmptyParts);
+const QSet<QString> IdSuggestions::IdSuggestionsPrivate::smallWords = i18nc("Small words that can be removed from titles when generating id suggestions; separated by pipe symbol", "a|als|am|an|are|as|at|auf|aus|be|but|by|das|dass|de|der|des|dich|dir|du|er|es|for|from|had|have|he|her|his|how|ihr|ihre|ihres|im|in|is|ist|it|kein|la|le|les|mein|mich|mir|mit|of|on|sein|sie|that|the|this|to|un|une|von|was|wer|which|wie|wird|with|yousie|that|the|this|to|un|une|von|was|wer|which|wie|wird|with|you").split(QStringLiteral("|"), QString::SkipEmptyParts).toSet();
 
 
 const QString IdSuggestions::keyDefaultFormatString = QStringLiteral("DefaultFormatString");
@@ -329,13 +464,47 @@ IdSuggestions::~IdSuggestions()
 
 QString IdSuggestions::formatId(const Entry &entry, const QString &formatStr) const
 {
-    QString id;
-    const QStringList tokenList = formatStr.split(QStringLiteral("|"), QString::SkipEmptyParts);
-    for (const QString &token : tokenList) {
-        id.append(d->translateToken(entry, token));
+    IdSuggestionsPrivate::EntryWords words(entry);
+    return d->evaluate(words, d->program(formatStr));
+}
+
+QStringList IdSuggestions::formatIds(const QVector<QSharedPointer<const Entry> > &entries, const QString &formatStr) const
+{
+    const QVector<IdSuggestionsPrivate::CompiledToken> program = d->program(formatStr);
+    const IdSuggestionsPrivate::BulkFormatter formatter(d, program);
+    QStringList result;
+    result.reserve(entries.count());
+    if (entries.count() < minEntriesForParallelFormatting || QThread::idealThreadCount() < 2) {
+        for (const QSharedPointer<const Entry> &entry : entries)
+            result.append(formatter(entry));
+    } else {
+        /// Singletons get created before worker threads start using them
+        EncoderLaTeX::instance();
+        JournalAbbreviations::self();
+        const QVector<QString> ids = QtConcurrent::blockingMapped<QVector<QString> >(entries, formatter);
+        for (const QString &id : ids)
+            result.append(id);
     }
 
-    return id;
+    return result;
+}
+
+void IdSuggestions::makeIdsUnique(QStringList &ids, QSet<QString> &existingIds)
+{
+    for (QStringList::Iterator it = ids.begin(); it != ids.end(); ++it) {
+        if (existingIds.contains(*it)) {
+            /// Append suffixes 'a' to 'z', then 'aa', 'ab', ... until the id is unique
+            QString candidate;
+            for (int n = 0; candidate.isEmpty() || existingIds.contains(candidate); ++n) {
+                QString suffix;
+                for (int i = n; i >= 0; i = i / 26 - 1)
+                    suffix.prepend(QChar(QLatin1Char('a').unicode() + i % 26));
+                candidate = *it + suffix;
+            }
+            *it = candidate;
+        }
+        existingIds.insert(*it);
+    }
 }
 
 QString IdSuggestions::defaultFormatId(const Entry &entry) const
@@ -343,6 +512,11 @@ QString IdSuggestions::defaultFormatId(const Entry &entry) const
     return formatId(entry, d->defaultFormatString());
 }
 
+QStringList IdSuggestions::defaultFormatIds(const QVector<QSharedPointer<const Entry> > &entries) const
+{
+    return formatIds(entries, d->defaultFormatString());
+}
+
 bool IdSuggestions::hasDefaultFormat() const
 {
     return !d->defaultFormatString().isEmpty();
@@ -361,10 +535,12 @@ bool IdSuggestions::applyDefaultFormatId(Entry &entry) const
 QStringList IdSuggestions::formatIdList(const Entry &entry) const
 {
     const QStringList formatStrings = d->formatStringList();
+    /// All format strings share the entry's normalized words
+    IdSuggestionsPrivate::EntryWords words(entry);
     QStringList result;
     result.reserve(formatStrings.size());
     for (const QString &formatString : formatStrings) {
-        result << formatId(entry, formatString);
+        result << d->evaluate(words, d->program(formatString));
     }
     return result;
 }
@@ -18,6 +18,10 @@
 #ifndef KBIBTEX_PROC_IDSUGGESTIONS_H
 #define KBIBTEX_PROC_IDSUGGESTIONS_H
 
+#include <QSet>
+#include <QVector>
+#include <QSharedPointer>
+
 #include "kbibtexproc_export.h"
 
 #include "entry.h"
@@ -50,7 +54,33 @@ public:
     ~IdSuggestions();
 
     QString formatId(const Entry &entry, const QString &formatStr) const;
+
+    /**
+     * Format ids for many entries at once. The result is the same as
+     * calling @see formatId for each entry, but the format string gets
+     * parsed only once and large numbers of entries get processed in
+     * parallel.
+     *
+     * @param entries entries to format ids for
+     * @param formatStr format string to apply
+     * @return formatted ids in the same order as the entries
+     */
+    QStringList formatIds(const QVector<QSharedPointer<const Entry> > &entries, const QString &formatStr) const;
+
+    /**
+     * Make ids unique with respect to already existing ids and to
+     * each other. Ids are processed in order; an id that is already
+     * taken gets the first free suffix of 'a', 'b', ..., 'z', 'aa',
+     * 'ab', and so on appended. Each resulting id is added to
+     * @p existingIds, so the outcome is deterministic for any given
+     * order of ids.
+     *
+     * @param ids ids to make unique, modified in place
+     * @param existingIds ids already in use
+     */
+    static void makeIdsUnique(QStringList &ids, QSet<QString> &existingIds);
     QString defaultFormatId(const Entry &entry) const;
+    QStringList defaultFormatIds(const QVector<QSharedPointer<const Entry> > &entries) const;
     bool hasDefaultFormat() const;
 
     /**
@@ -15,95 +15,456 @@
  *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
  ***************************************************************************/
 
+
 #include "journalabbreviations.h"
 
+#include <algorithm>
+
 #include <QHash>
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
 #include <QTextStream>
 #include <QRegularExpression>
 #include <QStandardPaths>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include "entry.h"
+#include "value.h"
 
 #include "logging_processing.h"
 
+/// Minimum number of distinct journal names for which names get resolved in parallel
+static const int minNamesForParallelResolution = 64;
+
+/// Identifies an index file and the byte order it was written in
+static const quint32 indexMagic = 0x4b424a41;
+/// To be increased whenever the index file's layout or the normalization of keys changes
+static const quint32 indexVersion = 2;
+
+/**
+ * Layout of an index file: a header, followed by two tables of records
+ * sorted by key, followed by the UTF-8 encoded strings the records refer to.
+ * All offsets are relative to the start of the file.
+ */
+struct IndexHeader {
+    quint32 magic;
+    quint32 version;
+    /// Modification time (ms since epoch) and size of the text file this index was built from
+    qint64 sourceLastModified;
+    qint64 sourceSize;
+    quint32 sourcePathOffset, sourcePathLength;
+    /// Table mapping normalized full names to abbreviations
+    quint32 longToShortOffset, longToShortCount;
+    /// Table mapping normalized abbreviations to full names
+    quint32 shortToLongOffset, shortToLongCount;
+};
+
+struct IndexRecord {
+    /// Normalized name used for lookups
+    quint32 keyOffset, keyLength;
+    /// Name as it appears in the text file
+    quint32 nameOffset, nameLength;
+    /// Name to translate to
+    quint32 valueOffset, valueLength;
+    /// Combination of RecordFlag values
+    quint32 flags;
+};
+
+enum RecordFlag {
+    /// The same key was found with different translations, e.g. an
+    /// abbreviation shared by several journals; value is the last one
+    rfAmbiguous = 1
+};
+
 class JournalAbbreviations::Private
 {
 private:
     const QString journalFilename;
+    const QString indexFilename;
+
+    QMutex loadMutex;
+    /// Set once the index is available, so that lookups need no locking afterwards
+    QAtomicInt loaded;
+    /// Index file mapped into memory or, if it could not be written, the index kept in memory
+    QFile indexFile;
+    QByteArray indexBuffer;
+    const uchar *indexData;
+    qint64 indexSize;
+    IndexHeader header;
+
+    struct Mapping {
+        QString name, value;
+        bool ambiguous;
+    };
+
+    static void appendString(QByteArray &strings, quint32 stringsOffset, const QByteArray &text, quint32 &offset, quint32 &length) {
+        offset = stringsOffset + static_cast<quint32>(strings.length());
+        length = static_cast<quint32>(text.length());
+        strings.append(text);
+    }
+
+    /**
+     * Parse the text file and serialize its mappings into the index layout.
+     */
+    QByteArray buildIndex(const QFileInfo &sourceInfo) const {
+        /// Mappings by normalized key, built like the former in-memory maps
+        QHash<QByteArray, Mapping> longToShort, shortToLong;
+
+        QFile journalFile(journalFilename);
+        if (!journalFile.open(QFile::ReadOnly)) {
+            qCWarning(LOG_KBIBTEX_PROCESSING) << "Cannot open journal abbreviation list file at" << journalFilename;
+            return QByteArray();
+        }
+
+        static const QRegularExpression splitRegExp(QStringLiteral("\\s*[=;]\\s*"));
+
+        QTextStream ts(&journalFile);
+        ts.setCodec("utf8");
+
+        QString line;
+        while (!(line = ts.readLine().trimmed()).isNull()) {
+            /// Skip empty lines or comments
+            if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) continue;
+            const QStringList columns = line.split(splitRegExp);
+            /// Skip lines that do not have at least two columns
+            if (columns.count() < 2) continue;
+            /// At this point, a given line like
+            ///    Accounts of Chemical Research=Acc. Chem. Res.;ACHRE4;M
+            /// may have been split into the columns of
+            ///    Accounts of Chemical Research
+            ///    Acc. Chem. Res.
+            ///    ACHRE4
+            ///    M
+            /// The last two columns are optional and are not processed here.
+            /// The first column is the journal's full name, the second column
+            /// is its abbreviation.
+
+            const QByteArray longKey = normalizedKey(columns[0]);
+            const QByteArray shortKey = normalizedKey(columns[1]);
+            if (longKey.isEmpty() || shortKey.isEmpty()) continue;
+
+            const auto it = longToShort.constFind(longKey);
+            /// If there is already a mapping from this full name to an
+            /// abbreviation, replace it only if the new abbreviation is shorter
+            if (it == longToShort.constEnd() || it->value.length() > columns[1].length())
+                longToShort.insert(longKey, Mapping {columns[0], columns[1], false});
+            /// Always add/replace mapping from abbreviation to full name,
+            /// but remember if the abbreviation is used for different journals
+            const auto shortIt = shortToLong.constFind(shortKey);
+            const bool ambiguous = shortIt != shortToLong.constEnd() && (shortIt->ambiguous || normalizedKey(shortIt->value) != longKey);
+            shortToLong.insert(shortKey, Mapping {columns[1], columns[0], ambiguous});
+        }
+        journalFile.close();
 
-    QHash<QString, QString> leftToRightMap, rightToLeftMap;
+        if (longToShort.isEmpty())
+            return QByteArray();
+
+        QByteArray strings;
+        IndexHeader newHeader;
+        newHeader.magic = indexMagic;
+        newHeader.version = indexVersion;
+        newHeader.sourceLastModified = sourceInfo.lastModified().toMSecsSinceEpoch();
+        newHeader.sourceSize = sourceInfo.size();
+        newHeader.longToShortCount = static_cast<quint32>(longToShort.count());
+        newHeader.shortToLongCount = static_cast<quint32>(shortToLong.count());
+        newHeader.longToShortOffset = sizeof(IndexHeader);
+        newHeader.shortToLongOffset = newHeader.longToShortOffset + newHeader.longToShortCount * sizeof(IndexRecord);
+        const quint32 stringsOffset = newHeader.shortToLongOffset + newHeader.shortToLongCount * sizeof(IndexRecord);
+
+        appendString(strings, stringsOffset, journalFilename.toUtf8(), newHeader.sourcePathOffset, newHeader.sourcePathLength);
+
+        QByteArray result(reinterpret_cast<const char *>(&newHeader), sizeof(IndexHeader));
+        for (const QHash<QByteArray, Mapping> *mappings : {&longToShort, &shortToLong}) {
+            QList<QByteArray> keys = mappings->keys();
+            /// Sorted by bytes, the same order as used by the binary search in @see findKey
+            std::sort(keys.begin(), keys.end());
+            for (const QByteArray &key : const_cast<const QList<QByteArray> &>(keys)) {
+                const Mapping &mapping = (*mappings)[key];
+                IndexRecord record;
+                appendString(strings, stringsOffset, key, record.keyOffset, record.keyLength);
+                appendString(strings, stringsOffset, mapping.name.toUtf8(), record.nameOffset, record.nameLength);
+                appendString(strings, stringsOffset, mapping.value.toUtf8(), record.valueOffset, record.valueLength);
+                record.flags = mapping.ambiguous ? rfAmbiguous : 0;
+                result.append(reinterpret_cast<const char *>(&record), sizeof(IndexRecord));
+            }
+        }
+        result.append(strings);
+
+        return result;
+    }
+
+    /**
+     * Check if @p data is a complete index built from the text file as it is now.
+     */
+    bool isValidIndex(const uchar *data, qint64 size, const QFileInfo &sourceInfo) const {
+        if (data == nullptr || size < static_cast<qint64>(sizeof(IndexHeader))) return false;
+        IndexHeader h;
+        memcpy(&h, data, sizeof(IndexHeader));
+        if (h.magic != indexMagic || h.version != indexVersion) return false;
+        if (h.sourceLastModified != sourceInfo.lastModified().toMSecsSinceEpoch() || h.sourceSize != sourceInfo.size()) return false;
+        if (static_cast<qint64>(h.sourcePathOffset) + h.sourcePathLength > size) return false;
+        if (QString::fromUtf8(reinterpret_cast<const char *>(data) + h.sourcePathOffset, static_cast<int>(h.sourcePathLength)) != journalFilename) return false;
+        if (static_cast<qint64>(h.longToShortOffset) + static_cast<qint64>(h.longToShortCount) * static_cast<qint64>(sizeof(IndexRecord)) > size) return false;
+        if (static_cast<qint64>(h.shortToLongOffset) + static_cast<qint64>(h.shortToLongCount) * static_cast<qint64>(sizeof(IndexRecord)) > size) return false;
+
+        /// Lookups access strings without any checks, so every string
+        /// of every record has to be within the index, even if the index
+        /// was truncated or altered after it had been written
+        for (const QPair<quint32, quint32> &table : {qMakePair(h.longToShortOffset, h.longToShortCount), qMakePair(h.shortToLongOffset, h.shortToLongCount)})
+            for (quint32 position = 0; position < table.second; ++position) {
+                IndexRecord r;
+                memcpy(&r, data + table.first + static_cast<qint64>(position) * static_cast<qint64>(sizeof(IndexRecord)), sizeof(IndexRecord));
+                if (static_cast<qint64>(r.keyOffset) + r.keyLength > size || static_cast<qint64>(r.nameOffset) + r.nameLength > size || static_cast<qint64>(r.valueOffset) + r.valueLength > size)
+                    return false;
+            }
+
+        return true;
+    }
+
+    /**
+     * Make the index available on first use of any lookup.
+     * Once loaded, no lock is taken anymore.
+     */
+    void ensureLoaded() {
+        if (loaded.loadAcquire() != 0) return;
+
+        QMutexLocker locker(&loadMutex);
+        if (loaded.load() != 0) return;
+        load();
+        /// Publish the index to threads not taking the lock
+        loaded.storeRelease(1);
+    }
+
+    /**
+     * Map the index file, building it first if there is no index
+     * file or if the text file has changed since it was built.
+     */
+    void load() {
+        if (journalFilename.isEmpty()) {
+            qCWarning(LOG_KBIBTEX_PROCESSING) << "Cannot locate journal abbreviation list file";
+            return;
+        }
+        const QFileInfo sourceInfo(journalFilename);
+
+        indexFile.setFileName(indexFilename);
+        if (indexFile.open(QFile::ReadOnly)) {
+            indexData = indexFile.map(0, indexFile.size());
+            indexSize = indexFile.size();
+            if (isValidIndex(indexData, indexSize, sourceInfo)) {
+                memcpy(&header, indexData, sizeof(IndexHeader));
+                return;
+            }
+            /// Index is outdated or broken, build a new one
+            if (indexData != nullptr)
+                indexFile.unmap(const_cast<uchar *>(indexData));
+            indexFile.close();
+            indexData = nullptr;
+            indexSize = 0;
+        }
+
+        indexBuffer = buildIndex(sourceInfo);
+        if (indexBuffer.isEmpty()) {
+            qCWarning(LOG_KBIBTEX_PROCESSING) << "No journal abbreviations found in" << journalFilename;
+            return;
+        }
+
+        QDir().mkpath(QFileInfo(indexFilename).absolutePath());
+        QSaveFile saveFile(indexFilename);
+        if (saveFile.open(QFile::WriteOnly) && saveFile.write(indexBuffer) == indexBuffer.size() && saveFile.commit()) {
+            if (indexFile.open(QFile::ReadOnly)) {
+                const uchar *mapped = indexFile.map(0, indexFile.size());
+                if (isValidIndex(mapped, indexFile.size(), sourceInfo)) {
+                    /// Use the mapped file and release the memory used while building
+                    indexData = mapped;
+                    indexSize = indexFile.size();
+                    indexBuffer.clear();
+                }
+            }
+        } else
+            qCWarning(LOG_KBIBTEX_PROCESSING) << "Cannot write journal abbreviation index to" << indexFilename;
+
+        if (indexData == nullptr) {
+            /// Fall back to the index built in memory
+            indexData = reinterpret_cast<const uchar *>(indexBuffer.constData());
+            indexSize = indexBuffer.size();
+        }
+        memcpy(&header, indexData, sizeof(IndexHeader));
+    }
+
+    inline IndexRecord record(quint32 tableOffset, quint32 position) const {
+        IndexRecord result;
+        memcpy(&result, indexData + tableOffset + position * sizeof(IndexRecord), sizeof(IndexRecord));
+        return result;
+    }
+
+    inline QByteArray bytes(quint32 offset, quint32 length) const {
+        return QByteArray::fromRawData(reinterpret_cast<const char *>(indexData) + offset, static_cast<int>(length));
+    }
+
+    inline QString string(quint32 offset, quint32 length) const {
+        return QString::fromUtf8(reinterpret_cast<const char *>(indexData) + offset, static_cast<int>(length));
+    }
+
+    /**
+     * Binary search for the first record in a table whose key is not less than @p key.
+     */
+    quint32 lowerBound(quint32 tableOffset, quint32 count, const QByteArray &key) const {
+        quint32 first = 0, length = count;
+        while (length > 0) {
+            const quint32 half = length / 2;
+            const IndexRecord r = record(tableOffset, first + half);
+            if (bytes(r.keyOffset, r.keyLength) < key) {
+                first += half + 1;
+                length -= half + 1;
+            } else
+                length = half;
+        }
+        return first;
+    }
+
+    bool findRecord(bool longToShort, const QByteArray &key, IndexRecord &result) {
+        ensureLoaded();
+        if (indexData == nullptr) return false;
+
+        const quint32 tableOffset = longToShort ? header.longToShortOffset : header.shortToLongOffset;
+        const quint32 count = longToShort ? header.longToShortCount : header.shortToLongCount;
+        const quint32 position = lowerBound(tableOffset, count, key);
+        if (position < count) {
+            result = record(tableOffset, position);
+            return bytes(result.keyOffset, result.keyLength) == key;
+        }
+        return false;
+    }
+
+    QString lookup(bool longToShort, const QString &name) {
+        IndexRecord r;
+        if (findRecord(longToShort, normalizedKey(name), r))
+            return string(r.valueOffset, r.valueLength);
+        return name;
+    }
+
+    QVector<QPair<QString, QString> > prefixLookup(bool longToShort, const QString &prefix, int maxResults) {
+        QVector<QPair<QString, QString> > result;
+        ensureLoaded();
+        if (indexData == nullptr) return result;
+
+        const quint32 tableOffset = longToShort ? header.longToShortOffset : header.shortToLongOffset;
+        const quint32 count = longToShort ? header.longToShortCount : header.shortToLongCount;
+        const QByteArray key = normalizedKey(prefix);
+        for (quint32 position = lowerBound(tableOffset, count, key); position < count && result.count() < maxResults; ++position) {
+            const IndexRecord r = record(tableOffset, position);
+            if (!bytes(r.keyOffset, r.keyLength).startsWith(key)) break;
+            result.append(qMakePair(string(r.nameOffset, r.nameLength), string(r.valueOffset, r.valueLength)));
+        }
+        return result;
+    }
 
 public:
     Private(JournalAbbreviations *parent)
-            : journalFilename(QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("kbibtex/jabref_journalabbrevlist.txt")))
+            : journalFilename(QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("kbibtex/jabref_journalabbrevlist.txt"))),
+          indexFilename(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/journalabbreviations.idx")),
+          loaded(0), indexData(nullptr), indexSize(0)
     {
         Q_UNUSED(parent)
     }
 
-    bool loadMapping() {
-        leftToRightMap.clear();
-        rightToLeftMap.clear();
+    /**
+     * Reduce a journal name to the form used for lookups: lower case,
+     * '&' replaced by 'and', punctuation removed, and words separated
+     * by single spaces. For example, both "Journal of Physics A: Math. &
+     * Theor." and "journal of physics a math and theor" become the same key.
+     */
+    static QByteArray normalizedKey(const QString &name) {
+        QString result;
+        result.reserve(name.length() + 4);
+        bool pendingSpace = false;
+        for (const QChar &c : name) {
+            if (c.isLetterOrNumber()) {
+                if (pendingSpace && !result.isEmpty())
+                    result.append(QLatin1Char(' '));
+                pendingSpace = false;
+                result.append(c.toLower());
+            } else if (c == QLatin1Char('&')) {
+                if (!result.isEmpty())
+                    result.append(QLatin1Char(' '));
+                result.append(QStringLiteral("and"));
+                pendingSpace = true;
+            } else
+                pendingSpace = true;
+        }
+        return result.toUtf8();
+    }
+
+    /// Outcome of translating a single journal name, see @see resolve
+    struct Resolution {
+        enum Kind {Unchanged, Changed, Unknown, Ambiguous} kind;
+        QString name;
+    };
 
-        QFile journalFile(journalFilename);
-        if (journalFile.open(QFile::ReadOnly)) {
-            static const QRegularExpression splitRegExp(QStringLiteral("\\s*[=;]\\s*"));
-
-            QTextStream ts(&journalFile);
-            ts.setCodec("utf8");
-
-            QString line;
-            while (!(line = ts.readLine().trimmed()).isNull()) {
-                /// Skip empty lines or comments
-                if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) continue;
-                const QStringList columns = line.split(splitRegExp);
-                /// Skip lines that do not have at least two columns
-                if (columns.count() < 2) continue;
-                /// At this point, a given line like
-                ///    Accounts of Chemical Research=Acc. Chem. Res.;ACHRE4;M
-                /// may have been split into the columns of
-                ///    Accounts of Chemical Research
-                ///    Acc. Chem. Res.
-                ///    ACHRE4
-                ///    M
-                /// The last two columns are optional and are not processed here.
-                /// The first column is the journal's full name, the second column
-                /// is its abbreviation.
-                /// QHash leftToRightMap maps from full name to abbreviation,
-                /// QHash rightToLeftMap maps from abbreviation to full name.
-
-                const QString alreadyInLeftToRightMap = leftToRightMap[columns[0]];
-                if (!alreadyInLeftToRightMap.isEmpty()) {
-                    if (alreadyInLeftToRightMap.length() > columns[1].length())
-                        /// If there is already an existing mapping from full name to
-                        /// abbreviation, replace it if the newly found abbreviation
-                        /// is longer.
-                        leftToRightMap.insert(columns[0], columns[1]);
-                } else
-                    /// Previously unknown journal full name, so add it to mapping.
-                    leftToRightMap.insert(columns[0], columns[1]);
-                /// Always add/replace mapping from abbreviation to full name.
-                rightToLeftMap.insert(columns[1], columns[0]);
+    /**
+     * Translate a journal name into the requested form. Names already in
+     * this form are kept, but get the spelling used in the abbreviation list.
+     */
+    Resolution resolve(const QString &name, JournalAbbreviations::NameForm form) {
+        const QByteArray key = normalizedKey(name);
+        const bool toShort = form == JournalAbbreviations::nfAbbreviation;
+        IndexRecord r;
+        Resolution result {Resolution::Unknown, name};
+        if (findRecord(!toShort, key, r))
+            /// Name is already in requested form
+            result.name = string(r.nameOffset, r.nameLength);
+        else if (findRecord(toShort, key, r)) {
+            if ((r.flags & rfAmbiguous) != 0) {
+                result.kind = Resolution::Ambiguous;
+                return result;
             }
+            result.name = string(r.valueOffset, r.valueLength);
+        } else
+            return result;
+        result.kind = result.name == name ? Resolution::Unchanged : Resolution::Changed;
+        return result;
+    }
 
-            journalFile.close();
+    /// Resolves journal names, used with QtConcurrent
+    class Resolver
+    {
+    public:
+        typedef Resolution result_type;
 
-            /// Success means at least one mapping has been recorded.
-            return !leftToRightMap.isEmpty();
-        } else {
-            qCWarning(LOG_KBIBTEX_PROCESSING) << "Cannot open journal abbreviation list file at" << journalFilename;
-            return false;
+        Resolver(Private *_d, JournalAbbreviations::NameForm _form)
+                : d(_d), form(_form) {
+            /// nothing
         }
+
+        Resolution operator()(const QString &name) const {
+            return d->resolve(name, form);
+        }
+
+    private:
+        Private *d;
+        const JournalAbbreviations::NameForm form;
+    };
+
+    QString toShortName(const QString &longName) {
+        return lookup(true, longName);
     }
 
-    QString leftToRight(const QString &left) {
-        if (leftToRightMap.isEmpty())
-            loadMapping(); ///< lazy loading of mapping, i.e. only when data gets requested the first time
-        return leftToRightMap.value(left, left);
+    QString toLongName(const QString &shortName) {
+        return lookup(false, shortName);
     }
 
-    QString rightToLeft(const QString &right) {
-        if (rightToLeftMap.isEmpty())
-            loadMapping(); ///< lazy loading of mapping, i.e. only when data gets requested the first time
-        return rightToLeftMap.value(right, right);
+    QVector<QPair<QString, QString> > longNamesStartingWith(const QString &prefix, int maxResults) {
+        return prefixLookup(true, prefix, maxResults);
+    }
+
+    QVector<QPair<QString, QString> > shortNamesStartingWith(const QString &prefix, int maxResults) {
+        return prefixLookup(false, prefix, maxResults);
     }
 };
 
@@ -127,9 +488,70 @@ JournalAbbreviations *JournalAbbreviations::self() {
 }
 
 QString JournalAbbreviations::toShortName(const QString &longName) const {
-    return d->leftToRight(longName);
+    return d->toShortName(longName);
 }
 
 QString JournalAbbreviations::toLongName(const QString &shortName) const {
-    return d->rightToLeft(shortName);
+    return d->toLongName(shortName);
+}
+
+JournalAbbreviations::NormalizationResult JournalAbbreviations::normalizeJournalNames(const QVector<QSharedPointer<Entry> > &entries, NameForm form) const
+{
+    NormalizationResult result;
+
+    /// Each distinct journal name is resolved only once
+    QStringList names;
+    QHash<QString, int> nameIndex;
+    QVector<int> entryNameIndex;
+    entryNameIndex.reserve(entries.count());
+    for (const QSharedPointer<Entry> &entry : entries) {
+        const Value value = entry->value(Entry::ftJournal);
+        /// Only journal names given as plain text get translated, not macros or composed values
+        const QSharedPointer<const PlainText> plainText = value.count() == 1 ? value.first().dynamicCast<const PlainText>() : QSharedPointer<const PlainText>();
+        if (plainText.isNull()) {
+            entryNameIndex.append(-1);
+            continue;
+        }
+        const QString name = plainText->text();
+        auto it = nameIndex.constFind(name);
+        if (it == nameIndex.constEnd()) {
+            it = nameIndex.insert(name, names.count());
+            names.append(name);
+        }
+        entryNameIndex.append(*it);
+    }
+
+    const Private::Resolver resolver(d, form);
+    QVector<Private::Resolution> resolutions;
+    if (names.count() < minNamesForParallelResolution || QThread::idealThreadCount() < 2) {
+        resolutions.reserve(names.count());
+        for (const QString &name : const_cast<const QStringList &>(names))
+            resolutions.append(resolver(name));
+    } else
+        resolutions = QtConcurrent::blockingMapped<QVector<Private::Resolution> >(names, resolver);
+
+    for (int i = 0; i < resolutions.count(); ++i)
+        if (resolutions[i].kind == Private::Resolution::Unknown)
+            result.unknownNames.append(names[i]);
+        else if (resolutions[i].kind == Private::Resolution::Ambiguous)
+            result.ambiguousNames.append(names[i]);
+
+    for (int i = 0; i < entries.count(); ++i) {
+        if (entryNameIndex[i] < 0) continue;
+        const Private::Resolution &resolution = resolutions[entryNameIndex[i]];
+        if (resolution.kind != Private::Resolution::Changed) continue;
+        entries[i]->remove(Entry::ftJournal);
+        entries[i]->insert(Entry::ftJournal, Value() << QSharedPointer<PlainText>(new PlainText(resolution.name)));
+        result.changedEntries.append(entries[i]);
+    }
+
+    return result;
+}
+
+QVector<QPair<QString, QString> > JournalAbbreviations::longNamesStartingWith(const QString &prefix, int maxResults) const {
+    return d->longNamesStartingWith(prefix, maxResults);
+}
+
+QVector<QPair<QString, QString> > JournalAbbreviations::shortNamesStartingWith(const QString &prefix, int maxResults) const {
+    return d->shortNamesStartingWith(prefix, maxResults);
 }
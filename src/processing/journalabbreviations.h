@@ -19,20 +19,90 @@
 #define KBIBTEX_PROC_JOURNALABBREVIATIONS_H
 
 #include <QString>
+#include <QVector>
+#include <QPair>
+#include <QStringList>
+#include <QSharedPointer>
 
 #include "kbibtexproc_export.h"
 
+class Entry;
+
 /**
+ * Translates between journals' full names and their abbreviations as
+ * listed in JabRef's journal abbreviation list. On first use, the list
+ * is compiled into an index file kept in the cache directory, which is
+ * rebuilt only if the list has been changed. Names are compared after
+ * normalization, so that differences in case, punctuation, or writing
+ * '&' instead of 'and' do not matter.
+ * All functions may be used from several threads at the same time.
  * @author Thomas Fischer <fischer@unix-ag.uni-kl.de>
  */
 class KBIBTEXPROC_EXPORT JournalAbbreviations
 {
 public:
+    enum NameForm {nfFullName, nfAbbreviation};
+
+    /**
+     * Summary of @see normalizeJournalNames: which entries were changed,
+     * and which journal names could not be translated.
+     */
+    struct NormalizationResult {
+        QVector<QSharedPointer<Entry> > changedEntries;
+        /// Journal names not found in the abbreviation list
+        QStringList unknownNames;
+        /// Abbreviations used for several journals, which were left as they are
+        QStringList ambiguousNames;
+    };
+
     static JournalAbbreviations *self();
 
+    /**
+     * Look up the abbreviation for a journal's full name.
+     * @param longName journal's full name
+     * @return abbreviation if known, otherwise @p longName
+     */
     QString toShortName(const QString &longName) const;
+
+    /**
+     * Look up the full name for a journal's abbreviation.
+     * @param shortName journal's abbreviated name
+     * @return full name if known, otherwise @p shortName
+     */
     QString toLongName(const QString &shortName) const;
 
+    /**
+     * Rewrite the journal field of many entries to use either the
+     * journals' full names or their abbreviations. Names already in the
+     * requested form get the spelling from the abbreviation list. Each
+     * distinct journal name is looked up only once, in parallel if there
+     * are many. Journal fields containing anything but plain text, such
+     * as macros, are left untouched.
+     * Entries are modified without notifying anyone, so callers have to
+     * update models or views showing the changed entries themselves.
+     * @param entries entries whose journal fields to rewrite
+     * @param form form to rewrite journal names to
+     * @return changed entries and journal names that could not be translated
+     */
+    NormalizationResult normalizeJournalNames(const QVector<QSharedPointer<Entry> > &entries, NameForm form) const;
+
+    /**
+     * Find journals whose full name starts with @p prefix,
+     * for example to offer completions while typing.
+     * @param prefix beginning of a journal's full name
+     * @param maxResults maximum number of journals to return
+     * @return pairs of full name and abbreviation, sorted by normalized full name
+     */
+    QVector<QPair<QString, QString> > longNamesStartingWith(const QString &prefix, int maxResults = 16) const;
+
+    /**
+     * Find journals whose abbreviation starts with @p prefix.
+     * @param prefix beginning of a journal's abbreviation
+     * @param maxResults maximum number of journals to return
+     * @return pairs of abbreviation and full name, sorted by normalized abbreviation
+     */
+    QVector<QPair<QString, QString> > shortNamesStartingWith(const QString &prefix, int maxResults = 16) const;
+
 protected:
     explicit JournalAbbreviations();
     ~JournalAbbreviations();
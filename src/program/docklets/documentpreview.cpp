@@ -66,6 +66,7 @@
 #include "entry.h"
 #include "file.h"
 #include "fileinfo.h"
+#include "attachmentresolver.h"
 #include "logging_program.h"
 
 ImageLabel::ImageLabel(const QString &text, QWidget *parent, Qt::WindowFlags f)
@@ -145,6 +146,11 @@ public:
     QSharedPointer<const Entry> entry;
     QUrl baseUrl;
     bool anyRemote;
+    /// URLs of current entry have been requested from the attachment resolver
+    bool awaitingUrls;
+    /// Request was made to check if the shown URLs are still current
+    bool refreshingUrls;
+    QSet<QUrl> shownUrls;
 
     KParts::ReadOnlyPart *locatePart(const QString &mimeType, QWidget *parentWidget) {
         KService::Ptr service = KMimeTypeTrader::self()->preferredService(mimeType, QStringLiteral("KParts/ReadOnlyPart"));
@@ -157,7 +163,7 @@ public:
     }
 
     DocumentPreviewPrivate(DocumentPreview *parent)
-            : p(parent), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), anyLocal(false), entry(nullptr), anyRemote(false) {
+            : p(parent), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), anyLocal(false), entry(nullptr), anyRemote(false), awaitingUrls(false), refreshingUrls(false) {
         setupGUI();
     }
 
@@ -326,35 +332,48 @@ public:
         /// clear flag that memorizes if any local file was referenced
         anyLocal = false;
         anyRemote = false;
+        shownUrls.clear();
+        refreshingUrls = false;
 
         /// do not load external reference if widget is hidden
-        if (isVisible()) {
-            const auto urlList = FileInfo::entryUrls(entry, baseUrl, FileInfo::TestExistenceYes);
-            for (const QUrl &url : urlList) {
-                bool isLocal = KBibTeX::isLocalOrRelative(url);
-                anyRemote |= !isLocal;
-                if (!onlyLocalFilesButton->isChecked() && !isLocal) continue;
-
-                KIO::StatJob *job = KIO::stat(url, KIO::StatJob::SourceSide, 3, KIO::HideProgressInfo);
-                runningJobs << job;
-                KJobWidgets::setWindow(job, p);
-                connect(job, &KIO::StatJob::result, p, &DocumentPreview::statFinished);
-            }
-            if (urlList.isEmpty()) {
-                /// Case no URLs associated with this entry.
-                /// For-loop above was never executed.
+        if (isVisible() && !entry.isNull()) {
+            /// Testing for files to exist may take a while,
+            /// URLs get shown by showUrls once resolved
+            awaitingUrls = true;
+            AttachmentResolver::instance().resolve(entry, baseUrl);
+        } else {
+            awaitingUrls = false;
+            if (isVisible())
                 showMessage(i18n("No documents to show.")); // krazy:exclude=qmethods
-                p->setCursor(Qt::ArrowCursor);
-            } else if (runningJobs.isEmpty()) {
-                /// Case no stat jobs are running. As there were URLs (tested in
-                /// previous condition), this implies that there were remote
-                /// references that were ignored by executing "continue" above.
-                /// Give user hint that by enabling remote files, more can be shown.
-                showMessage(i18n("<qt>No documents to show.<br/><a href=\"disableonlylocalfiles\">Disable the restriction</a> to local files to see remote documents.</qt>")); // krazy:exclude=qmethods
-                p->setCursor(Qt::ArrowCursor);
-            }
-        } else
             p->setCursor(Qt::ArrowCursor);
+        }
+    }
+
+    void showUrls(const QSet<QUrl> &urlList) {
+        shownUrls = urlList;
+        for (const QUrl &url : urlList) {
+            bool isLocal = KBibTeX::isLocalOrRelative(url);
+            anyRemote |= !isLocal;
+            if (!onlyLocalFilesButton->isChecked() && !isLocal) continue;
+
+            KIO::StatJob *job = KIO::stat(url, KIO::StatJob::SourceSide, 3, KIO::HideProgressInfo);
+            runningJobs << job;
+            KJobWidgets::setWindow(job, p);
+            connect(job, &KIO::StatJob::result, p, &DocumentPreview::statFinished);
+        }
+        if (urlList.isEmpty()) {
+            /// Case no URLs associated with this entry.
+            /// For-loop above was never executed.
+            showMessage(i18n("No documents to show.")); // krazy:exclude=qmethods
+            p->setCursor(Qt::ArrowCursor);
+        } else if (runningJobs.isEmpty()) {
+            /// Case no stat jobs are running. As there were URLs (tested in
+            /// previous condition), this implies that there were remote
+            /// references that were ignored by executing "continue" above.
+            /// Give user hint that by enabling remote files, more can be shown.
+            showMessage(i18n("<qt>No documents to show.<br/><a href=\"disableonlylocalfiles\">Disable the restriction</a> to local files to see remote documents.</qt>")); // krazy:exclude=qmethods
+            p->setCursor(Qt::ArrowCursor);
+        }
     }
 
     void showMessage(const QString &msgText) {
@@ -620,6 +639,8 @@ DocumentPreview::DocumentPreview(QDockWidget *parent)
         : QWidget(parent), d(new DocumentPreviewPrivate(this))
 {
     connect(parent, &QDockWidget::visibilityChanged, this, &DocumentPreview::visibilityChanged);
+    connect(&AttachmentResolver::instance(), &AttachmentResolver::urlsResolved, this, &DocumentPreview::urlsResolved);
+    connect(&AttachmentResolver::instance(), &AttachmentResolver::attachmentsChanged, this, &DocumentPreview::attachmentsChanged);
 }
 
 DocumentPreview::~DocumentPreview()
@@ -659,6 +680,30 @@ void DocumentPreview::comboBoxChanged(int index)
     d->comboBoxChanged(index);
 }
 
+void DocumentPreview::urlsResolved(const QSharedPointer<const Entry> &entry, const QSet<QUrl> &urls)
+{
+    /// Results may be for entries requested by other views
+    if (!d->awaitingUrls || entry != d->entry) return;
+    d->awaitingUrls = false;
+
+    if (d->refreshingUrls) {
+        d->refreshingUrls = false;
+        /// Reload only if files were added or removed, not to interrupt the user
+        if (urls != d->shownUrls)
+            d->update();
+    } else
+        d->showUrls(urls);
+}
+
+void DocumentPreview::attachmentsChanged()
+{
+    if (!isVisible() || d->entry.isNull() || d->awaitingUrls) return;
+
+    d->refreshingUrls = true;
+    d->awaitingUrls = true;
+    AttachmentResolver::instance().resolve(d->entry, d->baseUrl);
+}
+
 void DocumentPreview::statFinished(KJob *kjob)
 {
     KIO::StatJob *job = static_cast<KIO::StatJob *>(kjob);
@@ -23,6 +23,7 @@
 #include <QPixmap>
 
 #include <QUrl>
+#include <QSet>
 
 class QDockWidget;
 class QResizeEvent;
@@ -34,6 +35,7 @@ class Job;
 }
 
 class Element;
+class Entry;
 class File;
 
 class ImageLabel : public QLabel
@@ -73,6 +75,8 @@ private slots:
     void onlyLocalFilesChanged();
     void visibilityChanged(bool);
     void comboBoxChanged(int);
+    void urlsResolved(const QSharedPointer<const Entry> &entry, const QSet<QUrl> &urls);
+    void attachmentsChanged();
     void statFinished(KJob *);
     void loadingFinished();
     void linkActivated(const QString &link);
@@ -32,6 +32,9 @@
 #include "entry.h"
 #include "elementeditor.h"
 #include "mdiwidget.h"
+#include "fileview.h"
+#include "models/filemodel.h"
+#include "models/undojournal.h"
 
 class ElementForm::ElementFormPrivate
 {
@@ -142,7 +145,16 @@ public:
     }
 
     void apply() {
+        /// Record changes to allow undoing them like edits in the main list
+        FileView *fileView = mdiWidget->fileView();
+        UndoJournal *journal = fileView != nullptr && fileView->fileModel() != nullptr && !element.isNull() ? fileView->fileModel()->journal() : nullptr;
+        if (journal != nullptr) {
+            journal->beginOperation(i18n("Edit Element"));
+            journal->aboutToModify(element);
+        }
         elementEditor->apply();
+        if (journal != nullptr)
+            journal->endOperation();
         buttonApply->setEnabled(false);
         buttonReset->setEnabled(false);
         gotModified = false;
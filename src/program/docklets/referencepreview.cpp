@@ -34,6 +34,11 @@
 #include <QFileDialog>
 #include <QPushButton>
 #include <QFontDatabase>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 
 #include <KLocalizedString>
 #include <KComboBox>
@@ -53,6 +58,9 @@
 #include "element.h"
 #include "file.h"
 #include "entry.h"
+#include "macro.h"
+#include "preamble.h"
+#include "comment.h"
 #include "bibtexentries.h"
 #include "fileview.h"
 #include "logging_program.h"
@@ -79,6 +87,112 @@ previewStyles[] = {
 
 Q_DECLARE_METATYPE(PreviewStyles)
 
+/// Everything required to render a preview without accessing
+/// the bibliography or any widget, so it can happen in another thread
+struct PreviewRequest {
+    PreviewStyles previewStyle;
+    /// Element to render, with crossref'ed values merged in if the style requires it
+    QSharedPointer<const Element> element;
+    /// Holds only the bibliography's properties, not its elements
+    QSharedPointer<const File> fileProperties;
+    /// Hash of style and rendered element, crossref'ed values included
+    QString cacheKey;
+    QString htmlStart, notAvailableMessage, textColorName, fixedFontFamily;
+    /// Created in the main thread and used by one rendering at a time only,
+    /// see @see ReferencePreviewPrivate::exporterFor
+    FileExporter *exporter;
+};
+
+struct RenderedPreview {
+    QString cacheKey;
+    QString html;
+    bool buttonsEnabled;
+};
+
+static RenderedPreview renderPreview(const PreviewRequest &request)
+{
+    RenderedPreview result;
+    result.cacheKey = request.cacheKey;
+    result.buttonsEnabled = false;
+
+    FileExporter *exporter = request.exporter;
+    const PreviewStyles &previewStyle = request.previewStyle;
+
+    if (exporter == nullptr) {
+        /// something went wrong, no exporter ...
+        result.html = request.notAvailableMessage.arg(i18n("No output generated"));
+        return result;
+    }
+
+    QBuffer buffer;
+    buffer.open(QBuffer::WriteOnly);
+    QStringList errorLog;
+    const bool exporterResult = exporter->save(&buffer, request.element, request.fileProperties.data(), &errorLog);
+    buffer.close();
+
+    buffer.open(QBuffer::ReadOnly);
+    QString text = QString::fromUtf8(buffer.readAll().constData());
+    buffer.close();
+
+    result.buttonsEnabled = true;
+
+    if (!exporterResult || text.isEmpty()) {
+        /// something went wrong, no output ...
+        text = request.notAvailableMessage.arg(i18n("No output generated"));
+        result.buttonsEnabled = false;
+        qCDebug(LOG_KBIBTEX_PROGRAM) << errorLog.join(QStringLiteral("\n"));
+    } else {
+        /// beautify text
+        text.replace(QStringLiteral("``"), QStringLiteral("&ldquo;"));
+        text.replace(QStringLiteral("''"), QStringLiteral("&rdquo;"));
+        static const QRegularExpression openingSingleQuotationRegExp(QStringLiteral("(^|[> ,.;:!?])`(\\S)"));
+        static const QRegularExpression closingSingleQuotationRegExp(QStringLiteral("(\\S)'([ ,.;:!?<]|$)"));
+        text.replace(openingSingleQuotationRegExp, QStringLiteral("\\1&lsquo;\\2"));
+        text.replace(closingSingleQuotationRegExp, QStringLiteral("\\1&rsquo;\\2"));
+
+        if (previewStyle.style == QStringLiteral("wikipedia-cite"))
+            text.remove(QStringLiteral("\n"));
+
+        if (text.contains(QStringLiteral("{{cite FIXME"))) {
+            /// Wikipedia {{cite ...}} command had problems (e.g. unknown entry type)
+            text = request.notAvailableMessage.arg(i18n("This type of element is not supported by Wikipedia's <tt>{{cite}}</tt> command."));
+        } else if (previewStyle.type == QStringLiteral("exporter") || previewStyle.type.startsWith(QStringLiteral("plain_"))) {
+            /// source
+            text.prepend(QStringLiteral("';\">"));
+            text.prepend(request.fixedFontFamily);
+            text.prepend(QStringLiteral("<pre style=\"font-family: '"));
+            text.prepend(request.htmlStart);
+            text.append(QStringLiteral("</pre></body></html>"));
+        } else if (previewStyle.type == QStringLiteral("bibtex2html")) {
+            /// bibtex2html
+
+            /// remove "generated by" line from HTML code if BibTeX2HTML was used
+            text.remove(QRegularExpression(QStringLiteral("<hr><p><em>.*</p>")));
+            text.remove(QRegularExpression(QStringLiteral("<[/]?(font)[^>]*>")));
+            text.remove(QRegularExpression(QStringLiteral("^.*?<td.*?</td.*?<td>")));
+            text.remove(QRegularExpression(QStringLiteral("</td>.*$")));
+            text.remove(QRegularExpression(QStringLiteral("\\[ <a.*?</a> \\]")));
+
+            /// replace ASCII art with Unicode characters
+            text.replace(QStringLiteral("---"), QString(QChar(0x2014)));
+            text.replace(QStringLiteral("--"), QString(QChar(0x2013)));
+
+            text.prepend(request.htmlStart);
+            text.append("</body></html>");
+        } else if (previewStyle.type == QStringLiteral("xml")) {
+            /// XML/XSLT
+            text.prepend(request.htmlStart);
+            text.append("</body></html>");
+        }
+
+        /// adopt current color scheme
+        text.replace(QStringLiteral("color: black;"), QString(QStringLiteral("color: %1;")).arg(request.textColorName));
+    }
+
+    result.html = text;
+    return result;
+}
+
 class ReferencePreview::ReferencePreviewPrivate
 {
 private:
@@ -102,6 +216,25 @@ public:
     const int defaultFontSize;
     const QString htmlStart;
     const QString notAvailableMessage;
+    /// Serializes elements to compute cache keys, see @see makeRequest
+    FileExporterBibTeX *exporterBibTeX;
+    /// Exporters used by renderings, created in the main thread and kept
+    /// for later renderings, see @see exporterFor
+    FileExporterBibTeX *renderExporterBibTeX;
+    FileExporterRIS *renderExporterRIS;
+    FileExporterBibTeX2HTML *renderExporterBibTeX2HTML;
+    QHash<QString, FileExporterXSLT *> renderExportersXSLT;
+
+    /// Rendered previews by cache key, least recently used ones get dropped
+    QCache<QString, RenderedPreview> renderedPreviews;
+    static const int maxRenderedPreviews;
+    /// Renders one preview at a time in the background
+    QFutureWatcher<RenderedPreview> *renderWatcher;
+    /// Requests not started yet, the first one for the current element,
+    /// followed by neighbouring elements rendered speculatively
+    QList<PreviewRequest> pendingRequests;
+    /// Cache key of the preview to show once rendered
+    QString awaitedCacheKey;
 
     ReferencePreviewPrivate(ReferencePreview *parent)
             : p(parent), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))), configGroupName(QStringLiteral("Reference Preview Docklet")),
@@ -109,7 +242,11 @@ public:
           textColor(QApplication::palette().text().color()),
           defaultFontSize(QFontDatabase::systemFont(QFontDatabase::GeneralFont).pointSize()),
           htmlStart(QStringLiteral("<html>\n<head>\n<meta http-equiv=\"content-type\" content=\"text/html; charset=utf-8\" />\n<style type=\"text/css\">\npre {\n white-space: pre-wrap;\n white-space: -moz-pre-wrap;\n white-space: -pre-wrap;\n white-space: -o-pre-wrap;\n word-wrap: break-word;\n}\n</style>\n</head>\n<body style=\"color: ") + textColor.name() + QStringLiteral("; font-size: ") + QString::number(defaultFontSize) + QStringLiteral("pt; font-family: '") + QFontDatabase::systemFont(QFontDatabase::GeneralFont).family() + QStringLiteral("'; background-color: '") + QApplication::palette().base().color().name(QColor::HexRgb) + QStringLiteral("'\">")),
-          notAvailableMessage(htmlStart + QStringLiteral("<p style=\"font-style: italic;\">") + i18n("No preview available") + QStringLiteral("</p><p style=\"font-size: 90%;\">") + i18n("Reason:") + QStringLiteral(" %1</p></body></html>")) {
+          notAvailableMessage(htmlStart + QStringLiteral("<p style=\"font-style: italic;\">") + i18n("No preview available") + QStringLiteral("</p><p style=\"font-size: 90%;\">") + i18n("Reason:") + QStringLiteral(" %1</p></body></html>")),
+          exporterBibTeX(new FileExporterBibTeX(parent)), renderExporterBibTeX(new FileExporterBibTeX(parent)), renderExporterRIS(new FileExporterRIS(parent)), renderExporterBibTeX2HTML(new FileExporterBibTeX2HTML(parent)), renderedPreviews(maxRenderedPreviews), renderWatcher(new QFutureWatcher<RenderedPreview>(parent)) {
+        exporterBibTeX->setEncoding(QStringLiteral("utf-8"));
+        renderExporterBibTeX->setEncoding(QStringLiteral("utf-8"));
+
         QGridLayout *gridLayout = new QGridLayout(p);
         gridLayout->setMargin(0);
         gridLayout->setColumnStretch(0, 1);
@@ -141,6 +278,119 @@ public:
         gridLayout->addWidget(buttonSaveAsHTML, 2, 2, 1, 1);
     }
 
+    ~ReferencePreviewPrivate() {
+        pendingRequests.clear();
+        renderWatcher->waitForFinished();
+    }
+
+    /// Copy of the bibliography's properties, which exporters use for formatting
+    static QSharedPointer<const File> filePropertiesSnapshot(const File *file) {
+        static const QStringList propertyKeys = QStringList() << File::Url << File::Encoding << File::StringDelimiter << File::QuoteComment << File::KeywordCasing << File::ProtectCasing << File::NameFormatting << File::ListSeparator;
+        QSharedPointer<File> snapshot(new File());
+        if (file != nullptr)
+            for (const QString &key : propertyKeys)
+                if (file->hasProperty(key))
+                    snapshot->setProperty(key, file->property(key));
+        return snapshot;
+    }
+
+    PreviewRequest makeRequest(const QSharedPointer<const Element> &element, const QSharedPointer<const File> &fileProperties, const PreviewStyles &previewStyle) {
+        PreviewRequest request;
+        request.previewStyle = previewStyle;
+        request.fileProperties = fileProperties;
+        request.element = element;
+
+        /// Styles formatting references merge the crossref'ed entry's values into the current entry
+        const bool mergeCrossRef = previewStyle.type == QStringLiteral("bibtex2html") || previewStyle.type == QStringLiteral("xml") || previewStyle.type.endsWith(QStringLiteral("_xml"));
+        const QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
+        if (mergeCrossRef && !entry.isNull())
+            request.element = QSharedPointer<const Entry>(Entry::resolveCrossref(*entry, file, BibTeXEntries::self()->xmappings(entry->type())));
+        else if (!entry.isNull())
+            request.element = QSharedPointer<const Entry>(new Entry(*entry));
+        else {
+            const QSharedPointer<const Macro> macro = element.dynamicCast<const Macro>();
+            const QSharedPointer<const Preamble> preamble = element.dynamicCast<const Preamble>();
+            const QSharedPointer<const Comment> comment = element.dynamicCast<const Comment>();
+            if (!macro.isNull())
+                request.element = QSharedPointer<const Macro>(new Macro(*macro));
+            else if (!preamble.isNull())
+                request.element = QSharedPointer<const Preamble>(new Preamble(*preamble));
+            else if (!comment.isNull())
+                request.element = QSharedPointer<const Comment>(new Comment(*comment));
+        }
+
+        /// The element's source code covers its content and,
+        /// if merged, the values of the crossref'ed entry
+        const QByteArray source = exporterBibTeX->toString(request.element, file).toUtf8();
+        request.cacheKey = previewStyle.style + QLatin1Char(':') + QString::fromLatin1(QCryptographicHash::hash(source, QCryptographicHash::Sha1).toHex());
+
+        request.htmlStart = htmlStart;
+        request.notAvailableMessage = notAvailableMessage;
+        request.textColorName = textColor.name();
+        request.fixedFontFamily = QFontDatabase::systemFont(QFontDatabase::FixedFont).family();
+        request.exporter = nullptr;
+        return request;
+    }
+
+    /**
+     * Exporter for the given style. Exporters are created in the main thread
+     * only, as some register with services not to be used from other threads.
+     * Must not be called while a rendering is running, as the exporter
+     * gets configured for the style.
+     */
+    FileExporter *exporterFor(const PreviewStyles &previewStyle) {
+        if (previewStyle.type == QStringLiteral("exporter")) {
+            if (previewStyle.style == QStringLiteral("bibtex"))
+                return renderExporterBibTeX;
+            else if (previewStyle.style == QStringLiteral("ris"))
+                return renderExporterRIS;
+            qCWarning(LOG_KBIBTEX_PROGRAM) << "Don't know how to handle output style " << previewStyle.style << " for type " << previewStyle.type;
+        } else if (previewStyle.type == QStringLiteral("bibtex2html")) {
+            renderExporterBibTeX2HTML->setLaTeXBibliographyStyle(previewStyle.style);
+            return renderExporterBibTeX2HTML;
+        } else if (previewStyle.type == QStringLiteral("xml") || previewStyle.type.endsWith(QStringLiteral("_xml"))) {
+            const QString filename = previewStyle.style + QStringLiteral(".xsl");
+            FileExporterXSLT *exporterXSLT = renderExportersXSLT.value(filename, nullptr);
+            if (exporterXSLT == nullptr) {
+                exporterXSLT = new FileExporterXSLT(XSLTransform::locateXSLTfile(filename), p);
+                renderExportersXSLT.insert(filename, exporterXSLT);
+            }
+            return exporterXSLT;
+        } else
+            qCWarning(LOG_KBIBTEX_PROGRAM) << "Don't know how to handle output type " << previewStyle.type;
+        return nullptr;
+    }
+
+    /// Elements next to the current one in the file view, closest first
+    QList<QSharedPointer<Element> > neighbouringElements() const {
+        static const int offsets[] = {1, -1, 2, -2};
+        QList<QSharedPointer<Element> > result;
+        if (fileView == nullptr || fileView->model() == nullptr) return result;
+
+        const QModelIndex current = fileView->currentIndex();
+        if (!current.isValid()) return result;
+        for (int offset : offsets) {
+            const QModelIndex index = fileView->model()->index(current.row() + offset, 0, current.parent());
+            if (!index.isValid()) continue;
+            const QSharedPointer<Element> neighbour = fileView->elementAt(index);
+            if (!neighbour.isNull() && neighbour != element)
+                result.append(neighbour);
+        }
+        return result;
+    }
+
+    void startNextRendering() {
+        if (renderWatcher->isRunning()) return;
+
+        while (!pendingRequests.isEmpty()) {
+            PreviewRequest request = pendingRequests.takeFirst();
+            if (renderedPreviews.contains(request.cacheKey)) continue;
+            request.exporter = exporterFor(request.previewStyle);
+            renderWatcher->setFuture(QtConcurrent::run(renderPreview, request));
+            return;
+        }
+    }
+
     bool saveHTML(const QUrl &url) const {
         QTemporaryFile tempFile;
         tempFile.setAutoRemove(true);
@@ -197,6 +447,8 @@ public:
     }
 };
 
+const int ReferencePreview::ReferencePreviewPrivate::maxRenderedPreviews = 256;
+
 ReferencePreview::ReferencePreview(QWidget *parent)
         : QWidget(parent), d(new ReferencePreviewPrivate(this))
 {
@@ -205,6 +457,7 @@ ReferencePreview::ReferencePreview(QWidget *parent)
     connect(d->buttonOpen, &QPushButton::clicked, this, &ReferencePreview::openAsHTML);
     connect(d->buttonSaveAsHTML, &QPushButton::clicked, this, &ReferencePreview::saveAsHTML);
     connect(d->comboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &ReferencePreview::renderHTML);
+    connect(d->renderWatcher, &QFutureWatcher<RenderedPreview>::finished, this, &ReferencePreview::renderingFinished);
 
     setEnabled(false);
 }
@@ -241,138 +494,52 @@ void ReferencePreview::setElement(QSharedPointer<Element> element, const File *f
 
 void ReferencePreview::renderHTML()
 {
-    enum { ignore, /// do not include crossref'ed entry's values (one entry)
-           /// NOT USED: add, /// feed both the current entry as well as the crossref'ed entry into the exporter (two entries)
-           merge /// merge the crossref'ed entry's values into the current entry (one entry)
-         } crossRefHandling = ignore;
+    /// Any rendering not started yet has been superseded by this one
+    d->pendingRequests.clear();
+    d->awaitedCacheKey.clear();
 
     if (d->element.isNull()) {
         setHtml(d->notAvailableMessage.arg(i18n("No element selected")), false);
         return;
     }
 
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-
-    FileExporter *exporter = nullptr;
-
     const PreviewStyles previewStyle = d->comboBox->itemData(d->comboBox->currentIndex()).value<PreviewStyles>();
+    d->saveState();
+
+    const QSharedPointer<const File> fileProperties = ReferencePreviewPrivate::filePropertiesSnapshot(d->file);
+    const PreviewRequest request = d->makeRequest(d->element, fileProperties, previewStyle);
+    const RenderedPreview *renderedPreview = d->renderedPreviews.object(request.cacheKey);
+    if (renderedPreview != nullptr)
+        setHtml(renderedPreview->html, renderedPreview->buttonsEnabled);
+    else {
+        d->awaitedCacheKey = request.cacheKey;
+        d->pendingRequests.append(request);
+    }
 
-    if (previewStyle.type == QStringLiteral("exporter")) {
-        if (previewStyle.style == QStringLiteral("bibtex")) {
-            FileExporterBibTeX *exporterBibTeX = new FileExporterBibTeX(this);
-            exporterBibTeX->setEncoding(QStringLiteral("utf-8"));
-            exporter = exporterBibTeX;
-        } else if (previewStyle.style == QStringLiteral("ris"))
-            exporter = new FileExporterRIS(this);
-        else
-            qCWarning(LOG_KBIBTEX_PROGRAM) << "Don't know how to handle output style " << previewStyle.style << " for type " << previewStyle.type;
-    } else if (previewStyle.type == QStringLiteral("bibtex2html")) {
-        crossRefHandling = merge;
-        FileExporterBibTeX2HTML *exporterHTML = new FileExporterBibTeX2HTML(this);
-        exporterHTML->setLaTeXBibliographyStyle(previewStyle.style);
-        exporter = exporterHTML;
-    } else if (previewStyle.type == QStringLiteral("xml") || previewStyle.type.endsWith(QStringLiteral("_xml"))) {
-        crossRefHandling = merge;
-        const QString filename = previewStyle.style + QStringLiteral(".xsl");
-        exporter = new FileExporterXSLT(XSLTransform::locateXSLTfile(filename), this);
-    } else
-        qCWarning(LOG_KBIBTEX_PROGRAM) << "Don't know how to handle output type " << previewStyle.type;
-
-    if (exporter != nullptr) {
-        QBuffer buffer(this);
-        buffer.open(QBuffer::WriteOnly);
-
-        bool exporterResult = false;
-        QStringList errorLog;
-        QSharedPointer<const Entry> entry = d->element.dynamicCast<const Entry>();
-        /** NOT USED
-        if (crossRefHandling == add && !entry.isNull()) {
-            QString crossRef = PlainTextValue::text(entry->value(QStringLiteral("crossref")));
-            QSharedPointer<const Entry> crossRefEntry = d->file == NULL ? QSharedPointer<const Entry>() : d->file->containsKey(crossRef) .dynamicCast<const Entry>();
-            if (!crossRefEntry.isNull()) {
-                File file;
-                file.append(QSharedPointer<Entry>(new Entry(*entry)));
-                file.append(QSharedPointer<Entry>(new Entry(*crossRefEntry)));
-                exporterResult = exporter->save(&buffer, &file, &errorLog);
-            } else
-                exporterResult = exporter->save(&buffer, d->element, d->file, &errorLog);
-        } else */
-        if (crossRefHandling == merge && !entry.isNull()) {
-            QSharedPointer<Entry> merged = QSharedPointer<Entry>(Entry::resolveCrossref(*entry, d->file, BibTeXEntries::self()->xmappings(entry->type())));
-            exporterResult = exporter->save(&buffer, merged, d->file, &errorLog);
-        } else
-            exporterResult = exporter->save(&buffer, d->element, d->file, &errorLog);
-        buffer.close();
-        delete exporter;
-
-        buffer.open(QBuffer::ReadOnly);
-        QString text = QString::fromUtf8(buffer.readAll().constData());
-        buffer.close();
-
-        bool buttonsEnabled = true;
-
-        if (!exporterResult || text.isEmpty()) {
-            /// something went wrong, no output ...
-            text = d->notAvailableMessage.arg(i18n("No output generated"));
-            buttonsEnabled = false;
-            qCDebug(LOG_KBIBTEX_PROGRAM) << errorLog.join(QStringLiteral("\n"));
-        } else {
-            /// beautify text
-            text.replace(QStringLiteral("``"), QStringLiteral("&ldquo;"));
-            text.replace(QStringLiteral("''"), QStringLiteral("&rdquo;"));
-            static const QRegularExpression openingSingleQuotationRegExp(QStringLiteral("(^|[> ,.;:!?])`(\\S)"));
-            static const QRegularExpression closingSingleQuotationRegExp(QStringLiteral("(\\S)'([ ,.;:!?<]|$)"));
-            text.replace(openingSingleQuotationRegExp, QStringLiteral("\\1&lsquo;\\2"));
-            text.replace(closingSingleQuotationRegExp, QStringLiteral("\\1&rsquo;\\2"));
-
-            if (previewStyle.style == QStringLiteral("wikipedia-cite"))
-                text.remove(QStringLiteral("\n"));
-
-            if (text.contains(QStringLiteral("{{cite FIXME"))) {
-                /// Wikipedia {{cite ...}} command had problems (e.g. unknown entry type)
-                text = d->notAvailableMessage.arg(i18n("This type of element is not supported by Wikipedia's <tt>{{cite}}</tt> command."));
-            } else if (previewStyle.type == QStringLiteral("exporter") || previewStyle.type.startsWith(QStringLiteral("plain_"))) {
-                /// source
-                text.prepend(QStringLiteral("';\">"));
-                text.prepend(QFontDatabase::systemFont(QFontDatabase::FixedFont).family());
-                text.prepend(QStringLiteral("<pre style=\"font-family: '"));
-                text.prepend(d->htmlStart);
-                text.append(QStringLiteral("</pre></body></html>"));
-            } else if (previewStyle.type == QStringLiteral("bibtex2html")) {
-                /// bibtex2html
-
-                /// remove "generated by" line from HTML code if BibTeX2HTML was used
-                text.remove(QRegularExpression(QStringLiteral("<hr><p><em>.*</p>")));
-                text.remove(QRegularExpression(QStringLiteral("<[/]?(font)[^>]*>")));
-                text.remove(QRegularExpression(QStringLiteral("^.*?<td.*?</td.*?<td>")));
-                text.remove(QRegularExpression(QStringLiteral("</td>.*$")));
-                text.remove(QRegularExpression(QStringLiteral("\\[ <a.*?</a> \\]")));
-
-                /// replace ASCII art with Unicode characters
-                text.replace(QStringLiteral("---"), QString(QChar(0x2014)));
-                text.replace(QStringLiteral("--"), QString(QChar(0x2013)));
-
-                text.prepend(d->htmlStart);
-                text.append("</body></html>");
-            } else if (previewStyle.type == QStringLiteral("xml")) {
-                /// XML/XSLT
-                text.prepend(d->htmlStart);
-                text.append("</body></html>");
-            }
-
-            /// adopt current color scheme
-            text.replace(QStringLiteral("color: black;"), QString(QStringLiteral("color: %1;")).arg(d->textColor.name()));
+    /// Speculatively render neighbouring elements, in case
+    /// the user moves through the list with the arrow keys
+    if (d->htmlView->isEnabled()) {
+        const QList<QSharedPointer<Element> > neighbours = d->neighbouringElements();
+        for (const QSharedPointer<Element> &neighbour : neighbours) {
+            const PreviewRequest neighbourRequest = d->makeRequest(neighbour, fileProperties, previewStyle);
+            if (!d->renderedPreviews.contains(neighbourRequest.cacheKey))
+                d->pendingRequests.append(neighbourRequest);
         }
+    }
 
-        setHtml(text, buttonsEnabled);
+    d->startNextRendering();
+}
 
-        d->saveState();
-    } else {
-        /// something went wrong, no exporter ...
-        setHtml(d->notAvailableMessage.arg(i18n("No output generated")), false);
+void ReferencePreview::renderingFinished()
+{
+    const RenderedPreview renderedPreview = d->renderWatcher->result();
+    d->renderedPreviews.insert(renderedPreview.cacheKey, new RenderedPreview(renderedPreview));
+    if (renderedPreview.cacheKey == d->awaitedCacheKey) {
+        d->awaitedCacheKey.clear();
+        setHtml(renderedPreview.html, renderedPreview.buttonsEnabled);
     }
 
-    QApplication::restoreOverrideCursor();
+    d->startNextRendering();
 }
 
 void ReferencePreview::openAsHTML()
@@ -47,6 +47,7 @@ private:
 
 private slots:
     void renderHTML();
+    void renderingFinished();
     void openAsHTML();
     void saveAsHTML();
     void linkClicked(const QUrl &);
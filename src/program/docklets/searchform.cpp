@@ -93,7 +93,13 @@ public:
     SearchResults *sr;
     QMap<QListWidgetItem *, OnlineSearchAbstract *> itemToOnlineSearch;
     QSet<OnlineSearchAbstract *> runningSearches;
+    /// For each search engine which may deliver more results, where to continue searching
+    QMap<OnlineSearchAbstract *, OnlineSearchAbstract::ContinuationToken> continuationTokens;
+    /// Number of results received per search engine for the most recently requested page
+    QMap<OnlineSearchAbstract *, int> numResultsInPage;
+    int numResultsPerPage;
     QPushButton *searchButton;
+    QPushButton *loadMoreButton;
     QPushButton *useEntryButton;
     OnlineSearchQueryFormGeneral *generalQueryTermsForm;
     QTabWidget *tabWidget;
@@ -113,7 +119,7 @@ public:
 
     SearchFormPrivate(SearchResults *searchResults, SearchForm *parent)
             : p(parent), whichEnginesLabel(nullptr), config(KSharedConfig::openConfig(QStringLiteral("kbibtexrc"))),
-          configGroupName(QStringLiteral("Search Engines Docklet")), sr(searchResults), searchButton(nullptr), useEntryButton(nullptr), currentEntry(nullptr) {
+          configGroupName(QStringLiteral("Search Engines Docklet")), sr(searchResults), numResultsPerPage(0), searchButton(nullptr), loadMoreButton(nullptr), useEntryButton(nullptr), currentEntry(nullptr) {
         createGUI();
     }
 
@@ -189,10 +195,11 @@ public:
         layout->setColumnStretch(0, 0);
         layout->setColumnStretch(1, 1);
         layout->setColumnStretch(2, 0);
+        layout->setColumnStretch(3, 0);
 
         tabWidget = new QTabWidget(p);
         tabWidget->setDocumentMode(true);
-        layout->addWidget(tabWidget, 0, 0, 1, 3);
+        layout->addWidget(tabWidget, 0, 0, 1, 4);
 
         QWidget *widget = createQueryTermsStack(tabWidget);
         tabWidget->addTab(widget, QIcon::fromTheme(QStringLiteral("edit-rename")), i18n("Query Terms"));
@@ -212,8 +219,14 @@ public:
         progressBar->setMaximum(1000);
         progressBar->hide();
 
+        loadMoreButton = new QPushButton(QIcon::fromTheme(QStringLiteral("go-down-search")), i18n("More"), p);
+        loadMoreButton->setToolTip(i18n("Retrieve more results for the last search"));
+        layout->addWidget(loadMoreButton, 1, 2, 1, 1);
+        loadMoreButton->setEnabled(false);
+        connect(loadMoreButton, &QPushButton::clicked, p, &SearchForm::loadMoreResults);
+
         searchButton = new QPushButton(QIcon::fromTheme(QStringLiteral("edit-find")), i18n("Search"), p);
-        layout->addWidget(searchButton, 1, 2, 1, 1);
+        layout->addWidget(searchButton, 1, 3, 1, 1);
         connect(generalQueryTermsForm, &OnlineSearchQueryFormGeneral::returnPressed, searchButton, &QPushButton::click);
 
         updateGUI();
@@ -221,6 +234,7 @@ public:
 
     void loadEngines() {
         enginesList->clear();
+        continuationTokens.clear();
 
         addEngine(new OnlineSearchAcmPortal(p));
         addEngine(new OnlineSearchArXiv(p));
@@ -277,6 +291,7 @@ public:
         connect(searchButton, &QPushButton::clicked, p, &SearchForm::startSearch);
         searchButton->setText(i18n("Search"));
         searchButton->setIcon(QIcon::fromTheme(QStringLiteral("media-playback-start")));
+        loadMoreButton->setEnabled(!continuationTokens.isEmpty());
         for (int i = tabWidget->count() - 1; i >= 0; --i)
             tabWidget->widget(i)->setEnabled(true);
         tabWidget->unsetCursor();
@@ -289,6 +304,7 @@ public:
             connect(searchButton, &QPushButton::clicked, it.value(), &OnlineSearchAbstract::cancel);
         searchButton->setText(i18n("Stop"));
         searchButton->setIcon(QIcon::fromTheme(QStringLiteral("media-playback-stop")));
+        loadMoreButton->setEnabled(false);
         for (int i = tabWidget->count() - 1; i >= 0; --i)
             tabWidget->widget(i)->setEnabled(false);
         tabWidget->setCursor(Qt::WaitCursor);
@@ -349,6 +365,20 @@ public:
     void enginesListCurrentChanged(QListWidgetItem *current) {
         actionOpenHomepage->setEnabled(current != nullptr);
     }
+
+    void prefetchNextPages() {
+        /// While the user inspects the current results, retrieve
+        /// the next page of results from each search engine
+        /// that may provide more results
+        for (QMap<OnlineSearchAbstract *, OnlineSearchAbstract::ContinuationToken>::ConstIterator it = continuationTokens.constBegin(); it != continuationTokens.constEnd(); ++it)
+            it.key()->prefetchSearch(it.value(), numResultsPerPage);
+    }
+
+    void cancelPrefetching() {
+        for (QMap<OnlineSearchAbstract *, OnlineSearchAbstract::ContinuationToken>::ConstIterator it = continuationTokens.constBegin(); it != continuationTokens.constEnd(); ++it)
+            if (it.key()->busy())
+                it.key()->cancel();
+    }
 };
 
 SearchForm::SearchForm(SearchResults *searchResults, QWidget *parent)
@@ -387,6 +417,9 @@ void SearchForm::startSearch()
         return;
     }
 
+    d->cancelPrefetching();
+    d->continuationTokens.clear();
+    d->numResultsInPage.clear();
     d->runningSearches.clear();
     d->sr->clear();
     d->progressBar->setValue(0);
@@ -399,10 +432,14 @@ void SearchForm::startSearch()
 
         QMap<QString, QString> queryTerms = d->generalQueryTermsForm->getQueryTerms();
         int numResults = d->generalQueryTermsForm->getNumResults();
+        d->numResultsPerPage = numResults;
         for (QMap<QListWidgetItem *, OnlineSearchAbstract *>::ConstIterator it = d->itemToOnlineSearch.constBegin(); it != d->itemToOnlineSearch.constEnd(); ++it)
             if (it.key()->checkState() == Qt::Checked) {
                 it.value()->startSearch(queryTerms, numResults);
                 d->runningSearches.insert(it.value());
+                /// Next page of results will start after the results requested now
+                const OnlineSearchAbstract::ContinuationToken token {queryTerms, numResults};
+                d->continuationTokens.insert(it.value(), token);
             }
         if (d->runningSearches.isEmpty()) {
             /// if no search engine has been checked (selected), something went wrong
@@ -425,18 +462,47 @@ void SearchForm::startSearch()
     d->switchToCancel();
 }
 
+void SearchForm::loadMoreResults()
+{
+    if (d->continuationTokens.isEmpty()) return;
+
+    d->runningSearches.clear();
+    d->numResultsInPage.clear();
+    d->progressBar->setValue(0);
+    d->progressMap.clear();
+    d->useEntryButton->hide();
+    d->progressBar->show();
+
+    for (QMap<OnlineSearchAbstract *, OnlineSearchAbstract::ContinuationToken>::Iterator it = d->continuationTokens.begin(); it != d->continuationTokens.end(); ++it) {
+        d->runningSearches.insert(it.key());
+        /// Publishes prefetched results right away if available
+        it.key()->continueSearch(it.value(), d->numResultsPerPage);
+        it.value().offset += d->numResultsPerPage;
+    }
+
+    d->switchToCancel();
+}
+
 void SearchForm::foundEntry(QSharedPointer<Entry> entry)
 {
+    OnlineSearchAbstract *engine = static_cast<OnlineSearchAbstract *>(sender());
+    ++d->numResultsInPage[engine];
     d->sr->insertElement(entry);
 }
 
-void SearchForm::stoppedSearch(int)
+void SearchForm::stoppedSearch(int resultCode)
 {
     OnlineSearchAbstract *engine = static_cast<OnlineSearchAbstract *>(sender());
     if (d->runningSearches.remove(engine)) {
+        /// A search engine which failed or returned fewer results
+        /// than requested is not expected to deliver any more results
+        if (resultCode != OnlineSearchAbstract::resultNoError || d->numResultsInPage.value(engine, 0) < d->numResultsPerPage)
+            d->continuationTokens.remove(engine);
+
         if (d->runningSearches.isEmpty()) {
             /// last search engine stopped
             d->switchToSearch();
+            d->prefetchNextPages();
             emit doneSearching();
 
             QTimer::singleShot(1000, d->progressBar, &QProgressBar::hide);
@@ -496,6 +562,8 @@ void SearchForm::copyFromEntry()
 void SearchForm::updateProgress(int cur, int total)
 {
     OnlineSearchAbstract *ws = static_cast<OnlineSearchAbstract *>(sender());
+    /// Ignore progress of search engines prefetching results in the background
+    if (!d->runningSearches.contains(ws)) return;
     d->progressMap[ws] = total > 0 ? cur * 1000 / total : 0;
 
     int progress = 0, count = 0;
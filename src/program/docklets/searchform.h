@@ -79,6 +79,7 @@ private:
 private slots:
     void switchToEngines();
     void startSearch();
+    void loadMoreResults();
     void foundEntry(QSharedPointer<Entry> entry);
     void stoppedSearch(int resultCode);
     void tabSwitched(int newTab);
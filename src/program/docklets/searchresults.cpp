@@ -201,8 +201,9 @@ void SearchResults::importSelected()
     FileModel *sourceModel = d->resultList->fileModel();
     if (targetModel == nullptr || sourceModel == nullptr) return; ///< either source or target model is invalid
 
-    bool atLeastOneSuccessfullInsertion = false;
+    QList<QSharedPointer<Element> > clones;
     const QModelIndexList selList = d->resultList->selectionModel()->selectedRows();
+    clones.reserve(selList.count());
     for (const QModelIndex &modelIndex : selList) {
         /// Map from visible row to 'real' row
         /// that may be hidden through sorting
@@ -213,12 +214,12 @@ void SearchResults::importSelected()
         if (!entry.isNull()) {
             /// Important: make clone of entry before inserting
             /// in main list, otherwise data would be shared
-            QSharedPointer<Entry> clone(new Entry(*entry));
-            atLeastOneSuccessfullInsertion |= targetModel->insertRow(clone, targetModel->rowCount());
+            clones << QSharedPointer<Entry>(new Entry(*entry));
         } else
             qCWarning(LOG_KBIBTEX_PROGRAM) << "Trying to import something that isn't an Entry";
     }
 
-    if (atLeastOneSuccessfullInsertion)
+    /// Insert all imported entries as one block
+    if (!clones.isEmpty() && targetModel->insertElements(clones, targetModel->rowCount()))
         d->mainEditor->externalModification();
 }
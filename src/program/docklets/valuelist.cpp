@@ -40,6 +40,7 @@
 #include "fileview.h"
 #include "valuelistmodel.h"
 #include "models/filemodel.h"
+#include "models/undojournal.h"
 
 class ValueList::ValueListPrivate
 {
@@ -311,12 +312,17 @@ void ValueList::assignSelection() {
     /// Keep track if any modifications were made to the bibliography file
     bool madeModification = false;
 
+    /// Modifications can be undone as a whole
+    UndoJournal *journal = d->fileView->fileModel() != nullptr ? d->fileView->fileModel()->journal() : nullptr;
+    if (journal != nullptr) journal->beginOperation(i18n("Assign Value"));
+
     /// Go through all selected elements in current editor
     const QList<QSharedPointer<Element> > &selection = d->fileView->selectedElements();
     for (const auto &element : selection) {
         /// Only entries (not macros or comments) are of interest
         QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
         if (!entry.isNull()) {
+            if (journal != nullptr) journal->aboutToModify(entry, field);
             /// Fields are separated into two categories:
             /// 1. Where more values can be appended, like authors or URLs
             /// 2. Where values should be replaced, like title, year, or journal
@@ -352,6 +358,8 @@ void ValueList::assignSelection() {
         }
     }
 
+    if (journal != nullptr) journal->endOperation();
+
     if (madeModification) {
         /// Notify main editor about change it its data
         d->fileView->externalModification();
@@ -370,12 +378,17 @@ void ValueList::removeSelection() {
     /// Keep track if any modifications were made to the bibliography file
     bool madeModification = false;
 
+    /// Modifications can be undone as a whole
+    UndoJournal *journal = d->fileView->fileModel() != nullptr ? d->fileView->fileModel()->journal() : nullptr;
+    if (journal != nullptr) journal->beginOperation(i18n("Remove Value"));
+
     /// Go through all selected elements in current editor
     const QList<QSharedPointer<Element> > &selection = d->fileView->selectedElements();
     for (const auto &element : selection) {
         /// Only entries (not macros or comments) are of interest
         QSharedPointer<Entry> entry = element.dynamicCast<Entry>();
         if (!entry.isNull()) {
+            if (journal != nullptr) journal->aboutToModify(entry, field);
             Value entrysValueForField = entry->value(field);
             bool valueModified = false;
             for (int i = 0; i < entrysValueForField.count(); ++i) {
@@ -394,6 +407,8 @@ void ValueList::removeSelection() {
         }
     }
 
+    if (journal != nullptr) journal->endOperation();
+
     if (madeModification) {
         update();
         /// Notify main editor about change it its data
@@ -18,6 +18,12 @@
 #include <QtTest>
 
 #include "entry.h"
+#include "file.h"
+#include "macro.h"
+#include "completionindex.h"
+#include "bibtexfields.h"
+#include "models/filemodel.h"
+#include "models/undojournal.h"
 
 class KBibTeXDataTest : public QObject
 {
@@ -32,6 +38,19 @@ private slots:
      * irregularities in memory management or access.
      */
     void createAndRemoveValueFromEntries();
+    void resolveCrossrefReferencedKeys();
+    void completionIndexUpdates();
+    void valueDeepCopy();
+    void fileModelSortRoleWithoutCachedRows();
+    void fileModelCrossrefTargetModified();
+    void fileModelInsertElements();
+    void fileModelRemoveRowList();
+    void fileModelReplaceElements();
+    void undoJournalEntryModification();
+    void undoJournalInsertionAndRemoval();
+    void undoJournalGroupedOperation();
+    void undoJournalMacroModification();
+    void undoJournalColorLabelModification();
 
 private:
 };
@@ -51,9 +70,437 @@ void KBibTeXDataTest::createAndRemoveValueFromEntries()
     }
 }
 
+void KBibTeXDataTest::resolveCrossrefReferencedKeys()
+{
+    File file;
+    QSharedPointer<Entry> proceedings(new Entry(QStringLiteral("proceedings"), QStringLiteral("proc")));
+    proceedings->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Proceedings Title"))));
+    proceedings->insert(Entry::ftXData, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("pub,missing"))));
+    file.append(proceedings);
+    QSharedPointer<Entry> publisher(new Entry(QStringLiteral("xdata"), QStringLiteral("pub")));
+    publisher->insert(Entry::ftPublisher, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Publisher"))));
+    file.append(publisher);
+    Entry paper(Entry::etInProceedings, QStringLiteral("paper"));
+    paper.insert(Entry::ftCrossRef, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("proc"))));
+    file.append(QSharedPointer<Entry>(new Entry(paper)));
+
+    QStringList referencedKeys;
+    Entry *resolved = Entry::resolveCrossref(paper, &file, QMap<QString, QString>(), &referencedKeys);
+    QCOMPARE(PlainTextValue::text(resolved->value(Entry::ftTitle)), QStringLiteral("Proceedings Title"));
+    QCOMPARE(PlainTextValue::text(resolved->value(Entry::ftPublisher)), QStringLiteral("Publisher"));
+    QCOMPARE(referencedKeys, QStringList() << QStringLiteral("proc") << QStringLiteral("pub") << QStringLiteral("missing"));
+    delete resolved;
+}
+
+void KBibTeXDataTest::completionIndexUpdates()
+{
+    File file;
+    QSharedPointer<Entry> first(new Entry(Entry::etArticle, QStringLiteral("first")));
+    first->insert(Entry::ftJournal, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Journal B"))));
+    file.append(first);
+    QSharedPointer<Entry> second(new Entry(Entry::etArticle, QStringLiteral("second")));
+    second->insert(Entry::ftJournal, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Journal A"))));
+    file.append(second);
+    file.append(QSharedPointer<Macro>(new Macro(QStringLiteral("jnl"), Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Journal C"))))));
+
+    CompletionIndex *index = file.completionIndex();
+    QCOMPARE(index->values(Entry::ftJournal), file.uniqueEntryValuesList(Entry::ftJournal));
+    QCOMPARE(index->keys(File::etEntry), QStringList() << QStringLiteral("first") << QStringLiteral("second"));
+    QCOMPARE(index->completions(Entry::ftJournal), QStringList() << QStringLiteral("Journal A") << QStringLiteral("Journal B") << QStringLiteral("jnl"));
+    QCOMPARE(index->completions(Entry::ftCrossRef), QStringList() << QStringLiteral("first") << QStringLiteral("second") << QStringLiteral("jnl"));
+
+    /// Modified and removed elements are reflected in the index
+    first->insert(Entry::ftJournal, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Journal A"))));
+    index->updateElement(first);
+    QCOMPARE(index->values(Entry::ftJournal), QStringList() << QStringLiteral("Journal A"));
+    file.removeOne(second);
+    index->removeElement(second);
+    QCOMPARE(index->values(Entry::ftJournal), QStringList() << QStringLiteral("Journal A"));
+    QCOMPARE(index->keys(File::etEntry), QStringList() << QStringLiteral("first"));
+}
+
+void KBibTeXDataTest::valueDeepCopy()
+{
+    const QSharedPointer<PlainText> plainText(new PlainText(QStringLiteral("Title")));
+    const Value value = Value() << plainText << QSharedPointer<Person>(new Person(QStringLiteral("Ada"), QStringLiteral("Lovelace"))) << QSharedPointer<MacroKey>(new MacroKey(QStringLiteral("jnl")));
+
+    const Value copy = value.deepCopy();
+    QCOMPARE(copy, value);
+    for (int i = 0; i < value.count(); ++i)
+        QVERIFY(copy[i].data() != value[i].data());
+
+    /// Modifying an item of the copy leaves the original untouched
+    copy.first().dynamicCast<PlainText>()->setText(QStringLiteral("Other Title"));
+    QCOMPARE(plainText->text(), QStringLiteral("Title"));
+}
+
+void KBibTeXDataTest::fileModelSortRoleWithoutCachedRows()
+{
+    File file;
+    QSharedPointer<Entry> proceedings(new Entry(QStringLiteral("proceedings"), QStringLiteral("proc")));
+    proceedings->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Proceedings Title"))));
+    proceedings->insert(Entry::ftYear, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("2000"))));
+    file.append(proceedings);
+    QSharedPointer<Entry> paper(new Entry(Entry::etInProceedings, QStringLiteral("paper")));
+    paper->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Paper Title"))));
+    paper->insert(Entry::ftAuthor, Value() << QSharedPointer<Person>(new Person(QStringLiteral("Ada"), QStringLiteral("Lovelace"))));
+    paper->insert(Entry::ftCrossRef, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("proc"))));
+    file.append(paper);
+    file.append(QSharedPointer<Macro>(new Macro(QStringLiteral("jnl"), Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Journal"))))));
+
+    FileModel model;
+    model.setBibliographyFile(&file);
+    QVERIFY(model.columnCount() > 0);
+
+    /// Sort data computed for single cells, before any row got cached,
+    /// must match sort data taken from the cached rows
+    QVector<QVariant> uncached;
+    for (int row = 0; row < model.rowCount(); ++row)
+        for (int column = 0; column < model.columnCount(); ++column)
+            uncached.append(model.data(model.index(row, column), FileModel::SortRole));
+    int i = 0;
+    for (int row = 0; row < model.rowCount(); ++row)
+        for (int column = 0; column < model.columnCount(); ++column) {
+            const QModelIndex index = model.index(row, column);
+            model.data(index, Qt::DisplayRole);
+            QCOMPARE(model.data(index, FileModel::SortRole), uncached[i++]);
+        }
+}
+
+void KBibTeXDataTest::fileModelCrossrefTargetModified()
+{
+    int yearColumn = -1;
+    const BibTeXFields *bibtexFields = BibTeXFields::self();
+    for (int column = 0; yearColumn < 0 && column < bibtexFields->count(); ++column)
+        if (bibtexFields->at(column).upperCamelCase.toLower() == Entry::ftYear)
+            yearColumn = column;
+    QVERIFY(yearColumn >= 0);
+
+    File file;
+    QSharedPointer<Entry> proceedings(new Entry(QStringLiteral("proceedings"), QStringLiteral("proc")));
+    proceedings->insert(Entry::ftYear, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("2000"))));
+    file.append(proceedings);
+    QSharedPointer<Entry> paper(new Entry(Entry::etInProceedings, QStringLiteral("paper")));
+    paper->insert(Entry::ftCrossRef, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("proc"))));
+    file.append(paper);
+    QSharedPointer<Entry> other(new Entry(Entry::etInProceedings, QStringLiteral("other")));
+    other->insert(Entry::ftCrossRef, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("missing"))));
+    file.append(other);
+
+    FileModel model;
+    model.setBibliographyFile(&file);
+    /// The paper's year is inherited from the proceedings
+    QCOMPARE(model.data(model.index(1, yearColumn)).toString(), QStringLiteral("2000"));
+    QVERIFY(model.data(model.index(2, yearColumn)).toString().isEmpty());
+
+    /// Modifying the crossref'ed entry invalidates the resolved paper
+    proceedings->insert(Entry::ftYear, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("2001"))));
+    model.elementChanged(0);
+    QCOMPARE(model.data(model.index(1, yearColumn)).toString(), QStringLiteral("2001"));
+
+    /// Inserting an entry with a key looked up before invalidates
+    /// the entry which could not be resolved back then
+    QSharedPointer<Entry> missing(new Entry(QStringLiteral("proceedings"), QStringLiteral("missing")));
+    missing->insert(Entry::ftYear, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("1999"))));
+    QVERIFY(model.insertRow(missing, 3));
+    QCOMPARE(model.data(model.index(2, yearColumn)).toString(), QStringLiteral("1999"));
+}
+
+void KBibTeXDataTest::fileModelInsertElements()
+{
+    File file;
+    QSharedPointer<Entry> first(new Entry(Entry::etArticle, QStringLiteral("first")));
+    QSharedPointer<Entry> last(new Entry(Entry::etArticle, QStringLiteral("last")));
+    file.append(first);
+    file.append(last);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    QSignalSpy rowsInsertedSpy(&model, &FileModel::rowsInserted);
+
+    /// Ids and keys may clash with existing elements and with each other
+    QSharedPointer<Entry> duplicate1(new Entry(Entry::etBook, QStringLiteral("first")));
+    QSharedPointer<Entry> duplicate2(new Entry(Entry::etBook, QStringLiteral("first")));
+    QSharedPointer<Macro> macro(new Macro(QStringLiteral("last"), Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Text")))));
+    QSharedPointer<Entry> unique(new Entry(Entry::etBook, QStringLiteral("unique")));
+    QVERIFY(model.insertElements(QList<QSharedPointer<Element> >() << duplicate1 << duplicate2 << macro << unique, 1));
+
+    /// All elements get inserted as one block with a single notification
+    QCOMPARE(rowsInsertedSpy.count(), 1);
+    QCOMPARE(rowsInsertedSpy.first().at(1).toInt(), 1);
+    QCOMPARE(rowsInsertedSpy.first().at(2).toInt(), 4);
+    QCOMPARE(model.rowCount(), 6);
+    QCOMPARE(model.element(0), QSharedPointer<Element>(first));
+    QCOMPARE(model.element(1), QSharedPointer<Element>(duplicate1));
+    QCOMPARE(model.element(4), QSharedPointer<Element>(unique));
+    QCOMPARE(model.element(5), QSharedPointer<Element>(last));
+
+    QCOMPARE(duplicate1->id(), QStringLiteral("first_2"));
+    QCOMPARE(duplicate2->id(), QStringLiteral("first_3"));
+    QCOMPARE(macro->key(), QStringLiteral("last_2"));
+    QCOMPARE(unique->id(), QStringLiteral("unique"));
+    QCOMPARE(first->id(), QStringLiteral("first"));
+}
+
+void KBibTeXDataTest::fileModelRemoveRowList()
+{
+    File file;
+    for (int i = 0; i < 7; ++i)
+        file.append(QSharedPointer<Entry>(new Entry(Entry::etArticle, QString(QStringLiteral("entry%1")).arg(i))));
+    const QSharedPointer<Element> kept2 = file.at(2), kept6 = file.at(6);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    QSignalSpy rowsAboutToBeRemovedSpy(&model, &FileModel::rowsAboutToBeRemoved);
+
+    /// Unordered rows, given more than once, form two contiguous ranges
+    QVERIFY(model.removeRowList(QList<int>() << 4 << 0 << 5 << 1 << 3 << 4));
+
+    /// Each range gets removed with a single notification, bottom-most first
+    QCOMPARE(rowsAboutToBeRemovedSpy.count(), 2);
+    QCOMPARE(rowsAboutToBeRemovedSpy.at(0).at(1).toInt(), 3);
+    QCOMPARE(rowsAboutToBeRemovedSpy.at(0).at(2).toInt(), 5);
+    QCOMPARE(rowsAboutToBeRemovedSpy.at(1).at(1).toInt(), 0);
+    QCOMPARE(rowsAboutToBeRemovedSpy.at(1).at(2).toInt(), 1);
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(model.element(0), kept2);
+    QCOMPARE(model.element(1), kept6);
+
+    /// Rows out of range leave the model untouched
+    QVERIFY(!model.removeRowList(QList<int>() << 0 << 2));
+    QCOMPARE(model.rowCount(), 2);
+}
+
+void KBibTeXDataTest::fileModelReplaceElements()
+{
+    File file;
+    for (int i = 0; i < 4; ++i)
+        file.append(QSharedPointer<Entry>(new Entry(Entry::etArticle, QString(QStringLiteral("entry%1")).arg(i))));
+    const QSharedPointer<Element> original0 = file.at(0), original1 = file.at(1), original3 = file.at(3);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    QSignalSpy rowsInsertedSpy(&model, &FileModel::rowsInserted);
+    QSignalSpy rowsAboutToBeRemovedSpy(&model, &FileModel::rowsAboutToBeRemoved);
+    QSignalSpy dataChangedSpy(&model, &FileModel::dataChanged);
+
+    QMap<int, QSharedPointer<Element> > replacements;
+    const QSharedPointer<Element> replacement0(new Entry(Entry::etBook, QStringLiteral("replacement0")));
+    const QSharedPointer<Element> replacement2(new Entry(Entry::etBook, QStringLiteral("replacement2")));
+    replacements.insert(2, replacement2);
+    replacements.insert(0, replacement0);
+    QVERIFY(model.replaceElements(replacements));
+
+    /// Replaced elements keep their rows; views see modified rows only
+    QCOMPARE(rowsInsertedSpy.count(), 0);
+    QCOMPARE(rowsAboutToBeRemovedSpy.count(), 0);
+    QCOMPARE(dataChangedSpy.count(), 2);
+    QCOMPARE(model.rowCount(), 4);
+    QCOMPARE(model.element(0), replacement0);
+    QCOMPARE(model.element(1), original1);
+    QCOMPARE(model.element(2), replacement2);
+    QCOMPARE(model.element(3), original3);
+
+    model.journal()->undo();
+    QCOMPARE(model.element(0), original0);
+    QCOMPARE(model.element(3), original3);
+}
+
+void KBibTeXDataTest::undoJournalEntryModification()
+{
+    File file;
+    QSharedPointer<Entry> entry(new Entry(Entry::etArticle, QStringLiteral("first")));
+    entry->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Title"))));
+    file.append(entry);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    UndoJournal *journal = model.journal();
+
+    journal->beginOperation(QStringLiteral("Edit"));
+    journal->aboutToModify(entry);
+    /// Value items modified in place must not alter the journal's copies
+    entry->value(Entry::ftTitle).first().dynamicCast<PlainText>()->setText(QStringLiteral("Other Title"));
+    entry->insert(Entry::ftYear, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("2000"))));
+    entry->setId(QStringLiteral("second"));
+    journal->endOperation();
+    QVERIFY(journal->canUndo());
+    QCOMPARE(journal->undoLabel(), QStringLiteral("Edit"));
+
+    journal->undo();
+    QCOMPARE(PlainTextValue::text(entry->value(Entry::ftTitle)), QStringLiteral("Title"));
+    QVERIFY(!entry->contains(Entry::ftYear));
+    QCOMPARE(entry->id(), QStringLiteral("first"));
+    QVERIFY(!journal->canUndo());
+    QVERIFY(journal->canRedo());
+
+    journal->redo();
+    QCOMPARE(PlainTextValue::text(entry->value(Entry::ftTitle)), QStringLiteral("Other Title"));
+    QCOMPARE(PlainTextValue::text(entry->value(Entry::ftYear)), QStringLiteral("2000"));
+    QCOMPARE(entry->id(), QStringLiteral("second"));
+
+    /// Announced, but unchanged entries do not make an operation
+    journal->beginOperation(QStringLiteral("Nothing"));
+    journal->aboutToModify(entry);
+    journal->endOperation();
+    QCOMPARE(journal->undoLabel(), QStringLiteral("Edit"));
+}
+
+void KBibTeXDataTest::undoJournalInsertionAndRemoval()
+{
+    File file;
+    QSharedPointer<Entry> first(new Entry(Entry::etArticle, QStringLiteral("first")));
+    QSharedPointer<Entry> second(new Entry(Entry::etArticle, QStringLiteral("second")));
+    file.append(first);
+    file.append(second);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    UndoJournal *journal = model.journal();
+
+    QSharedPointer<Entry> inserted(new Entry(Entry::etBook, QStringLiteral("inserted")));
+    QVERIFY(model.insertRow(inserted, 1));
+    QCOMPARE(model.rowCount(), 3);
+    journal->undo();
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(model.element(1), QSharedPointer<Element>(second));
+    journal->redo();
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(model.element(1), QSharedPointer<Element>(inserted));
+
+    QVERIFY(model.removeRowList(QList<int>() << 0 << 2));
+    QCOMPARE(model.rowCount(), 1);
+    journal->undo();
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(model.element(0), QSharedPointer<Element>(first));
+    QCOMPARE(model.element(1), QSharedPointer<Element>(inserted));
+    QCOMPARE(model.element(2), QSharedPointer<Element>(second));
+    journal->redo();
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.element(0), QSharedPointer<Element>(inserted));
+}
+
+void KBibTeXDataTest::undoJournalGroupedOperation()
+{
+    File file;
+    QSharedPointer<Entry> entry(new Entry(Entry::etArticle, QStringLiteral("first")));
+    file.append(entry);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    UndoJournal *journal = model.journal();
+
+    journal->beginOperation(QStringLiteral("Outer"));
+    QVERIFY(model.insertRow(QSharedPointer<Entry>(new Entry(Entry::etBook, QStringLiteral("inserted"))), 1));
+    journal->aboutToModify(entry, Entry::ftTitle);
+    entry->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Title"))));
+    /// Operations are not available while the outer one is recorded
+    QVERIFY(!journal->canUndo());
+    journal->endOperation();
+
+    /// Nested operations get undone and redone as a whole
+    QCOMPARE(journal->undoLabel(), QStringLiteral("Outer"));
+    journal->undo();
+    QCOMPARE(model.rowCount(), 1);
+    QVERIFY(!entry->contains(Entry::ftTitle));
+    QVERIFY(!journal->canUndo());
+    journal->redo();
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(PlainTextValue::text(entry->value(Entry::ftTitle)), QStringLiteral("Title"));
+
+    /// A new operation discards operations which could be redone
+    journal->undo();
+    QVERIFY(model.removeRow(0));
+    QVERIFY(!journal->canRedo());
+}
+
+void KBibTeXDataTest::undoJournalMacroModification()
+{
+    File file;
+    QSharedPointer<Macro> macro(new Macro(QStringLiteral("jnl"), Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Journal")))));
+    file.append(macro);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    UndoJournal *journal = model.journal();
+
+    journal->beginOperation(QStringLiteral("Edit"));
+    journal->aboutToModify(QSharedPointer<Element>(macro));
+    macro->setKey(QStringLiteral("journal"));
+    macro->value().first().dynamicCast<PlainText>()->setText(QStringLiteral("Other Journal"));
+    journal->endOperation();
+
+    journal->undo();
+    QCOMPARE(macro->key(), QStringLiteral("jnl"));
+    QCOMPARE(PlainTextValue::text(macro->value()), QStringLiteral("Journal"));
+    journal->redo();
+    QCOMPARE(macro->key(), QStringLiteral("journal"));
+    QCOMPARE(PlainTextValue::text(macro->value()), QStringLiteral("Other Journal"));
+}
+
+void KBibTeXDataTest::undoJournalColorLabelModification()
+{
+    File file;
+    QSharedPointer<Entry> colored(new Entry(Entry::etArticle, QStringLiteral("colored")));
+    colored->insert(Entry::ftColor, Value() << QSharedPointer<VerbatimText>(new VerbatimText(QStringLiteral("#ff0000"))));
+    QSharedPointer<Entry> plain(new Entry(Entry::etArticle, QStringLiteral("plain")));
+    file.append(colored);
+    file.append(plain);
+    FileModel model;
+    model.setBibliographyFile(&file);
+    UndoJournal *journal = model.journal();
+
+    /// An earlier operation which must survive undoing the color change
+    QVERIFY(model.insertRow(QSharedPointer<Entry>(new Entry(Entry::etBook, QStringLiteral("inserted"))), 2));
+
+    /// Same steps as ColorLabelContextMenu::colorActivated performs on all selected rows
+    journal->beginOperation(QStringLiteral("Set Color Label"));
+    for (int row = 0; row < 2; ++row) {
+        QSharedPointer<Entry> entry = model.element(row).dynamicCast<Entry>();
+        journal->aboutToModify(entry, Entry::ftColor);
+        entry->remove(Entry::ftColor);
+        entry->insert(Entry::ftColor, Value() << QSharedPointer<VerbatimText>(new VerbatimText(QStringLiteral("#00ff00"))));
+        model.elementChanged(row);
+    }
+    journal->endOperation();
+    QCOMPARE(journal->undoLabel(), QStringLiteral("Set Color Label"));
+
+    journal->undo();
+    QCOMPARE(PlainTextValue::text(colored->value(Entry::ftColor)), QStringLiteral("#ff0000"));
+    QVERIFY(!plain->contains(Entry::ftColor));
+    QCOMPARE(model.rowCount(), 3);
+    QVERIFY(journal->canUndo());
+
+    journal->redo();
+    QCOMPARE(PlainTextValue::text(colored->value(Entry::ftColor)), QStringLiteral("#00ff00"));
+    QCOMPARE(PlainTextValue::text(plain->value(Entry::ftColor)), QStringLiteral("#00ff00"));
+
+    /// Undoing both operations restores the original file
+    journal->undo();
+    journal->undo();
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(PlainTextValue::text(colored->value(Entry::ftColor)), QStringLiteral("#ff0000"));
+    QVERIFY(!journal->canUndo());
+}
+
+static FieldDescription fieldDescription(const QString &upperCamelCase, const QString &upperCamelCaseAlt, KBibTeX::TypeFlag typeFlag)
+{
+    FieldDescription fd;
+    fd.upperCamelCase = upperCamelCase;
+    fd.upperCamelCaseAlt = upperCamelCaseAlt;
+    fd.label = upperCamelCase;
+    fd.preferredTypeFlag = typeFlag;
+    fd.typeFlags = typeFlag | KBibTeX::tfSource;
+    fd.defaultWidth = 10;
+    fd.defaultVisible = true;
+    fd.typeIndependent = false;
+    return fd;
+}
+
 void KBibTeXDataTest::initTestCase()
 {
-    // TODO
+    /// Fields depend on the user's configuration, which may be missing;
+    /// install known columns so that tests on FileModel run everywhere
+    BibTeXFields *bibtexFields = BibTeXFields::self();
+    bibtexFields->clear();
+    bibtexFields->append(fieldDescription(QStringLiteral("^id"), QString(), KBibTeX::tfSource));
+    bibtexFields->append(fieldDescription(QStringLiteral("^type"), QString(), KBibTeX::tfSource));
+    bibtexFields->append(fieldDescription(QStringLiteral("Title"), QString(), KBibTeX::tfPlainText));
+    bibtexFields->append(fieldDescription(QStringLiteral("Author"), QStringLiteral("Editor"), KBibTeX::tfPerson));
+    bibtexFields->append(fieldDescription(QStringLiteral("Year"), QString(), KBibTeX::tfPlainText));
 }
 
 QTEST_MAIN(KBibTeXDataTest)
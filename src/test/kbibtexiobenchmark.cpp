@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QBuffer>
+#include <QFile>
+
+#include "value.h"
+#include "entry.h"
+#include "macro.h"
+#include "file.h"
+#include "fileexporterbibtex.h"
+#include "fileimporterbibtex.h"
+#include "fileinfo.h"
+/// Provides definition of TESTSET_DIRECTORY
+#include "test-config.h"
+
+/**
+ * Measures the time to export large bibliographies and to
+ * find references in real-world bibliographies.
+ * Not run as part of the test suite; run 'kbibtexiobenchmark'
+ * manually to compare changes to the exporters or FileInfo.
+ */
+class KBibTeXIOBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fileExporterBibTeXsave();
+    void fileInfoEntryUrls();
+    void cleanupTestCase();
+
+private:
+    File *bibTeXfile;
+};
+
+void KBibTeXIOBenchmark::initTestCase()
+{
+    static const int numEntries = 200000;
+    static const QStringList journals {QStringLiteral("Journal of Irreproducible Results"), QStringLiteral("Annals of Improbable Research"), QStringLiteral("Zeitschrift für Naturforschung")};
+
+    bibTeXfile = new File();
+    bibTeXfile->append(QSharedPointer<Macro>(new Macro(QStringLiteral("jir"), Value() << QSharedPointer<PlainText>(new PlainText(journals[0])))));
+    for (int i = 0; i < numEntries; ++i) {
+        QSharedPointer<Entry> entry(new Entry(i % 3 == 0 ? Entry::etInProceedings : Entry::etArticle, QString(QStringLiteral("author%1title%2")).arg(i % 977).arg(i)));
+        entry->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QString(QStringLiteral("On the Properties of {Café} Number %1")).arg(i))));
+        entry->insert(Entry::ftAuthor, Value() << QSharedPointer<Person>(new Person(QStringLiteral("René"), QString(QStringLiteral("Müller%1")).arg(i % 977))) << QSharedPointer<Person>(new Person(QStringLiteral("Jane"), QStringLiteral("Doe"))));
+        entry->insert(Entry::ftJournal, Value() << QSharedPointer<PlainText>(new PlainText(journals[i % journals.count()])));
+        entry->insert(Entry::ftYear, Value() << QSharedPointer<PlainText>(new PlainText(QString::number(1950 + i % 70))));
+        entry->insert(Entry::ftPages, Value() << QSharedPointer<PlainText>(new PlainText(QString(QStringLiteral("%1--%2")).arg(i % 500).arg(i % 500 + 12))));
+        entry->insert(Entry::ftDOI, Value() << QSharedPointer<VerbatimText>(new VerbatimText(QString(QStringLiteral("10.1000/%1")).arg(i))));
+        entry->insert(Entry::ftKeywords, Value() << QSharedPointer<Keyword>(new Keyword(QStringLiteral("benchmark"))) << QSharedPointer<Keyword>(new Keyword(QStringLiteral("export"))));
+        if (i % 1000 == 1)
+            entry->insert(Entry::ftCrossRef, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("author0title0"))));
+        bibTeXfile->append(entry);
+    }
+}
+
+void KBibTeXIOBenchmark::fileExporterBibTeXsave()
+{
+    FileExporterBibTeX fileExporterBibTeX(this);
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QBuffer::WriteOnly);
+        QVERIFY(fileExporterBibTeX.save(&buffer, bibTeXfile));
+    }
+}
+
+void KBibTeXIOBenchmark::fileInfoEntryUrls()
+{
+    /// Bibliography with several thousand entries from the test set
+    QFile bibFile(QLatin1String(TESTSET_DIRECTORY "/bib/digiplay.bib"));
+    if (!bibFile.open(QFile::ReadOnly))
+        QSKIP("Test set not available, set TESTSET_DIRECTORY when configuring");
+    FileImporterBibTeX importer(this);
+    QScopedPointer<File> file(importer.load(&bibFile));
+    bibFile.close();
+    QVERIFY(!file.isNull());
+
+    QList<QSharedPointer<const Entry> > entries;
+    for (const QSharedPointer<Element> &element : const_cast<const File &>(*file)) {
+        const QSharedPointer<const Entry> entry = element.dynamicCast<const Entry>();
+        if (!entry.isNull())
+            entries.append(entry);
+    }
+    QVERIFY(!entries.isEmpty());
+
+    /// Not testing for existence to measure scanning texts only
+    QBENCHMARK {
+        for (const QSharedPointer<const Entry> &entry : const_cast<const QList<QSharedPointer<const Entry> > &>(entries))
+            FileInfo::entryUrls(entry, QUrl(), FileInfo::TestExistenceNo);
+    }
+}
+
+void KBibTeXIOBenchmark::cleanupTestCase()
+{
+    delete bibTeXfile;
+}
+
+QTEST_MAIN(KBibTeXIOBenchmark)
+
+#include "kbibtexiobenchmark.moc"
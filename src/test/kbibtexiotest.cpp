@@ -18,23 +18,67 @@
 #include <QtTest>
 
 #include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QCryptographicHash>
+#include <QSignalSpy>
 
 #include "encoderxml.h"
 #include "encoderlatex.h"
 #include "value.h"
 #include "entry.h"
+#include "macro.h"
 #include "fileexporterbibtex.h"
 #include "fileexporterris.h"
 #include "fileexporterxml.h"
+#include "fileexportertoolchain.h"
 #include "file.h"
 #include "fileimporterbibtex.h"
 #include "fileimporter.h"
 #include "fileimporterris.h"
 #include "fileinfo.h"
+#include "attachmentresolver.h"
+#include "pdftextextractor.h"
+#include "pdftextindex.h"
 #include "preferences.h"
 
 Q_DECLARE_METATYPE(QMimeType)
 
+/// Runs arbitrary command lines as stages in its working directory
+class ToolchainStagesExporter : public FileExporterToolchain
+{
+public:
+    ToolchainStagesExporter()
+            : FileExporterToolchain(nullptr) {
+        /// nothing
+    }
+
+    void reloadConfig() override {
+        /// nothing
+    }
+
+    bool save(QIODevice *, const File *, QStringList * = nullptr) override {
+        return false;
+    }
+
+    bool save(QIODevice *, const QSharedPointer<const Element>, const File *, QStringList * = nullptr) override {
+        return false;
+    }
+
+    bool writeFile(const QString &filename, const QByteArray &data) {
+        QFile file(QDir(tempDir.path()).filePath(filename));
+        return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+    }
+
+    QByteArray readFile(const QString &filename) const {
+        QFile file(QDir(tempDir.path()).filePath(filename));
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+
+    bool run(const QStringList &progs, QStringList *errorLog) {
+        return runProcesses(progs, errorLog);
+    }
+};
+
 class KBibTeXIOTest : public QObject
 {
     Q_OBJECT
@@ -55,6 +99,7 @@ private slots:
     void fileInfoMimeTypeForUrl();
     void fileInfoUrlsInText_data();
     void fileInfoUrlsInText();
+    void fileInfoEntryUrlsExistence();
     QVector<QPair<const char *, File *> > fileImporterExporterTestCases();
     void fileExporterXMLsave_data();
     void fileExporterXMLsave();
@@ -62,6 +107,16 @@ private slots:
     void fileExporterRISsave();
     void fileExporterBibTeXsave_data();
     void fileExporterBibTeXsave();
+    void fileExporterBibTeXsaveLargeFile();
+    void fileExporterBibTeXreuseExporter();
+    void fileExporterToolchainSkipsUnchangedStages();
+    void pdfTextExtractorCachedText();
+    void pdfTextExtractorMergesRequests();
+    void pdfTextExtractorFailedExtraction();
+    void pdfTextIndexTokenize_data();
+    void pdfTextIndexTokenize();
+    void pdfTextIndexDocumentContains_data();
+    void pdfTextIndexDocumentContains();
     void fileImporterRISload_data();
     void fileImporterRISload();
     void fileImporterBibTeXload_data();
@@ -72,8 +127,13 @@ private slots:
     void partialBibTeXInput();
     void partialRISInput_data();
     void partialRISInput();
+    void cleanupTestCase();
 
 private:
+    QString pdfFileWithCachedText(const QString &name, const QByteArray &content, const QString &text);
+
+    QTemporaryDir pdfDirectory;
+    QStringList pdfTextCacheFilenames;
 };
 
 void KBibTeXIOTest::encoderXMLdecode_data()
@@ -212,6 +272,8 @@ void KBibTeXIOTest::fileInfoUrlsInText_data()
     QTest::addColumn<QSet<QUrl>>("expectedUrls");
 
     QTest::newRow("Empty text") << QString() << QSet<QUrl>();
+    QTest::newRow("Text without references") << QStringLiteral("On the Properties of {Caf\\'e} Number 42, by J. Doe and R. Müller, pp. 10--12") << QSet<QUrl>();
+    QTest::newRow("Domain name without scheme") << QStringLiteral("see www.example.org for details") << QSet<QUrl>{QUrl(QStringLiteral("http://www.example.org"))};
     QTest::newRow("Lore ipsum with DOI (without URL)") << QStringLiteral("Lore ipsum 10.1000/38-abc Lore ipsum") << QSet<QUrl>{QUrl(FileInfo::doiUrlPrefix() + QStringLiteral("10.1000/38-abc"))};
     QTest::newRow("Lore ipsum with DOI (with URL)") << QStringLiteral("Lore ipsum http://doi.example.org/10.1000/38-abc Lore ipsum") << QSet<QUrl>{QUrl(FileInfo::doiUrlPrefix() + QStringLiteral("10.1000/38-abc"))};
     QTest::newRow("URLs and DOI (without URL), all semicolon-separated") << QStringLiteral("http://www.example.com;10.1000/38-abc   ;\nhttps://www.example.com") << QSet<QUrl>{QUrl(QStringLiteral("http://www.example.com")), QUrl(FileInfo::doiUrlPrefix() + QStringLiteral("10.1000/38-abc")), QUrl(QStringLiteral("https://www.example.com"))};
@@ -233,6 +295,35 @@ void KBibTeXIOTest::fileInfoUrlsInText()
         QCOMPARE(extractedUrls.contains(expectedUrl), true);
 }
 
+void KBibTeXIOTest::fileInfoEntryUrlsExistence()
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    const QString directory = QDir(tempDir.path()).canonicalPath();
+    QVERIFY(QDir(directory).mkdir(QStringLiteral("refs")));
+    const QStringList filenames {QStringLiteral("/doe2018.pdf"), QStringLiteral("/refs/doe2018.ps"), QStringLiteral("/notes.txt")};
+    for (const QString &filename : filenames) {
+        QFile file(directory + filename);
+        QVERIFY(file.open(QFile::WriteOnly));
+    }
+
+    QCOMPARE(AttachmentResolver::existingFile(directory + QStringLiteral("/refs/../notes.txt")), directory + QStringLiteral("/notes.txt"));
+    QCOMPARE(AttachmentResolver::existingFile(directory + QStringLiteral("/missing.txt")), QString());
+    /// Directories are not files
+    QCOMPARE(AttachmentResolver::existingFile(directory + QStringLiteral("/refs")), QString());
+
+    QSharedPointer<Entry> entry(new Entry(Entry::etArticle, QStringLiteral("doe2018")));
+    Value value;
+    value.append(QSharedPointer<VerbatimText>(new VerbatimText(QStringLiteral("notes.txt; file:missing.pdf"))));
+    entry->insert(Entry::ftFile, value);
+    const QSet<QUrl> urls = FileInfo::entryUrls(entry, QUrl::fromLocalFile(directory + QStringLiteral("/refs.bib")), FileInfo::TestExistenceYes);
+
+    QSet<QUrl> expectedUrls;
+    for (const QString &filename : filenames)
+        expectedUrls.insert(QUrl::fromLocalFile(directory + filename));
+    QCOMPARE(urls, expectedUrls);
+}
+
 QVector<QPair<const char *, File *> > KBibTeXIOTest::fileImporterExporterTestCases()
 {
     static QVector<QPair<const char *, File *> > result;
@@ -354,6 +445,252 @@ void KBibTeXIOTest::fileExporterBibTeXsave()
     QCOMPARE(generatedData, bibTeXdata);
 }
 
+void KBibTeXIOTest::fileExporterBibTeXsaveLargeFile()
+{
+    /// Large enough to get serialized in parallel, in multiple chunks
+    static const int numEntries = 5000;
+
+    File bibTeXfile;
+    bibTeXfile.setProperty(File::Encoding, QStringLiteral("latex"));
+    QVector<QSharedPointer<const Element> > expectedOrder;
+    QSharedPointer<Entry> crossRefTarget(new Entry(Entry::etBook, QStringLiteral("proceedings")));
+    crossRefTarget->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("Proceedings"))));
+    bibTeXfile.append(crossRefTarget);
+    for (int i = 0; i < numEntries; ++i) {
+        QSharedPointer<Entry> entry(new Entry(Entry::etInProceedings, QString(QStringLiteral("entry%1")).arg(i)));
+        entry->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QString(QStringLiteral("Title %1 with \u00dcmlaut")).arg(i))));
+        entry->insert(Entry::ftAuthor, Value() << QSharedPointer<Person>(new Person(QStringLiteral("Jane"), QString(QStringLiteral("Doe%1")).arg(i))));
+        if (i % 100 == 0)
+            entry->insert(Entry::ftCrossRef, Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("proceedings"))));
+        bibTeXfile.append(entry);
+        expectedOrder << entry;
+        if (i == 0) {
+            /// Macros following the first entry have to be written before it
+            QSharedPointer<Macro> macro(new Macro(QStringLiteral("acm"), Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("ACM")))));
+            bibTeXfile.append(macro);
+            expectedOrder.prepend(macro);
+        }
+    }
+    /// Crossref'ed entries are written last
+    expectedOrder << crossRefTarget;
+
+    FileExporterBibTeX fileExporterBibTeX(this);
+    QString expectedData;
+    for (const QSharedPointer<const Element> &element : const_cast<const QVector<QSharedPointer<const Element> > &>(expectedOrder))
+        expectedData.append(fileExporterBibTeX.toString(element, &bibTeXfile));
+
+    QCOMPARE(fileExporterBibTeX.toString(&bibTeXfile), expectedData);
+}
+
+void KBibTeXIOTest::fileExporterBibTeXreuseExporter()
+{
+    QVector<QSharedPointer<const Element> > elements;
+    for (int i = 0; i < 3; ++i) {
+        QSharedPointer<Entry> entry(new Entry(Entry::etArticle, QString(QStringLiteral("article%1")).arg(i)));
+        entry->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QString(QStringLiteral("\u00dcber %1")).arg(i))));
+        entry->insert(Entry::ftAuthor, Value() << QSharedPointer<Person>(new Person(QStringLiteral("Jane"), QStringLiteral("Doe"))));
+        elements << entry;
+    }
+    elements << QSharedPointer<Macro>(new Macro(QStringLiteral("acm"), Value() << QSharedPointer<PlainText>(new PlainText(QStringLiteral("ACM")))));
+
+    /// An exporter kept for many small exports, like the clipboard's,
+    /// writes the same as a new exporter for each element
+    FileExporterBibTeX reusedExporter(this);
+    reusedExporter.setEncoding(QStringLiteral("latex"));
+    for (const QSharedPointer<const Element> &element : const_cast<const QVector<QSharedPointer<const Element> > &>(elements)) {
+        FileExporterBibTeX freshExporter(this);
+        freshExporter.setEncoding(QStringLiteral("latex"));
+        const QString expectedData = freshExporter.toString(element, nullptr);
+        QCOMPARE(reusedExporter.toString(element, nullptr), expectedData);
+        /// Forced LaTeX encoding is applied without a bibliography file
+        QVERIFY(!expectedData.contains(QChar(0x00dc)));
+    }
+}
+
+void KBibTeXIOTest::fileExporterToolchainSkipsUnchangedStages()
+{
+    if (QStandardPaths::findExecutable(QStringLiteral("cp")).isEmpty())
+        QSKIP("Program 'cp' is not available");
+
+    /// The same command line appears twice, like repeated LaTeX passes
+    const QStringList progs {QStringLiteral("cp input.txt first.txt"), QStringLiteral("cp first.txt second.txt"), QStringLiteral("cp first.txt second.txt")};
+    ToolchainStagesExporter exporter;
+    QVERIFY(exporter.writeFile(QStringLiteral("input.txt"), QByteArrayLiteral("data")));
+
+    QStringList errorLog;
+    QVERIFY(exporter.run(progs, &errorLog));
+    QCOMPARE(errorLog.filter(QStringLiteral("skipped")).count(), 0);
+    QCOMPARE(exporter.readFile(QStringLiteral("second.txt")), QByteArrayLiteral("data"));
+
+    /// Output files are kept, but do not prevent skipping any stage on unchanged input
+    QCOMPARE(exporter.readFile(QStringLiteral("first.txt")), QByteArrayLiteral("data"));
+    errorLog.clear();
+    QVERIFY(exporter.run(progs, &errorLog));
+    QCOMPARE(errorLog.filter(QStringLiteral("skipped")).count(), progs.count());
+    QCOMPARE(exporter.readFile(QStringLiteral("second.txt")), QByteArrayLiteral("data"));
+
+    /// Changed input makes all stages depending on it run again
+    QVERIFY(exporter.writeFile(QStringLiteral("input.txt"), QByteArrayLiteral("other data")));
+    errorLog.clear();
+    QVERIFY(exporter.run(progs, &errorLog));
+    QCOMPARE(errorLog.filter(QStringLiteral("skipped")).count(), 0);
+    QCOMPARE(exporter.readFile(QStringLiteral("second.txt")), QByteArrayLiteral("other data"));
+}
+
+void KBibTeXIOTest::pdfTextExtractorCachedText()
+{
+    static const QByteArray content = QByteArrayLiteral("PDF file with cached text");
+    static const QString text = QStringLiteral("Text cached under the content's hash");
+    const QString pdfFilename = pdfFileWithCachedText(QStringLiteral("cached.pdf"), content, text);
+    PDFTextExtractor &extractor = PDFTextExtractor::instance();
+    QSignalSpy textAvailableSpy(&extractor, &PDFTextExtractor::textAvailable);
+
+    QVERIFY(extractor.text(pdfFilename).isEmpty());
+    QVERIFY(extractor.isPending(pdfFilename));
+    QVERIFY(textAvailableSpy.wait());
+    QCOMPARE(textAvailableSpy.takeFirst().at(0).toString(), pdfFilename);
+    QCOMPARE(extractor.contentHash(pdfFilename), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+
+    /// Text is available right away once extracted
+    QCOMPARE(extractor.text(pdfFilename), text);
+    QVERIFY(!extractor.isPending(pdfFilename));
+
+    /// A copy with a different name has the same content, so its text is found in the cache
+    const QString copyFilename = QDir(pdfDirectory.path()).filePath(QStringLiteral("cached-copy.pdf"));
+    QVERIFY(QFile::copy(pdfFilename, copyFilename));
+    QVERIFY(extractor.text(copyFilename).isEmpty());
+    QVERIFY(textAvailableSpy.wait());
+    QCOMPARE(extractor.text(copyFilename), text);
+    QCOMPARE(extractor.contentHash(copyFilename), extractor.contentHash(pdfFilename));
+}
+
+void KBibTeXIOTest::pdfTextExtractorMergesRequests()
+{
+    const QString pdfFilename = pdfFileWithCachedText(QStringLiteral("merged.pdf"), QByteArrayLiteral("PDF file requested repeatedly"), QStringLiteral("Requested repeatedly"));
+    const QString linkFilename = QDir(pdfDirectory.path()).filePath(QStringLiteral("merged-link.pdf"));
+    if (!QFile::link(pdfFilename, linkFilename))
+        QSKIP("Cannot create symbolic links");
+    PDFTextExtractor &extractor = PDFTextExtractor::instance();
+    QSignalSpy textAvailableSpy(&extractor, &PDFTextExtractor::textAvailable);
+
+    /// Requests for the same file, even through different names, share one extraction
+    const int pendingCount = extractor.pendingCount();
+    QVERIFY(extractor.text(pdfFilename).isEmpty());
+    QVERIFY(extractor.text(pdfFilename).isEmpty());
+    QVERIFY(extractor.text(linkFilename).isEmpty());
+    QCOMPARE(extractor.pendingCount(), pendingCount + 1);
+
+    /// Each requested name gets notified once
+    QVERIFY(textAvailableSpy.wait());
+    QStringList notifiedFilenames;
+    for (int i = 0; i < textAvailableSpy.count(); ++i)
+        notifiedFilenames << textAvailableSpy.at(i).at(0).toString();
+    notifiedFilenames.sort();
+    QCOMPARE(notifiedFilenames, QStringList() << linkFilename << pdfFilename);
+    QCOMPARE(extractor.pendingCount(), pendingCount);
+    QCOMPARE(extractor.text(linkFilename), extractor.text(pdfFilename));
+}
+
+void KBibTeXIOTest::pdfTextExtractorFailedExtraction()
+{
+    /// No cached text, so extraction is attempted and fails
+    const QString pdfFilename = pdfFileWithCachedText(QStringLiteral("invalid.pdf"), QByteArrayLiteral("Not a PDF file"), QString());
+    PDFTextExtractor &extractor = PDFTextExtractor::instance();
+    QSignalSpy textAvailableSpy(&extractor, &PDFTextExtractor::textAvailable);
+
+    QVERIFY(extractor.text(pdfFilename).isEmpty());
+    QVERIFY(textAvailableSpy.wait());
+    const QString text = extractor.text(pdfFilename);
+    QVERIFY(text.contains(QStringLiteral("### Skipped as file could not be opened as PDF file ###")));
+
+    /// Text loaded from the cache later has to be the same
+    QFile cacheFile(pdfTextCacheFilenames.last());
+    QVERIFY(cacheFile.open(QFile::ReadOnly));
+    QCOMPARE(QString::fromUtf8(cacheFile.readAll()), text);
+}
+
+void KBibTeXIOTest::pdfTextIndexTokenize_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QStringList>("tokens");
+
+    QTest::newRow("Empty text") << QString() << QStringList();
+    QTest::newRow("No words") << QStringLiteral("++ -- ?!") << QStringList();
+    QTest::newRow("Lower case") << QStringLiteral("Neural NETWORKS") << QStringList {QStringLiteral("networks"), QStringLiteral("neural")};
+    QTest::newRow("Punctuation and digits") << QStringLiteral("e.g. C++11, back-propagation") << QStringList {QStringLiteral("back"), QStringLiteral("c"), QStringLiteral("e"), QStringLiteral("g"), QStringLiteral("propagation"), QStringLiteral("11")};
+    QTest::newRow("Each word once") << QStringLiteral("data data\nData") << QStringList {QStringLiteral("data")};
+    QTest::newRow("Non-ASCII letters") << QStringLiteral("Stra\u00DFe \u00C4rger") << QStringList {QStringLiteral("stra\u00DFe"), QStringLiteral("\u00E4rger")};
+}
+
+void KBibTeXIOTest::pdfTextIndexTokenize()
+{
+    QFETCH(QString, text);
+    QFETCH(QStringList, tokens);
+
+    QStringList result = PDFTextIndex::tokenize(text);
+    result.sort();
+    tokens.sort();
+    QCOMPARE(result, tokens);
+}
+
+void KBibTeXIOTest::pdfTextIndexDocumentContains_data()
+{
+    QTest::addColumn<QString>("term");
+    QTest::addColumn<bool>("contained");
+
+    QTest::newRow("Single word") << QStringLiteral("neural") << true;
+    QTest::newRow("Different case") << QStringLiteral("NEURAL") << true;
+    QTest::newRow("Part of a word") << QStringLiteral("eura") << true;
+    QTest::newRow("Missing word") << QStringLiteral("quantum") << false;
+    QTest::newRow("Several words") << QStringLiteral("neural networks") << true;
+    QTest::newRow("Several words in wrong order") << QStringLiteral("networks neural") << false;
+    QTest::newRow("Word with punctuation") << QStringLiteral("e.g.") << true;
+    QTest::newRow("Word with symbols") << QStringLiteral("C++") << true;
+    QTest::newRow("Only symbols") << QStringLiteral("++") << true;
+    QTest::newRow("Missing symbols") << QStringLiteral("--") << false;
+}
+
+void KBibTeXIOTest::pdfTextIndexDocumentContains()
+{
+    QFETCH(QString, term);
+    QFETCH(bool, contained);
+
+    /// Text is taken from the cache, so the file does not have to be a valid PDF file
+    const QString pdfFilename = pdfFileWithCachedText(QStringLiteral("index.pdf"), QByteArrayLiteral("PDF file to be indexed"), QStringLiteral("Training neural networks in C++,\ne.g. using back-propagation."));
+    PDFTextIndex &index = PDFTextIndex::instance();
+    QSignalSpy indexChangedSpy(&index, &PDFTextIndex::indexChanged);
+    while (!index.documentContains(pdfFilename, QStringLiteral("neural"))) {
+        /// Index is being loaded, or the file was not indexed yet
+        /// but got queued for indexing
+        QVERIFY(indexChangedSpy.wait());
+    }
+
+    QCOMPARE(index.documentContains(pdfFilename, term), contained);
+}
+
+QString KBibTeXIOTest::pdfFileWithCachedText(const QString &name, const QByteArray &content, const QString &text)
+{
+    const QString pdfFilename = QDir(pdfDirectory.path()).filePath(name);
+    if (QFile::exists(pdfFilename)) return pdfFilename;
+
+    QFile pdfFile(pdfFilename);
+    if (pdfFile.open(QFile::WriteOnly)) {
+        pdfFile.write(content);
+        pdfFile.close();
+    }
+
+    /// Extracted text is cached under the SHA1 hash of the PDF file's content
+    const QString cacheFilename = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/pdftotext/") + QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex()) + QStringLiteral(".txt");
+    QFile cacheFile(cacheFilename);
+    if (!text.isNull() && QDir().mkpath(QFileInfo(cacheFilename).absolutePath()) && cacheFile.open(QFile::WriteOnly)) {
+        cacheFile.write(text.toUtf8());
+        cacheFile.close();
+    }
+    pdfTextCacheFilenames << cacheFilename;
+
+    return pdfFilename;
+}
+
 void KBibTeXIOTest::fileImporterRISload_data()
 {
     QTest::addColumn<QByteArray>("risData");
@@ -596,6 +933,10 @@ void KBibTeXIOTest::partialRISInput()
 
 void KBibTeXIOTest::initTestCase()
 {
+    /// Keep caches written by tests, e.g. of PDF files' text, apart from the user's ones
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/pdftextindex.dat"));
+
     QFile texFile(QStandardPaths::writableLocation(QStandardPaths::TempLocation) + QStringLiteral("/encoderlatex-tables.tex"));
     qDebug() << "Writing LaTeX tables to: " << texFile.fileName();
     if (texFile.open(QFile::WriteOnly)) {
@@ -606,6 +947,12 @@ void KBibTeXIOTest::initTestCase()
     qRegisterMetaType<FileImporter::MessageSeverity>();
 }
 
+void KBibTeXIOTest::cleanupTestCase()
+{
+    for (const QString &cacheFilename : const_cast<const QStringList &>(pdfTextCacheFilenames))
+        QFile::remove(cacheFilename);
+}
+
 QTEST_MAIN(KBibTeXIOTest)
 
 #include "kbibtexiotest.moc"
@@ -17,10 +17,35 @@
 
 #include <QtTest>
 
+#include <QTemporaryDir>
+#include <QCryptographicHash>
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QUrlQuery>
+#ifdef HAVE_ZOTERO
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#endif // HAVE_ZOTERO
+
 #include "onlinesearchabstract.h"
+#include "internalnetworkaccessmanager.h"
+#include "findpdfbatch.h"
+#include "file.h"
+#include "entry.h"
+#ifdef HAVE_ZOTERO
+#include "zotero/api.h"
+#include "zotero/itemstore.h"
+#include "zotero/items.h"
+#endif // HAVE_ZOTERO
 
 typedef QMap<QString, QString> FormData;
 
+Q_DECLARE_METATYPE(QSharedPointer<Entry>)
+
 class OnlineSearchDummy : public OnlineSearchAbstract
 {
     Q_OBJECT
@@ -38,6 +63,71 @@ protected:
     QString favIconUrl() const override;
 };
 
+/**
+ * Minimal HTTP server answering each request with
+ * the value of the request's query item 'q'.
+ */
+class QueryEchoServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit QueryEchoServer(QObject *parent = nullptr);
+
+private slots:
+    void newClient();
+    void readRequest();
+};
+
+/// Search engine sending one request per search, publishing the reply as an entry's id
+class OnlineSearchNetworkDummy : public OnlineSearchAbstract
+{
+    Q_OBJECT
+
+public:
+    OnlineSearchNetworkDummy(const QUrl &serverUrl, QObject *parent);
+    void startSearch(const QMap<QString, QString> &query, int numResults) override;
+    QString label() const override;
+    QUrl homepage() const override;
+
+protected:
+    QString favIconUrl() const override;
+
+private:
+    const QUrl serverUrl;
+
+private slots:
+    void downloadDone();
+};
+
+#ifdef HAVE_ZOTERO
+/**
+ * Minimal HTTP server answering requests for a Zotero
+ * library's items and deleted items like Zotero does.
+ */
+class ZoteroMockServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    int libraryVersion;
+    /// Item key -> item as JSON object, including its version
+    QMap<QString, QJsonObject> items;
+    /// Item key -> library version at which the item got deleted
+    QMap<QString, int> deletedItems;
+    /// Query strings of all requests received
+    QStringList receivedQueries;
+
+    explicit ZoteroMockServer(QObject *parent = nullptr);
+
+    void addItem(const QString &key, int version, const QString &collection, const QString &tag);
+
+private slots:
+    void newClient();
+    void readRequest();
+};
+#endif // HAVE_ZOTERO
+
 class KBibTeXNetworkingTest : public QObject
 {
     Q_OBJECT
@@ -48,8 +138,17 @@ private slots:
     void onlineSearchAbstractFormParameters();
     void onlineSearchAbstractSanitizeEntry_data();
     void onlineSearchAbstractSanitizeEntry();
+    void onlineSearchAbstractContinueSearch();
+    void onlineSearchAbstractPrefetchSearch();
+    void onlineSearchAbstractCancelPrefetchSearch();
+    void findPDFBatchSkipsProcessedEntries();
+#ifdef HAVE_ZOTERO
+    void zoteroItemStoreSynchronize();
+#endif // HAVE_ZOTERO
+    void cleanupTestCase();
 
 private:
+    QStringList filesToRemove;
 };
 
 OnlineSearchDummy::OnlineSearchDummy(QObject *parent)
@@ -61,7 +160,12 @@ OnlineSearchDummy::OnlineSearchDummy(QObject *parent)
 void OnlineSearchDummy::startSearch(const QMap<QString, QString> &query, int numResults)
 {
     Q_UNUSED(query)
-    Q_UNUSED(numResults)
+
+    /// Publish as many entries as requested, numbered consecutively
+    m_hasBeenCanceled = false;
+    for (int i = 0; i < numResults; ++i)
+        publishEntry(QSharedPointer<Entry>(new Entry(Entry::etMisc, QString(QStringLiteral("dummy%1")).arg(i))));
+    stopSearch(resultNoError);
 }
 
 QString OnlineSearchDummy::label() const
@@ -89,6 +193,161 @@ void OnlineSearchDummy::sanitizeEntry_public(QSharedPointer<Entry> entry)
     sanitizeEntry(entry);
 }
 
+QueryEchoServer::QueryEchoServer(QObject *parent)
+    : QTcpServer(parent)
+{
+    connect(this, &QTcpServer::newConnection, this, &QueryEchoServer::newClient);
+    listen(QHostAddress::LocalHost);
+}
+
+void QueryEchoServer::newClient()
+{
+    while (hasPendingConnections()) {
+        QTcpSocket *socket = nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, &QueryEchoServer::readRequest);
+        connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+    }
+}
+
+void QueryEchoServer::readRequest()
+{
+    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
+    /// Wait for the request's header to be complete
+    if (!socket->peek(65536).contains("\r\n\r\n")) return;
+    const QUrl url(QString::fromLatin1(socket->readLine().split(' ').value(1)));
+    socket->readAll();
+
+    const QByteArray body = QUrlQuery(url).queryItemValue(QStringLiteral("q")).toUtf8();
+    socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+
+OnlineSearchNetworkDummy::OnlineSearchNetworkDummy(const QUrl &_serverUrl, QObject *parent)
+    : OnlineSearchAbstract(parent), serverUrl(_serverUrl)
+{
+    /// nothing
+}
+
+void OnlineSearchNetworkDummy::startSearch(const QMap<QString, QString> &query, int numResults)
+{
+    Q_UNUSED(numResults)
+
+    m_hasBeenCanceled = false;
+    curStep = 0;
+    numSteps = 1;
+    refreshBusyProperty();
+
+    QUrl url(serverUrl);
+    QUrlQuery urlQuery;
+    urlQuery.addQueryItem(QStringLiteral("q"), query.value(queryKeyFreeText));
+    url.setQuery(urlQuery);
+    QNetworkRequest request(url);
+    QNetworkReply *reply = InternalNetworkAccessManager::instance().get(request);
+    connect(reply, &QNetworkReply::finished, this, &OnlineSearchNetworkDummy::downloadDone);
+}
+
+QString OnlineSearchNetworkDummy::label() const
+{
+    return QStringLiteral("Network Dummy Search");
+}
+
+QUrl OnlineSearchNetworkDummy::homepage() const
+{
+    return serverUrl;
+}
+
+QString OnlineSearchNetworkDummy::favIconUrl() const
+{
+    return serverUrl.toString() + QStringLiteral("favicon.ico");
+}
+
+void OnlineSearchNetworkDummy::downloadDone()
+{
+    QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
+    if (handleErrors(reply)) {
+        ++curStep;
+        publishEntry(QSharedPointer<Entry>(new Entry(Entry::etMisc, QString::fromUtf8(reply->readAll()))));
+        stopSearch(resultNoError);
+        refreshBusyProperty();
+    }
+    reply->deleteLater();
+}
+
+#ifdef HAVE_ZOTERO
+ZoteroMockServer::ZoteroMockServer(QObject *parent)
+    : QTcpServer(parent), libraryVersion(0)
+{
+    connect(this, &QTcpServer::newConnection, this, &ZoteroMockServer::newClient);
+    listen(QHostAddress::LocalHost);
+}
+
+void ZoteroMockServer::addItem(const QString &key, int version, const QString &collection, const QString &tag)
+{
+    QJsonObject data;
+    data.insert(QStringLiteral("collections"), QJsonArray {collection});
+    data.insert(QStringLiteral("tags"), QJsonArray {QJsonObject {{QStringLiteral("tag"), tag}}});
+    QJsonObject item;
+    item.insert(QStringLiteral("key"), key);
+    item.insert(QStringLiteral("version"), version);
+    item.insert(QStringLiteral("data"), data);
+    item.insert(QStringLiteral("bibtex"), QString(QStringLiteral("@misc{%1,\n  title = {Item %1}\n}\n")).arg(key));
+    items.insert(key, item);
+    libraryVersion = qMax(libraryVersion, version);
+}
+
+void ZoteroMockServer::newClient()
+{
+    while (hasPendingConnections()) {
+        QTcpSocket *socket = nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, &ZoteroMockServer::readRequest);
+        connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+    }
+}
+
+void ZoteroMockServer::readRequest()
+{
+    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
+    /// Wait for the request's header to be complete
+    if (!socket->peek(65536).contains("\r\n\r\n")) return;
+    const QUrl url(QString::fromLatin1(socket->readLine().split(' ').value(1)));
+    int ifModifiedSinceVersion = -1;
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.startsWith("If-Modified-Since-Version:"))
+            ifModifiedSinceVersion = line.mid(26).trimmed().toInt();
+    }
+    receivedQueries << url.path() + QLatin1Char('?') + url.query();
+
+    const QUrlQuery query(url);
+    const int since = query.queryItemValue(QStringLiteral("since")).toInt();
+    QByteArray status = "200 OK", headers, body;
+    if (ifModifiedSinceVersion >= libraryVersion)
+        status = "304 Not Modified";
+    else if (url.path().endsWith(QStringLiteral("/deleted"))) {
+        QJsonArray keys;
+        for (QMap<QString, int>::ConstIterator it = deletedItems.constBegin(); it != deletedItems.constEnd(); ++it)
+            if (it.value() > since)
+                keys.append(it.key());
+        body = QJsonDocument(QJsonObject {{QStringLiteral("items"), keys}}).toJson();
+    } else {
+        QJsonArray modified;
+        for (const QJsonObject &item : const_cast<const QMap<QString, QJsonObject> &>(items))
+            if (item.value(QStringLiteral("version")).toInt() > since)
+                modified.append(item);
+        const int start = query.queryItemValue(QStringLiteral("start")).toInt();
+        const int limit = query.queryItemValue(QStringLiteral("limit")).toInt();
+        QJsonArray page;
+        for (int i = start; i < modified.count() && i < start + limit; ++i)
+            page.append(modified[i]);
+        headers = "Total-Results: " + QByteArray::number(modified.count()) + "\r\n";
+        body = QJsonDocument(page).toJson();
+    }
+
+    socket->write("HTTP/1.1 " + status + "\r\nLast-Modified-Version: " + QByteArray::number(libraryVersion) + "\r\n" + headers + "Content-Type: application/json\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+#endif // HAVE_ZOTERO
+
 void KBibTeXNetworkingTest::onlineSearchAbstractFormParameters_data()
 {
     QTest::addColumn<QString>("htmlCode");
@@ -222,9 +481,213 @@ void KBibTeXNetworkingTest::onlineSearchAbstractSanitizeEntry()
     delete goodOutputEntry;
 }
 
+void KBibTeXNetworkingTest::onlineSearchAbstractContinueSearch()
+{
+    OnlineSearchDummy onlineSearch(this);
+    QSignalSpy foundEntrySpy(&onlineSearch, &OnlineSearchAbstract::foundEntry);
+    QSignalSpy stoppedSearchSpy(&onlineSearch, &OnlineSearchAbstract::stoppedSearch);
+
+    const QMap<QString, QString> query {{OnlineSearchAbstract::queryKeyFreeText, QStringLiteral("kbibtex")}};
+    onlineSearch.startSearch(query, 2);
+    QCOMPARE(foundEntrySpy.count(), 2);
+    QCOMPARE(stoppedSearchSpy.count(), 1);
+
+    /// Dummy search cannot skip results, so results already published must be suppressed
+    const OnlineSearchAbstract::ContinuationToken token {query, 2};
+    onlineSearch.continueSearch(token, 3);
+    QCOMPARE(foundEntrySpy.count(), 5);
+    QCOMPARE(stoppedSearchSpy.count(), 2);
+    for (int i = 0; i < foundEntrySpy.count(); ++i) {
+        const QSharedPointer<Entry> entry = foundEntrySpy.at(i).at(0).value<QSharedPointer<Entry> >();
+        QCOMPARE(entry->id(), QString(QStringLiteral("dummy%1")).arg(i));
+    }
+}
+
+void KBibTeXNetworkingTest::onlineSearchAbstractPrefetchSearch()
+{
+    OnlineSearchDummy onlineSearch(this);
+    QSignalSpy foundEntrySpy(&onlineSearch, &OnlineSearchAbstract::foundEntry);
+    QSignalSpy stoppedSearchSpy(&onlineSearch, &OnlineSearchAbstract::stoppedSearch);
+
+    const QMap<QString, QString> query {{OnlineSearchAbstract::queryKeyFreeText, QStringLiteral("kbibtex")}};
+    const OnlineSearchAbstract::ContinuationToken token {query, 4};
+
+    /// Prefetched results must be held back ...
+    onlineSearch.prefetchSearch(token, 4);
+    QCOMPARE(foundEntrySpy.count(), 0);
+    QCOMPARE(stoppedSearchSpy.count(), 0);
+
+    /// ... until they get requested
+    onlineSearch.continueSearch(token, 4);
+    QCOMPARE(foundEntrySpy.count(), 4);
+    QCOMPARE(foundEntrySpy.first().at(0).value<QSharedPointer<Entry> >()->id(), QStringLiteral("dummy4"));
+    QVERIFY(stoppedSearchSpy.wait());
+    QCOMPARE(stoppedSearchSpy.count(), 1);
+}
+
+void KBibTeXNetworkingTest::onlineSearchAbstractCancelPrefetchSearch()
+{
+    QueryEchoServer server(this);
+    QVERIFY(server.isListening());
+    OnlineSearchNetworkDummy onlineSearch(QUrl(QString(QStringLiteral("http://127.0.0.1:%1/")).arg(server.serverPort())), this);
+    QSignalSpy foundEntrySpy(&onlineSearch, &OnlineSearchAbstract::foundEntry);
+    QSignalSpy stoppedSearchSpy(&onlineSearch, &OnlineSearchAbstract::stoppedSearch);
+
+    const QMap<QString, QString> oldQuery {{OnlineSearchAbstract::queryKeyFreeText, QStringLiteral("old")}};
+    const QMap<QString, QString> newQuery {{OnlineSearchAbstract::queryKeyFreeText, QStringLiteral("new")}};
+    onlineSearch.prefetchSearch(OnlineSearchAbstract::ContinuationToken {oldQuery, 0}, 1);
+    QVERIFY(onlineSearch.busy());
+
+    /// A new search cancels prefetching first, while its request is still in flight
+    onlineSearch.cancel();
+    QVERIFY(!onlineSearch.busy());
+    QCOMPARE(stoppedSearchSpy.count(), 0);
+    onlineSearch.startSearch(newQuery, 1);
+    QVERIFY(stoppedSearchSpy.wait());
+    /// Give a late reply to the prefetching request the chance to arrive
+    QTest::qWait(250);
+    QCOMPARE(stoppedSearchSpy.count(), 1);
+    QCOMPARE(stoppedSearchSpy.first().at(0).toInt(), OnlineSearchAbstract::resultNoError);
+    QCOMPARE(foundEntrySpy.count(), 1);
+    QCOMPARE(foundEntrySpy.first().at(0).value<QSharedPointer<Entry> >()->id(), QStringLiteral("new"));
+
+    /// A cancelled regular search gets reported as stopped right away, and only once
+    onlineSearch.startSearch(oldQuery, 1);
+    onlineSearch.cancel();
+    QCOMPARE(stoppedSearchSpy.count(), 2);
+    QCOMPARE(stoppedSearchSpy.last().at(0).toInt(), OnlineSearchAbstract::resultCancelled);
+    QTest::qWait(250);
+    QCOMPARE(stoppedSearchSpy.count(), 2);
+    QCOMPARE(foundEntrySpy.count(), 1);
+}
+
+void KBibTeXNetworkingTest::findPDFBatchSkipsProcessedEntries()
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    File bibTeXFile;
+    const QUrl bibTeXUrl = QUrl::fromLocalFile(QDir(tempDir.path()).filePath(QStringLiteral("bibliography.bib")));
+    bibTeXFile.setProperty(File::Url, bibTeXUrl);
+
+    /// Entry processed by an earlier, interrupted batch for the same bibliography
+    QSharedPointer<Entry> processedEntry(new Entry(Entry::etArticle, QStringLiteral("processed")));
+    const QString progressFilename = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/findpdfbatch/") + QString::fromLatin1(QCryptographicHash::hash(bibTeXUrl.toString().toUtf8(), QCryptographicHash::Sha1).toHex()) + QStringLiteral(".txt");
+    filesToRemove << progressFilename;
+    QVERIFY(QDir().mkpath(QFileInfo(progressFilename).absolutePath()));
+    QFile progressFile(progressFilename);
+    QVERIFY(progressFile.open(QFile::WriteOnly));
+    progressFile.write("processed\n");
+    progressFile.close();
+
+    /// Entry with a PDF file named after its id next to the bibliography
+    QSharedPointer<Entry> entryWithPDF(new Entry(Entry::etArticle, QStringLiteral("withpdf")));
+    QFile pdfFile(QDir(tempDir.path()).filePath(QStringLiteral("withpdf.pdf")));
+    QVERIFY(pdfFile.open(QFile::WriteOnly));
+    pdfFile.close();
+
+    FindPDFBatch batch(&bibTeXFile);
+    QSignalSpy progressSpy(&batch, &FindPDFBatch::progress);
+    QSignalSpy finishedSpy(&batch, &FindPDFBatch::finished);
+    QVERIFY(batch.start(QList<QSharedPointer<Entry> >() << processedEntry << entryWithPDF));
+
+    /// Both entries get skipped, so the batch completes without any search
+    /// once the entry's files have been tested in the background
+    QVERIFY(batch.isRunning());
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QVERIFY(!batch.isRunning());
+    QCOMPARE(progressSpy.count(), 1);
+    QCOMPARE(progressSpy.first().at(0).toInt(), 2);
+    QCOMPARE(progressSpy.first().at(1).toInt(), 2);
+    QCOMPARE(progressSpy.first().at(2).toInt(), 0);
+
+    /// Progress is kept for interrupted batches only
+    QVERIFY(!QFile::exists(progressFilename));
+}
+
+#ifdef HAVE_ZOTERO
+void KBibTeXNetworkingTest::zoteroItemStoreSynchronize()
+{
+    ZoteroMockServer server(this);
+    QVERIFY(server.isListening());
+    server.addItem(QStringLiteral("AAAA1111"), 1, QStringLiteral("COLL1"), QStringLiteral("red"));
+    server.addItem(QStringLiteral("BBBB2222"), 2, QStringLiteral("COLL2"), QStringLiteral("red"));
+
+    const QUrl baseUrl(QString(QStringLiteral("http://127.0.0.1:%1/users/1")).arg(server.serverPort()));
+    /// Local copy of the library is stored under the hash of the library's URL,
+    /// so a copy left behind by an earlier run on the same port has to go
+    const QString storeFilename = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/zotero/") + QString::fromLatin1(QCryptographicHash::hash(baseUrl.toString().toUtf8(), QCryptographicHash::Sha1).toHex()) + QStringLiteral(".json");
+    QFile::remove(storeFilename);
+    filesToRemove << storeFilename;
+    QSharedPointer<Zotero::API> api(new Zotero::API(baseUrl, QStringLiteral("secret"), this));
+    {
+        /// Initial synchronization fetches all items
+        Zotero::ItemStore itemStore(api, this);
+        QSignalSpy synchronizedSpy(&itemStore, &Zotero::ItemStore::synchronized);
+        itemStore.synchronize();
+        QVERIFY(synchronizedSpy.wait());
+        QCOMPARE(synchronizedSpy.first().at(0).toInt(), 0);
+        QCOMPARE(itemStore.count(), 2);
+        QCOMPARE(itemStore.libraryVersion(), 2);
+        QCOMPARE(itemStore.itemsByCollection(QStringLiteral("COLL1")).count(), 1);
+        QCOMPARE(itemStore.itemsByTag(QStringLiteral("red")).count(), 2);
+        QCOMPARE(itemStore.itemsByTag(QStringLiteral("blue")).count(), 0);
+    }
+
+    server.addItem(QStringLiteral("CCCC3333"), 3, QStringLiteral("COLL1"), QStringLiteral("blue"));
+    server.items.remove(QStringLiteral("AAAA1111"));
+    server.deletedItems.insert(QStringLiteral("AAAA1111"), 3);
+    server.receivedQueries.clear();
+    {
+        /// Local copy gets loaded from disk and only changes get fetched
+        Zotero::ItemStore itemStore(api, this);
+        QCOMPARE(itemStore.libraryVersion(), 2);
+        QSignalSpy synchronizedSpy(&itemStore, &Zotero::ItemStore::synchronized);
+        itemStore.synchronize();
+        QVERIFY(synchronizedSpy.wait());
+        QCOMPARE(synchronizedSpy.first().at(0).toInt(), 0);
+        QCOMPARE(server.receivedQueries.count(), 2);
+        QVERIFY(server.receivedQueries.first().contains(QStringLiteral("since=2")));
+        QCOMPARE(itemStore.count(), 2);
+        QCOMPARE(itemStore.libraryVersion(), 3);
+        QCOMPARE(itemStore.itemsByCollection(QStringLiteral("COLL1")).count(), 1);
+        QCOMPARE(itemStore.itemsByTag(QStringLiteral("blue")).count(), 1);
+
+        /// Unmodified library requires a single request only
+        server.receivedQueries.clear();
+        itemStore.synchronize();
+        QVERIFY(synchronizedSpy.wait());
+        QCOMPARE(server.receivedQueries.count(), 1);
+        QCOMPARE(itemStore.count(), 2);
+        QCOMPARE(itemStore.libraryVersion(), 3);
+    }
+
+    {
+        /// Requests made while synchronizing are all served afterwards
+        Zotero::Items items(api, this);
+        QSignalSpy foundElementSpy(&items, &Zotero::Items::foundElement);
+        QSignalSpy stoppedSearchSpy(&items, &Zotero::Items::stoppedSearch);
+        items.retrieveItemsByCollection(QStringLiteral("COLL1"));
+        items.retrieveItemsByTag(QStringLiteral("red"));
+        QVERIFY(stoppedSearchSpy.wait());
+        QCOMPARE(stoppedSearchSpy.count(), 2);
+        QCOMPARE(foundElementSpy.count(), 2);
+        QCOMPARE(foundElementSpy.at(0).at(0).value<QSharedPointer<Element> >().dynamicCast<Entry>()->id(), QStringLiteral("CCCC3333"));
+        QCOMPARE(foundElementSpy.at(1).at(0).value<QSharedPointer<Element> >().dynamicCast<Entry>()->id(), QStringLiteral("BBBB2222"));
+    }
+}
+#endif // HAVE_ZOTERO
+
 void KBibTeXNetworkingTest::initTestCase()
 {
-    // TODO
+    QStandardPaths::setTestModeEnabled(true);
+    qRegisterMetaType<QSharedPointer<Entry> >("QSharedPointer<Entry>");
+    qRegisterMetaType<QSharedPointer<Element> >("QSharedPointer<Element>");
+}
+
+void KBibTeXNetworkingTest::cleanupTestCase()
+{
+    for (const QString &filename : const_cast<const QStringList &>(filesToRemove))
+        QFile::remove(filename);
 }
 
 QTEST_MAIN(KBibTeXNetworkingTest)
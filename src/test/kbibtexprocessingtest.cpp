@@ -0,0 +1,294 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2018 by Thomas Fischer <fischer@unix-ag.uni-kl.de> *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QStandardPaths>
+
+#include "checkbibtex.h"
+#include "journalabbreviations.h"
+#include "idsuggestions.h"
+
+/// Journal field of each entry as plain text
+static QStringList journalNames(const QVector<QSharedPointer<Entry> > &entries)
+{
+    QStringList result;
+    for (const QSharedPointer<Entry> &entry : entries)
+        result << PlainTextValue::text(entry->value(Entry::ftJournal));
+    return result;
+}
+
+class KBibTeXProcessingTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void checkBibTeXFindingsFromLog();
+    void journalAbbreviationsLookup_data();
+    void journalAbbreviationsLookup();
+    void journalAbbreviationsPrefixSearch();
+    void journalAbbreviationsNormalizeJournalNames();
+    void idSuggestionsFormatIds_data();
+    void idSuggestionsFormatIds();
+    void idSuggestionsMakeIdsUnique_data();
+    void idSuggestionsMakeIdsUnique();
+
+private:
+    QString journalListFilename, journalIndexFilename;
+};
+
+void KBibTeXProcessingTest::checkBibTeXFindingsFromLog()
+{
+    /// BibTeX source as written by FileExporterBibTeX,
+    /// line numbers matter for the errors in the log below
+    static const QString bibText = QStringLiteral("@string{acm = \"ACM\"}\n" // line 1
+                                   "\n"
+                                   "@article{smith2000,\n" // line 3
+                                   "\tauthor = {Smith},\n"
+                                   "\tyear = {2000}\n"
+                                   "}\n"
+                                   "\n"
+                                   "@book{doe2001,\n" // line 8
+                                   "\ttitle = {Book\n"
+                                   "}\n" // line 10
+                                   "\n"
+                                   "@proceedings{conf2000,\n" // line 12
+                                   "\tyear = {2000}\n"
+                                   "}\n");
+    /// Canned log of a BibTeX run, as found in a .blg file
+    static const QString blgText = QStringLiteral("This is BibTeX, Version 0.99d (TeX Live 2018)\n"
+                                   "The top-level auxiliary file: bibtex-to-output.aux\n"
+                                   "The style file: plain.bst\n"
+                                   "Database file #1: bibtex-to-output.bib\n"
+                                   "Illegal, another @string command---line 1 of file bibtex-to-output.bib\n"
+                                   " : @string{acm = \"ACM\"}\n"
+                                   "I'm skipping whatever remains of this command\n"
+                                   "I was expecting a `,' or a `}'---line 10 of file bibtex-to-output.bib\n"
+                                   " : }\n"
+                                   "I'm skipping whatever remains of this entry\n"
+                                   "Warning--empty journal in smith2000\n"
+                                   "Warning--empty title in conf2000\n"
+                                   "Warning--empty title in doe2001\n"
+                                   "(There were 2 error messages)\n");
+
+    /// conf2000 is only included as crossref'ed entry, but not checked itself
+    const QSet<QString> checkedIds = QSet<QString>() << QStringLiteral("smith2000") << QStringLiteral("doe2001");
+    const QVector<CheckBibTeXBatch::Finding> findings = CheckBibTeXBatch::findingsFromLog(bibText, blgText, checkedIds);
+
+    QCOMPARE(findings.count(), 4);
+    /// Errors in macros do not belong to any entry
+    QCOMPARE(findings[0].id, QString());
+    QCOMPARE(findings[0].severity, CheckBibTeX::BibTeXError);
+    QCOMPARE(findings[0].message, QStringLiteral("Illegal, another @string command"));
+    QCOMPARE(findings[1].id, QStringLiteral("doe2001"));
+    QCOMPARE(findings[1].severity, CheckBibTeX::BibTeXError);
+    QCOMPARE(findings[1].message, QStringLiteral("I was expecting a `,' or a `}'"));
+    QCOMPARE(findings[2].id, QStringLiteral("smith2000"));
+    QCOMPARE(findings[2].severity, CheckBibTeX::BibTeXWarning);
+    QVERIFY(findings[2].message.contains(QStringLiteral("journal")));
+    QCOMPARE(findings[3].id, QStringLiteral("doe2001"));
+    QCOMPARE(findings[3].severity, CheckBibTeX::BibTeXWarning);
+
+    /// A log without problems yields no findings
+    QVERIFY(CheckBibTeXBatch::findingsFromLog(bibText, QStringLiteral("This is BibTeX, Version 0.99d (TeX Live 2018)\n"), checkedIds).isEmpty());
+}
+
+void KBibTeXProcessingTest::journalAbbreviationsLookup_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<bool>("toShort");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("Full name as listed") << QStringLiteral("Journal of Physics A: Mathematical and Theoretical") << true << QStringLiteral("J. Phys. A: Math. Theor.");
+    QTest::newRow("Full name in other case and punctuation") << QStringLiteral("JOURNAL OF PHYSICS A -- mathematical and theoretical") << true << QStringLiteral("J. Phys. A: Math. Theor.");
+    QTest::newRow("Full name using '&' instead of 'and'") << QStringLiteral("Journal of Physics A: Mathematical & Theoretical") << true << QStringLiteral("J. Phys. A: Math. Theor.");
+    QTest::newRow("Full name using 'and' instead of '&'") << QStringLiteral("Physics and Society") << true << QStringLiteral("Phys. Soc.");
+    QTest::newRow("Abbreviation without punctuation") << QStringLiteral("J Phys D Appl Phys") << false << QStringLiteral("Journal of Physics D: Applied Physics");
+    QTest::newRow("Unknown full name") << QStringLiteral("Journal of Unknown Results") << true << QStringLiteral("Journal of Unknown Results");
+    QTest::newRow("Unknown abbreviation") << QStringLiteral("J. Unkn. Res.") << false << QStringLiteral("J. Unkn. Res.");
+}
+
+void KBibTeXProcessingTest::journalAbbreviationsLookup()
+{
+    QFETCH(QString, name);
+    QFETCH(bool, toShort);
+    QFETCH(QString, expected);
+
+    const JournalAbbreviations *ja = JournalAbbreviations::self();
+    QCOMPARE(toShort ? ja->toShortName(name) : ja->toLongName(name), expected);
+}
+
+void KBibTeXProcessingTest::journalAbbreviationsPrefixSearch()
+{
+    const JournalAbbreviations *ja = JournalAbbreviations::self();
+    typedef QVector<QPair<QString, QString> > NamePairs;
+
+    /// Results are sorted by normalized name, no matter the order in the list
+    const NamePairs longNames = ja->longNamesStartingWith(QStringLiteral("journal of PHYSICS"));
+    QCOMPARE(longNames, NamePairs()
+             << qMakePair(QStringLiteral("Journal of Physics A: Mathematical and Theoretical"), QStringLiteral("J. Phys. A: Math. Theor."))
+             << qMakePair(QStringLiteral("Journal of Physics B: Atomic, Molecular and Optical Physics"), QStringLiteral("J. Phys. B: At. Mol. Opt. Phys."))
+             << qMakePair(QStringLiteral("Journal of Physics D: Applied Physics"), QStringLiteral("J. Phys. D: Appl. Phys.")));
+    QCOMPARE(ja->longNamesStartingWith(QStringLiteral("Journal of Physics"), 2), longNames.mid(0, 2));
+
+    QCOMPARE(ja->shortNamesStartingWith(QStringLiteral("J. Phys. B")), NamePairs() << qMakePair(QStringLiteral("J. Phys. B: At. Mol. Opt. Phys."), QStringLiteral("Journal of Physics B: Atomic, Molecular and Optical Physics")));
+    QVERIFY(ja->longNamesStartingWith(QStringLiteral("Zeitschrift")).isEmpty());
+}
+
+void KBibTeXProcessingTest::journalAbbreviationsNormalizeJournalNames()
+{
+    const JournalAbbreviations *ja = JournalAbbreviations::self();
+    static const QStringList journals {QStringLiteral("Journal of Physics D: Applied Physics"), QStringLiteral("J. Phys. A: Math. Theor."), QStringLiteral("journal of physics d applied physics"), QStringLiteral("Journal of Unknown Results"), QStringLiteral("Ann. Phys.")};
+    QVector<QSharedPointer<Entry> > entries;
+    for (const QString &journal : journals) {
+        QSharedPointer<Entry> entry(new Entry(Entry::etArticle, QString(QStringLiteral("entry%1")).arg(entries.count())));
+        entry->insert(Entry::ftJournal, Value() << QSharedPointer<PlainText>(new PlainText(journal)));
+        entries.append(entry);
+    }
+    /// Journals given as macros are left untouched
+    QSharedPointer<Entry> entryWithMacro(new Entry(Entry::etArticle, QStringLiteral("macro")));
+    entryWithMacro->insert(Entry::ftJournal, Value() << QSharedPointer<MacroKey>(new MacroKey(QStringLiteral("jpd"))));
+    entries.append(entryWithMacro);
+
+    /// Names already abbreviated are kept, other spellings of full names get abbreviated, too
+    JournalAbbreviations::NormalizationResult result = ja->normalizeJournalNames(entries, JournalAbbreviations::nfAbbreviation);
+    QCOMPARE(journalNames(entries), QStringList() << QStringLiteral("J. Phys. D: Appl. Phys.") << QStringLiteral("J. Phys. A: Math. Theor.") << QStringLiteral("J. Phys. D: Appl. Phys.") << QStringLiteral("Journal of Unknown Results") << QStringLiteral("Ann. Phys.") << QStringLiteral("jpd"));
+    QCOMPARE(result.changedEntries, QVector<QSharedPointer<Entry> >() << entries[0] << entries[2]);
+    QCOMPARE(result.unknownNames, QStringList() << QStringLiteral("Journal of Unknown Results"));
+    QVERIFY(result.ambiguousNames.isEmpty());
+
+    /// Abbreviations shared by several journals cannot be expanded
+    result = ja->normalizeJournalNames(entries, JournalAbbreviations::nfFullName);
+    QCOMPARE(journalNames(entries), QStringList() << QStringLiteral("Journal of Physics D: Applied Physics") << QStringLiteral("Journal of Physics A: Mathematical and Theoretical") << QStringLiteral("Journal of Physics D: Applied Physics") << QStringLiteral("Journal of Unknown Results") << QStringLiteral("Ann. Phys.") << QStringLiteral("jpd"));
+    QCOMPARE(result.changedEntries, QVector<QSharedPointer<Entry> >() << entries[0] << entries[1] << entries[2]);
+    QCOMPARE(result.unknownNames, QStringList() << QStringLiteral("Journal of Unknown Results"));
+    QCOMPARE(result.ambiguousNames, QStringList() << QStringLiteral("Ann. Phys."));
+
+    /// Round trip back to abbreviations
+    result = ja->normalizeJournalNames(entries, JournalAbbreviations::nfAbbreviation);
+    QCOMPARE(journalNames(entries), QStringList() << QStringLiteral("J. Phys. D: Appl. Phys.") << QStringLiteral("J. Phys. A: Math. Theor.") << QStringLiteral("J. Phys. D: Appl. Phys.") << QStringLiteral("Journal of Unknown Results") << QStringLiteral("Ann. Phys.") << QStringLiteral("jpd"));
+    QCOMPARE(result.changedEntries, QVector<QSharedPointer<Entry> >() << entries[0] << entries[1] << entries[2]);
+
+    /// Normalizing again changes nothing
+    result = ja->normalizeJournalNames(entries, JournalAbbreviations::nfAbbreviation);
+    QVERIFY(result.changedEntries.isEmpty());
+}
+
+void KBibTeXProcessingTest::idSuggestionsFormatIds_data()
+{
+    QTest::addColumn<QString>("formatStr");
+
+    QTest::newRow("Authors and year") << QStringLiteral("A2|y");
+    QTest::newRow("Author, year, and title") << QStringLiteral("al|Y|\":|T3l");
+    QTest::newRow("Volume and pages") << QStringLiteral("a|v|\"-|p");
+    QTest::newRow("Journal and type") << QStringLiteral("J|e");
+}
+
+void KBibTeXProcessingTest::idSuggestionsFormatIds()
+{
+    QFETCH(QString, formatStr);
+
+    /// Enough entries to get formatted in parallel
+    QVector<QSharedPointer<const Entry> > entries;
+    for (int i = 0; i < 1000; ++i) {
+        QSharedPointer<Entry> entry(new Entry(Entry::etArticle, QString(QStringLiteral("entry%1")).arg(i)));
+        Value authors;
+        for (int a = 0; a <= i % 4; ++a)
+            authors << QSharedPointer<Person>(new Person(QStringLiteral("Jane"), QString(QStringLiteral("M\u00FCller%1")).arg((i + a) % 7)));
+        entry->insert(Entry::ftAuthor, authors);
+        entry->insert(Entry::ftYear, Value() << QSharedPointer<PlainText>(new PlainText(QString::number(1990 + i % 30))));
+        entry->insert(Entry::ftTitle, Value() << QSharedPointer<PlainText>(new PlainText(QString(QStringLiteral("On the Analysis of %1 Problems")).arg(i))));
+        entry->insert(Entry::ftJournal, Value() << QSharedPointer<PlainText>(new PlainText(i % 2 == 0 ? QStringLiteral("Journal of Physics D: Applied Physics") : QStringLiteral("Annals of Physics"))));
+        if (i % 3 != 0) {
+            entry->insert(Entry::ftVolume, Value() << QSharedPointer<PlainText>(new PlainText(QString::number(i % 50))));
+            entry->insert(Entry::ftPages, Value() << QSharedPointer<PlainText>(new PlainText(QString(QStringLiteral("%1--%2")).arg(i).arg(i + 10))));
+        }
+        entries.append(entry);
+    }
+
+    IdSuggestions idSuggestions;
+    const QStringList ids = idSuggestions.formatIds(entries, formatStr);
+    QCOMPARE(ids.count(), entries.count());
+    /// Same ids as formatted one by one, in the entries' order
+    for (int i = 0; i < entries.count(); ++i)
+        QCOMPARE(ids[i], idSuggestions.formatId(*entries[i], formatStr));
+}
+
+void KBibTeXProcessingTest::idSuggestionsMakeIdsUnique_data()
+{
+    QTest::addColumn<QStringList>("ids");
+    QTest::addColumn<QStringList>("existingIds");
+    QTest::addColumn<QStringList>("uniqueIds");
+
+    QTest::newRow("No collisions") << (QStringList() << QStringLiteral("smith2000") << QStringLiteral("doe2001")) << (QStringList() << QStringLiteral("jones1999")) << (QStringList() << QStringLiteral("smith2000") << QStringLiteral("doe2001"));
+    QTest::newRow("Collision with existing id") << (QStringList() << QStringLiteral("jones1999")) << (QStringList() << QStringLiteral("jones1999")) << (QStringList() << QStringLiteral("jones1999a"));
+    QTest::newRow("Collisions among ids") << (QStringList() << QStringLiteral("smith2000") << QStringLiteral("smith2000") << QStringLiteral("smith2000")) << QStringList() << (QStringList() << QStringLiteral("smith2000") << QStringLiteral("smith2000a") << QStringLiteral("smith2000b"));
+    QTest::newRow("Suffixed id already taken") << (QStringList() << QStringLiteral("smith2000") << QStringLiteral("smith2000a")) << (QStringList() << QStringLiteral("smith2000") << QStringLiteral("smith2000b")) << (QStringList() << QStringLiteral("smith2000a") << QStringLiteral("smith2000aa"));
+
+    QStringList allSingleLetterSuffixes(QStringLiteral("doe"));
+    for (char c = 'a'; c <= 'z'; ++c)
+        allSingleLetterSuffixes << QStringLiteral("doe") + QLatin1Char(c);
+    QTest::newRow("Suffixes beyond 'z'") << (QStringList() << QStringLiteral("doe") << QStringLiteral("doe")) << allSingleLetterSuffixes << (QStringList() << QStringLiteral("doeaa") << QStringLiteral("doeab"));
+}
+
+void KBibTeXProcessingTest::idSuggestionsMakeIdsUnique()
+{
+    QFETCH(QStringList, ids);
+    QFETCH(QStringList, existingIds);
+    QFETCH(QStringList, uniqueIds);
+
+    QSet<QString> existingIdSet = existingIds.toSet();
+    IdSuggestions::makeIdsUnique(ids, existingIdSet);
+    QCOMPARE(ids, uniqueIds);
+    /// Resulting ids are taken now, too
+    for (const QString &id : const_cast<const QStringList &>(uniqueIds))
+        QVERIFY(existingIdSet.contains(id));
+    QCOMPARE(existingIdSet.count(), existingIds.count() + uniqueIds.count());
+}
+
+void KBibTeXProcessingTest::initTestCase()
+{
+    /// Provide a journal abbreviation list of known contents
+    /// instead of using the one that may be installed
+    QStandardPaths::setTestModeEnabled(true);
+    journalListFilename = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/kbibtex/jabref_journalabbrevlist.txt");
+    journalIndexFilename = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/journalabbreviations.idx");
+    QFile::remove(journalIndexFilename);
+    QVERIFY(QDir().mkpath(QFileInfo(journalListFilename).absolutePath()));
+    QFile journalList(journalListFilename);
+    QVERIFY(journalList.open(QFile::WriteOnly));
+    journalList.write("# Journal abbreviations for testing\n"
+                      "Journal of Physics D: Applied Physics=J. Phys. D: Appl. Phys.\n"
+                      "Journal of Physics A: Mathematical and Theoretical=J. Phys. A: Math. Theor.\n"
+                      "Journal of Physics B: Atomic, Molecular and Optical Physics=J. Phys. B: At. Mol. Opt. Phys.;JPAPEH\n"
+                      "Physics & Society=Phys. Soc.\n"
+                      "Annals of Physics=Ann. Phys.\n"
+                      "Annalen der Physik=Ann. Phys.\n");
+    journalList.close();
+}
+
+void KBibTeXProcessingTest::cleanupTestCase()
+{
+    QFile::remove(journalListFilename);
+    QFile::remove(journalIndexFilename);
+}
+
+QTEST_MAIN(KBibTeXProcessingTest)
+
+#include "kbibtexprocessingtest.moc"